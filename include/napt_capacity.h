@@ -0,0 +1,97 @@
+/***************************************************************************************
+ *  File        : napt_capacity.h
+ *  Description : Uplink (STA) bottleneck bandwidth estimation
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  See README.md for complete setup instructions.
+ *--------------------------------------------------------------------------------------
+ ***************************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_netif_ip_addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Where the current capacity figure came from
+ */
+typedef enum {
+    HOTSPOT_CAPACITY_SOURCE_NONE = 0,     /**< No estimate yet */
+    HOTSPOT_CAPACITY_SOURCE_LOWER_BOUND,  /**< Highest rate seen without RTT inflation (link may be faster) */
+    HOTSPOT_CAPACITY_SOURCE_SATURATED,    /**< Rate delivered while RTT was inflated (queue building at the bottleneck) */
+    HOTSPOT_CAPACITY_SOURCE_PROBE,        /**< Result of hotspot_probe_uplink_capacity() */
+} hotspot_capacity_source_t;
+
+/**
+ * @brief Uplink capacity estimate
+ *
+ * Also delivered as the data of HOTSPOT_EVENT_UPLINK_CAPACITY.
+ */
+typedef struct {
+    uint32_t uplink_bps;                /**< Estimated bottleneck bandwidth, bits per second */
+    uint32_t delivered_bps;             /**< Rate sent on the STA interface during the last interval */
+    uint32_t min_rtt_us;                /**< Minimum TCP RTT seen through the uplink (propagation delay) */
+    uint32_t srtt_us;                   /**< Smoothed TCP RTT through the uplink */
+    uint32_t rtt_samples;               /**< Total RTT samples taken since the hotspot was enabled */
+    hotspot_capacity_source_t source;   /**< How uplink_bps was obtained */
+    int64_t updated_us;                 /**< esp_timer time of the last change to uplink_bps */
+} hotspot_capacity_t;
+
+/**
+ * @brief Active probe settings
+ *
+ * The probe sends a back-to-back train of UDP datagrams to an echo server
+ * (RFC 862) and measures the dispersion of the echoed train. The result is
+ * the bottleneck of the round trip, which on typical asymmetric links is
+ * the uplink.
+ */
+typedef struct {
+    esp_ip4_addr_t server;  /**< UDP echo server address */
+    uint16_t port;          /**< UDP echo server port */
+    uint16_t packet_size;   /**< Datagram payload size (max 1472) */
+    uint16_t packet_count;  /**< Number of datagrams in the train (min 2) */
+    uint32_t timeout_ms;    /**< How long to wait for echoes after the train is sent */
+} hotspot_capacity_probe_config_t;
+
+#define HOTSPOT_CAPACITY_PROBE_CONFIG_DEFAULT() { \
+    .server = { .addr = 0 },                      \
+    .port = 7,                                    \
+    .packet_size = 1200,                          \
+    .packet_count = 32,                           \
+    .timeout_ms = 1000,                           \
+}
+
+/**
+ * @brief Get the current uplink capacity estimate
+ *
+ * The estimate is built passively from traffic the hotspot already forwards:
+ * delivered throughput on the STA interface and TCP RTT through the uplink.
+ * When RTT inflates above the minimum, a queue is building at the bottleneck
+ * and the delivered rate is taken as its capacity.
+ *
+ * @param[out] out Estimate
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG if out is NULL
+ */
+esp_err_t hotspot_get_uplink_capacity(hotspot_capacity_t *out);
+
+/**
+ * @brief Run a short active capacity probe
+ *
+ * Blocks the caller for at most roughly timeout_ms. On success the result
+ * replaces the current estimate and HOTSPOT_EVENT_UPLINK_CAPACITY is posted.
+ *
+ * @param config Probe settings (server must be set)
+ * @param[out] out_bps Measured bottleneck bandwidth (may be NULL)
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_STATE if the hotspot
+ *         is not running, ESP_ERR_TIMEOUT if fewer than two echoes arrived
+ */
+esp_err_t hotspot_probe_uplink_capacity(const hotspot_capacity_probe_config_t *config, uint32_t *out_bps);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,66 @@
+/***************************************************************************************
+ *  File        : napt_dhcps.h
+ *  Description : The hotspot's DHCP server - leases and counters
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  See README.md for complete setup instructions.
+ *--------------------------------------------------------------------------------------
+ ***************************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_netif_ip_addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief One entry of the lease table
+ */
+typedef struct {
+    uint8_t mac[6];
+    esp_ip4_addr_t ip;
+    bool bound;                 /**< false: offered, released or expired, still reserved for this client */
+    uint32_t expires_in_s;      /**< Remaining lease or offer time, 0 once expired */
+} hotspot_dhcp_lease_t;
+
+/**
+ * @brief DHCP server counters since boot
+ */
+typedef struct {
+    uint32_t discovers;
+    uint32_t offers;
+    uint32_t requests;
+    uint32_t acks;
+    uint32_t naks;
+    uint32_t rapid_commits;     /**< DISCOVERs answered straight with an ACK (option 80) */
+    uint32_t releases;
+    uint32_t declines;          /**< Addresses a client found in use; held back for a while */
+    uint32_t informs;
+    uint32_t pool_exhausted;    /**< DISCOVERs left unanswered for lack of an address */
+    uint32_t nvs_writes;        /**< Lease table saves to NVS */
+    uint8_t arp_pinned;         /**< Associated clients with a static ARP entry right now */
+} hotspot_dhcp_stats_t;
+
+/**
+ * @brief Get the DHCP server counters
+ */
+esp_err_t hotspot_dhcp_get_stats(hotspot_dhcp_stats_t *stats);
+
+/**
+ * @brief List the lease table
+ *
+ * @param out   Array for the results
+ * @param max   Capacity of out
+ * @param count Set to the number of entries written
+ */
+esp_err_t hotspot_dhcp_get_leases(hotspot_dhcp_lease_t *out, size_t max, size_t *count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,62 @@
+/***************************************************************************************
+ *  File        : napt_dns_snoop.h
+ *  Description : Traffic classification from DNS answers seen by the forwarder
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  See README.md for complete setup instructions.
+ *--------------------------------------------------------------------------------------
+ ***************************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "napt_qos.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief DNS snooping statistics
+ */
+typedef struct {
+    uint32_t responses_parsed;  /**< Upstream answers inspected */
+    uint32_t bindings_added;    /**< (client, address) -> domain rule bindings recorded */
+    uint32_t bindings_active;   /**< Bindings currently unexpired */
+    uint32_t evictions;         /**< Live bindings pushed out because the table was full */
+    uint32_t packets_marked;    /**< Client packets classified through a binding */
+} hotspot_dns_snoop_stats_t;
+
+/**
+ * @brief Classify traffic to a domain (and its subdomains)
+ *
+ * When a client resolves a name matching domain through the hotspot's
+ * DNS forwarder, the returned addresses are bound to that client. Its
+ * packets to those addresses are then queued in cls by the uplink QoS
+ * scheduler. Their DSCP is left as the client set it, unless
+ * hotspot_qos_config_t::remark_dscp is set. Needs QoS enabled.
+ *
+ * CNAME chains are followed, so a rule for "googlevideo.com" also covers
+ * names that resolve through it. Rules are checked in the order they were
+ * added.
+ *
+ * @param domain Domain suffix, e.g. "zoom.us"
+ * @param cls    Class for matching traffic
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, or ESP_ERR_NO_MEM if the rule table is full
+ */
+esp_err_t hotspot_dns_class_add(const char *domain, hotspot_qos_class_t cls);
+
+/**
+ * @brief Remove all domain rules and forget existing bindings
+ */
+void hotspot_dns_class_clear(void);
+
+/**
+ * @brief Get DNS snooping statistics
+ */
+esp_err_t hotspot_dns_snoop_get_stats(hotspot_dns_snoop_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
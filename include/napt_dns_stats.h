@@ -0,0 +1,90 @@
+/***************************************************************************************
+ *  File        : napt_dns_stats.h
+ *  Description : Query statistics from the hotspot's DNS forwarder
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  See README.md for complete setup instructions.
+ *--------------------------------------------------------------------------------------
+ ***************************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_netif_ip_addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Forwarder-wide DNS statistics
+ */
+typedef struct {
+    uint32_t queries;           /**< Queries received from clients */
+    uint32_t cache_hits;        /**< Answered from the local cache */
+    uint32_t upstream_queries;  /**< Forwarded to the upstream resolver */
+    uint32_t upstream_failures; /**< Upstream timeouts or errors */
+    uint32_t upstream_dropped;  /**< Given up on to make room for newer queries (not failures) */
+    uint32_t latency_avg_us;    /**< Mean upstream round trip */
+    uint32_t latency_min_us;
+    uint32_t latency_max_us;
+    uint16_t cache_entries;     /**< Answers currently cached */
+} hotspot_dns_stats_t;
+
+/**
+ * @brief One of the most queried names
+ *
+ * From a fixed-size space-saving table: any name that received more than
+ * 1/N of all queries (N = table size) is listed, and queries - error is a
+ * guaranteed lower bound for it. Names longer than the stored length are
+ * truncated.
+ */
+typedef struct {
+    char name[64];
+    uint32_t queries;           /**< Estimated query count */
+    uint32_t error;             /**< Maximum overestimate */
+} hotspot_dns_name_stats_t;
+
+/**
+ * @brief Resolver load generated by one client
+ */
+typedef struct {
+    esp_ip4_addr_t client;
+    uint32_t queries;
+    uint32_t cache_hits;
+    uint32_t upstream_failures;
+    uint32_t latency_avg_us;    /**< Mean upstream round trip for this client's misses */
+} hotspot_dns_client_stats_t;
+
+/**
+ * @brief Get forwarder-wide DNS statistics
+ */
+esp_err_t hotspot_dns_get_stats(hotspot_dns_stats_t *stats);
+
+/**
+ * @brief Get the most queried names, most popular first
+ *
+ * @param out   Array for the results
+ * @param max   Capacity of out
+ * @param count Set to the number of entries written
+ */
+esp_err_t hotspot_dns_get_top_names(hotspot_dns_name_stats_t *out, size_t max, size_t *count);
+
+/**
+ * @brief Get per-client query statistics, busiest client first
+ *
+ * Up to HOTSPOT_DNS_STATS_CLIENTS (default 8) clients are tracked; when the
+ * table is full the least active one is replaced.
+ */
+esp_err_t hotspot_dns_get_client_stats(hotspot_dns_client_stats_t *out, size_t max, size_t *count);
+
+/**
+ * @brief Clear all DNS statistics (the cache itself is kept)
+ */
+void hotspot_dns_stats_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
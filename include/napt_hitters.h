@@ -0,0 +1,74 @@
+/***************************************************************************************
+ *  File        : napt_hitters.h
+ *  Description : Top flows and clients by forwarded bytes
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  See README.md for complete setup instructions.
+ *--------------------------------------------------------------------------------------
+ ***************************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_netif_ip_addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Bytes forwarded for one flow over the tracking window
+ *
+ * Counts are estimates from a fixed-size space-saving table: a flow that
+ * carried more than 1/N of the window's traffic (N = table size) is always
+ * listed, and bytes - error is a guaranteed lower bound for it.
+ */
+typedef struct {
+    esp_ip4_addr_t client;      /**< Hotspot client (pre-NAT address) */
+    esp_ip4_addr_t remote;      /**< Far end */
+    uint16_t client_port;
+    uint16_t remote_port;
+    uint8_t proto;              /**< IP protocol */
+    uint32_t bytes;             /**< Estimated bytes, both directions */
+    uint32_t error;             /**< Maximum overestimate in bytes */
+    uint32_t bytes_up;          /**< Client -> uplink, counted while the flow was tracked */
+    uint32_t bytes_down;        /**< Uplink -> client, counted while the flow was tracked */
+} hotspot_flow_usage_t;
+
+/**
+ * @brief Bytes forwarded for one client over the tracking window
+ */
+typedef struct {
+    esp_ip4_addr_t client;
+    uint32_t bytes;             /**< Estimated bytes, both directions */
+    uint32_t error;             /**< Maximum overestimate in bytes */
+    uint32_t bytes_up;
+    uint32_t bytes_down;
+} hotspot_client_usage_t;
+
+/**
+ * @brief Get the heaviest flows, largest first
+ *
+ * Covers roughly the last HOTSPOT_HITTERS_WINDOW_MS (default 60s). Only
+ * traffic through the hotspot's forwarding path is counted.
+ *
+ * @param out   Array for the results
+ * @param max   Capacity of out
+ * @param count Set to the number of entries written
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_STATE if tracking
+ *         has never been started, or ESP_ERR_NO_MEM
+ */
+esp_err_t hotspot_get_top_flows(hotspot_flow_usage_t *out, size_t max, size_t *count);
+
+/**
+ * @brief Get the heaviest clients, largest first
+ *
+ * Same window and semantics as hotspot_get_top_flows().
+ */
+esp_err_t hotspot_get_top_clients(hotspot_client_usage_t *out, size_t max, size_t *count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -10,10 +10,223 @@
  ***************************************************************************************/
 #pragma once
 
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_netif_ip_addr.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief Event base for hotspot notifications
+ *
+ * Register with esp_event_handler_register(HOTSPOT_EVENT, ...) on the
+ * default event loop.
+ */
+ESP_EVENT_DECLARE_BASE(HOTSPOT_EVENT);
+
+/**
+ * @brief Event IDs posted under HOTSPOT_EVENT
+ */
+typedef enum {
+    HOTSPOT_EVENT_UPLINK_CAPACITY,  /**< Uplink capacity estimate changed. Data: hotspot_capacity_t (napt_capacity.h) */
+    HOTSPOT_EVENT_ENABLE_DONE,      /**< hotspot_enable_async() finished. Data: hotspot_result_t */
+    HOTSPOT_EVENT_DISABLE_DONE,     /**< hotspot_disable_async() finished. Data: hotspot_result_t */
+    HOTSPOT_EVENT_STATE_CHANGED,    /**< hotspot_get_state() changed. Data: hotspot_state_event_t */
+    HOTSPOT_EVENT_CLIENT_JOINED,    /**< A station associated with the AP. Data: hotspot_client_event_t */
+    HOTSPOT_EVENT_CLIENT_LEFT,      /**< A station left the AP. Data: hotspot_client_event_t */
+    HOTSPOT_EVENT_UPLINK_DOWN,      /**< STA lost its connection or IP while the hotspot is up. No data */
+    HOTSPOT_EVENT_UPLINK_UP,        /**< STA got an IP again. No data */
+    HOTSPOT_EVENT_HEALTH,           /**< NAT or DNS forwarder health changed. Data: hotspot_health_t */
+    HOTSPOT_EVENT_CHANNEL_CHANGED,  /**< AP changed channel while enabled. Data: hotspot_channel_info_t */
+    HOTSPOT_EVENT_CLIENT_REJECTED,  /**< Admission control turned a station away. Data: hotspot_client_rejected_t */
+} hotspot_event_t;
+
+/**
+ * @brief Hotspot lifecycle state
+ *
+ * Stopped -> Starting -> Running <-> Degraded uplink, Running/Degraded <->
+ * Idle, Running/Degraded/Idle <-> Suspended, and any enabled state ->
+ * Stopping -> Stopped. A failed start goes straight back to Stopped.
+ */
+typedef enum {
+    HOTSPOT_STATE_STOPPED = 0,
+    HOTSPOT_STATE_STARTING,
+    HOTSPOT_STATE_RUNNING,
+    HOTSPOT_STATE_DEGRADED_UPLINK,  /**< AP is up but the STA has no connection or IP */
+    HOTSPOT_STATE_SUSPENDED,        /**< See hotspot_suspend() */
+    HOTSPOT_STATE_STOPPING,
+    HOTSPOT_STATE_IDLE,             /**< No clients for idle_timeout_s, see hotspot_config_t */
+    HOTSPOT_STATE_MAX,
+} hotspot_state_t;
+
+/**
+ * @brief Time spent in each state since boot
+ *
+ * Includes the time so far in the current state.
+ */
+typedef struct {
+    uint64_t time_ms[HOTSPOT_STATE_MAX];    /**< Indexed by hotspot_state_t */
+    uint32_t entries[HOTSPOT_STATE_MAX];    /**< Times each state was entered */
+} hotspot_state_times_t;
+
+/**
+ * @brief Data for HOTSPOT_EVENT_STATE_CHANGED
+ */
+typedef struct {
+    hotspot_state_t previous;
+    hotspot_state_t state;
+} hotspot_state_event_t;
+
+/**
+ * @brief Data for HOTSPOT_EVENT_CLIENT_JOINED / HOTSPOT_EVENT_CLIENT_LEFT
+ */
+typedef struct {
+    uint8_t mac[6];
+    uint8_t aid;            /**< Association ID assigned by the AP */
+} hotspot_client_event_t;
+
+/**
+ * @brief Data for HOTSPOT_EVENT_HEALTH
+ */
+typedef struct {
+    bool nat_enabled;
+    bool dns_ok;                /**< false after HOTSPOT_DNS_UNHEALTHY_FAILURES upstream failures in a row */
+    uint32_t dns_failures;      /**< Consecutive upstream failures */
+} hotspot_health_t;
+
+/**
+ * @brief Outcome of an asynchronous enable/disable
+ */
+typedef struct {
+    esp_err_t result;       /**< ESP_OK or the error that stopped the operation */
+    uint32_t elapsed_ms;    /**< Time spent executing the request */
+} hotspot_result_t;
+
+/**
+ * @brief Why admission control turned a station away
+ */
+typedef enum {
+    HOTSPOT_REJECT_NONE = 0,
+    HOTSPOT_REJECT_HEAP,        /**< Free internal heap below admit_min_free_heap */
+    HOTSPOT_REJECT_FLOWS,       /**< Active flows above admit_max_flows */
+    HOTSPOT_REJECT_QUEUE,       /**< QoS backlog above admit_max_queue_pct */
+    HOTSPOT_REJECT_MAX,
+} hotspot_reject_reason_t;
+
+/**
+ * @brief Data for HOTSPOT_EVENT_CLIENT_REJECTED
+ */
+typedef struct {
+    uint8_t mac[6];
+    uint8_t aid;
+    hotspot_reject_reason_t reason;
+} hotspot_client_rejected_t;
+
+/**
+ * @brief Admission control counters since boot
+ */
+typedef struct {
+    uint32_t admitted;
+    uint32_t rejected[HOTSPOT_REJECT_MAX];  /**< Indexed by hotspot_reject_reason_t ([0] unused) */
+} hotspot_admission_stats_t;
+
+/**
+ * @brief AP channel and how it relates to the uplink
+ */
+typedef struct {
+    uint8_t channel;        /**< AP primary channel */
+    uint8_t secondary;      /**< HT40 secondary channel (wifi_second_chan_t), 0 = HT20 */
+    bool aligned;           /**< Same primary channel as the STA */
+    uint32_t migrations;    /**< Times the AP changed channel while enabled (following the STA or auto channel) */
+} hotspot_channel_info_t;
+
+/**
+ * @brief Radio tuning applied while the hotspot is enabled
+ *
+ * See README.md for what each profile changes. Settings that were in place
+ * before enable are restored on disable.
+ */
+typedef enum {
+    HOTSPOT_WIFI_PROFILE_DEFAULT = 0,   /**< Leave driver settings alone */
+    HOTSPOT_WIFI_PROFILE_MAX_THROUGHPUT,/**< No STA power save, STA HT40, no 11b on the AP */
+    HOTSPOT_WIFI_PROFILE_LOW_LATENCY,   /**< No STA power save, HT20, no 11b on the AP */
+    HOTSPOT_WIFI_PROFILE_LOW_POWER,     /**< STA max modem sleep, HT20, DTIM 3 */
+} hotspot_wifi_profile_t;
+
+/**
+ * @brief Runtime hotspot configuration
+ *
+ * Start from HOTSPOT_CONFIG_DEFAULT(). Checked by hotspot_enable_with_config()
+ * and hotspot_configure(); out-of-range values are rejected, not clamped.
+ */
+typedef struct {
+    char ssid[33];                  /**< 1-32 characters */
+    char password[65];              /**< 8-64 characters, or empty for an open network */
+    uint8_t channel;                /**< 1-13, used when not following the STA */
+    bool follow_sta_channel;        /**< Put the AP on the STA's channel and keep it there */
+    bool auto_channel;              /**< Without a STA channel to follow, scan and pick the least busy channel */
+    uint8_t max_connections;        /**< 1-ESP_WIFI_MAX_CONN_NUM */
+    uint16_t beacon_interval;       /**< 100-60000 TU */
+    hotspot_wifi_profile_t wifi_profile;    /**< Applied on enable, undone on disable */
+    esp_ip4_addr_t ip;              /**< AP address, also the clients' gateway */
+    esp_ip4_addr_t netmask;         /**< Contiguous, /8 to /30 */
+    esp_ip4_addr_t dns_fallback;    /**< Upstream DNS when the STA has none */
+    uint16_t dns_task_stack;        /**< DNS forwarder stack in bytes, at least 2048 */
+    uint8_t dns_task_priority;      /**< Below configMAX_PRIORITIES */
+    int8_t dns_task_core;           /**< Core to pin the forwarder to, -1 = any */
+    uint8_t dns_max_pending;        /**< Upstream queries in flight, 1-HOTSPOT_DNS_MAX_PENDING (default 8) */
+    uint32_t admit_min_free_heap;   /**< Turn new stations away below this much free internal heap, 0 = off (suggested 32768) */
+    uint16_t admit_max_flows;       /**< ... above this many active flows (lwIP NAPT holds 512 by default), 0 = off (suggested 450) */
+    uint8_t admit_max_queue_pct;    /**< ... above this QoS backlog, percent of the queue limits, 0 = off (suggested 80) */
+    uint16_t idle_timeout_s;        /**< Go idle after this long without clients, 0 = never */
+    uint16_t idle_beacon_interval;  /**< Beacon interval while idle, beacon_interval-60000 TU */
+    bool ntp_server;                /**< Answer NTP on port 123 from a clock disciplined by ntp_upstream */
+    esp_ip4_addr_t ntp_upstream;    /**< Upstream NTP server */
+    uint16_t ntp_poll_s;            /**< Upstream poll interval, at least 16 s */
+    uint32_t dhcp_lease_s;          /**< DHCP lease time, at least 60 s; clients renew at half of it */
+    bool dhcp_rapid_commit;         /**< Answer a DISCOVER with Rapid Commit (option 80) straight with an ACK */
+} hotspot_config_t;
+
+#define HOTSPOT_CONFIG_DEFAULT() {                              \
+    .ssid = "ESP32-Hotspot",                                    \
+    .password = "esp32hotspot",                                 \
+    .channel = 1,                                               \
+    .follow_sta_channel = true,                                 \
+    .auto_channel = false,                                      \
+    .max_connections = 4,                                       \
+    .beacon_interval = 100,                                     \
+    .wifi_profile = HOTSPOT_WIFI_PROFILE_DEFAULT,               \
+    .ip = { .addr = ESP_IP4TOADDR(192, 168, 4, 1) },            \
+    .netmask = { .addr = ESP_IP4TOADDR(255, 255, 255, 0) },     \
+    .dns_fallback = { .addr = ESP_IP4TOADDR(8, 8, 8, 8) },      \
+    .dns_task_stack = 3072,                                     \
+    .dns_task_priority = 5,                                     \
+    .dns_task_core = -1,                                        \
+    .dns_max_pending = 8,                                       \
+    .admit_min_free_heap = 0,                                   \
+    .admit_max_flows = 0,                                       \
+    .admit_max_queue_pct = 0,                                   \
+    .idle_timeout_s = 0,                                        \
+    .idle_beacon_interval = 1000,                               \
+    .ntp_server = false,                                        \
+    .ntp_upstream = { .addr = ESP_IP4TOADDR(216, 239, 35, 0) }, \
+    .ntp_poll_s = 1024,                                         \
+    .dhcp_lease_s = 14400,                                      \
+    .dhcp_rapid_commit = true,                                  \
+}
+
+/**
+ * @brief Completion callback for the async API
+ *
+ * Runs in the hotspot control task. Keep it short and do not call the
+ * blocking hotspot_enable()/hotspot_disable() from it.
+ */
+typedef void (*hotspot_done_cb_t)(esp_err_t result, void *arg);
+
 /**
  * @brief Enable WiFi hotspot with internet sharing
  * 
@@ -60,9 +273,145 @@ void enable_hotspot(const char *ssid, const char *password);
  */
 void disable_hotspot(void);
 
+/**
+ * @brief Enable the hotspot and report the result
+ *
+ * Same as enable_hotspot(), blocking, but returns why it failed.
+ *
+ * @note Not from a handler on the default event loop: the AP start event it
+ *       waits for is delivered there. Use hotspot_enable_async() instead.
+ *
+ * @return ESP_OK (also if already enabled),
+ *         ESP_ERR_INVALID_STATE if the STA is not connected or when called
+ *         from the default event loop,
+ *         ESP_ERR_TIMEOUT if the AP did not start,
+ *         ESP_ERR_NO_MEM, or the error from the WiFi driver
+ */
+esp_err_t hotspot_enable(const char *ssid, const char *password);
+
+/**
+ * @brief Enable the hotspot with a full configuration
+ *
+ * The configuration also becomes the base for later enable_hotspot() /
+ * hotspot_enable() calls, which only override SSID and password.
+ * If the hotspot is already enabled this behaves like hotspot_configure().
+ *
+ * @return ESP_ERR_INVALID_ARG if config fails validation, otherwise as
+ *         hotspot_enable()
+ */
+esp_err_t hotspot_enable_with_config(const hotspot_config_t *config);
+
+/**
+ * @brief Change the configuration, applying what can be applied live
+ *
+ * While the hotspot is enabled, SSID, password, channel, client limit and
+ * beacon interval are pushed to the driver immediately (this restarts the
+ * AP, so clients reconnect). Address, netmask, DNS fallback and forwarder
+ * task settings take effect on the next enable. When the hotspot is
+ * stopped, everything is stored for the next enable.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, or the error from the WiFi driver
+ */
+esp_err_t hotspot_configure(const hotspot_config_t *config);
+
+/**
+ * @brief Get the configuration in use (or to be used by the next enable)
+ */
+esp_err_t hotspot_get_config(hotspot_config_t *config);
+
+/**
+ * @brief Get the AP channel, its alignment with the STA and the migration count
+ */
+esp_err_t hotspot_get_channel_info(hotspot_channel_info_t *info);
+
+/**
+ * @brief Get admission control counters
+ */
+esp_err_t hotspot_get_admission_stats(hotspot_admission_stats_t *stats);
+
+/**
+ * @brief Disable the hotspot and report the result
+ *
+ * @return ESP_OK, or ESP_ERR_TIMEOUT if the DNS forwarder task did not exit
+ *         in time. Everything else is stopped regardless; the next enable
+ *         waits for the forwarder again and fails with
+ *         ESP_ERR_INVALID_STATE if it is still there.
+ */
+esp_err_t hotspot_disable(void);
+
+/**
+ * @brief Enable the hotspot without blocking the caller
+ *
+ * Queues the request to a control task and returns immediately. ssid and
+ * password are copied. On completion cb (if not NULL) is called and
+ * HOTSPOT_EVENT_ENABLE_DONE is posted with a hotspot_result_t. Requests
+ * run one at a time in the order they were made.
+ *
+ * @return ESP_OK if queued, ESP_ERR_INVALID_ARG for an over-long SSID or
+ *         password, ESP_ERR_NO_MEM if the request queue is full
+ */
+esp_err_t hotspot_enable_async(const char *ssid, const char *password, hotspot_done_cb_t cb, void *arg);
+
+/**
+ * @brief Disable the hotspot without blocking the caller
+ *
+ * Completion is reported through cb and HOTSPOT_EVENT_DISABLE_DONE.
+ */
+esp_err_t hotspot_disable_async(hotspot_done_cb_t cb, void *arg);
+
+/**
+ * @brief Suspend the hotspot without tearing it down
+ *
+ * Disconnects all clients, hides the SSID, stretches the beacon interval
+ * to the maximum and drops client traffic. The AP netif, DHCP leases, DNS
+ * cache, NAT and all tasks are kept, so hotspot_resume() only has to undo
+ * the AP configuration change. Stations that try to join while suspended
+ * are disconnected straight away.
+ *
+ * @return ESP_OK (also if already suspended),
+ *         ESP_ERR_INVALID_STATE if the hotspot is not enabled,
+ *         or the error from the WiFi driver
+ */
+esp_err_t hotspot_suspend(void);
+
+/**
+ * @brief Resume a suspended hotspot
+ *
+ * hotspot_enable() on a suspended hotspot resumes it as well.
+ *
+ * @return ESP_OK (also if not suspended), ESP_ERR_INVALID_STATE if the
+ *         hotspot is not enabled, or the error from the WiFi driver
+ */
+esp_err_t hotspot_resume(void);
+
+/**
+ * @brief Check if the hotspot is enabled but suspended
+ */
+bool is_hotspot_suspended(void);
+
+/**
+ * @brief Current hotspot state
+ *
+ * A single atomic load; safe from any task or ISR and never blocks.
+ * Changes are also posted as HOTSPOT_EVENT_STATE_CHANGED.
+ */
+hotspot_state_t hotspot_get_state(void);
+
+/**
+ * @brief Get the time spent in each state, to compare e.g. Idle and Running
+ */
+esp_err_t hotspot_get_state_times(hotspot_state_times_t *times);
+
+/**
+ * @brief Name of a state, for logging
+ */
+const char *hotspot_state_name(hotspot_state_t state);
+
 /**
  * @brief Check if hotspot is currently enabled
  * 
+ * True in the Running, Degraded uplink, Idle and Suspended states.
+ *
  * @return true if hotspot is enabled, false otherwise
  */
 bool is_hotspot_enabled(void);
@@ -0,0 +1,93 @@
+/***************************************************************************************
+ *  File        : napt_mcast.h
+ *  Description : Broadcast and multicast filtering on the AP and STA segments
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  See README.md for complete setup instructions.
+ *--------------------------------------------------------------------------------------
+ ***************************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Broadcast/multicast traffic classes that can be filtered
+ *
+ * ARP, DHCP, IGMP and ICMPv6 (neighbour discovery) are never filtered.
+ */
+typedef enum {
+    HOTSPOT_MCAST_MDNS = 0,     /**< UDP 5353 */
+    HOTSPOT_MCAST_SSDP,         /**< UDP 1900 (UPnP discovery) */
+    HOTSPOT_MCAST_LLMNR,        /**< UDP 5355 */
+    HOTSPOT_MCAST_NETBIOS,      /**< UDP 137-138 */
+    HOTSPOT_MCAST_OTHER,        /**< Any other IPv4 broadcast or multicast */
+    HOTSPOT_MCAST_IPV6,         /**< IPv6 multicast other than ICMPv6 */
+    HOTSPOT_MCAST_PROTO_MAX,
+} hotspot_mcast_proto_t;
+
+/**
+ * @brief Where a frame is seen
+ */
+typedef enum {
+    HOTSPOT_MCAST_FROM_CLIENTS = 0, /**< Received on the AP */
+    HOTSPOT_MCAST_TO_CLIENTS,       /**< Sent on the AP */
+    HOTSPOT_MCAST_FROM_UPLINK,      /**< Received on the STA */
+    HOTSPOT_MCAST_TO_UPLINK,        /**< Sent on the STA */
+    HOTSPOT_MCAST_DIR_MAX,
+} hotspot_mcast_dir_t;
+
+#define HOTSPOT_MCAST_DIR_BIT(dir) (1u << (dir))
+#define HOTSPOT_MCAST_DROP_ALL 0x0f
+
+/**
+ * @brief Filter configuration
+ */
+typedef struct {
+    uint8_t drop[HOTSPOT_MCAST_PROTO_MAX];  /**< Per class, HOTSPOT_MCAST_DIR_BIT()s of the directions to drop */
+} hotspot_mcast_config_t;
+
+#define HOTSPOT_MCAST_CONFIG_DEFAULT() {    \
+    .drop = { 0 },                          \
+}
+
+/**
+ * @brief Dropped frames for one class and direction
+ */
+typedef struct {
+    uint32_t packets;
+    uint32_t bytes;
+} hotspot_mcast_counter_t;
+
+typedef struct {
+    hotspot_mcast_counter_t dropped[HOTSPOT_MCAST_PROTO_MAX][HOTSPOT_MCAST_DIR_MAX];
+} hotspot_mcast_stats_t;
+
+/**
+ * @brief Apply a filter configuration
+ *
+ * May be called at any time and takes effect with the next frame. Nothing
+ * is filtered until this is called.
+ *
+ * @return ESP_OK or ESP_ERR_INVALID_ARG
+ */
+esp_err_t hotspot_mcast_configure(const hotspot_mcast_config_t *config);
+
+/**
+ * @brief Get the active filter configuration
+ */
+esp_err_t hotspot_mcast_get_config(hotspot_mcast_config_t *config);
+
+/**
+ * @brief Get dropped frame and byte counters since boot
+ */
+esp_err_t hotspot_mcast_get_stats(hotspot_mcast_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
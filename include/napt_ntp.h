@@ -0,0 +1,58 @@
+/***************************************************************************************
+ *  File        : napt_ntp.h
+ *  Description : Local NTP server on the AP address, disciplined from upstream
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  See README.md for complete setup instructions.
+ *--------------------------------------------------------------------------------------
+ ***************************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_netif_ip_addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief NTP server state and counters
+ *
+ * The clock and its frequency estimate survive hotspot restarts; the
+ * counters run since boot.
+ */
+typedef struct {
+    bool synced;                /**< Clients get valid time (last sync within HOTSPOT_NTP_HOLDOVER_S) */
+    uint8_t stratum;            /**< Served stratum, upstream + 1; 16 while unsynced */
+    esp_ip4_addr_t upstream;    /**< Server the clock was last disciplined from */
+    int32_t offset_us;          /**< Last measured offset to upstream, before correction */
+    uint32_t delay_us;          /**< Last upstream round trip */
+    int32_t drift_ppb;          /**< Frequency correction applied to the local clock */
+    uint32_t last_sync_age_s;   /**< Since the last accepted upstream sample, 0 if never */
+    uint32_t requests;          /**< Client requests answered */
+    uint32_t unsynced_replies;  /**< ... of which marked unsynchronised (LI = 3) */
+    uint32_t upstream_polls;    /**< Requests sent upstream */
+    uint32_t upstream_failures; /**< Timeouts, kiss-o'-death and rejected replies */
+} hotspot_ntp_status_t;
+
+/**
+ * @brief Get the NTP server state
+ *
+ * Enabled with hotspot_config_t::ntp_server.
+ */
+esp_err_t hotspot_ntp_get_status(hotspot_ntp_status_t *status);
+
+/**
+ * @brief Read the disciplined clock
+ *
+ * @param unix_us Microseconds since 1970-01-01 UTC
+ * @return ESP_OK, or ESP_ERR_INVALID_STATE until the first upstream sync
+ */
+esp_err_t hotspot_ntp_get_time(int64_t *unix_us);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,142 @@
+/***************************************************************************************
+ *  File        : napt_qos.h
+ *  Description : Priority queueing of traffic forwarded to the uplink
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  See README.md for complete setup instructions.
+ *--------------------------------------------------------------------------------------
+ ***************************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Traffic classes, highest priority first
+ */
+typedef enum {
+    HOTSPOT_QOS_CLASS_VOICE = 0,    /**< Real-time media (EF) */
+    HOTSPOT_QOS_CLASS_INTERACTIVE,  /**< DNS, gaming, SSH, control traffic */
+    HOTSPOT_QOS_CLASS_BEST_EFFORT,  /**< Everything else */
+    HOTSPOT_QOS_CLASS_BULK,         /**< Background transfers (CS1) */
+    HOTSPOT_QOS_CLASS_MAX,
+} hotspot_qos_class_t;
+
+/**
+ * @brief How the classes share the uplink
+ */
+typedef enum {
+    HOTSPOT_QOS_SCHED_STRICT = 0,   /**< Always serve the highest non-empty class */
+    HOTSPOT_QOS_SCHED_WEIGHTED,     /**< Deficit round robin using weights[] */
+} hotspot_qos_sched_t;
+
+/**
+ * @brief QoS configuration
+ */
+typedef struct {
+    bool enabled;                                   /**< Queue uplink traffic (false = plain FIFO pass-through) */
+    hotspot_qos_sched_t scheduler;                  /**< Strict priority or weighted */
+    uint8_t weights[HOTSPOT_QOS_CLASS_MAX];         /**< DRR weights (quantum = weight * 1514 bytes) */
+    uint16_t queue_limit[HOTSPOT_QOS_CLASS_MAX];    /**< Max queued packets per class (tail drop) */
+    uint32_t rate_bps;                              /**< Shaper rate. 0 = follow the uplink capacity estimate */
+    uint8_t rate_percent;                           /**< Percent of the estimate to shape to when rate_bps is 0 */
+    bool prioritize_dns;                            /**< Put upstream DNS (port 53, incl. our forwarder) in INTERACTIVE */
+    bool prioritize_acks;                           /**< Send pure TCP ACKs through a lane ahead of all classes */
+    bool ack_thinning;                              /**< Drop a queued ACK when a newer one for the same flow arrives */
+    bool remark_dscp;                               /**< Rewrite DSCP on egress to remark_value[class] */
+    uint8_t remark_value[HOTSPOT_QOS_CLASS_MAX];    /**< DSCP written per class when remark_dscp is set */
+} hotspot_qos_config_t;
+
+#define HOTSPOT_QOS_CONFIG_DEFAULT() {              \
+    .enabled = true,                                \
+    .scheduler = HOTSPOT_QOS_SCHED_STRICT,          \
+    .weights = { 8, 4, 2, 1 },                      \
+    .queue_limit = { 32, 32, 64, 64 },              \
+    .rate_bps = 0,                                  \
+    .rate_percent = 90,                             \
+    .prioritize_dns = true,                         \
+    .prioritize_acks = true,                        \
+    .ack_thinning = false,                          \
+    .remark_dscp = false,                           \
+    .remark_value = { 46, 34, 0, 8 },               \
+}
+
+/**
+ * @brief Per-class queue statistics
+ */
+typedef struct {
+    uint32_t enqueued_packets;
+    uint32_t enqueued_bytes;
+    uint32_t sent_packets;
+    uint32_t sent_bytes;
+    uint32_t dropped_packets;   /**< Tail drops (queue full) */
+    uint32_t dropped_bytes;
+    uint16_t queue_packets;     /**< Current depth */
+    uint16_t queue_peak;        /**< Highest depth seen */
+    uint32_t queue_bytes;       /**< Current backlog */
+} hotspot_qos_class_stats_t;
+
+typedef struct {
+    hotspot_qos_class_stats_t cls[HOTSPOT_QOS_CLASS_MAX];
+    hotspot_qos_class_stats_t ack_lane;     /**< Pure TCP ACKs (when prioritize_acks is set) */
+    uint32_t acks_thinned;      /**< Queued ACKs replaced by a newer cumulative ACK */
+    uint32_t shaper_rate_bps;   /**< Rate currently applied, 0 = unshaped */
+    uint32_t driver_busy;       /**< Times the WiFi driver pushed back (TX buffers full) */
+} hotspot_qos_stats_t;
+
+/**
+ * @brief Apply a QoS configuration
+ *
+ * May be called at any time. Takes effect immediately if the hotspot is
+ * running; disabling drops the packets still queued. Takes the same lock
+ * as hotspot_enable()/hotspot_disable(), so do not call it from their
+ * completion callbacks.
+ *
+ * @return ESP_OK or ESP_ERR_INVALID_ARG
+ */
+esp_err_t hotspot_qos_configure(const hotspot_qos_config_t *config);
+
+/**
+ * @brief Get the active QoS configuration
+ */
+esp_err_t hotspot_qos_get_config(hotspot_qos_config_t *config);
+
+/**
+ * @brief Map a DSCP value (0-63) to a class
+ *
+ * Defaults: EF(46) -> VOICE; CS4-CS7, AF4x, AF3x -> INTERACTIVE;
+ * CS1(8) -> BULK; everything else -> BEST_EFFORT.
+ */
+esp_err_t hotspot_qos_set_dscp_class(uint8_t dscp, hotspot_qos_class_t cls);
+
+/**
+ * @brief Add a port or protocol rule
+ *
+ * Rules are checked in the order they were added, before the DSCP map.
+ * A rule matches when the IP protocol matches (0 = any) and either the
+ * source or destination port is within [port_min, port_max]. A range of
+ * 0-0 matches every packet of the protocol (e.g. ICMP).
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, or ESP_ERR_NO_MEM if the table is full
+ */
+esp_err_t hotspot_qos_add_rule(uint8_t proto, uint16_t port_min, uint16_t port_max, hotspot_qos_class_t cls);
+
+/**
+ * @brief Remove all port and protocol rules
+ */
+void hotspot_qos_clear_rules(void);
+
+/**
+ * @brief Get per-class queue statistics
+ */
+esp_err_t hotspot_qos_get_stats(hotspot_qos_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,84 @@
+/***************************************************************************************
+ *  File        : napt_reflector.h
+ *  Description : mDNS / SSDP service discovery reflector between clients and the LAN
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  See README.md for complete setup instructions.
+ *--------------------------------------------------------------------------------------
+ ***************************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Discovery protocols the reflector handles
+ */
+typedef enum {
+    HOTSPOT_REFLECT_MDNS = 0,   /**< Multicast DNS, UDP 5353 */
+    HOTSPOT_REFLECT_SSDP,       /**< UPnP discovery, UDP 1900 */
+    HOTSPOT_REFLECT_PROTO_MAX,
+} hotspot_reflect_proto_t;
+
+/**
+ * @brief Reflector configuration
+ */
+typedef struct {
+    bool enabled[HOTSPOT_REFLECT_PROTO_MAX];
+    uint8_t queries_per_s[HOTSPOT_REFLECT_PROTO_MAX];   /**< Client queries forwarded to the LAN, 1-100 (bursts of twice that) */
+    uint8_t replies_per_s[HOTSPOT_REFLECT_PROTO_MAX];   /**< Answers sent to clients, 1-100 (bursts of twice that) */
+} hotspot_reflector_config_t;
+
+#define HOTSPOT_REFLECTOR_CONFIG_DEFAULT() {    \
+    .enabled = { false, false },                \
+    .queries_per_s = { 2, 2 },                  \
+    .replies_per_s = { 20, 20 },                \
+}
+
+/**
+ * @brief Counters for one protocol since boot
+ */
+typedef struct {
+    uint32_t client_queries;    /**< Queries seen from clients */
+    uint32_t cache_answered;    /**< Queries answered from the cache, not forwarded */
+    uint32_t forwarded;         /**< Queries sent to the LAN */
+    uint32_t query_limited;     /**< Queries dropped by the rate limit or a full intake queue */
+    uint32_t responses;         /**< Responses received from the LAN */
+    uint32_t replies;           /**< Answers sent to clients */
+    uint32_t reply_limited;     /**< Answers dropped by the rate limit */
+} hotspot_reflector_proto_stats_t;
+
+typedef struct {
+    hotspot_reflector_proto_stats_t proto[HOTSPOT_REFLECT_PROTO_MAX];
+    uint16_t cache_entries;     /**< Responses currently cached */
+} hotspot_reflector_stats_t;
+
+/**
+ * @brief Apply a reflector configuration
+ *
+ * May be called at any time. The reflector runs while the hotspot is
+ * enabled and at least one protocol is.
+ *
+ * @return ESP_OK or ESP_ERR_INVALID_ARG
+ */
+esp_err_t hotspot_reflector_configure(const hotspot_reflector_config_t *config);
+
+/**
+ * @brief Get the active reflector configuration
+ */
+esp_err_t hotspot_reflector_get_config(hotspot_reflector_config_t *config);
+
+/**
+ * @brief Get reflector counters
+ */
+esp_err_t hotspot_reflector_get_stats(hotspot_reflector_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,142 @@
+/***************************************************************************************
+ *  File        : napt_stations.h
+ *  Description : Per-station radio and traffic table for the AP's clients
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  See README.md for complete setup instructions.
+ *--------------------------------------------------------------------------------------
+ ***************************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_netif_ip_addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bits of hotspot_station_info_t::phy
+#define HOTSPOT_STATION_PHY_11B  0x01
+#define HOTSPOT_STATION_PHY_11G  0x02
+#define HOTSPOT_STATION_PHY_11N  0x04
+#define HOTSPOT_STATION_PHY_LR   0x08   /**< Espressif long range */
+#define HOTSPOT_STATION_PHY_11AX 0x10
+
+/**
+ * @brief Milestones of a station's join, in the order they normally happen
+ *
+ * Times are taken from WIFI_EVENT_AP_STACONNECTED, which the driver posts
+ * once association and the 4-way handshake are done.
+ */
+typedef enum {
+    HOTSPOT_JOIN_DHCP_DISCOVER = 0, /**< First DISCOVER received */
+    HOTSPOT_JOIN_DHCP_OFFER,        /**< First OFFER sent */
+    HOTSPOT_JOIN_DHCP_REQUEST,      /**< First REQUEST received (the first DHCP message for INIT-REBOOT) */
+    HOTSPOT_JOIN_DHCP_ACK,          /**< First ACK sent (straight after DISCOVER with Rapid Commit) */
+    HOTSPOT_JOIN_FIRST_DNS,         /**< First UDP query to port 53 */
+    HOTSPOT_JOIN_FIRST_FORWARD,     /**< First packet to an address outside the AP subnet */
+    HOTSPOT_JOIN_FIRST_NAT,         /**< First packet back from outside: a NAT flow carried traffic both ways */
+    HOTSPOT_JOIN_EVENT_MAX,
+} hotspot_join_event_t;
+
+#define HOTSPOT_JOIN_NOT_REACHED UINT32_MAX
+
+/**
+ * @brief Intervals of a join that are aggregated into histograms
+ *
+ * A phase whose start milestone was skipped is measured from the one
+ * before it (e.g. FIRST_DNS from association for a static address).
+ */
+typedef enum {
+    HOTSPOT_JOIN_PHASE_DHCP_START = 0,  /**< Association -> first DISCOVER or REQUEST (client) */
+    HOTSPOT_JOIN_PHASE_OFFER,           /**< DISCOVER -> OFFER (server) */
+    HOTSPOT_JOIN_PHASE_REQUEST,         /**< OFFER -> REQUEST (client) */
+    HOTSPOT_JOIN_PHASE_ACK,             /**< REQUEST, or DISCOVER with Rapid Commit -> ACK (server) */
+    HOTSPOT_JOIN_PHASE_DNS,             /**< ACK -> first DNS query */
+    HOTSPOT_JOIN_PHASE_FORWARD,         /**< ACK -> first forwarded packet */
+    HOTSPOT_JOIN_PHASE_NAT,             /**< First forwarded packet -> first reply (uplink round trip) */
+    HOTSPOT_JOIN_PHASE_TOTAL,           /**< Association -> first reply */
+    HOTSPOT_JOIN_PHASE_MAX,
+} hotspot_join_phase_t;
+
+// Bucket 0 is below 4 ms, bucket i covers [2^(i+1), 2^(i+2)) ms, the last
+// one (16.4 s and up) is open-ended
+#define HOTSPOT_JOIN_HIST_BUCKETS 14
+
+/**
+ * @brief Distribution of one join phase
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t avg_ms;
+    uint32_t max_ms;
+    uint32_t buckets[HOTSPOT_JOIN_HIST_BUCKETS];
+} hotspot_join_hist_t;
+
+/**
+ * @brief Join latency since boot or the last reset
+ */
+typedef struct {
+    uint32_t completed;         /**< Joins that got a reply through NAT */
+    uint32_t incomplete;        /**< Stations that left, or got no reply within HOTSPOT_JOIN_TIMEOUT_MS */
+    uint32_t slow;              /**< Completed joins over HOTSPOT_JOIN_SLOW_MS (logged) */
+    hotspot_join_hist_t phases[HOTSPOT_JOIN_PHASE_MAX];
+} hotspot_join_stats_t;
+
+/**
+ * @brief One associated station
+ *
+ * Traffic is counted at the AP netif, so "up" is what the station sent
+ * (including frames the hotspot then dropped) and "down" is what was
+ * sent to it, broadcasts excluded. Counters start at association.
+ */
+typedef struct {
+    uint8_t mac[6];
+    uint8_t aid;                /**< Association ID */
+    esp_ip4_addr_t ip;          /**< Last source address seen in the AP subnet, or its DHCP lease; 0 if unknown */
+    int8_t rssi;                /**< Signal of the station's last frames as seen by the driver */
+    uint8_t phy;                /**< HOTSPOT_STATION_PHY_* modes the station supports */
+    uint32_t connected_s;       /**< Since association */
+    uint32_t idle_ms;           /**< Since the last frame from the station, UINT32_MAX if none yet */
+    uint64_t bytes_up;
+    uint64_t bytes_down;
+    uint32_t packets_up;
+    uint32_t packets_down;
+    uint16_t nat_flows;         /**< Estimated distinct TCP/UDP flows leaving the subnet, last one to two windows */
+    uint32_t dns_queries;       /**< UDP queries to port 53, to any server */
+    uint32_t join_ms[HOTSPOT_JOIN_EVENT_MAX];   /**< Milestones in ms after association, HOTSPOT_JOIN_NOT_REACHED if not (yet) */
+} hotspot_station_info_t;
+
+/**
+ * @brief Snapshot the station table
+ *
+ * RSSI and PHY modes are read from the driver at the time of the call.
+ * Flows are counted over HOTSPOT_STATIONS_FLOW_WINDOW_MS (default 60s).
+ *
+ * @param out   Array for the results
+ * @param max   Capacity of out
+ * @param count Set to the number of entries written
+ */
+esp_err_t hotspot_get_stations(hotspot_station_info_t *out, size_t max, size_t *count);
+
+/**
+ * @brief Get the join latency histograms
+ *
+ * A join is counted once the station gets its first reply through NAT,
+ * leaves, or HOTSPOT_JOIN_TIMEOUT_MS (default 30s) passes. Joins slower
+ * than HOTSPOT_JOIN_SLOW_MS (default 3s) and incomplete ones are logged
+ * with their timeline.
+ */
+esp_err_t hotspot_get_join_stats(hotspot_join_stats_t *stats);
+
+/**
+ * @brief Clear the join latency histograms
+ */
+void hotspot_join_stats_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,113 @@
+/***************************************************************************************
+ *  File        : napt_admission.cpp
+ *  Description : Load-aware admission control for new hotspot clients
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - The WiFi driver has no pre-association hook, so a station is checked
+ *     when it has associated and deauthenticated straight away if refused.
+ *   - Only new stations are checked; clients already connected are never
+ *     dropped to make room.
+ ***************************************************************************************/
+
+#include "napt_internal.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+
+static const char *TAG = "napt_admission";
+
+// Thresholds, copied from the config so the event task never reads the
+// config while the control task replaces it. 0 = check off.
+typedef struct {
+    uint32_t min_free_heap;
+    uint16_t max_flows;
+    uint8_t max_queue_pct;
+} admission_limits_t;
+
+static portMUX_TYPE admission_lock = portMUX_INITIALIZER_UNLOCKED;
+static admission_limits_t admission_limits = {};
+static hotspot_admission_stats_t admission_stats = {};
+
+void napt_admission_configure(const hotspot_config_t *config)
+{
+    portENTER_CRITICAL(&admission_lock);
+    admission_limits.min_free_heap = config->admit_min_free_heap;
+    admission_limits.max_flows = config->admit_max_flows;
+    admission_limits.max_queue_pct = config->admit_max_queue_pct;
+    portEXIT_CRITICAL(&admission_lock);
+}
+
+// ============================================================================
+// PRESSURE SIGNALS
+// ============================================================================
+// QoS backlog as a percentage of the configured queue limits. With QoS off
+// nothing is queued and this is 0.
+static uint32_t queue_pressure_pct(void)
+{
+    hotspot_qos_stats_t stats;
+    hotspot_qos_config_t qos;
+    if (hotspot_qos_get_stats(&stats) != ESP_OK || hotspot_qos_get_config(&qos) != ESP_OK) {
+        return 0;
+    }
+    uint32_t queued = 0;
+    uint32_t limit = 0;
+    for (int c = 0; c < HOTSPOT_QOS_CLASS_MAX; c++) {
+        queued += stats.cls[c].queue_packets;
+        limit += qos.queue_limit[c];
+    }
+    return limit ? queued * 100 / limit : 0;
+}
+
+// ============================================================================
+// ADMISSION CHECK
+// ============================================================================
+// Cheapest signal first. Called from the default event loop.
+// ============================================================================
+hotspot_reject_reason_t napt_admission_check(void)
+{
+    portENTER_CRITICAL(&admission_lock);
+    admission_limits_t limits = admission_limits;
+    portEXIT_CRITICAL(&admission_lock);
+
+    hotspot_reject_reason_t reason = HOTSPOT_REJECT_NONE;
+    size_t free_heap = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    uint32_t flows = 0;
+    uint32_t queue_pct = 0;
+
+    if (limits.min_free_heap && free_heap < limits.min_free_heap) {
+        reason = HOTSPOT_REJECT_HEAP;
+    } else if (limits.max_flows && (flows = napt_hitters_active_flows()) > limits.max_flows) {
+        reason = HOTSPOT_REJECT_FLOWS;
+    } else if (limits.max_queue_pct && (queue_pct = queue_pressure_pct()) > limits.max_queue_pct) {
+        reason = HOTSPOT_REJECT_QUEUE;
+    }
+
+    portENTER_CRITICAL(&admission_lock);
+    if (reason == HOTSPOT_REJECT_NONE) {
+        admission_stats.admitted++;
+    } else {
+        admission_stats.rejected[reason]++;
+    }
+    portEXIT_CRITICAL(&admission_lock);
+
+    if (reason != HOTSPOT_REJECT_NONE) {
+        ESP_LOGW(TAG, "Station refused: free heap %u, ~%lu flows, queue %lu%%", (unsigned)free_heap,
+                 (unsigned long)flows, (unsigned long)queue_pct);
+    }
+    return reason;
+}
+
+esp_err_t hotspot_get_admission_stats(hotspot_admission_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&admission_lock);
+    *stats = admission_stats;
+    portEXIT_CRITICAL(&admission_lock);
+    return ESP_OK;
+}
@@ -0,0 +1,196 @@
+/***************************************************************************************
+ *  File        : napt_arp.cpp
+ *  Description : Static ARP entries for associated clients with a DHCP lease
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - A client's MAC/IP binding is known from the DHCP ACK, so the AP never
+ *     has to ARP for it: the entry is added as static when the lease is
+ *     granted (or when a station with a lease associates) and removed when
+ *     the station leaves or the lease goes away.
+ *   - Static entries are never evicted, so at most HOTSPOT_ARP_MAX_PINNED
+ *     are used and the rest of ARP_TABLE_SIZE stays free for the uplink.
+ *   - Needs ETHARP_SUPPORT_STATIC_ENTRIES in lwIP; without it this is a no-op.
+ *   - Pin table and etharp calls only run in the tcpip thread.
+ ***************************************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include "napt_internal.h"
+#include "esp_log.h"
+#include "lwip/opt.h"
+#include "lwip/tcpip.h"
+#include "lwip/etharp.h"
+
+#ifndef HOTSPOT_ARP_MAX_PINNED
+#define HOTSPOT_ARP_MAX_PINNED (ARP_TABLE_SIZE / 2)
+#endif
+
+static const char *TAG = "napt_arp";
+
+#if ETHARP_SUPPORT_STATIC_ENTRIES
+
+typedef struct {
+    uint8_t mac[6];
+    uint32_t ip;        // Network order, 0 = free
+} pin_t;
+
+static pin_t pins[HOTSPOT_ARP_MAX_PINNED];
+static volatile uint8_t pinned = 0;
+
+static void pin_remove(pin_t *p)
+{
+    ip4_addr_t addr;
+    addr.addr = p->ip;
+    etharp_remove_static_entry(&addr);
+    p->ip = 0;
+    pinned--;
+}
+
+// ============================================================================
+// TCPIP THREAD
+// ============================================================================
+void napt_arp_pin(uint32_t ip, const uint8_t *mac)
+{
+    pin_t *slot = NULL;
+    for (int i = 0; i < HOTSPOT_ARP_MAX_PINNED; i++) {
+        pin_t *p = &pins[i];
+        if (p->ip == 0) {
+            if (slot == NULL) {
+                slot = p;
+            }
+            continue;
+        }
+        bool same_mac = memcmp(p->mac, mac, 6) == 0;
+        if (same_mac && p->ip == ip) {
+            return;
+        }
+        // The client moved to another address, or the address to another client
+        if (same_mac || p->ip == ip) {
+            pin_remove(p);
+            if (slot == NULL) {
+                slot = p;
+            }
+        }
+    }
+    if (slot == NULL) {
+        ESP_LOGD(TAG, "All %d pins in use", HOTSPOT_ARP_MAX_PINNED);
+        return;
+    }
+
+    ip4_addr_t addr;
+    addr.addr = ip;
+    struct eth_addr eth;
+    memcpy(eth.addr, mac, 6);
+    if (etharp_add_static_entry(&addr, &eth) != ERR_OK) {
+        return;     // ARP table full of static entries, or no route to the address
+    }
+    memcpy(slot->mac, mac, 6);
+    slot->ip = ip;
+    pinned++;
+}
+
+void napt_arp_unpin_ip(uint32_t ip)
+{
+    for (int i = 0; i < HOTSPOT_ARP_MAX_PINNED; i++) {
+        if (pins[i].ip == ip) {
+            pin_remove(&pins[i]);
+            return;
+        }
+    }
+}
+
+static void unpin_mac(const uint8_t *mac)
+{
+    for (int i = 0; i < HOTSPOT_ARP_MAX_PINNED; i++) {
+        if (pins[i].ip != 0 && memcmp(pins[i].mac, mac, 6) == 0) {
+            pin_remove(&pins[i]);
+            return;
+        }
+    }
+}
+
+typedef struct {
+    uint8_t mac[6];
+    bool joined;
+} station_msg_t;
+
+static void station_cb(void *ctx)
+{
+    station_msg_t *msg = (station_msg_t *)ctx;
+    uint32_t ip;
+    if (!msg->joined) {
+        unpin_mac(msg->mac);
+    } else if (napt_dhcps_lease_ip(msg->mac, &ip)) {
+        // Back with a lease it still holds; it may not ask DHCP at all
+        napt_arp_pin(ip, msg->mac);
+    }
+    free(msg);
+}
+
+static void clear_cb(void *ctx)
+{
+    for (int i = 0; i < HOTSPOT_ARP_MAX_PINNED; i++) {
+        if (pins[i].ip != 0) {
+            pin_remove(&pins[i]);
+        }
+    }
+}
+
+// ============================================================================
+// OTHER TASKS
+// ============================================================================
+// Association events arrive in the event task; the work is handed over to
+// the tcpip thread. Losing one to a full mailbox only costs an ARP request.
+// ============================================================================
+void napt_arp_station(const uint8_t *mac, bool joined)
+{
+    station_msg_t *msg = (station_msg_t *)malloc(sizeof(station_msg_t));
+    if (msg == NULL) {
+        return;
+    }
+    memcpy(msg->mac, mac, 6);
+    msg->joined = joined;
+    if (tcpip_callback(station_cb, msg) != ERR_OK) {
+        free(msg);
+    }
+}
+
+void napt_arp_clear(void)
+{
+    tcpip_callback(clear_cb, NULL);
+}
+
+uint8_t napt_arp_pinned(void)
+{
+    return pinned;
+}
+
+#else // !ETHARP_SUPPORT_STATIC_ENTRIES
+
+void napt_arp_pin(uint32_t ip, const uint8_t *mac)
+{
+}
+
+void napt_arp_unpin_ip(uint32_t ip)
+{
+}
+
+void napt_arp_station(const uint8_t *mac, bool joined)
+{
+}
+
+void napt_arp_clear(void)
+{
+    ESP_LOGD(TAG, "lwIP built without ETHARP_SUPPORT_STATIC_ENTRIES, clients are not pinned");
+}
+
+uint8_t napt_arp_pinned(void)
+{
+    return 0;
+}
+
+#endif // ETHARP_SUPPORT_STATIC_ENTRIES
@@ -0,0 +1,388 @@
+/***************************************************************************************
+ *  File        : napt_capacity.cpp
+ *  Description : Passive and active estimation of the STA uplink bottleneck bandwidth
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - The passive estimator only reads packets that are already being forwarded.
+ *   - The active probe needs a UDP echo server reachable through the uplink.
+ ***************************************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include "napt_interface.h"
+#include "napt_capacity.h"
+#include "napt_internal.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+
+// Estimator tick. Delivered rate and RTT are aggregated over one tick.
+#ifndef HOTSPOT_CAPACITY_INTERVAL_MS
+#define HOTSPOT_CAPACITY_INTERVAL_MS 250
+#endif
+
+// Number of ticks the max-rate filter looks back over (40 * 250ms = 10s)
+#ifndef HOTSPOT_CAPACITY_WINDOW
+#define HOTSPOT_CAPACITY_WINDOW 40
+#endif
+
+// How long a minimum RTT stays valid before it is refreshed from new samples
+#ifndef HOTSPOT_CAPACITY_MIN_RTT_WINDOW_MS
+#define HOTSPOT_CAPACITY_MIN_RTT_WINDOW_MS 30000
+#endif
+
+// RTT above min_rtt * NUM / DEN means a queue is building at the bottleneck
+#define RTT_INFLATION_NUM 5
+#define RTT_INFLATION_DEN 4
+
+// Ignore ticks carrying less than this; they say nothing about capacity
+#define MIN_SATURATED_RATE_BPS 64000
+
+// Estimate changes smaller than 1/8 do not produce an event
+#define EVENT_CHANGE_SHIFT 3
+
+// In-flight RTT samples (one per slot, indexed by flow hash)
+#define RTT_SLOTS 64
+#define RTT_SLOT_STALE_US 3000000
+
+static const char *TAG = "napt_capacity";
+
+// ============================================================================
+// ESTIMATOR STATE
+// ============================================================================
+typedef struct {
+    uint32_t key;       // Flow hash, 0 = free
+    uint32_t seq_end;   // ACK that completes the sample
+    uint32_t sent_us;   // Low 32 bits of esp_timer time
+} rtt_slot_t;
+
+typedef struct {
+    uint32_t rate_bps;
+    uint32_t sustained_bps;     // min(rate, previous tick's rate) if both saturated, else 0
+    bool saturated;
+} rate_sample_t;
+
+static portMUX_TYPE capacity_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t capacity_timer = NULL;
+
+static rtt_slot_t rtt_slots[RTT_SLOTS];
+static rate_sample_t rate_window[HOTSPOT_CAPACITY_WINDOW];
+static uint32_t rate_window_pos = 0;
+
+// Per-tick accumulators (written from the forwarding path)
+static uint32_t tick_bytes = 0;
+static uint32_t tick_rtt_sum_us = 0;
+static uint32_t tick_rtt_count = 0;
+static uint32_t tick_rtt_min_us = UINT32_MAX;
+static int64_t tick_start_us = 0;
+
+static uint32_t min_rtt_stamp_ms = 0;
+static uint32_t last_event_bps = 0;
+static hotspot_capacity_t estimate = {};
+
+// ============================================================================
+// FORWARDING PATH OBSERVER
+// ============================================================================
+// STA_OUT: count bytes and start an RTT sample for TCP segments that consume
+//          sequence space (data or SYN).
+// STA_IN:  an ACK covering the sample's end sequence completes it.
+// ============================================================================
+void napt_capacity_on_packet(napt_hook_t hook, const napt_pkt_t *pkt)
+{
+    if (hook == NAPT_HOOK_STA_OUT) {
+        uint32_t now_us = (uint32_t)esp_timer_get_time();
+        portENTER_CRITICAL_SAFE(&capacity_lock);
+        tick_bytes += pkt->frame_len;
+        if (pkt->l4 != NULL && pkt->proto == IP_PROTO_TCP &&
+            (pkt->payload_len > 0 || (pkt->tcp_flags & NAPT_TCP_SYN))) {
+            uint32_t key = napt_flow_hash(pkt->src, pkt->sport, pkt->dst, pkt->dport, pkt->proto) | 1;
+            rtt_slot_t *slot = &rtt_slots[key % RTT_SLOTS];
+            // One sample in flight per slot; a stale sample may be replaced
+            if (slot->key == 0 || now_us - slot->sent_us > RTT_SLOT_STALE_US) {
+                slot->key = key;
+                slot->seq_end = pkt->seq + pkt->payload_len + ((pkt->tcp_flags & NAPT_TCP_SYN) ? 1 : 0);
+                slot->sent_us = now_us;
+            }
+        }
+        portEXIT_CRITICAL_SAFE(&capacity_lock);
+    } else if (hook == NAPT_HOOK_STA_IN) {
+        if (pkt->l4 == NULL || pkt->proto != IP_PROTO_TCP || !(pkt->tcp_flags & NAPT_TCP_ACK)) {
+            return;
+        }
+        uint32_t key = napt_flow_hash(pkt->src, pkt->sport, pkt->dst, pkt->dport, pkt->proto) | 1;
+        uint32_t now_us = (uint32_t)esp_timer_get_time();
+        portENTER_CRITICAL_SAFE(&capacity_lock);
+        rtt_slot_t *slot = &rtt_slots[key % RTT_SLOTS];
+        if (slot->key == key && (int32_t)(pkt->ack - slot->seq_end) >= 0) {
+            uint32_t rtt = now_us - slot->sent_us;
+            slot->key = 0;
+            tick_rtt_sum_us += rtt;
+            tick_rtt_count++;
+            if (rtt < tick_rtt_min_us) {
+                tick_rtt_min_us = rtt;
+            }
+        }
+        portEXIT_CRITICAL_SAFE(&capacity_lock);
+    }
+}
+
+// ============================================================================
+// ESTIMATOR TICK
+// ============================================================================
+// Once per interval:
+// 1. Turn the byte count into a delivered rate
+// 2. Update smoothed and minimum RTT
+// 3. Mark the interval "saturated" if RTT was inflated (queue at bottleneck)
+// 4. Estimate = max over the window of the rate sustained across two
+//    consecutive saturated intervals. Bytes are counted as they leave for
+//    the router, so a one-interval burst (slow-start overshoot, mostly
+//    dropped past the STA) would otherwise hold the estimate high for the
+//    whole window. With no saturated samples the highest rate seen is only
+//    a lower bound, so the estimate may grow but never shrink from it.
+// ============================================================================
+static void capacity_tick(void *arg)
+{
+    int64_t now_us = esp_timer_get_time();
+    uint32_t now_ms = (uint32_t)(now_us / 1000);
+    bool post_event = false;
+    hotspot_capacity_t snapshot;
+
+    portENTER_CRITICAL(&capacity_lock);
+
+    int64_t elapsed_us = now_us - tick_start_us;
+    tick_start_us = now_us;
+    if (elapsed_us <= 0) {
+        elapsed_us = HOTSPOT_CAPACITY_INTERVAL_MS * 1000;
+    }
+    uint32_t rate_bps = (uint32_t)(((uint64_t)tick_bytes * 8 * 1000000) / (uint64_t)elapsed_us);
+    uint32_t rtt_count = tick_rtt_count;
+    uint32_t rtt_avg = rtt_count ? tick_rtt_sum_us / rtt_count : 0;
+    uint32_t rtt_min = tick_rtt_min_us;
+    tick_bytes = 0;
+    tick_rtt_sum_us = 0;
+    tick_rtt_count = 0;
+    tick_rtt_min_us = UINT32_MAX;
+
+    estimate.delivered_bps = rate_bps;
+
+    if (rtt_count > 0) {
+        estimate.rtt_samples += rtt_count;
+        estimate.srtt_us = estimate.srtt_us ? (estimate.srtt_us * 7 + rtt_avg) / 8 : rtt_avg;
+        if (estimate.min_rtt_us == 0 || rtt_min < estimate.min_rtt_us ||
+            now_ms - min_rtt_stamp_ms > HOTSPOT_CAPACITY_MIN_RTT_WINDOW_MS) {
+            estimate.min_rtt_us = rtt_min;
+            min_rtt_stamp_ms = now_ms;
+        }
+    }
+
+    bool saturated = rtt_count > 0 && rate_bps >= MIN_SATURATED_RATE_BPS &&
+                     (uint64_t)rtt_avg * RTT_INFLATION_DEN > (uint64_t)estimate.min_rtt_us * RTT_INFLATION_NUM;
+
+    const rate_sample_t *prev = &rate_window[(rate_window_pos + HOTSPOT_CAPACITY_WINDOW - 1) % HOTSPOT_CAPACITY_WINDOW];
+    rate_window[rate_window_pos].rate_bps = rate_bps;
+    rate_window[rate_window_pos].sustained_bps =
+        saturated && prev->saturated ? (rate_bps < prev->rate_bps ? rate_bps : prev->rate_bps) : 0;
+    rate_window[rate_window_pos].saturated = saturated;
+    rate_window_pos = (rate_window_pos + 1) % HOTSPOT_CAPACITY_WINDOW;
+
+    uint32_t max_saturated = 0;
+    uint32_t max_any = 0;
+    for (int i = 0; i < HOTSPOT_CAPACITY_WINDOW; i++) {
+        if (rate_window[i].sustained_bps > max_saturated) {
+            max_saturated = rate_window[i].sustained_bps;
+        }
+        if (rate_window[i].rate_bps > max_any) {
+            max_any = rate_window[i].rate_bps;
+        }
+    }
+
+    if (max_saturated > 0) {
+        // Follows the link down as well as up (variable-rate uplinks)
+        if (estimate.uplink_bps != max_saturated || estimate.source != HOTSPOT_CAPACITY_SOURCE_SATURATED) {
+            estimate.uplink_bps = max_saturated;
+            estimate.source = HOTSPOT_CAPACITY_SOURCE_SATURATED;
+            estimate.updated_us = now_us;
+        }
+    } else if (max_any > estimate.uplink_bps && max_any >= MIN_SATURATED_RATE_BPS) {
+        estimate.uplink_bps = max_any;
+        estimate.source = HOTSPOT_CAPACITY_SOURCE_LOWER_BOUND;
+        estimate.updated_us = now_us;
+    }
+
+    uint32_t delta = estimate.uplink_bps > last_event_bps ? estimate.uplink_bps - last_event_bps
+                                                          : last_event_bps - estimate.uplink_bps;
+    if (estimate.uplink_bps != 0 && delta > (last_event_bps >> EVENT_CHANGE_SHIFT)) {
+        last_event_bps = estimate.uplink_bps;
+        post_event = true;
+    }
+    snapshot = estimate;
+
+    portEXIT_CRITICAL(&capacity_lock);
+
+    if (post_event) {
+        ESP_LOGI(TAG, "Uplink capacity: %lu kbit/s (min RTT %lu us, SRTT %lu us)",
+                 (unsigned long)(snapshot.uplink_bps / 1000),
+                 (unsigned long)snapshot.min_rtt_us, (unsigned long)snapshot.srtt_us);
+        esp_event_post(HOTSPOT_EVENT, HOTSPOT_EVENT_UPLINK_CAPACITY, &snapshot, sizeof(snapshot), 0);
+    }
+}
+
+// ============================================================================
+// START / STOP
+// ============================================================================
+void napt_capacity_start(void)
+{
+    portENTER_CRITICAL(&capacity_lock);
+    memset(rtt_slots, 0, sizeof(rtt_slots));
+    memset(rate_window, 0, sizeof(rate_window));
+    rate_window_pos = 0;
+    tick_bytes = 0;
+    tick_rtt_sum_us = 0;
+    tick_rtt_count = 0;
+    tick_rtt_min_us = UINT32_MAX;
+    tick_start_us = esp_timer_get_time();
+    // Keep the last estimate across restarts - the uplink has not changed
+    estimate.delivered_bps = 0;
+    portEXIT_CRITICAL(&capacity_lock);
+
+    if (capacity_timer == NULL) {
+        esp_timer_create_args_t args = {};
+        args.callback = capacity_tick;
+        args.name = "napt_capacity";
+        if (esp_timer_create(&args, &capacity_timer) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create estimator timer");
+            capacity_timer = NULL;
+            return;
+        }
+    }
+    esp_timer_start_periodic(capacity_timer, HOTSPOT_CAPACITY_INTERVAL_MS * 1000);
+}
+
+void napt_capacity_stop(void)
+{
+    if (capacity_timer != NULL) {
+        esp_timer_stop(capacity_timer);
+    }
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+esp_err_t hotspot_get_uplink_capacity(hotspot_capacity_t *out)
+{
+    if (out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&capacity_lock);
+    *out = estimate;
+    portEXIT_CRITICAL(&capacity_lock);
+    return ESP_OK;
+}
+
+// ============================================================================
+// hotspot_probe_uplink_capacity()
+// ============================================================================
+// Packet-train dispersion probe:
+// 1. Send packet_count datagrams back to back to a UDP echo server
+// 2. Timestamp the first and last echo that comes back
+// 3. capacity = (received - 1) * size * 8 / (t_last - t_first)
+//
+// The train is spaced out by the slowest link it crosses, so the echo
+// spacing reveals the bottleneck rate regardless of propagation delay.
+// ============================================================================
+esp_err_t hotspot_probe_uplink_capacity(const hotspot_capacity_probe_config_t *config, uint32_t *out_bps)
+{
+    if (config == NULL || config->server.addr == 0 || config->packet_count < 2 ||
+        config->packet_size < 16 || config->packet_size > 1472) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!is_hotspot_enabled()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t *buf = (uint8_t *)malloc(config->packet_size);
+    if (buf == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Probe: unable to create socket: errno %d", errno);
+        free(buf);
+        return ESP_FAIL;
+    }
+
+    struct sockaddr_in dest = {};
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons(config->port);
+    dest.sin_addr.s_addr = config->server.addr;
+
+    struct timeval tv;
+    tv.tv_sec = config->timeout_ms / 1000;
+    tv.tv_usec = (config->timeout_ms % 1000) * 1000;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    // Send the train back to back
+    memset(buf, 0xA5, config->packet_size);
+    for (uint16_t i = 0; i < config->packet_count; i++) {
+        buf[0] = (uint8_t)(i >> 8);
+        buf[1] = (uint8_t)i;
+        if (sendto(sock, buf, config->packet_size, 0, (struct sockaddr *)&dest, sizeof(dest)) < 0) {
+            // Driver TX queue full - back off briefly and retry once
+            vTaskDelay(1);
+            sendto(sock, buf, config->packet_size, 0, (struct sockaddr *)&dest, sizeof(dest));
+        }
+    }
+
+    // Collect echoes
+    int64_t first_us = 0;
+    int64_t last_us = 0;
+    uint32_t received = 0;
+    while (received < config->packet_count) {
+        int len = recvfrom(sock, buf, config->packet_size, 0, NULL, NULL);
+        if (len <= 0) {
+            break;
+        }
+        int64_t now = esp_timer_get_time();
+        if (received == 0) {
+            first_us = now;
+        }
+        last_us = now;
+        received++;
+    }
+
+    close(sock);
+    free(buf);
+
+    if (received < 2 || last_us <= first_us) {
+        ESP_LOGW(TAG, "Probe: only %lu of %u echoes received", (unsigned long)received, config->packet_count);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    uint64_t bits = (uint64_t)(received - 1) * config->packet_size * 8;
+    uint32_t bps = (uint32_t)(bits * 1000000 / (uint64_t)(last_us - first_us));
+
+    hotspot_capacity_t snapshot;
+    portENTER_CRITICAL(&capacity_lock);
+    estimate.uplink_bps = bps;
+    estimate.source = HOTSPOT_CAPACITY_SOURCE_PROBE;
+    estimate.updated_us = esp_timer_get_time();
+    last_event_bps = bps;
+    snapshot = estimate;
+    portEXIT_CRITICAL(&capacity_lock);
+
+    ESP_LOGI(TAG, "Probe: %lu kbit/s (%lu/%u echoes)", (unsigned long)(bps / 1000),
+             (unsigned long)received, config->packet_count);
+    esp_event_post(HOTSPOT_EVENT, HOTSPOT_EVENT_UPLINK_CAPACITY, &snapshot, sizeof(snapshot), 0);
+
+    if (out_bps != NULL) {
+        *out_bps = bps;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,89 @@
+/***************************************************************************************
+ *  File        : napt_channel.cpp
+ *  Description : 2.4 GHz channel scoring from scan results
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Pure functions on plain structs: no WiFi driver calls, so recorded scan
+ *     results can be replayed on a host build.
+ *   - Lower score = less contended channel.
+ ***************************************************************************************/
+
+#include <string.h>
+#include "napt_internal.h"
+
+// Extra cost per BSS sharing the exact primary channel. Co-channel networks
+// defer to each other (CSMA), so each one costs airtime even when weak.
+#ifndef NAPT_CHANNEL_BSS_PENALTY
+#define NAPT_CHANNEL_BSS_PENALTY 40
+#endif
+
+// A new channel has to score at least this much (percent) better than the
+// current one before it is worth moving clients
+#ifndef NAPT_CHANNEL_HYSTERESIS_PCT
+#define NAPT_CHANNEL_HYSTERESIS_PCT 20
+#endif
+
+// ============================================================================
+// SCORING
+// ============================================================================
+// A 20 MHz signal spans about +-2 channels and leaks into +-4. Each BSS adds
+// its weight to the channels it overlaps, scaled 5/5 on its own channel down
+// to 1/5 four channels away. The weight is the RSSI in dB above -100 dBm, so
+// a -40 dBm neighbour counts six times as much as a -90 dBm one. HT40 BSSs
+// occupy a second 20 MHz block four channels above or below the primary.
+// ============================================================================
+static void add_block(uint32_t scores[NAPT_CHANNEL_MAX + 1], int center, uint32_t weight)
+{
+    for (int ch = 1; ch <= NAPT_CHANNEL_MAX; ch++) {
+        int d = ch > center ? ch - center : center - ch;
+        if (d <= 4) {
+            scores[ch] += weight * (uint32_t)(5 - d);
+        }
+    }
+}
+
+void napt_channel_score(const napt_scan_bss_t *bss, int count, uint32_t scores[NAPT_CHANNEL_MAX + 1])
+{
+    memset(scores, 0, sizeof(uint32_t) * (NAPT_CHANNEL_MAX + 1));
+
+    for (int i = 0; i < count; i++) {
+        int primary = bss[i].primary;
+        if (primary < 1 || primary > NAPT_CHANNEL_MAX) {
+            continue;
+        }
+        int rssi = bss[i].rssi < -100 ? -100 : (bss[i].rssi > 0 ? 0 : bss[i].rssi);
+        uint32_t weight = (uint32_t)(rssi + 100) + 1;
+
+        add_block(scores, primary, weight);
+        if (bss[i].second == NAPT_CHANNEL_SECOND_ABOVE) {
+            add_block(scores, primary + 4, weight);
+        } else if (bss[i].second == NAPT_CHANNEL_SECOND_BELOW) {
+            add_block(scores, primary - 4, weight);
+        }
+        scores[primary] += NAPT_CHANNEL_BSS_PENALTY;
+    }
+}
+
+uint8_t napt_channel_pick(const uint32_t scores[NAPT_CHANNEL_MAX + 1], uint16_t candidates, uint8_t current)
+{
+    uint8_t best = 0;
+    for (int ch = 1; ch <= NAPT_CHANNEL_MAX; ch++) {
+        if ((candidates & (1u << ch)) && (best == 0 || scores[ch] < scores[best])) {
+            best = (uint8_t)ch;
+        }
+    }
+    if (best == 0) {
+        return current;
+    }
+
+    // Stay put unless the gain is clear
+    if (current >= 1 && current <= NAPT_CHANNEL_MAX && (candidates & (1u << current)) &&
+        (uint64_t)scores[best] * 100 >= (uint64_t)scores[current] * (100 - NAPT_CHANNEL_HYSTERESIS_PCT)) {
+        return current;
+    }
+    return best;
+}
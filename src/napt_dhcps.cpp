@@ -0,0 +1,956 @@
+/***************************************************************************************
+ *  File        : napt_dhcps.cpp
+ *  Description : DHCP server for the AP side, with Rapid Commit
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Replaces the esp_netif DHCP server, which cannot do Rapid Commit
+ *     (RFC 4039) or advertise NTP (option 42).
+ *   - Runs on a raw udp_pcb, so requests are answered straight from the
+ *     tcpip thread with no task switch in between.
+ *   - Replies are a precomputed template (BOOTP header and the options that
+ *     only change on enable) plus a handful of per-client fields.
+ *   - Leases are keyed by chaddr; the client identifier option is ignored.
+ *   - Bindings are saved to NVS in batches and restored after a reboot, so
+ *     a returning client's INIT-REBOOT is ACKed with its old address.
+ ***************************************************************************************/
+
+#include <string.h>
+#include "napt_dhcps.h"
+#include "napt_internal.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_netif_net_stack.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "nvs.h"
+#include "lwip/udp.h"
+#include "lwip/tcpip.h"
+#include "lwip/pbuf.h"
+
+#ifndef HOTSPOT_DHCP_MAX_LEASES
+#define HOTSPOT_DHCP_MAX_LEASES 16
+#endif
+
+// How long an offered address is held for the client it was offered to
+#ifndef HOTSPOT_DHCP_OFFER_HOLD_S
+#define HOTSPOT_DHCP_OFFER_HOLD_S 30
+#endif
+
+// How long a declined (found in use) address is kept out of the pool
+#ifndef HOTSPOT_DHCP_DECLINE_HOLD_S
+#define HOTSPOT_DHCP_DECLINE_HOLD_S 300
+#endif
+
+// Lease changes are written to NVS this long after the first one, so a
+// burst of joins costs one write
+#ifndef HOTSPOT_DHCP_SAVE_DELAY_S
+#define HOTSPOT_DHCP_SAVE_DELAY_S 30
+#endif
+
+// ... and never more often than this
+#ifndef HOTSPOT_DHCP_SAVE_MIN_INTERVAL_S
+#define HOTSPOT_DHCP_SAVE_MIN_INTERVAL_S 300
+#endif
+
+#define LEASE_BUCKETS 16            // MAC hash buckets, power of two
+#define LEASE_NONE 0xff             // End of a bucket chain
+#define NVS_NAMESPACE "napt_dhcps"
+#define NVS_KEY "leases"
+#define NVS_VERSION 1
+
+#define DHCP_SERVER_PORT 67
+#define DHCP_CLIENT_PORT 68
+#define DHCP_OPTIONS_OFS 240        // BOOTP header (236) + magic cookie
+#define DHCP_MSG_MAX 576            // Largest message every client must accept
+#define BOOTP_MIN_LEN 300           // Some clients drop shorter BOOTP replies
+
+// Message types, option 53
+#define DHCPDISCOVER 1
+#define DHCPOFFER    2
+#define DHCPREQUEST  3
+#define DHCPDECLINE  4
+#define DHCPACK      5
+#define DHCPNAK      6
+#define DHCPRELEASE  7
+#define DHCPINFORM   8
+
+#define OPT_PAD             0
+#define OPT_SUBNET_MASK     1
+#define OPT_ROUTER          3
+#define OPT_DNS             6
+#define OPT_BROADCAST       28
+#define OPT_NTP             42
+#define OPT_REQUESTED_IP    50
+#define OPT_LEASE_TIME      51
+#define OPT_MSG_TYPE        53
+#define OPT_SERVER_ID       54
+#define OPT_T1              58
+#define OPT_T2              59
+#define OPT_RAPID_COMMIT    80
+#define OPT_END             255
+
+static const uint8_t DHCP_MAGIC[4] = { 99, 130, 83, 99 };
+
+static const char *TAG = "napt_dhcps";
+
+// ============================================================================
+// LEASE TABLE
+// ============================================================================
+// Entries are kept after release or expiry so a returning client gets its
+// old address; they are only reused once no free slot is left, oldest first.
+// Every entry with a MAC (not free, not declined) is chained into the bucket
+// of its MAC hash. Changed in the tcpip thread under dhcps_lock.
+// ============================================================================
+typedef enum {
+    LEASE_FREE = 0,
+    LEASE_OFFERED,
+    LEASE_BOUND,
+    LEASE_RELEASED,
+    LEASE_DECLINED,     // mac is zero, the address is held back until expires
+} lease_state_t;
+
+typedef struct {
+    uint8_t mac[6];
+    uint8_t state;      // lease_state_t
+    uint8_t next;       // Next entry in the bucket, LEASE_NONE at the end
+    uint32_t ip;        // Network order
+    uint32_t expires;   // Uptime seconds
+} lease_t;
+
+static_assert(HOTSPOT_DHCP_MAX_LEASES < LEASE_NONE, "lease index must fit the chain links");
+
+static portMUX_TYPE dhcps_lock = portMUX_INITIALIZER_UNLOCKED;
+static lease_t leases[HOTSPOT_DHCP_MAX_LEASES];
+static uint8_t buckets[LEASE_BUCKETS];
+static hotspot_dhcp_stats_t dhcps_stats = {};
+static bool leases_loaded = false;      // NVS read once per boot
+
+// Set by napt_dhcps_start(), read in the tcpip thread while the pcb exists
+static struct udp_pcb *dhcps_pcb = NULL;
+static struct netif *dhcps_netif = NULL;
+static uint32_t server_ip = 0;          // Network order
+static uint32_t server_mask = 0;
+static uint32_t pool_first = 0;         // Host order
+static uint32_t pool_last = 0;
+static uint32_t lease_time_s = 7200;
+static bool rapid_commit = false;
+
+// Reply template: header up to the options, then option blocks in the
+// order server id | lease times | network settings
+static uint8_t tpl_header[DHCP_OPTIONS_OFS];
+static uint8_t tpl_options[64];
+static size_t tpl_lease_ofs = 0;
+static size_t tpl_net_ofs = 0;
+static size_t tpl_len = 0;
+
+static SemaphoreHandle_t dhcps_call_done = NULL;
+
+static uint32_t now_s(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+// Caller holds dhcps_lock for all of the lease helpers
+static bool lease_active(const lease_t *l, uint32_t now)
+{
+    return (l->state == LEASE_OFFERED || l->state == LEASE_BOUND || l->state == LEASE_DECLINED) &&
+           (int32_t)(l->expires - now) > 0;
+}
+
+// FNV-1a over the MAC
+static uint8_t *bucket_of(const uint8_t *mac)
+{
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < 6; i++) {
+        h = (h ^ mac[i]) * 16777619u;
+    }
+    return &buckets[h & (LEASE_BUCKETS - 1)];
+}
+
+static void lease_link(lease_t *l)
+{
+    uint8_t *head = bucket_of(l->mac);
+    l->next = *head;
+    *head = (uint8_t)(l - leases);
+}
+
+static void lease_unlink(lease_t *l)
+{
+    uint8_t idx = (uint8_t)(l - leases);
+    for (uint8_t *link = bucket_of(l->mac); *link != LEASE_NONE; link = &leases[*link].next) {
+        if (*link == idx) {
+            *link = l->next;
+            return;
+        }
+    }
+}
+
+static void leases_clear(void)
+{
+    memset(leases, 0, sizeof(leases));
+    memset(buckets, LEASE_NONE, sizeof(buckets));
+}
+
+static lease_t *lease_by_mac(const uint8_t *mac)
+{
+    for (uint8_t i = *bucket_of(mac); i != LEASE_NONE; i = leases[i].next) {
+        if (memcmp(leases[i].mac, mac, 6) == 0) {
+            return &leases[i];
+        }
+    }
+    return NULL;
+}
+
+static lease_t *lease_by_ip(uint32_t ip)
+{
+    for (int i = 0; i < HOTSPOT_DHCP_MAX_LEASES; i++) {
+        if (leases[i].state != LEASE_FREE && leases[i].ip == ip) {
+            return &leases[i];
+        }
+    }
+    return NULL;
+}
+
+static bool ip_in_pool(uint32_t ip)
+{
+    uint32_t h = ntohl(ip);
+    return h >= pool_first && h <= pool_last && ip != server_ip;
+}
+
+// New entry for a client without one: the requested address if nobody has
+// it, else the lowest address never handed out, else the entry that went
+// inactive longest ago (slot and address both).
+static lease_t *lease_alloc(const uint8_t *mac, uint32_t requested, uint32_t now)
+{
+    lease_t *slot = NULL;
+    lease_t *victim = NULL;
+    for (int i = 0; i < HOTSPOT_DHCP_MAX_LEASES; i++) {
+        lease_t *l = &leases[i];
+        if (l->state == LEASE_FREE) {
+            if (slot == NULL) {
+                slot = l;
+            }
+        } else if (!lease_active(l, now) && (victim == NULL || (int32_t)(l->expires - victim->expires) < 0)) {
+            victim = l;
+        }
+    }
+
+    uint32_t ip = 0;
+    if (requested != 0 && ip_in_pool(requested) && lease_by_ip(requested) == NULL) {
+        ip = requested;
+    }
+    if (ip == 0 && slot != NULL) {
+        // At most HOTSPOT_DHCP_MAX_LEASES addresses are taken, so this ends quickly
+        for (uint32_t h = pool_first; h <= pool_last; h++) {
+            uint32_t candidate = htonl(h);
+            if (candidate != server_ip && lease_by_ip(candidate) == NULL) {
+                ip = candidate;
+                break;
+            }
+        }
+    }
+    if (slot == NULL || ip == 0) {
+        if (victim == NULL) {
+            return NULL;
+        }
+        slot = victim;
+        if (ip == 0) {
+            ip = victim->ip;
+        }
+    }
+
+    if (slot->state != LEASE_FREE && slot->state != LEASE_DECLINED) {
+        lease_unlink(slot);
+    }
+    memcpy(slot->mac, mac, 6);
+    lease_link(slot);
+    slot->ip = ip;
+    slot->state = LEASE_OFFERED;
+    slot->expires = now;
+    return slot;
+}
+
+static void lease_bind(lease_t *l, uint32_t now)
+{
+    l->state = LEASE_BOUND;
+    l->expires = now + lease_time_s;
+}
+
+// ============================================================================
+// PERSISTENCE
+// ============================================================================
+// Only bindings are saved (MAC, address, bound or not), never expiry times:
+// uptime restarts on reboot, so a restored binding gets a full lease. A
+// change schedules one write HOTSPOT_DHCP_SAVE_DELAY_S later, at least
+// HOTSPOT_DHCP_SAVE_MIN_INTERVAL_S after the previous one, done in the
+// hotspot control task. A table identical to the stored one is not written
+// at all. Renewals change nothing that is saved. Without nvs_flash_init()
+// leases are simply not kept.
+// ============================================================================
+typedef struct {
+    uint8_t mac[6];
+    uint8_t bound;
+    uint8_t reserved;
+    uint32_t ip;
+} saved_lease_t;
+
+typedef struct {
+    uint8_t version;
+    uint8_t count;
+    uint16_t reserved;
+    uint32_t server_ip;
+    uint32_t mask;
+    saved_lease_t leases[HOTSPOT_DHCP_MAX_LEASES];
+} saved_table_t;
+
+#define SAVED_LEN(count) (offsetof(saved_table_t, leases) + (count) * sizeof(saved_lease_t))
+
+static SemaphoreHandle_t save_mutex = NULL;
+static esp_timer_handle_t save_timer = NULL;
+static volatile bool save_dirty = false;
+static int64_t last_save_us = 0;
+static saved_table_t save_buf;          // Under save_mutex
+static saved_table_t saved;             // What NVS holds
+static size_t saved_len = 0;
+
+static size_t leases_snapshot(saved_table_t *t)
+{
+    memset(t, 0, sizeof(*t));
+    t->version = NVS_VERSION;
+    uint32_t now = now_s();
+    portENTER_CRITICAL(&dhcps_lock);
+    t->server_ip = server_ip;
+    t->mask = server_mask;
+    for (int i = 0; i < HOTSPOT_DHCP_MAX_LEASES; i++) {
+        const lease_t *l = &leases[i];
+        if (l->state == LEASE_BOUND || l->state == LEASE_RELEASED) {
+            saved_lease_t *e = &t->leases[t->count++];
+            memcpy(e->mac, l->mac, 6);
+            e->bound = l->state == LEASE_BOUND && lease_active(l, now);
+            e->ip = l->ip;
+        }
+    }
+    portEXIT_CRITICAL(&dhcps_lock);
+    return SAVED_LEN(t->count);
+}
+
+static void leases_save(void)
+{
+    xSemaphoreTake(save_mutex, portMAX_DELAY);
+    save_dirty = false;
+    size_t len = leases_snapshot(&save_buf);
+    if (len != saved_len || memcmp(&save_buf, &saved, len) != 0) {
+        nvs_handle_t nvs;
+        esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+        if (err == ESP_OK) {
+            err = nvs_set_blob(nvs, NVS_KEY, &save_buf, len);
+            if (err == ESP_OK) {
+                err = nvs_commit(nvs);
+            }
+            nvs_close(nvs);
+        }
+        if (err == ESP_OK) {
+            memcpy(&saved, &save_buf, len);
+            saved_len = len;
+            last_save_us = esp_timer_get_time();
+            portENTER_CRITICAL(&dhcps_lock);
+            dhcps_stats.nvs_writes++;
+            portEXIT_CRITICAL(&dhcps_lock);
+        } else {
+            ESP_LOGW(TAG, "Unable to save leases: %s", esp_err_to_name(err));
+        }
+    }
+    xSemaphoreGive(save_mutex);
+}
+
+// Flash writes can stall for tens of ms; they don't belong in the esp_timer
+// task, which every other timer callback shares
+static void save_timer_cb(void *arg)
+{
+    if (napt_ctl_post(leases_save) != ESP_OK) {
+        esp_timer_start_once(save_timer, 1000000);  // Control queue full; try again
+    }
+}
+
+// tcpip thread, after a binding changed
+static void save_schedule(void)
+{
+    save_dirty = true;
+    if (save_timer == NULL || esp_timer_is_active(save_timer)) {
+        return;
+    }
+    int64_t delay_s = HOTSPOT_DHCP_SAVE_DELAY_S;
+    if (last_save_us != 0) {
+        int64_t since_s = (esp_timer_get_time() - last_save_us) / 1000000;
+        if (HOTSPOT_DHCP_SAVE_MIN_INTERVAL_S - since_s > delay_s) {
+            delay_s = HOTSPOT_DHCP_SAVE_MIN_INTERVAL_S - since_s;
+        }
+    }
+    esp_timer_start_once(save_timer, (uint64_t)delay_s * 1000000);
+}
+
+// Once per boot, after the pool for this subnet is known
+static void leases_load(void)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+    size_t len = sizeof(saved);
+    esp_err_t err = nvs_get_blob(nvs, NVS_KEY, &saved, &len);
+    nvs_close(nvs);
+    if (err != ESP_OK || len < SAVED_LEN(0) || saved.version != NVS_VERSION ||
+        saved.count > HOTSPOT_DHCP_MAX_LEASES || len != SAVED_LEN(saved.count)) {
+        saved_len = 0;
+        return;
+    }
+    saved_len = len;
+    if (saved.server_ip != server_ip || saved.mask != server_mask) {
+        return;     // Another subnet; the next save replaces it
+    }
+
+    uint32_t now = now_s();
+    int restored = 0;
+    portENTER_CRITICAL(&dhcps_lock);
+    for (int i = 0; i < saved.count; i++) {
+        const saved_lease_t *e = &saved.leases[i];
+        if (!ip_in_pool(e->ip) || lease_by_ip(e->ip) != NULL || lease_by_mac(e->mac) != NULL) {
+            continue;
+        }
+        lease_t *l = &leases[restored++];
+        memcpy(l->mac, e->mac, 6);
+        l->ip = e->ip;
+        if (e->bound) {
+            lease_bind(l, now);
+        } else {
+            l->state = LEASE_RELEASED;
+            l->expires = now;
+        }
+        lease_link(l);
+    }
+    portEXIT_CRITICAL(&dhcps_lock);
+    ESP_LOGI(TAG, "Restored %d leases", restored);
+}
+
+// ============================================================================
+// MESSAGES
+// ============================================================================
+typedef struct {
+    uint8_t type;
+    const uint8_t *mac;         // chaddr
+    uint32_t ciaddr;            // Network order, as are the addresses below
+    uint32_t requested_ip;
+    uint32_t server_id;
+    bool rapid_commit;
+} dhcp_request_t;
+
+static bool request_parse(const uint8_t *msg, size_t len, dhcp_request_t *req)
+{
+    // BOOTREQUEST over Ethernet with the DHCP cookie
+    if (len < DHCP_OPTIONS_OFS + 3 || msg[0] != 1 || msg[1] != 1 || msg[2] != 6 ||
+        memcmp(msg + 236, DHCP_MAGIC, sizeof(DHCP_MAGIC)) != 0) {
+        return false;
+    }
+    memset(req, 0, sizeof(*req));
+    req->mac = msg + 28;
+    memcpy(&req->ciaddr, msg + 12, 4);
+
+    size_t i = DHCP_OPTIONS_OFS;
+    while (i < len) {
+        uint8_t code = msg[i++];
+        if (code == OPT_PAD) {
+            continue;
+        }
+        if (code == OPT_END || i >= len) {
+            break;
+        }
+        uint8_t olen = msg[i++];
+        if (i + olen > len) {
+            break;
+        }
+        const uint8_t *v = msg + i;
+        switch (code) {
+        case OPT_MSG_TYPE:
+            if (olen == 1) {
+                req->type = v[0];
+            }
+            break;
+        case OPT_REQUESTED_IP:
+            if (olen == 4) {
+                memcpy(&req->requested_ip, v, 4);
+            }
+            break;
+        case OPT_SERVER_ID:
+            if (olen == 4) {
+                memcpy(&req->server_id, v, 4);
+            }
+            break;
+        case OPT_RAPID_COMMIT:
+            req->rapid_commit = true;
+            break;
+        }
+        i += olen;
+    }
+    return req->type != 0;
+}
+
+static uint8_t *put_option(uint8_t *o, uint8_t code, const void *value, uint8_t len)
+{
+    *o++ = code;
+    *o++ = len;
+    memcpy(o, value, len);
+    return o + len;
+}
+
+static uint8_t *put_option_u32(uint8_t *o, uint8_t code, uint32_t value)
+{
+    uint32_t be = htonl(value);
+    return put_option(o, code, &be, 4);
+}
+
+// Everything in a reply that only depends on the configuration
+static void template_build(const hotspot_config_t *config)
+{
+    memset(tpl_header, 0, sizeof(tpl_header));
+    tpl_header[0] = 2;      // BOOTREPLY
+    tpl_header[1] = 1;      // Ethernet
+    tpl_header[2] = 6;
+    memcpy(tpl_header + 236, DHCP_MAGIC, sizeof(DHCP_MAGIC));
+
+    uint32_t broadcast = server_ip | ~server_mask;
+    uint8_t *o = tpl_options;
+    o = put_option(o, OPT_SERVER_ID, &server_ip, 4);
+    tpl_lease_ofs = o - tpl_options;
+    o = put_option_u32(o, OPT_LEASE_TIME, lease_time_s);
+    o = put_option_u32(o, OPT_T1, lease_time_s / 2);
+    o = put_option_u32(o, OPT_T2, lease_time_s / 8 * 7);
+    tpl_net_ofs = o - tpl_options;
+    o = put_option(o, OPT_SUBNET_MASK, &server_mask, 4);
+    o = put_option(o, OPT_ROUTER, &server_ip, 4);
+    o = put_option(o, OPT_DNS, &server_ip, 4);          // The DNS forwarder
+    o = put_option(o, OPT_BROADCAST, &broadcast, 4);
+    if (config->ntp_server) {
+        o = put_option(o, OPT_NTP, &server_ip, 4);
+    }
+    tpl_len = o - tpl_options;
+}
+
+// INFORM gets an ACK without address or lease times, NAK only the server id
+static size_t reply_build(uint8_t *out, const uint8_t *msg, uint8_t type, uint32_t yiaddr, bool rapid, bool inform)
+{
+    memcpy(out, tpl_header, DHCP_OPTIONS_OFS);
+    memcpy(out + 4, msg + 4, 4);        // xid
+    memcpy(out + 10, msg + 10, 2);      // flags
+    memcpy(out + 24, msg + 24, 4);      // giaddr
+    memcpy(out + 28, msg + 28, 16);     // chaddr
+    if (inform) {
+        memcpy(out + 12, msg + 12, 4);  // ciaddr
+    } else if (type != DHCPNAK) {
+        memcpy(out + 16, &yiaddr, 4);
+    }
+
+    uint8_t *o = out + DHCP_OPTIONS_OFS;
+    *o++ = OPT_MSG_TYPE;
+    *o++ = 1;
+    *o++ = type;
+    if (type == DHCPNAK) {
+        memcpy(o, tpl_options, tpl_lease_ofs);
+        o += tpl_lease_ofs;
+    } else if (inform) {
+        memcpy(o, tpl_options, tpl_lease_ofs);
+        o += tpl_lease_ofs;
+        memcpy(o, tpl_options + tpl_net_ofs, tpl_len - tpl_net_ofs);
+        o += tpl_len - tpl_net_ofs;
+    } else {
+        memcpy(o, tpl_options, tpl_len);
+        o += tpl_len;
+    }
+    if (rapid) {
+        *o++ = OPT_RAPID_COMMIT;
+        *o++ = 0;
+    }
+    *o++ = OPT_END;
+
+    size_t len = o - out;
+    if (len < BOOTP_MIN_LEN) {
+        memset(o, 0, BOOTP_MIN_LEN - len);
+        len = BOOTP_MIN_LEN;
+    }
+    return len;
+}
+
+// Same event the esp_netif server posts, for applications that listen for it
+static void post_assigned(const uint8_t *mac, uint32_t ip)
+{
+    ip_event_ap_staipassigned_t evt;
+    memset(&evt, 0, sizeof(evt));
+    evt.ip.addr = ip;
+    memcpy(evt.mac, mac, sizeof(evt.mac));
+    esp_event_post(IP_EVENT, IP_EVENT_AP_STAIPASSIGNED, &evt, sizeof(evt), 0);
+}
+
+// ============================================================================
+// SERVER (tcpip thread)
+// ============================================================================
+static void dhcps_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, uint16_t port)
+{
+    // Only ever used from the tcpip thread
+    static uint8_t msg[DHCP_MSG_MAX];
+    static uint8_t reply[DHCP_MSG_MAX];
+
+    size_t len = pbuf_copy_partial(p, msg, sizeof(msg), 0);
+    pbuf_free(p);
+    dhcp_request_t req;
+    if (!request_parse(msg, len, &req)) {
+        return;
+    }
+
+    uint32_t now = now_s();
+    uint8_t type = 0;
+    uint32_t yiaddr = 0;
+    bool rapid = false;
+    bool assigned = false;
+    bool changed = false;       // A binding that is saved to NVS
+    uint32_t declined = 0;
+    uint32_t dropped = 0;       // Address given up, its ARP pin goes
+    lease_t *l;
+
+    portENTER_CRITICAL(&dhcps_lock);
+    switch (req.type) {
+    case DHCPDISCOVER:
+        dhcps_stats.discovers++;
+        l = lease_by_mac(req.mac);
+        if (l == NULL) {
+            l = lease_alloc(req.mac, req.requested_ip, now);
+        }
+        if (l == NULL) {
+            dhcps_stats.pool_exhausted++;
+            break;
+        }
+        yiaddr = l->ip;
+        if (req.rapid_commit && rapid_commit) {
+            // Two-message exchange: the DISCOVER already commits the client
+            lease_bind(l, now);
+            type = DHCPACK;
+            rapid = true;
+            assigned = true;
+            dhcps_stats.rapid_commits++;
+        } else {
+            if (l->state != LEASE_BOUND || !lease_active(l, now)) {
+                l->state = LEASE_OFFERED;
+                l->expires = now + HOTSPOT_DHCP_OFFER_HOLD_S;
+            }
+            type = DHCPOFFER;
+        }
+        break;
+
+    case DHCPREQUEST:
+        dhcps_stats.requests++;
+        l = lease_by_mac(req.mac);
+        if (req.server_id != 0) {
+            // SELECTING: answer to our offer, or the client picked another server
+            if (req.server_id != server_ip) {
+                if (l != NULL && l->state == LEASE_OFFERED) {
+                    l->state = LEASE_RELEASED;
+                }
+            } else if (l != NULL && l->ip == req.requested_ip) {
+                type = DHCPACK;
+            } else {
+                type = DHCPNAK;
+            }
+        } else if (req.ciaddr != 0) {
+            // RENEWING / REBINDING: silent for clients we never leased to
+            if (l != NULL && l->ip == req.ciaddr) {
+                type = DHCPACK;
+            } else if (l != NULL) {
+                type = DHCPNAK;
+            }
+        } else if (req.requested_ip != 0) {
+            // INIT-REBOOT: a client with no record here gets no answer (RFC 2131 4.3.2)
+            lease_t *owner = lease_by_ip(req.requested_ip);
+            if ((req.requested_ip & server_mask) != (server_ip & server_mask)) {
+                type = DHCPNAK;
+            } else if (l != NULL && l->ip == req.requested_ip) {
+                type = DHCPACK;
+            } else if (l != NULL || (owner != NULL && lease_active(owner, now))) {
+                type = DHCPNAK;
+            }
+        }
+        if (type == DHCPACK) {
+            yiaddr = l->ip;
+            assigned = req.ciaddr == 0;     // A renewal is not a new assignment
+            lease_bind(l, now);
+        }
+        break;
+
+    case DHCPDECLINE:
+        l = lease_by_mac(req.mac);
+        if (req.server_id == server_ip && l != NULL && l->ip == req.requested_ip) {
+            lease_unlink(l);
+            memset(l->mac, 0, sizeof(l->mac));
+            l->state = LEASE_DECLINED;
+            l->expires = now + HOTSPOT_DHCP_DECLINE_HOLD_S;
+            dhcps_stats.declines++;
+            declined = l->ip;
+            dropped = l->ip;
+            changed = true;
+        }
+        break;
+
+    case DHCPRELEASE:
+        l = lease_by_mac(req.mac);
+        if (l != NULL && l->ip == req.ciaddr) {
+            l->state = LEASE_RELEASED;
+            l->expires = now;
+            dhcps_stats.releases++;
+            dropped = l->ip;
+            changed = true;
+        }
+        break;
+
+    case DHCPINFORM:
+        if (req.ciaddr != 0) {
+            type = DHCPACK;
+            dhcps_stats.informs++;
+        }
+        break;
+    }
+    if (type == DHCPOFFER) {
+        dhcps_stats.offers++;
+    } else if (type == DHCPACK) {
+        dhcps_stats.acks++;
+    } else if (type == DHCPNAK) {
+        dhcps_stats.naks++;
+    }
+    portEXIT_CRITICAL(&dhcps_lock);
+
+    if (req.type == DHCPDISCOVER) {
+        napt_stations_dhcp(req.mac, HOTSPOT_JOIN_DHCP_DISCOVER);
+    } else if (req.type == DHCPREQUEST) {
+        napt_stations_dhcp(req.mac, HOTSPOT_JOIN_DHCP_REQUEST);
+    }
+    if (declined != 0) {
+        ESP_LOGW(TAG, "Address " IPSTR " declined, in use by another host", IP2STR((esp_ip4_addr_t *)&declined));
+    }
+    if (changed || assigned) {
+        save_schedule();
+    }
+    if (dropped != 0) {
+        napt_arp_unpin_ip(dropped);
+    }
+    if (type == 0) {
+        return;
+    }
+    if (type == DHCPACK && yiaddr != 0) {
+        // Pinned before the ACK goes out, so not even a unicast ACK needs ARP
+        napt_arp_pin(yiaddr, req.mac);
+    }
+    bool inform = req.type == DHCPINFORM;
+    size_t out_len = reply_build(reply, msg, type, yiaddr, rapid, inform);
+    struct pbuf *out = pbuf_alloc(PBUF_TRANSPORT, out_len, PBUF_RAM);
+    if (out == NULL) {
+        return;
+    }
+    pbuf_take(out, reply, out_len);
+
+    // Clients with an address get unicast; everyone else is broadcast to,
+    // since their address can't be resolved yet
+    ip_addr_t dst;
+    memset(&dst, 0, sizeof(dst));
+    dst.type = IPADDR_TYPE_V4;
+    dst.u_addr.ip4.addr = req.ciaddr != 0 && type != DHCPNAK ? req.ciaddr : IPADDR_BROADCAST;
+    udp_sendto_if(pcb, out, &dst, DHCP_CLIENT_PORT, dhcps_netif);
+    pbuf_free(out);
+
+    if (type == DHCPOFFER) {
+        napt_stations_dhcp(req.mac, HOTSPOT_JOIN_DHCP_OFFER);
+    } else if (type == DHCPACK && !inform) {
+        napt_stations_dhcp(req.mac, HOTSPOT_JOIN_DHCP_ACK);
+    }
+
+    if (assigned) {
+        post_assigned(req.mac, yiaddr);
+    }
+}
+
+// ============================================================================
+// START / STOP
+// ============================================================================
+// The pcb is created and removed in the tcpip thread, like every raw API
+// call; the control task waits for it.
+// ============================================================================
+static void dhcps_open_cb(void *ctx)
+{
+    err_t *err = (err_t *)ctx;
+    dhcps_pcb = udp_new();
+    if (dhcps_pcb == NULL) {
+        *err = ERR_MEM;
+    } else {
+        ip_set_option(dhcps_pcb, SOF_BROADCAST);
+        udp_bind_netif(dhcps_pcb, dhcps_netif);
+        *err = udp_bind(dhcps_pcb, IP_ADDR_ANY, DHCP_SERVER_PORT);
+        if (*err != ERR_OK) {
+            udp_remove(dhcps_pcb);
+            dhcps_pcb = NULL;
+        } else {
+            udp_recv(dhcps_pcb, dhcps_recv, NULL);
+        }
+    }
+    xSemaphoreGive(dhcps_call_done);
+}
+
+static void dhcps_close_cb(void *ctx)
+{
+    udp_remove(dhcps_pcb);
+    dhcps_pcb = NULL;
+    xSemaphoreGive(dhcps_call_done);
+}
+
+static bool dhcps_call(tcpip_callback_fn fn, void *ctx)
+{
+    if (tcpip_callback(fn, ctx) != ERR_OK) {
+        return false;
+    }
+    xSemaphoreTake(dhcps_call_done, portMAX_DELAY);
+    return true;
+}
+
+esp_err_t napt_dhcps_start(esp_netif_t *ap, const hotspot_config_t *config)
+{
+    if (dhcps_pcb != NULL) {
+        return ESP_OK;
+    }
+    if (dhcps_call_done == NULL) {
+        dhcps_call_done = xSemaphoreCreateBinary();
+        save_mutex = xSemaphoreCreateMutex();
+        if (dhcps_call_done == NULL || save_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (save_timer == NULL) {
+        esp_timer_create_args_t args = {};
+        args.callback = save_timer_cb;
+        args.name = "dhcps_save";
+        esp_timer_create(&args, &save_timer);   // Without it leases are only kept in RAM
+    }
+    struct netif *nif = (struct netif *)esp_netif_get_netif_impl(ap);
+    if (nif == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    bool subnet_changed = server_ip != config->ip.addr || server_mask != config->netmask.addr;
+    dhcps_netif = nif;
+    server_ip = config->ip.addr;
+    server_mask = config->netmask.addr;
+    pool_first = (ntohl(server_ip) & ntohl(server_mask)) + 1;
+    pool_last = (ntohl(server_ip) | ~ntohl(server_mask)) - 1;
+    if (pool_first == ntohl(server_ip)) {
+        pool_first++;
+    } else if (pool_last == ntohl(server_ip)) {
+        pool_last--;
+    }
+    lease_time_s = config->dhcp_lease_s;
+    rapid_commit = config->dhcp_rapid_commit;
+
+    // Saved leases on the first start after boot; leases from another
+    // subnet mean nothing now
+    if (!leases_loaded) {
+        leases_clear();
+        leases_load();
+        leases_loaded = true;
+    } else if (subnet_changed) {
+        portENTER_CRITICAL(&dhcps_lock);
+        leases_clear();
+        portEXIT_CRITICAL(&dhcps_lock);
+        save_schedule();
+    }
+    template_build(config);
+
+    err_t err = ERR_OK;
+    if (!dhcps_call(dhcps_open_cb, &err) || err != ERR_OK) {
+        ESP_LOGE(TAG, "Unable to open port %d: %d", DHCP_SERVER_PORT, err);
+        return ESP_FAIL;
+    }
+    esp_ip4_addr_t first = { .addr = htonl(pool_first) };
+    esp_ip4_addr_t last = { .addr = htonl(pool_last) };
+    ESP_LOGI(TAG, "Serving " IPSTR " - " IPSTR ", lease %lu s%s", IP2STR(&first), IP2STR(&last),
+             (unsigned long)lease_time_s, rapid_commit ? ", rapid commit" : "");
+    return ESP_OK;
+}
+
+void napt_dhcps_stop(void)
+{
+    if (dhcps_pcb == NULL) {
+        return;
+    }
+    dhcps_call(dhcps_close_cb, NULL);
+
+    // Pending changes are written now rather than lost to a power cut
+    if (save_timer != NULL) {
+        esp_timer_stop(save_timer);
+    }
+    if (save_dirty) {
+        leases_save();
+    }
+    ESP_LOGI(TAG, "Stopped");
+}
+
+bool napt_dhcps_lease_ip(const uint8_t *mac, uint32_t *ip)
+{
+    bool found = false;
+    portENTER_CRITICAL(&dhcps_lock);
+    lease_t *l = leases_loaded ? lease_by_mac(mac) : NULL;
+    if (l != NULL && l->state == LEASE_BOUND && lease_active(l, now_s())) {
+        *ip = l->ip;
+        found = true;
+    }
+    portEXIT_CRITICAL(&dhcps_lock);
+    return found;
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+esp_err_t hotspot_dhcp_get_stats(hotspot_dhcp_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&dhcps_lock);
+    *stats = dhcps_stats;
+    portEXIT_CRITICAL(&dhcps_lock);
+    stats->arp_pinned = napt_arp_pinned();
+    return ESP_OK;
+}
+
+esp_err_t hotspot_dhcp_get_leases(hotspot_dhcp_lease_t *out, size_t max, size_t *count)
+{
+    if (out == NULL || count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    lease_t snap[HOTSPOT_DHCP_MAX_LEASES];
+    portENTER_CRITICAL(&dhcps_lock);
+    memcpy(snap, leases, sizeof(snap));
+    portEXIT_CRITICAL(&dhcps_lock);
+
+    uint32_t now = now_s();
+    *count = 0;
+    for (int i = 0; i < HOTSPOT_DHCP_MAX_LEASES && *count < max; i++) {
+        const lease_t *l = &snap[i];
+        if (l->state == LEASE_FREE || l->state == LEASE_DECLINED) {
+            continue;
+        }
+        hotspot_dhcp_lease_t *o = &out[(*count)++];
+        memcpy(o->mac, l->mac, sizeof(o->mac));
+        o->ip.addr = l->ip;
+        o->bound = l->state == LEASE_BOUND && lease_active(l, now);
+        o->expires_in_s = lease_active(l, now) ? l->expires - now : 0;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,226 @@
+/***************************************************************************************
+ *  File        : napt_dns_cache.cpp
+ *  Description : Small answer cache in front of the upstream resolver
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Whole upstream answers are stored and replayed with the client's ID and
+ *     question and with TTLs reduced by the time spent in the cache.
+ *   - Only positive, untruncated, single-question answers are cached.
+ *   - Owned by the DNS forwarder task; no locking.
+ ***************************************************************************************/
+
+#include <string.h>
+#include "napt_internal.h"
+
+#ifndef HOTSPOT_DNS_CACHE_ENTRIES
+#define HOTSPOT_DNS_CACHE_ENTRIES 8
+#endif
+
+#ifndef HOTSPOT_DNS_CACHE_MAX_TTL_S
+#define HOTSPOT_DNS_CACHE_MAX_TTL_S 3600
+#endif
+
+// Plain UDP DNS limit, same as the forwarder buffers
+#define DNS_CACHE_MSG_MAX 512
+
+// ============================================================================
+// CACHE STATE
+// ============================================================================
+typedef struct {
+    uint32_t hash;          // Question hash, 0 = free
+    uint32_t stored_ms;
+    uint32_t expires_ms;
+    uint16_t len;
+    uint16_t qlen;          // Question section length (qname + type + class)
+    uint8_t msg[DNS_CACHE_MSG_MAX];
+} cache_entry_t;
+
+static cache_entry_t cache[HOTSPOT_DNS_CACHE_ENTRIES];
+
+static inline bool cache_live(const cache_entry_t *e, uint32_t now_ms)
+{
+    return e->hash != 0 && (int32_t)(e->expires_ms - now_ms) > 0;
+}
+
+static inline uint8_t lower(uint8_t c)
+{
+    return (c >= 'A' && c <= 'Z') ? (uint8_t)(c - 'A' + 'a') : c;
+}
+
+// ============================================================================
+// QUESTION KEY
+// ============================================================================
+// The first question always starts at offset 12 and is never compressed, so
+// its raw bytes are the key. Label text is compared case-insensitively
+// (clients randomize case); length bytes, QTYPE and QCLASS are compared raw.
+// ============================================================================
+static uint32_t question_hash(const uint8_t *q, int qlen)
+{
+    uint32_t h = 2166136261u;   // FNV-1a
+    int i = 0;
+    while (i < qlen - 4 && q[i] != 0) {
+        int label = q[i];
+        h = (h ^ q[i]) * 16777619u;
+        for (int j = 1; j <= label && i + j < qlen; j++) {
+            h = (h ^ lower(q[i + j])) * 16777619u;
+        }
+        i += label + 1;
+    }
+    for (; i < qlen; i++) {
+        h = (h ^ q[i]) * 16777619u;
+    }
+    return h != 0 ? h : 1;
+}
+
+static bool question_equal(const uint8_t *a, const uint8_t *b, int qlen)
+{
+    int i = 0;
+    while (i < qlen - 4 && a[i] != 0) {
+        int label = a[i];
+        if (b[i] != a[i] || i + label >= qlen) {
+            return false;
+        }
+        for (int j = 1; j <= label; j++) {
+            if (lower(a[i + j]) != lower(b[i + j])) {
+                return false;
+            }
+        }
+        i += label + 1;
+    }
+    return memcmp(a + i, b + i, qlen - i) == 0;
+}
+
+// ============================================================================
+// TTL HANDLING
+// ============================================================================
+// Walks every RR after the question. With age_s == 0 returns the smallest
+// answer TTL (UINT32_MAX if none); otherwise subtracts age_s from all TTLs in
+// place. OPT pseudo-records are skipped - their TTL field holds EDNS flags.
+// ============================================================================
+static uint32_t walk_ttls(uint8_t *msg, int len, const napt_dns_msg_t *m, uint32_t age_s)
+{
+    uint32_t min_ttl = UINT32_MAX;
+    int total = m->ancount + m->nscount + m->arcount;
+    int off = m->answers_off;
+    napt_dns_rr_t rr;
+
+    for (int i = 0; i < total && off >= 0; i++) {
+        off = napt_dns_read_rr(msg, len, off, &rr, NULL, 0);
+        if (off < 0 || rr.type == NAPT_DNS_TYPE_OPT) {
+            continue;
+        }
+        if (age_s == 0) {
+            if (i < m->ancount && rr.ttl < min_ttl) {
+                min_ttl = rr.ttl;
+            }
+            continue;
+        }
+        uint32_t ttl = rr.ttl > age_s ? rr.ttl - age_s : 0;
+        uint8_t *p = msg + rr.rdata_off - 6;
+        p[0] = (uint8_t)(ttl >> 24);
+        p[1] = (uint8_t)(ttl >> 16);
+        p[2] = (uint8_t)(ttl >> 8);
+        p[3] = (uint8_t)ttl;
+    }
+    return min_ttl;
+}
+
+// ============================================================================
+// LOOKUP / STORE
+// ============================================================================
+int napt_dns_cache_lookup(const uint8_t *query, int len, const napt_dns_msg_t *q, uint8_t *out, int out_len)
+{
+    if (q->qdcount != 1 || (q->flags & (NAPT_DNS_FLAG_QR | NAPT_DNS_OPCODE_MASK)) != 0) {
+        return 0;
+    }
+    int qlen = q->answers_off - NAPT_DNS_HEADER_LEN;
+    const uint8_t *question = query + NAPT_DNS_HEADER_LEN;
+    uint32_t hash = question_hash(question, qlen);
+    uint32_t now_ms = napt_now_ms();
+
+    for (int i = 0; i < HOTSPOT_DNS_CACHE_ENTRIES; i++) {
+        cache_entry_t *e = &cache[i];
+        if (e->hash != hash || e->qlen != qlen || !cache_live(e, now_ms) || e->len > out_len ||
+            !question_equal(e->msg + NAPT_DNS_HEADER_LEN, question, qlen)) {
+            continue;
+        }
+
+        memcpy(out, e->msg, e->len);
+        out[0] = query[0];
+        out[1] = query[1];
+        memcpy(out + NAPT_DNS_HEADER_LEN, question, qlen);
+
+        uint32_t age_s = (now_ms - e->stored_ms) / 1000;
+        if (age_s > 0) {
+            static napt_dns_msg_t m;
+            if (napt_dns_parse(out, e->len, &m)) {
+                walk_ttls(out, e->len, &m, age_s);
+            }
+        }
+        return e->len;
+    }
+    return 0;
+}
+
+void napt_dns_cache_store(const uint8_t *msg, int len)
+{
+    // Forwarder task only - keeps the parsed name off its stack
+    static napt_dns_msg_t m;
+
+    if (len > DNS_CACHE_MSG_MAX || !napt_dns_parse(msg, len, &m)) {
+        return;
+    }
+    if (!(m.flags & NAPT_DNS_FLAG_QR) || (m.flags & (NAPT_DNS_FLAG_TC | NAPT_DNS_OPCODE_MASK | NAPT_DNS_RCODE_MASK)) ||
+        m.qdcount != 1 || m.ancount == 0) {
+        return;
+    }
+
+    uint32_t ttl = walk_ttls((uint8_t *)msg, len, &m, 0);
+    if (ttl == 0 || ttl == UINT32_MAX) {
+        return;
+    }
+    if (ttl > HOTSPOT_DNS_CACHE_MAX_TTL_S) {
+        ttl = HOTSPOT_DNS_CACHE_MAX_TTL_S;
+    }
+
+    int qlen = m.answers_off - NAPT_DNS_HEADER_LEN;
+    uint32_t hash = question_hash(msg + NAPT_DNS_HEADER_LEN, qlen);
+    uint32_t now_ms = napt_now_ms();
+
+    // Same question, else a free or expired entry, else the one expiring first
+    cache_entry_t *target = NULL;
+    for (int i = 0; i < HOTSPOT_DNS_CACHE_ENTRIES; i++) {
+        cache_entry_t *e = &cache[i];
+        if (e->hash == hash && e->qlen == qlen && question_equal(e->msg + NAPT_DNS_HEADER_LEN, msg + NAPT_DNS_HEADER_LEN, qlen)) {
+            target = e;
+            break;
+        }
+        if (target == NULL || (cache_live(target, now_ms) &&
+            (!cache_live(e, now_ms) || (int32_t)(e->expires_ms - target->expires_ms) < 0))) {
+            target = e;
+        }
+    }
+
+    memcpy(target->msg, msg, len);
+    target->len = (uint16_t)len;
+    target->qlen = (uint16_t)qlen;
+    target->hash = hash;
+    target->stored_ms = now_ms;
+    target->expires_ms = now_ms + ttl * 1000;
+}
+
+int napt_dns_cache_count(void)
+{
+    uint32_t now_ms = napt_now_ms();
+    int n = 0;
+    for (int i = 0; i < HOTSPOT_DNS_CACHE_ENTRIES; i++) {
+        if (cache_live(&cache[i], now_ms)) {
+            n++;
+        }
+    }
+    return n;
+}
@@ -0,0 +1,149 @@
+/***************************************************************************************
+ *  File        : napt_dns_msg.cpp
+ *  Description : Minimal DNS wire-format reader used by the DNS forwarder
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Read-only and bounds-checked: messages come straight off the network.
+ ***************************************************************************************/
+
+#include <string.h>
+#include <ctype.h>
+#include "napt_internal.h"
+
+// Compression pointers followed before a name is considered malformed
+#define DNS_MAX_POINTERS 16
+
+// ============================================================================
+// NAMES
+// ============================================================================
+// Reads a (possibly compressed) name starting at off into out as a dotted,
+// lowercase string without the trailing dot ("" for the root).
+// Returns the offset just past the name as it appears at off, or -1.
+// ============================================================================
+int napt_dns_read_name(const uint8_t *msg, int len, int off, char *out, size_t out_len)
+{
+    int next = -1;      // Where parsing resumes after the first pointer
+    int pointers = 0;
+    size_t pos = 0;
+
+    while (off < len) {
+        uint8_t label = msg[off];
+
+        if (label == 0) {
+            if (out != NULL && out_len > 0) {
+                out[pos < out_len ? pos : out_len - 1] = '\0';
+            }
+            return next >= 0 ? next : off + 1;
+        }
+
+        if ((label & 0xC0) == 0xC0) {
+            if (off + 1 >= len || ++pointers > DNS_MAX_POINTERS) {
+                return -1;
+            }
+            if (next < 0) {
+                next = off + 2;
+            }
+            off = ((label & 0x3F) << 8) | msg[off + 1];
+            continue;
+        }
+
+        if ((label & 0xC0) != 0 || off + 1 + label > len) {
+            return -1;
+        }
+
+        if (out != NULL) {
+            // Label plus separator plus terminator must fit
+            if (pos + label + 2 > out_len) {
+                return -1;
+            }
+            if (pos > 0) {
+                out[pos++] = '.';
+            }
+            for (int i = 0; i < label; i++) {
+                out[pos++] = (char)tolower(msg[off + 1 + i]);
+            }
+        }
+        off += 1 + label;
+    }
+    return -1;
+}
+
+// ============================================================================
+// HEADER AND QUESTION
+// ============================================================================
+bool napt_dns_parse(const uint8_t *msg, int len, napt_dns_msg_t *out)
+{
+    if (len < NAPT_DNS_HEADER_LEN) {
+        return false;
+    }
+
+    out->id = ((uint16_t)msg[0] << 8) | msg[1];
+    out->flags = ((uint16_t)msg[2] << 8) | msg[3];
+    out->qdcount = ((uint16_t)msg[4] << 8) | msg[5];
+    out->ancount = ((uint16_t)msg[6] << 8) | msg[7];
+    out->nscount = ((uint16_t)msg[8] << 8) | msg[9];
+    out->arcount = ((uint16_t)msg[10] << 8) | msg[11];
+    out->qname[0] = '\0';
+    out->qtype = 0;
+    out->qclass = 0;
+    out->answers_off = NAPT_DNS_HEADER_LEN;
+
+    // Only the first question is kept; the rest are skipped
+    int off = NAPT_DNS_HEADER_LEN;
+    for (int q = 0; q < out->qdcount; q++) {
+        off = napt_dns_read_name(msg, len, off, q == 0 ? out->qname : NULL, sizeof(out->qname));
+        if (off < 0 || off + 4 > len) {
+            return false;
+        }
+        if (q == 0) {
+            out->qtype = ((uint16_t)msg[off] << 8) | msg[off + 1];
+            out->qclass = ((uint16_t)msg[off + 2] << 8) | msg[off + 3];
+        }
+        off += 4;
+    }
+    out->answers_off = off;
+    return true;
+}
+
+// ============================================================================
+// RESOURCE RECORDS
+// ============================================================================
+// Reads the RR at off. name may be NULL if the owner name is not needed.
+// Returns the offset of the next RR, or -1.
+// ============================================================================
+int napt_dns_read_rr(const uint8_t *msg, int len, int off, napt_dns_rr_t *rr, char *name, size_t name_len)
+{
+    off = napt_dns_read_name(msg, len, off, name, name_len);
+    if (off < 0 || off + 10 > len) {
+        return -1;
+    }
+    rr->type = ((uint16_t)msg[off] << 8) | msg[off + 1];
+    rr->rclass = ((uint16_t)msg[off + 2] << 8) | msg[off + 3];
+    rr->ttl = ((uint32_t)msg[off + 4] << 24) | ((uint32_t)msg[off + 5] << 16) |
+              ((uint32_t)msg[off + 6] << 8) | msg[off + 7];
+    rr->rdlength = ((uint16_t)msg[off + 8] << 8) | msg[off + 9];
+    rr->rdata_off = off + 10;
+    if (rr->rdata_off + rr->rdlength > len) {
+        return -1;
+    }
+    return rr->rdata_off + rr->rdlength;
+}
+
+bool napt_dns_name_matches(const char *name, const char *suffix)
+{
+    size_t n = strlen(name);
+    size_t s = strlen(suffix);
+    if (s == 0 || s > n) {
+        return false;
+    }
+    if (strcmp(name + n - s, suffix) != 0) {
+        return false;
+    }
+    // Whole name, or a label boundary ("video.example.com" matches "example.com"
+    // but "badexample.com" does not)
+    return n == s || name[n - s - 1] == '.';
+}
@@ -0,0 +1,292 @@
+/***************************************************************************************
+ *  File        : napt_dns_snoop.cpp
+ *  Description : Binds resolved addresses to domain rules for traffic classification
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Port-based classification no longer works when everything is on 443, but
+ *     the DNS forwarder sees which name every address came from.
+ ***************************************************************************************/
+
+#include <string.h>
+#include "napt_dns_snoop.h"
+#include "napt_internal.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+
+#ifndef HOTSPOT_DNS_SNOOP_ENTRIES
+#define HOTSPOT_DNS_SNOOP_ENTRIES 128       // Must be a power of two
+#endif
+
+#ifndef HOTSPOT_DNS_CLASS_MAX_RULES
+#define HOTSPOT_DNS_CLASS_MAX_RULES 16
+#endif
+
+// Bindings outlive short DNS TTLs (clients keep using addresses well past
+// them) but do not linger forever
+#ifndef HOTSPOT_DNS_SNOOP_MIN_TTL_S
+#define HOTSPOT_DNS_SNOOP_MIN_TTL_S 120
+#endif
+
+#ifndef HOTSPOT_DNS_SNOOP_MAX_TTL_S
+#define HOTSPOT_DNS_SNOOP_MAX_TTL_S 3600
+#endif
+
+#define SNOOP_PROBE 8                       // Linear probe window
+#define SNOOP_MAX_NAMES 4                   // qname + CNAME targets considered
+
+static const char *TAG = "napt_dns_snoop";
+
+// ============================================================================
+// SNOOP STATE
+// ============================================================================
+typedef struct {
+    uint32_t client;        // Client address (network order), 0 = free
+    uint32_t addr;          // Resolved address (network order)
+    uint32_t expires_ms;
+    uint8_t rule;           // Index into dns_rules
+} snoop_entry_t;
+
+typedef struct {
+    char domain[64];
+    hotspot_qos_class_t cls;
+} dns_rule_t;
+
+static portMUX_TYPE snoop_lock = portMUX_INITIALIZER_UNLOCKED;
+static snoop_entry_t snoop_table[HOTSPOT_DNS_SNOOP_ENTRIES];
+static dns_rule_t dns_rules[HOTSPOT_DNS_CLASS_MAX_RULES];
+static volatile int dns_rule_count = 0;
+static hotspot_dns_snoop_stats_t snoop_stats = {};
+
+static inline uint32_t snoop_index(uint32_t client, uint32_t addr)
+{
+    return napt_flow_hash(client, 0, addr, 0, 0) & (HOTSPOT_DNS_SNOOP_ENTRIES - 1);
+}
+
+static inline bool snoop_live(const snoop_entry_t *e, uint32_t now_ms)
+{
+    return e->client != 0 && (int32_t)(e->expires_ms - now_ms) > 0;
+}
+
+// ============================================================================
+// TABLE
+// ============================================================================
+// Caller holds snoop_lock. Reuses the entry for the same pair, else the first
+// free or expired slot in the probe window, else evicts the one closest to
+// expiry.
+static void snoop_bind(uint32_t client, uint32_t addr, uint8_t rule, uint32_t ttl_s, uint32_t now_ms)
+{
+    if (ttl_s < HOTSPOT_DNS_SNOOP_MIN_TTL_S) {
+        ttl_s = HOTSPOT_DNS_SNOOP_MIN_TTL_S;
+    } else if (ttl_s > HOTSPOT_DNS_SNOOP_MAX_TTL_S) {
+        ttl_s = HOTSPOT_DNS_SNOOP_MAX_TTL_S;
+    }
+
+    uint32_t base = snoop_index(client, addr);
+    snoop_entry_t *target = NULL;
+    snoop_entry_t *victim = NULL;
+
+    for (int i = 0; i < SNOOP_PROBE; i++) {
+        snoop_entry_t *e = &snoop_table[(base + i) & (HOTSPOT_DNS_SNOOP_ENTRIES - 1)];
+        if (e->client == client && e->addr == addr) {
+            target = e;
+            break;
+        }
+        if (!snoop_live(e, now_ms)) {
+            if (target == NULL) {
+                target = e;
+            }
+        } else if (victim == NULL || (int32_t)(e->expires_ms - victim->expires_ms) < 0) {
+            victim = e;
+        }
+    }
+
+    if (target == NULL) {
+        target = victim;
+        snoop_stats.evictions++;
+    }
+
+    target->client = client;
+    target->addr = addr;
+    target->rule = rule;
+    target->expires_ms = now_ms + ttl_s * 1000;
+    snoop_stats.bindings_added++;
+}
+
+// ============================================================================
+// FORWARDER SIDE
+// ============================================================================
+// Called by the DNS forwarder with every upstream answer before it is
+// relayed to the client:
+// 1. Collect the question name and any CNAME targets
+// 2. Find the first domain rule matching one of them
+// 3. Bind each A record address to (client, rule)
+// ============================================================================
+void napt_dns_snoop_response(uint32_t client, const uint8_t *msg, int len)
+{
+    if (dns_rule_count == 0) {
+        return;
+    }
+
+    // Forwarder task only - static keeps ~1KB of names off its stack
+    static napt_dns_msg_t dns;
+    static char names[SNOOP_MAX_NAMES][NAPT_DNS_NAME_MAX];
+    int name_count = 0;
+
+    if (!napt_dns_parse(msg, len, &dns) || !(dns.flags & NAPT_DNS_FLAG_QR) || dns.qname[0] == '\0') {
+        return;
+    }
+    strcpy(names[name_count++], dns.qname);
+
+    // First pass: CNAME targets
+    int off = dns.answers_off;
+    napt_dns_rr_t rr;
+    for (int i = 0; i < dns.ancount && off >= 0; i++) {
+        off = napt_dns_read_rr(msg, len, off, &rr, NULL, 0);
+        if (off >= 0 && rr.type == NAPT_DNS_TYPE_CNAME && name_count < SNOOP_MAX_NAMES &&
+            napt_dns_read_name(msg, len, rr.rdata_off, names[name_count], NAPT_DNS_NAME_MAX) > 0) {
+            name_count++;
+        }
+    }
+
+    int rule = -1;
+    portENTER_CRITICAL(&snoop_lock);
+    snoop_stats.responses_parsed++;
+    for (int r = 0; r < dns_rule_count && rule < 0; r++) {
+        for (int n = 0; n < name_count; n++) {
+            if (napt_dns_name_matches(names[n], dns_rules[r].domain)) {
+                rule = r;
+                break;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&snoop_lock);
+
+    if (rule < 0) {
+        return;
+    }
+
+    // Second pass: A records
+    uint32_t now_ms = napt_now_ms();
+    off = dns.answers_off;
+    for (int i = 0; i < dns.ancount && off >= 0; i++) {
+        off = napt_dns_read_rr(msg, len, off, &rr, NULL, 0);
+        if (off >= 0 && rr.type == NAPT_DNS_TYPE_A && rr.rclass == NAPT_DNS_CLASS_IN && rr.rdlength == 4) {
+            uint32_t addr;
+            memcpy(&addr, msg + rr.rdata_off, 4);
+            portENTER_CRITICAL(&snoop_lock);
+            snoop_bind(client, addr, (uint8_t)rule, rr.ttl, now_ms);
+            portEXIT_CRITICAL(&snoop_lock);
+        }
+    }
+}
+
+// ============================================================================
+// FORWARDING PATH SIDE
+// ============================================================================
+// AP_IN, before NAT rewrites the source: look up (client, destination) and
+// tell the uplink scheduler which class the packet belongs to.
+// ============================================================================
+void napt_dns_snoop_on_packet(napt_hook_t hook, const napt_pkt_t *pkt)
+{
+    if (hook != NAPT_HOOK_AP_IN || dns_rule_count == 0 || pkt->ip == NULL) {
+        return;
+    }
+
+    uint32_t now_ms = napt_now_ms();
+    uint32_t base = snoop_index(pkt->src, pkt->dst);
+    int rule = -1;
+
+    portENTER_CRITICAL_SAFE(&snoop_lock);
+    for (int i = 0; i < SNOOP_PROBE; i++) {
+        const snoop_entry_t *e = &snoop_table[(base + i) & (HOTSPOT_DNS_SNOOP_ENTRIES - 1)];
+        if (e->client == pkt->src && e->addr == pkt->dst) {
+            if (snoop_live(e, now_ms) && e->rule < dns_rule_count) {
+                rule = e->rule;
+                snoop_stats.packets_marked++;
+            }
+            break;
+        }
+        if (e->client == 0) {
+            break;
+        }
+    }
+    hotspot_qos_class_t cls = rule >= 0 ? dns_rules[rule].cls : HOTSPOT_QOS_CLASS_BEST_EFFORT;
+    portEXIT_CRITICAL_SAFE(&snoop_lock);
+
+    if (rule >= 0) {
+        napt_qos_mark(pkt, cls);
+    }
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+esp_err_t hotspot_dns_class_add(const char *domain, hotspot_qos_class_t cls)
+{
+    if (domain == NULL || cls >= HOTSPOT_QOS_CLASS_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Stored lowercase without leading/trailing dots, like the parser emits
+    while (*domain == '.') {
+        domain++;
+    }
+    size_t len = strlen(domain);
+    while (len > 0 && domain[len - 1] == '.') {
+        len--;
+    }
+    if (len == 0 || len >= sizeof(dns_rules[0].domain)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+    portENTER_CRITICAL(&snoop_lock);
+    if (dns_rule_count >= HOTSPOT_DNS_CLASS_MAX_RULES) {
+        ret = ESP_ERR_NO_MEM;
+    } else {
+        dns_rule_t *r = &dns_rules[dns_rule_count];
+        for (size_t i = 0; i < len; i++) {
+            char c = domain[i];
+            r->domain[i] = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+        }
+        r->domain[len] = '\0';
+        r->cls = cls;
+        dns_rule_count++;
+    }
+    portEXIT_CRITICAL(&snoop_lock);
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Domain rule: %.*s -> class %d", (int)len, domain, cls);
+    }
+    return ret;
+}
+
+void hotspot_dns_class_clear(void)
+{
+    portENTER_CRITICAL(&snoop_lock);
+    dns_rule_count = 0;
+    memset(snoop_table, 0, sizeof(snoop_table));
+    portEXIT_CRITICAL(&snoop_lock);
+}
+
+esp_err_t hotspot_dns_snoop_get_stats(hotspot_dns_snoop_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint32_t now_ms = napt_now_ms();
+    portENTER_CRITICAL(&snoop_lock);
+    *stats = snoop_stats;
+    stats->bindings_active = 0;
+    for (int i = 0; i < HOTSPOT_DNS_SNOOP_ENTRIES; i++) {
+        if (snoop_live(&snoop_table[i], now_ms)) {
+            stats->bindings_active++;
+        }
+    }
+    portEXIT_CRITICAL(&snoop_lock);
+    return ESP_OK;
+}
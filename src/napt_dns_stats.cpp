@@ -0,0 +1,248 @@
+/***************************************************************************************
+ *  File        : napt_dns_stats.cpp
+ *  Description : Top queried names, per-client load and upstream latency
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Fixed memory: names go through a space-saving sketch keyed by a 64-bit
+ *     hash; only the tracked entries keep their string.
+ ***************************************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include "napt_dns_stats.h"
+#include "napt_internal.h"
+#include "freertos/FreeRTOS.h"
+
+#ifndef HOTSPOT_DNS_STATS_NAMES
+#define HOTSPOT_DNS_STATS_NAMES 16
+#endif
+
+#ifndef HOTSPOT_DNS_STATS_CLIENTS
+#define HOTSPOT_DNS_STATS_CLIENTS 8
+#endif
+
+#define NAME_LEN sizeof(((hotspot_dns_name_stats_t *)0)->name)
+
+// ============================================================================
+// STATS STATE
+// ============================================================================
+typedef struct {
+    uint32_t client;        // Network order, 0 = free
+    uint32_t queries;
+    uint32_t cache_hits;
+    uint32_t upstream_failures;
+    uint32_t latency_samples;
+    uint64_t latency_sum_us;
+} client_entry_t;
+
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static napt_sketch_t name_sketch;
+static char names[HOTSPOT_DNS_STATS_NAMES][NAME_LEN];   // Indexed by sketch slot
+static client_entry_t clients[HOTSPOT_DNS_STATS_CLIENTS];
+static hotspot_dns_stats_t totals = {};
+static uint64_t latency_sum_us = 0;
+static uint32_t latency_samples = 0;
+
+// FNV-1a, 64-bit so distinct names practically never share a counter. Only
+// the part that fits the table is hashed, so a name counts the same whether
+// the caller passes it whole (cache hits) or already truncated (upstream).
+static uint64_t name_hash(const char *name)
+{
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < NAME_LEN - 1 && name[i] != '\0'; i++) {
+        h = (h ^ (uint8_t)name[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+// Caller holds stats_lock. Existing entry, else a free one, else the least active.
+static client_entry_t *client_get(uint32_t client)
+{
+    client_entry_t *victim = &clients[0];
+    for (int i = 0; i < HOTSPOT_DNS_STATS_CLIENTS; i++) {
+        client_entry_t *c = &clients[i];
+        if (c->client == client) {
+            return c;
+        }
+        if (victim->client != 0 && (c->client == 0 || c->queries < victim->queries)) {
+            victim = c;
+        }
+    }
+    memset(victim, 0, sizeof(*victim));
+    victim->client = client;
+    return victim;
+}
+
+// ============================================================================
+// FORWARDER SIDE
+// ============================================================================
+// Called once per client query with how it was answered. latency_us is the
+// upstream round trip for NAPT_DNS_UPSTREAM_OK, ignored otherwise.
+// ============================================================================
+void napt_dns_stats_record(uint32_t client, const char *qname, napt_dns_outcome_t outcome, uint32_t latency_us)
+{
+    // First call comes from the forwarder task; allocation happens once
+    if (name_sketch.items == NULL) {
+        napt_sketch_t sketch;
+        if (!napt_sketch_init(&sketch, HOTSPOT_DNS_STATS_NAMES)) {
+            return;
+        }
+        portENTER_CRITICAL(&stats_lock);
+        name_sketch = sketch;
+        portEXIT_CRITICAL(&stats_lock);
+    }
+
+    uint64_t key = qname != NULL && qname[0] != '\0' ? name_hash(qname) : 0;
+
+    portENTER_CRITICAL(&stats_lock);
+    client_entry_t *c = client_get(client);
+    totals.queries++;
+    c->queries++;
+
+    switch (outcome) {
+    case NAPT_DNS_CACHE_HIT:
+        totals.cache_hits++;
+        c->cache_hits++;
+        break;
+    case NAPT_DNS_UPSTREAM_OK:
+        totals.upstream_queries++;
+        latency_sum_us += latency_us;
+        latency_samples++;
+        c->latency_sum_us += latency_us;
+        c->latency_samples++;
+        if (totals.latency_min_us == 0 || latency_us < totals.latency_min_us) {
+            totals.latency_min_us = latency_us;
+        }
+        if (latency_us > totals.latency_max_us) {
+            totals.latency_max_us = latency_us;
+        }
+        break;
+    case NAPT_DNS_UPSTREAM_FAILED:
+        totals.upstream_queries++;
+        totals.upstream_failures++;
+        c->upstream_failures++;
+        break;
+    case NAPT_DNS_DROPPED:
+        totals.upstream_queries++;
+        totals.upstream_dropped++;
+        break;
+    }
+
+    if (key != 0) {
+        bool is_new;
+        int slot = napt_sketch_add(&name_sketch, key, 1, &is_new);
+        if (slot >= 0 && is_new) {
+            strncpy(names[slot], qname, NAME_LEN - 1);
+            names[slot][NAME_LEN - 1] = '\0';
+        }
+    }
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+esp_err_t hotspot_dns_get_stats(hotspot_dns_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&stats_lock);
+    *stats = totals;
+    stats->latency_avg_us = latency_samples ? (uint32_t)(latency_sum_us / latency_samples) : 0;
+    portEXIT_CRITICAL(&stats_lock);
+    stats->cache_entries = (uint16_t)napt_dns_cache_count();
+    return ESP_OK;
+}
+
+esp_err_t hotspot_dns_get_top_names(hotspot_dns_name_stats_t *out, size_t max, size_t *count)
+{
+    if (out == NULL || count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *count = 0;
+
+    typedef struct {
+        napt_sketch_item_t items[HOTSPOT_DNS_STATS_NAMES];
+        napt_sketch_item_t sorted[HOTSPOT_DNS_STATS_NAMES];
+        char names[HOTSPOT_DNS_STATS_NAMES][NAME_LEN];
+    } snapshot_t;
+    snapshot_t *snap = (snapshot_t *)malloc(sizeof(snapshot_t));
+    if (snap == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Raw copy under the lock, sort outside it
+    napt_sketch_t copy = {};
+    portENTER_CRITICAL(&stats_lock);
+    if (name_sketch.items != NULL) {
+        copy = name_sketch;
+        copy.items = snap->items;
+        memcpy(snap->items, name_sketch.items, name_sketch.size * sizeof(napt_sketch_item_t));
+        memcpy(snap->names, names, sizeof(names));
+    }
+    portEXIT_CRITICAL(&stats_lock);
+
+    int n = napt_sketch_top(&copy, snap->sorted, HOTSPOT_DNS_STATS_NAMES);
+    for (int i = 0; i < n && (size_t)i < max; i++) {
+        memcpy(out[i].name, snap->names[snap->sorted[i].slot], NAME_LEN);
+        out[i].queries = snap->sorted[i].count;
+        out[i].error = snap->sorted[i].error;
+        (*count)++;
+    }
+    free(snap);
+    return ESP_OK;
+}
+
+esp_err_t hotspot_dns_get_client_stats(hotspot_dns_client_stats_t *out, size_t max, size_t *count)
+{
+    if (out == NULL || count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    client_entry_t snap[HOTSPOT_DNS_STATS_CLIENTS];
+    portENTER_CRITICAL(&stats_lock);
+    memcpy(snap, clients, sizeof(snap));
+    portEXIT_CRITICAL(&stats_lock);
+
+    // Insertion sort by query count, busiest first
+    for (int i = 1; i < HOTSPOT_DNS_STATS_CLIENTS; i++) {
+        client_entry_t tmp = snap[i];
+        int j = i - 1;
+        while (j >= 0 && snap[j].queries < tmp.queries) {
+            snap[j + 1] = snap[j];
+            j--;
+        }
+        snap[j + 1] = tmp;
+    }
+
+    *count = 0;
+    for (int i = 0; i < HOTSPOT_DNS_STATS_CLIENTS && *count < max; i++) {
+        if (snap[i].client == 0) {
+            continue;
+        }
+        hotspot_dns_client_stats_t *c = &out[(*count)++];
+        c->client.addr = snap[i].client;
+        c->queries = snap[i].queries;
+        c->cache_hits = snap[i].cache_hits;
+        c->upstream_failures = snap[i].upstream_failures;
+        c->latency_avg_us = snap[i].latency_samples ?
+            (uint32_t)(snap[i].latency_sum_us / snap[i].latency_samples) : 0;
+    }
+    return ESP_OK;
+}
+
+void hotspot_dns_stats_reset(void)
+{
+    portENTER_CRITICAL(&stats_lock);
+    napt_sketch_reset(&name_sketch);
+    memset(clients, 0, sizeof(clients));
+    memset(&totals, 0, sizeof(totals));
+    latency_sum_us = 0;
+    latency_samples = 0;
+    portEXIT_CRITICAL(&stats_lock);
+}
@@ -0,0 +1,333 @@
+/***************************************************************************************
+ *  File        : napt_fwd.cpp
+ *  Description : Forwarding path hooks on the AP and STA lwIP netifs
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Hooks are installed by swapping the lwIP netif input/linkoutput pointers,
+ *     so no lwIP rebuild or custom lwipopts are needed.
+ *   - Everything in here runs per packet. Keep it constant-time.
+ ***************************************************************************************/
+
+#include <string.h>
+#include "napt_internal.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_netif_net_stack.h"
+#include "lwip/netif.h"
+#include "lwip/prot/ethernet.h"
+#include "lwip/prot/ip.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/tcp.h"
+#include "lwip/prot/udp.h"
+
+static const char *TAG = "napt_fwd";
+
+// ============================================================================
+// HOOK STATE
+// ============================================================================
+static struct netif *ap_lwip = NULL;
+static netif_input_fn ap_input_orig = NULL;
+static netif_linkoutput_fn ap_linkoutput_orig = NULL;
+static struct netif *sta_lwip = NULL;
+static netif_input_fn sta_input_orig = NULL;
+static netif_linkoutput_fn sta_linkoutput_orig = NULL;
+static volatile bool fwd_active = false;
+static volatile bool fwd_paused = false;    // Hotspot suspended: drop client traffic
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+uint32_t napt_now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+// Final mixing step of MurmurHash3 - cheap and good enough for table indexing
+static inline uint32_t mix32(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+uint32_t napt_flow_hash(uint32_t a, uint16_t aport, uint32_t b, uint16_t bport, uint8_t proto)
+{
+    // Order the endpoints so both directions of a flow hash the same
+    if (a > b || (a == b && aport > bport)) {
+        uint32_t t = a; a = b; b = t;
+        uint16_t tp = aport; aport = bport; bport = tp;
+    }
+    uint32_t h = mix32(a ^ 0x9e3779b9);
+    h = mix32(h ^ b);
+    h = mix32(h ^ (((uint32_t)aport << 16) | bport));
+    return mix32(h ^ proto);
+}
+
+// ============================================================================
+// PACKET PARSER
+// ============================================================================
+bool napt_pkt_parse(struct pbuf *p, napt_pkt_t *pkt)
+{
+    memset(pkt, 0, sizeof(*pkt));
+    pkt->p = p;
+    pkt->frame_len = p->tot_len;
+
+    if (p->len < SIZEOF_ETH_HDR) {
+        return false;
+    }
+
+    uint8_t *eth = (uint8_t *)p->payload;
+    pkt->eth = eth;
+    pkt->broadcast = (eth[0] & eth[1] & eth[2] & eth[3] & eth[4] & eth[5]) == 0xff;
+    pkt->multicast = !pkt->broadcast && (eth[0] & 0x01);
+    pkt->ether_type = ((uint16_t)eth[12] << 8) | eth[13];
+    if (pkt->ether_type != ETHTYPE_IP) {
+        return false;
+    }
+
+    // IPv4 header
+    uint8_t *ip = eth + SIZEOF_ETH_HDR;
+    uint16_t avail = p->len - SIZEOF_ETH_HDR;
+    if (avail < IP_HLEN || (ip[0] >> 4) != 4) {
+        return false;
+    }
+    uint8_t hlen = (ip[0] & 0x0f) * 4;
+    if (hlen < IP_HLEN || avail < hlen) {
+        return false;
+    }
+
+    pkt->ip = ip;
+    pkt->ip_hlen = hlen;
+    pkt->ip_len = ((uint16_t)ip[2] << 8) | ip[3];
+    pkt->tos = ip[1];
+    pkt->proto = ip[9];
+    memcpy(&pkt->src, ip + 12, 4);
+    memcpy(&pkt->dst, ip + 16, 4);
+
+    // Non-first fragments carry no transport header
+    uint16_t frag_off = (((uint16_t)ip[6] << 8) | ip[7]) & IP_OFFMASK;
+    if (frag_off != 0) {
+        return true;
+    }
+
+    uint8_t *l4 = ip + hlen;
+    avail -= hlen;
+    uint16_t l4_len = pkt->ip_len > hlen ? pkt->ip_len - hlen : 0;
+
+    if (pkt->proto == IP_PROTO_TCP && avail >= TCP_HLEN) {
+        uint8_t thlen = (l4[12] >> 4) * 4;
+        if (thlen < TCP_HLEN || avail < thlen) {
+            return true;
+        }
+        pkt->l4 = l4;
+        pkt->sport = ((uint16_t)l4[0] << 8) | l4[1];
+        pkt->dport = ((uint16_t)l4[2] << 8) | l4[3];
+        pkt->seq = ((uint32_t)l4[4] << 24) | ((uint32_t)l4[5] << 16) | ((uint32_t)l4[6] << 8) | l4[7];
+        pkt->ack = ((uint32_t)l4[8] << 24) | ((uint32_t)l4[9] << 16) | ((uint32_t)l4[10] << 8) | l4[11];
+        pkt->tcp_flags = l4[13];
+        pkt->tcp_hlen = thlen;
+        pkt->payload_len = l4_len > thlen ? l4_len - thlen : 0;
+    } else if (pkt->proto == IP_PROTO_UDP && avail >= UDP_HLEN) {
+        pkt->l4 = l4;
+        pkt->sport = ((uint16_t)l4[0] << 8) | l4[1];
+        pkt->dport = ((uint16_t)l4[2] << 8) | l4[3];
+        pkt->payload_len = l4_len > UDP_HLEN ? l4_len - UDP_HLEN : 0;
+    }
+
+    return true;
+}
+
+// ============================================================================
+// AP HOOKS (client side)
+// ============================================================================
+// AP input runs in the WiFi driver task, before lwIP routes and NATs the
+// frame, so the client's own address is still in the header.
+// ============================================================================
+static err_t ap_input_hook(struct pbuf *p, struct netif *inp)
+{
+    if (fwd_paused) {
+        pbuf_free(p);
+        return ERR_OK;
+    }
+
+    napt_pkt_t pkt;
+    bool is_ip = napt_pkt_parse(p, &pkt);
+    // Everything the station sent counts, including what is filtered below
+    napt_stations_on_packet(NAPT_HOOK_AP_IN, &pkt);
+    // The reflector sees discovery queries even when the filter drops them
+    napt_reflector_on_packet(&pkt);
+    if (napt_mcast_drop(NAPT_HOOK_AP_IN, &pkt)) {
+        pbuf_free(p);
+        return ERR_OK;
+    }
+    if (is_ip) {
+        napt_dns_snoop_on_packet(NAPT_HOOK_AP_IN, &pkt);
+        napt_hitters_on_packet(NAPT_HOOK_AP_IN, &pkt);
+    }
+    return ap_input_orig(p, inp);
+}
+
+// AP linkoutput runs in the tcpip thread after NAPT has translated the
+// destination back to the client's address.
+static err_t ap_linkoutput_hook(struct netif *nif, struct pbuf *p)
+{
+    // linkoutput never owns p, so dropping is just not sending
+    if (fwd_paused) {
+        return ERR_OK;
+    }
+
+    napt_pkt_t pkt;
+    bool is_ip = napt_pkt_parse(p, &pkt);
+    if (napt_mcast_drop(NAPT_HOOK_AP_OUT, &pkt)) {
+        return ERR_OK;
+    }
+    napt_stations_on_packet(NAPT_HOOK_AP_OUT, &pkt);
+    if (is_ip) {
+        napt_hitters_on_packet(NAPT_HOOK_AP_OUT, &pkt);
+    }
+    return ap_linkoutput_orig(nif, p);
+}
+
+// ============================================================================
+// STA HOOKS (uplink side)
+// ============================================================================
+// STA input runs in the WiFi driver task before the frame is posted to the
+// tcpip thread. STA linkoutput runs in the tcpip thread once NAPT has
+// rewritten the frame; from there it goes through the QoS queues. The QoS
+// task also transmits queued frames, outside the tcpip thread, which the
+// WiFi driver's TX path allows.
+// ============================================================================
+static err_t sta_input_hook(struct pbuf *p, struct netif *inp)
+{
+    napt_pkt_t pkt;
+    bool is_ip = napt_pkt_parse(p, &pkt);
+    if (napt_mcast_drop(NAPT_HOOK_STA_IN, &pkt)) {
+        pbuf_free(p);
+        return ERR_OK;
+    }
+    if (is_ip) {
+        napt_capacity_on_packet(NAPT_HOOK_STA_IN, &pkt);
+    }
+    return sta_input_orig(p, inp);
+}
+
+// Final step before the driver. The capacity estimator is fed here, at the
+// moment the frame actually leaves, not when it was queued.
+static err_t sta_transmit(napt_pkt_t *pkt)
+{
+    if (pkt->ip != NULL) {
+        napt_capacity_on_packet(NAPT_HOOK_STA_OUT, pkt);
+    }
+    return sta_linkoutput_orig(sta_lwip, pkt->p);
+}
+
+err_t napt_fwd_sta_transmit(struct pbuf *p)
+{
+    napt_pkt_t pkt;
+    napt_pkt_parse(p, &pkt);
+    return sta_transmit(&pkt);
+}
+
+static err_t sta_linkoutput_hook(struct netif *nif, struct pbuf *p)
+{
+    napt_pkt_t pkt;
+    napt_pkt_parse(p, &pkt);
+    if (napt_mcast_drop(NAPT_HOOK_STA_OUT, &pkt)) {
+        return ERR_OK;
+    }
+
+    // QoS either takes the frame (queued/dropped) or lets it straight through
+    if (napt_qos_enqueue(&pkt, false)) {
+        return ERR_OK;
+    }
+
+    err_t err = sta_transmit(&pkt);
+    if (err == ERR_MEM && napt_qos_enqueue(&pkt, true)) {
+        // Driver out of TX buffers - QoS holds the frame instead of dropping it
+        return ERR_OK;
+    }
+    napt_qos_bypass_done(&pkt, err);
+    return err;
+}
+
+// ============================================================================
+// INSTALL / REMOVE
+// ============================================================================
+// Swapping the pointers is a single aligned word store, so frames already in
+// flight through the old function complete normally.
+// ============================================================================
+esp_err_t napt_fwd_start(esp_netif_t *ap, esp_netif_t *sta)
+{
+    if (fwd_active) {
+        return ESP_OK;
+    }
+
+    struct netif *ap_nif = ap ? (struct netif *)esp_netif_get_netif_impl(ap) : NULL;
+    struct netif *sta_nif = sta ? (struct netif *)esp_netif_get_netif_impl(sta) : NULL;
+    if (ap_nif == NULL || sta_nif == NULL) {
+        ESP_LOGE(TAG, "AP/STA lwIP netif not available");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ap_lwip = ap_nif;
+    ap_input_orig = ap_nif->input;
+    ap_linkoutput_orig = ap_nif->linkoutput;
+    ap_nif->input = ap_input_hook;
+    ap_nif->linkoutput = ap_linkoutput_hook;
+
+    sta_lwip = sta_nif;
+    sta_input_orig = sta_nif->input;
+    sta_linkoutput_orig = sta_nif->linkoutput;
+    sta_nif->input = sta_input_hook;
+    sta_nif->linkoutput = sta_linkoutput_hook;
+
+    fwd_active = true;
+    ESP_LOGI(TAG, "Forwarding path hooks installed");
+    return ESP_OK;
+}
+
+void napt_fwd_stop(void)
+{
+    if (!fwd_active) {
+        return;
+    }
+
+    // Only restore if nobody else has chained on top of us in the meantime
+    if (ap_lwip != NULL) {
+        if (ap_lwip->input == ap_input_hook) {
+            ap_lwip->input = ap_input_orig;
+        }
+        if (ap_lwip->linkoutput == ap_linkoutput_hook) {
+            ap_lwip->linkoutput = ap_linkoutput_orig;
+        }
+    }
+    if (sta_lwip != NULL) {
+        if (sta_lwip->input == sta_input_hook) {
+            sta_lwip->input = sta_input_orig;
+        }
+        if (sta_lwip->linkoutput == sta_linkoutput_hook) {
+            sta_lwip->linkoutput = sta_linkoutput_orig;
+        }
+    }
+
+    fwd_active = false;
+    fwd_paused = false;
+    ESP_LOGI(TAG, "Forwarding path hooks removed");
+}
+
+void napt_fwd_set_paused(bool paused)
+{
+    fwd_paused = paused;
+}
+
+bool napt_fwd_active(void)
+{
+    return fwd_active;
+}
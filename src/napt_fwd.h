@@ -0,0 +1,103 @@
+/***************************************************************************************
+ *  File        : napt_fwd.h
+ *  Description : Forwarding path hooks shared by the hotspot subsystems (internal)
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Not part of the public API. Only included by sources in src/.
+ ***************************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/prot/ip.h"
+
+// ============================================================================
+// HOOK POINTS
+// ============================================================================
+// The hotspot sits between two lwIP netifs. Frames are observed at the four
+// points where they enter or leave the stack:
+//
+//   [Clients] --AP_IN-->  [ESP32 lwIP + NAPT]  --STA_OUT--> [Router]
+//   [Clients] <--AP_OUT-- [ESP32 lwIP + NAPT]  <--STA_IN--  [Router]
+//
+// AP_IN / AP_OUT see client addresses (before NAT / after de-NAT).
+// STA_IN / STA_OUT see the STA address and NAPT-mapped ports.
+// ============================================================================
+typedef enum {
+    NAPT_HOOK_AP_IN = 0,
+    NAPT_HOOK_AP_OUT,
+    NAPT_HOOK_STA_IN,
+    NAPT_HOOK_STA_OUT,
+} napt_hook_t;
+
+// TCP flag bits as they appear in the TCP header
+#define NAPT_TCP_FIN 0x01
+#define NAPT_TCP_SYN 0x02
+#define NAPT_TCP_RST 0x04
+#define NAPT_TCP_PSH 0x08
+#define NAPT_TCP_ACK 0x10
+#define NAPT_TCP_ECE 0x40
+#define NAPT_TCP_CWR 0x80
+
+// ============================================================================
+// PARSED PACKET
+// ============================================================================
+// Zero-copy view of an Ethernet frame. Only the first pbuf of the chain is
+// parsed; when the headers do not fit in it, ip is NULL and the frame is
+// treated as opaque (it is still forwarded normally).
+// All addresses are in network byte order, ports and lengths in host order.
+// ============================================================================
+typedef struct {
+    struct pbuf *p;
+    uint8_t *eth;              // Start of Ethernet header
+    uint8_t *ip;               // Start of IPv4 header, NULL if not parsed
+    uint8_t *l4;               // Start of TCP/UDP header, NULL if not parsed
+    uint16_t frame_len;        // Total frame length (whole pbuf chain)
+    uint16_t ether_type;       // Host order
+    uint16_t ip_len;           // IPv4 total length
+    uint8_t ip_hlen;           // IPv4 header length in bytes
+    uint8_t proto;             // IPPROTO_TCP, IPPROTO_UDP, ...
+    uint8_t tos;               // IPv4 TOS byte (DSCP << 2 | ECN)
+    uint32_t src;
+    uint32_t dst;
+    uint16_t sport;
+    uint16_t dport;
+    uint8_t tcp_flags;
+    uint8_t tcp_hlen;          // TCP header length in bytes (incl. options)
+    uint32_t seq;              // Host order
+    uint32_t ack;              // Host order
+    uint16_t payload_len;      // L4 payload length
+    bool broadcast;            // Ethernet broadcast destination
+    bool multicast;            // Ethernet multicast destination (not broadcast)
+    bool qos_bypass;           // napt_qos_enqueue() let it past the queues
+    uint8_t qos_lane;          // QoS lane it was classified into when it did
+} napt_pkt_t;
+
+// ============================================================================
+// FORWARDING PATH API
+// ============================================================================
+esp_err_t napt_fwd_start(esp_netif_t *ap, esp_netif_t *sta);
+void napt_fwd_stop(void);
+bool napt_fwd_active(void);
+
+// While paused, frames to and from clients are dropped at the AP hooks; the
+// hooks themselves stay installed so resuming is a single flag write
+void napt_fwd_set_paused(bool paused);
+
+// Send a frame on the STA interface, bypassing the QoS queues
+err_t napt_fwd_sta_transmit(struct pbuf *p);
+
+// Parse an Ethernet frame into pkt. Returns true if an IPv4 header was found.
+bool napt_pkt_parse(struct pbuf *p, napt_pkt_t *pkt);
+
+// 32-bit hash of a connection as seen on one side of the NAT. The hash is
+// direction independent: both directions of a flow produce the same value.
+uint32_t napt_flow_hash(uint32_t a, uint16_t aport, uint32_t b, uint16_t bport, uint8_t proto);
+
+// Current time in milliseconds (wraps after ~49 days)
+uint32_t napt_now_ms(void);
@@ -0,0 +1,388 @@
+/***************************************************************************************
+ *  File        : napt_hitters.cpp
+ *  Description : Heavy-hitter flows and clients on the client-facing (AP) side
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Counted on the AP netif, where the client's own address is still visible
+ *     (NAT hides it on the STA side).
+ *   - The sliding window is approximated with two tumbling epochs: the previous
+ *     epoch is weighted by how much of it still overlaps the window.
+ ***************************************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "napt_hitters.h"
+#include "napt_internal.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+
+#ifndef HOTSPOT_HITTERS_FLOWS
+#define HOTSPOT_HITTERS_FLOWS 32
+#endif
+
+#ifndef HOTSPOT_HITTERS_CLIENTS
+#define HOTSPOT_HITTERS_CLIENTS 16
+#endif
+
+#ifndef HOTSPOT_HITTERS_WINDOW_MS
+#define HOTSPOT_HITTERS_WINDOW_MS 60000
+#endif
+
+// Bits per epoch for the distinct-flow estimate (power of two). Linear
+// counting stays within a few percent up to roughly this many flows.
+#ifndef HOTSPOT_HITTERS_FLOW_BITMAP
+#define HOTSPOT_HITTERS_FLOW_BITMAP 1024
+#endif
+
+static const char *TAG = "napt_hitters";
+
+// ============================================================================
+// TABLES
+// ============================================================================
+typedef struct {
+    uint32_t client;        // Network order
+    uint32_t remote;        // Network order, 0 in the client table
+    uint16_t client_port;
+    uint16_t remote_port;
+    uint8_t proto;
+    uint32_t bytes_up;
+    uint32_t bytes_down;
+} hitter_data_t;
+
+typedef struct {
+    napt_sketch_t sketch;
+    hitter_data_t *data;    // Indexed by sketch slot
+} hitter_table_t;
+
+typedef enum {
+    TABLE_FLOWS = 0,
+    TABLE_CLIENTS,
+    TABLE_MAX,
+} hitter_table_id_t;
+
+static const uint16_t table_size[TABLE_MAX] = { HOTSPOT_HITTERS_FLOWS, HOTSPOT_HITTERS_CLIENTS };
+
+static portMUX_TYPE hitters_lock = portMUX_INITIALIZER_UNLOCKED;
+static hitter_table_t tables[2][TABLE_MAX];     // [epoch][table]
+static uint32_t flow_bits[2][HOTSPOT_HITTERS_FLOW_BITMAP / 32];    // [epoch], one bit per flow hash
+static uint32_t epoch_start_ms[2];
+static int cur_epoch = 0;
+static uint32_t hitters_stop_ms = 0;
+static bool hitters_allocated = false;
+static volatile bool hitters_running = false;
+
+// Merged view of both epochs, used when answering queries
+typedef struct {
+    uint64_t key;
+    hitter_data_t data;
+    uint32_t bytes;
+    uint32_t error;
+} hitter_result_t;
+
+// Allocated once and kept - the memory ceiling is fixed by the table sizes
+static bool hitters_alloc(void)
+{
+    if (hitters_allocated) {
+        return true;
+    }
+    for (int e = 0; e < 2; e++) {
+        for (int t = 0; t < TABLE_MAX; t++) {
+            hitter_table_t *tab = &tables[e][t];
+            if (tab->data == NULL) {
+                tab->data = (hitter_data_t *)calloc(table_size[t], sizeof(hitter_data_t));
+            }
+            if (tab->data == NULL ||
+                (tab->sketch.items == NULL && !napt_sketch_init(&tab->sketch, table_size[t]))) {
+                ESP_LOGE(TAG, "Out of memory for heavy-hitter tables");
+                return false;
+            }
+        }
+    }
+    hitters_allocated = true;
+    return true;
+}
+
+static void epoch_reset(int e, uint32_t now_ms)
+{
+    for (int t = 0; t < TABLE_MAX; t++) {
+        napt_sketch_reset(&tables[e][t].sketch);
+    }
+    memset(flow_bits[e], 0, sizeof(flow_bits[e]));
+    epoch_start_ms[e] = now_ms;
+}
+
+// Caller holds hitters_lock
+static void epoch_advance(uint32_t now_ms)
+{
+    uint32_t age = now_ms - epoch_start_ms[cur_epoch];
+    if (age < HOTSPOT_HITTERS_WINDOW_MS) {
+        return;
+    }
+    if (age >= 2 * HOTSPOT_HITTERS_WINDOW_MS) {
+        // Idle for more than a window: nothing in the previous epoch overlaps
+        epoch_reset(cur_epoch ^ 1, now_ms - HOTSPOT_HITTERS_WINDOW_MS);
+    }
+    cur_epoch ^= 1;
+    epoch_reset(cur_epoch, now_ms);
+}
+
+// Caller holds hitters_lock
+static void table_add(hitter_table_t *t, uint64_t key, const hitter_data_t *id, uint32_t bytes, bool up)
+{
+    bool is_new;
+    int slot = napt_sketch_add(&t->sketch, key, bytes, &is_new);
+    if (slot < 0) {
+        return;
+    }
+    hitter_data_t *d = &t->data[slot];
+    if (is_new) {
+        *d = *id;
+    }
+    if (up) {
+        d->bytes_up += bytes;
+    } else {
+        d->bytes_down += bytes;
+    }
+}
+
+// ============================================================================
+// FORWARDING PATH SIDE
+// ============================================================================
+// AP_IN (client -> ESP, WiFi task) and AP_OUT (ESP -> client, tcpip thread).
+// Two O(log k) sketch updates per packet, regardless of traffic volume.
+// ============================================================================
+void napt_hitters_on_packet(napt_hook_t hook, const napt_pkt_t *pkt)
+{
+    if (!hitters_running || pkt->ip == NULL || (hook != NAPT_HOOK_AP_IN && hook != NAPT_HOOK_AP_OUT)) {
+        return;
+    }
+
+    bool up = hook == NAPT_HOOK_AP_IN;
+    hitter_data_t id = {};
+    id.client = up ? pkt->src : pkt->dst;
+    id.remote = up ? pkt->dst : pkt->src;
+    id.client_port = up ? pkt->sport : pkt->dport;
+    id.remote_port = up ? pkt->dport : pkt->sport;
+    id.proto = pkt->proto;
+
+    // Client address in the low word keeps flows of different clients apart
+    // even if their tuple hashes collide
+    uint64_t flow_key = ((uint64_t)napt_flow_hash(id.client, id.client_port, id.remote,
+                                                  id.remote_port, id.proto) << 32) | id.client;
+    hitter_data_t client_id = {};
+    client_id.client = id.client;
+
+    uint32_t now_ms = napt_now_ms();
+    portENTER_CRITICAL_SAFE(&hitters_lock);
+    epoch_advance(now_ms);
+    table_add(&tables[cur_epoch][TABLE_FLOWS], flow_key, &id, pkt->frame_len, up);
+    table_add(&tables[cur_epoch][TABLE_CLIENTS], id.client, &client_id, pkt->frame_len, up);
+    uint32_t bit = (uint32_t)(flow_key >> 32) & (HOTSPOT_HITTERS_FLOW_BITMAP - 1);
+    flow_bits[cur_epoch][bit >> 5] |= 1u << (bit & 31);
+    portEXIT_CRITICAL_SAFE(&hitters_lock);
+}
+
+// Linear counting over the union of both epochs: n = -m * ln(empty / m)
+uint32_t napt_hitters_active_flows(void)
+{
+    if (!hitters_running) {
+        return 0;
+    }
+    int set = 0;
+    portENTER_CRITICAL(&hitters_lock);
+    for (int i = 0; i < HOTSPOT_HITTERS_FLOW_BITMAP / 32; i++) {
+        set += __builtin_popcount(flow_bits[0][i] | flow_bits[1][i]);
+    }
+    portEXIT_CRITICAL(&hitters_lock);
+
+    int empty = HOTSPOT_HITTERS_FLOW_BITMAP - set;
+    if (empty == 0) {
+        empty = 1;      // Saturated: report the largest value the bitmap can tell apart
+    }
+    return (uint32_t)(-(float)HOTSPOT_HITTERS_FLOW_BITMAP * logf((float)empty / HOTSPOT_HITTERS_FLOW_BITMAP) + 0.5f);
+}
+
+void napt_hitters_start(void)
+{
+    if (!hitters_alloc()) {
+        return;
+    }
+    uint32_t now_ms = napt_now_ms();
+    portENTER_CRITICAL(&hitters_lock);
+    cur_epoch = 0;
+    epoch_reset(0, now_ms);
+    epoch_reset(1, now_ms - HOTSPOT_HITTERS_WINDOW_MS);
+    portEXIT_CRITICAL(&hitters_lock);
+    hitters_running = true;
+}
+
+void napt_hitters_stop(void)
+{
+    // Tables are kept so the last window can still be queried
+    hitters_running = false;
+    hitters_stop_ms = napt_now_ms();
+}
+
+// ============================================================================
+// QUERIES
+// ============================================================================
+// 1. Snapshot both epochs of the table under the lock
+// 2. Outside the lock, merge by key: current + previous * overlap
+// 3. Sort by merged bytes
+// ============================================================================
+static esp_err_t hitters_top(hitter_table_id_t t, hitter_result_t **out, int *out_count)
+{
+    if (!hitters_allocated) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int k = table_size[t];
+    napt_sketch_item_t *items = (napt_sketch_item_t *)malloc(2 * k * sizeof(napt_sketch_item_t));
+    hitter_data_t *data = (hitter_data_t *)malloc(2 * k * sizeof(hitter_data_t));
+    hitter_result_t *res = (hitter_result_t *)malloc(2 * k * sizeof(hitter_result_t));
+    if (items == NULL || data == NULL || res == NULL) {
+        free(items);
+        free(data);
+        free(res);
+        return ESP_ERR_NO_MEM;
+    }
+
+    int n[2];
+    uint32_t now_ms = napt_now_ms();
+    portENTER_CRITICAL(&hitters_lock);
+    if (hitters_running) {
+        epoch_advance(now_ms);
+    } else {
+        // Frozen tables: report them as of when tracking stopped
+        now_ms = hitters_stop_ms;
+    }
+    int cur = cur_epoch;
+    uint32_t elapsed = now_ms - epoch_start_ms[cur];
+    for (int e = 0; e < 2; e++) {
+        const hitter_table_t *tab = &tables[e == 0 ? cur : cur ^ 1][t];
+        // Raw copy only - interrupts are off while the lock is held
+        n[e] = tab->sketch.size;
+        memcpy(items + e * k, tab->sketch.items, n[e] * sizeof(napt_sketch_item_t));
+        memcpy(data + e * k, tab->data, k * sizeof(hitter_data_t));
+    }
+    portEXIT_CRITICAL(&hitters_lock);
+
+    // Fraction (in 1/1024) of the previous epoch still inside the window
+    uint32_t prev_weight = elapsed >= HOTSPOT_HITTERS_WINDOW_MS ? 0 :
+        (uint32_t)(((uint64_t)(HOTSPOT_HITTERS_WINDOW_MS - elapsed) << 10) / HOTSPOT_HITTERS_WINDOW_MS);
+
+    int count = 0;
+    for (int e = 0; e < 2; e++) {
+        for (int i = 0; i < n[e]; i++) {
+            const napt_sketch_item_t *it = &items[e * k + i];
+            const hitter_data_t *d = &data[e * k + it->slot];
+            uint32_t w = e == 0 ? 1024 : prev_weight;
+            uint32_t bytes = (uint32_t)(((uint64_t)it->count * w) >> 10);
+            uint32_t error = (uint32_t)(((uint64_t)it->error * w) >> 10);
+            uint32_t up = (uint32_t)(((uint64_t)d->bytes_up * w) >> 10);
+            uint32_t down = (uint32_t)(((uint64_t)d->bytes_down * w) >> 10);
+            if (bytes == 0) {
+                continue;
+            }
+
+            int j = 0;
+            while (j < count && res[j].key != it->key) {
+                j++;
+            }
+            if (j == count) {
+                res[count].key = it->key;
+                res[count].data = *d;
+                res[count].data.bytes_up = 0;
+                res[count].data.bytes_down = 0;
+                res[count].bytes = 0;
+                res[count].error = 0;
+                count++;
+            }
+            res[j].bytes += bytes;
+            res[j].error += error;
+            res[j].data.bytes_up += up;
+            res[j].data.bytes_down += down;
+        }
+    }
+    free(items);
+    free(data);
+
+    // Insertion sort, largest first - at most 2k entries
+    for (int i = 1; i < count; i++) {
+        hitter_result_t tmp = res[i];
+        int j = i - 1;
+        while (j >= 0 && res[j].bytes < tmp.bytes) {
+            res[j + 1] = res[j];
+            j--;
+        }
+        res[j + 1] = tmp;
+    }
+
+    *out = res;
+    *out_count = count;
+    return ESP_OK;
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+esp_err_t hotspot_get_top_flows(hotspot_flow_usage_t *out, size_t max, size_t *count)
+{
+    if (out == NULL || count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *count = 0;
+
+    hitter_result_t *res;
+    int n;
+    esp_err_t err = hitters_top(TABLE_FLOWS, &res, &n);
+    if (err != ESP_OK) {
+        return err;
+    }
+    for (int i = 0; i < n && (size_t)i < max; i++) {
+        hotspot_flow_usage_t *f = &out[i];
+        f->client.addr = res[i].data.client;
+        f->remote.addr = res[i].data.remote;
+        f->client_port = res[i].data.client_port;
+        f->remote_port = res[i].data.remote_port;
+        f->proto = res[i].data.proto;
+        f->bytes = res[i].bytes;
+        f->error = res[i].error;
+        f->bytes_up = res[i].data.bytes_up;
+        f->bytes_down = res[i].data.bytes_down;
+        (*count)++;
+    }
+    free(res);
+    return ESP_OK;
+}
+
+esp_err_t hotspot_get_top_clients(hotspot_client_usage_t *out, size_t max, size_t *count)
+{
+    if (out == NULL || count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *count = 0;
+
+    hitter_result_t *res;
+    int n;
+    esp_err_t err = hitters_top(TABLE_CLIENTS, &res, &n);
+    if (err != ESP_OK) {
+        return err;
+    }
+    for (int i = 0; i < n && (size_t)i < max; i++) {
+        hotspot_client_usage_t *c = &out[i];
+        c->client.addr = res[i].data.client;
+        c->bytes = res[i].bytes;
+        c->error = res[i].error;
+        c->bytes_up = res[i].data.bytes_up;
+        c->bytes_down = res[i].data.bytes_down;
+        (*count)++;
+    }
+    free(res);
+    return ESP_OK;
+}
@@ -12,12 +12,20 @@
 
 
 #include <string.h>
+#include <stdlib.h>
+#include <atomic>
 #include "napt_interface.h"
+#include "napt_internal.h"
 #include "esp_log.h"
 #include "esp_netif.h"
 #include "esp_wifi.h"
+#include "esp_timer.h"
+#include "esp_random.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "lwip/dns.h"
 #include "lwip/ip4_addr.h"
 #include "lwip/sockets.h"
@@ -39,14 +47,87 @@
 #define HOTSPOT_MAX_CONNECTIONS 4
 #endif
 
+// Async enable/disable requests that can be pending at once
+#ifndef HOTSPOT_CTL_QUEUE_LEN
+#define HOTSPOT_CTL_QUEUE_LEN 4
+#endif
+
+// DNS queries that can be waiting for an upstream answer at once
+#ifndef HOTSPOT_DNS_MAX_PENDING
+#define HOTSPOT_DNS_MAX_PENDING 8
+#endif
+
+// Port the forwarder answers clients on (0 = ephemeral, host tests)
+#ifndef HOTSPOT_DNS_PORT
+#define HOTSPOT_DNS_PORT 53
+#endif
+
+#ifndef HOTSPOT_DNS_UPSTREAM_TIMEOUT_MS
+#define HOTSPOT_DNS_UPSTREAM_TIMEOUT_MS 2000
+#endif
+
+// Beacon interval while suspended (TU, driver maximum)
+#ifndef HOTSPOT_SUSPEND_BEACON_INTERVAL
+#define HOTSPOT_SUSPEND_BEACON_INTERVAL 60000
+#endif
+
+// Consecutive upstream DNS failures before the forwarder is reported unhealthy
+#ifndef HOTSPOT_DNS_UNHEALTHY_FAILURES
+#define HOTSPOT_DNS_UNHEALTHY_FAILURES 3
+#endif
+
+// Auto channel: channels considered (bit n = channel n), scan size and how
+// often an idle AP re-evaluates
+#ifndef HOTSPOT_AUTO_CHANNEL_MASK
+#define HOTSPOT_AUTO_CHANNEL_MASK NAPT_CHANNEL_MASK_NON_OVERLAPPING
+#endif
+
+#ifndef HOTSPOT_AUTO_CHANNEL_MAX_BSS
+#define HOTSPOT_AUTO_CHANNEL_MAX_BSS 32
+#endif
+
+#ifndef HOTSPOT_AUTO_CHANNEL_INTERVAL_S
+#define HOTSPOT_AUTO_CHANNEL_INTERVAL_S 900
+#endif
+
+// Upper bound on waiting for the driver to report the AP as started
+#ifndef HOTSPOT_AP_START_TIMEOUT_MS
+#define HOTSPOT_AP_START_TIMEOUT_MS 3000
+#endif
+
 static const char *TAG = "napt_interface";
 
+ESP_EVENT_DEFINE_BASE(HOTSPOT_EVENT);
+
 
 // ============================================================================
 // HOTSPOT STATE
 // ============================================================================
-static bool hotspot_enabled = false;
+// Written by the control path and by WiFi/IP event handlers, read from anywhere
+static std::atomic<hotspot_state_t> hotspot_state(HOTSPOT_STATE_STOPPED);
+static std::atomic<bool> uplink_up(false);
 static esp_netif_t *ap_netif = NULL;
+static wifi_config_t ap_active_config;     // AP config applied by hotspot_start()
+static hotspot_config_t hotspot_config;     // Current / next configuration, see config_get()
+static bool hotspot_config_set = false;
+
+// AP channel as last applied; migrations counts moves to follow the STA
+static wifi_second_chan_t ap_second_chan = WIFI_SECOND_CHAN_NONE;
+static uint32_t channel_migrations = 0;
+static esp_timer_handle_t channel_timer = NULL;    // Periodic auto channel re-check
+
+// Idle mode: one-shot timer armed while no clients are connected, and the
+// application's probe request event mask bit while we override it
+static esp_timer_handle_t idle_timer = NULL;
+static std::atomic<bool> idle_wake_pending(false);
+static std::atomic<uint16_t> idle_timeout_s(0);     // config idle_timeout_s, read without the control mutex
+static uint32_t idle_saved_probe_mask = WIFI_EVENT_MASK_AP_PROBEREQRECVED;
+
+// WiFi driver events that bring-up waits on
+#define AP_STARTED_BIT (1 << 0)
+static EventGroupHandle_t wifi_event_group = NULL;
+static esp_event_handler_instance_t wifi_event_instance = NULL;
+static esp_event_handler_instance_t ip_event_instance = NULL;
 
 // NAT (Network Address Translation) state for internet sharing
 static bool napt_enabled = false;
@@ -55,10 +136,34 @@ static uint32_t napt_address = 0;  // Track which IP address NAT is enabled on
 // ============================================================================
 // DNS FORWARDER STATE
 // ============================================================================
-static int dns_forwarder_socket = -1;
 static TaskHandle_t dns_forwarder_task_handle = NULL;
+static volatile bool dns_forwarder_run = false;     // Cleared to make the task exit
+static SemaphoreHandle_t dns_forwarder_done = NULL; // Given by the task as its last action
+
+// Sockets are created by dns_forwarder_start() and owned (closed) by the task
+static int dns_listen_socket = -1;      // Client queries, HOTSPOT_DNS_PORT
+static int dns_upstream_socket = -1;    // All upstream queries, non-blocking
+static int dns_wake_socket = -1;        // Loopback; a datagram here wakes select()
+static struct sockaddr_in dns_wake_addr;
+
+// Queries forwarded upstream and not yet answered, matched by rewritten ID
+typedef struct {
+    bool used;
+    uint16_t upstream_id;
+    uint16_t client_id;
+    struct sockaddr_in client;
+    int64_t sent_us;
+    char qname[64];             // For statistics (truncated like the stats table)
+} dns_pending_t;
+
+static dns_pending_t dns_pending[HOTSPOT_DNS_MAX_PENDING];
+static int dns_pending_limit = HOTSPOT_DNS_MAX_PENDING;    // From the config at start
 static ip_addr_t upstream_dns;  // Upstream DNS server to forward queries to
 
+// Upstream health, written by the forwarder task
+static std::atomic<uint32_t> dns_failures(0);
+static std::atomic<bool> dns_ok(true);
+
 // ============================================================================
 // NAT SUPPORT FUNCTIONS
 // ============================================================================
@@ -68,6 +173,323 @@ extern "C" {
     void ip_napt_enable(uint32_t addr, int enable);
 }
 
+// ============================================================================
+// CONFIGURATION
+// ============================================================================
+// The compile-time macros above only seed the configuration; everything at
+// runtime reads hotspot_config. Caller holds the control mutex.
+// ============================================================================
+static hotspot_config_t *config_get(void)
+{
+    if (!hotspot_config_set)
+    {
+        hotspot_config_t defaults = HOTSPOT_CONFIG_DEFAULT();
+        strncpy(defaults.ssid, DEFAULT_HOTSPOT_SSID, sizeof(defaults.ssid) - 1);
+        strncpy(defaults.password, DEFAULT_HOTSPOT_PASSWORD, sizeof(defaults.password) - 1);
+        if (strlen(defaults.password) < 8)
+        {
+            defaults.password[0] = '\0';
+        }
+        defaults.channel = HOTSPOT_CHANNEL;
+        defaults.max_connections = HOTSPOT_MAX_CONNECTIONS;
+        hotspot_config = defaults;
+        hotspot_config_set = true;
+    }
+    return &hotspot_config;
+}
+
+static bool config_valid(const hotspot_config_t *c)
+{
+    size_t ssid_len = strnlen(c->ssid, sizeof(c->ssid));
+    size_t pw_len = strnlen(c->password, sizeof(c->password));
+    if (ssid_len == 0 || ssid_len >= sizeof(c->ssid) || pw_len >= sizeof(c->password) ||
+        (pw_len > 0 && pw_len < 8))
+    {
+        return false;
+    }
+    if (c->channel < 1 || c->channel > 13 ||
+        c->max_connections < 1 || c->max_connections > ESP_WIFI_MAX_CONN_NUM ||
+        c->beacon_interval < 100 || c->beacon_interval > 60000 ||
+        (unsigned)c->wifi_profile > HOTSPOT_WIFI_PROFILE_LOW_POWER)
+    {
+        return false;
+    }
+    
+    // Contiguous mask, and the AP address must be a host address in it
+    uint32_t mask = ntohl(c->netmask.addr);
+    uint32_t ip = ntohl(c->ip.addr);
+    if (mask < 0xff000000 || mask > 0xfffffffc || (~mask & (~mask + 1)) != 0 ||
+        (ip & ~mask) == 0 || (ip & ~mask) == ~mask)
+    {
+        return false;
+    }
+    
+    if (c->dns_fallback.addr == 0 || c->dns_task_stack < 2048 ||
+        c->dns_task_priority >= configMAX_PRIORITIES ||
+        c->dns_task_core < -1 || c->dns_task_core >= portNUM_PROCESSORS ||
+        c->dns_max_pending < 1 || c->dns_max_pending > HOTSPOT_DNS_MAX_PENDING ||
+        c->admit_max_queue_pct > 100 ||
+        (c->idle_timeout_s != 0 && (c->idle_beacon_interval < c->beacon_interval || c->idle_beacon_interval > 60000)) ||
+        (c->ntp_server && (c->ntp_upstream.addr == 0 || c->ntp_poll_s < 16)) ||
+        c->dhcp_lease_s < 60)
+    {
+        return false;
+    }
+    return true;
+}
+
+static void config_to_ap(const hotspot_config_t *c, wifi_config_t *ap_config)
+{
+    memset(ap_config, 0, sizeof(*ap_config));
+    size_t ssid_len = strlen(c->ssid);
+    memcpy(ap_config->ap.ssid, c->ssid, ssid_len);
+    ap_config->ap.ssid_len = ssid_len;
+    
+    if (c->password[0] != '\0')
+    {
+        strncpy((char *)ap_config->ap.password, c->password, sizeof(ap_config->ap.password));
+        ap_config->ap.authmode = WIFI_AUTH_WPA2_PSK;
+    }
+    else
+    {
+        // No password - open network (not recommended)
+        ap_config->ap.authmode = WIFI_AUTH_OPEN;
+    }
+    
+    ap_config->ap.channel = c->channel;
+    ap_config->ap.max_connection = c->max_connections;
+    ap_config->ap.beacon_interval = c->beacon_interval;
+    ap_config->ap.dtim_period = napt_profile_dtim(c->wifi_profile);
+}
+
+// What actually goes to the driver in a given state: hidden with rare
+// beacons while suspended, slower beacons while idle
+static void config_for_state(hotspot_state_t state, const hotspot_config_t *c, wifi_config_t *applied)
+{
+    if (state == HOTSPOT_STATE_SUSPENDED)
+    {
+        applied->ap.ssid_hidden = 1;
+        applied->ap.beacon_interval = HOTSPOT_SUSPEND_BEACON_INTERVAL;
+    }
+    else if (state == HOTSPOT_STATE_IDLE)
+    {
+        applied->ap.beacon_interval = c->idle_beacon_interval;
+    }
+}
+
+// ============================================================================
+// STATE MACHINE
+// ============================================================================
+// Every transition goes through state_set() or state_transition() so each one
+// is posted exactly once. Event posts never block: a full event queue drops
+// the notification, but hotspot_get_state() is always current.
+// ============================================================================
+static const char *const state_names[] = {
+    "Stopped", "Starting", "Running", "Degraded uplink", "Suspended", "Stopping", "Idle",
+};
+
+// Time per state, charged to the previous state on every transition
+static portMUX_TYPE state_time_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint64_t state_time_us[HOTSPOT_STATE_MAX];
+static uint32_t state_entries[HOTSPOT_STATE_MAX];
+static int64_t state_since_us = 0;
+
+static void state_post(hotspot_state_t previous, hotspot_state_t state)
+{
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&state_time_lock);
+    state_time_us[previous] += now_us - state_since_us;
+    state_entries[state]++;
+    state_since_us = now_us;
+    portEXIT_CRITICAL(&state_time_lock);
+    
+    ESP_LOGI(TAG, "State: %s -> %s", state_names[previous], state_names[state]);
+    hotspot_state_event_t event = {};
+    event.previous = previous;
+    event.state = state;
+    esp_event_post(HOTSPOT_EVENT, HOTSPOT_EVENT_STATE_CHANGED, &event, sizeof(event), 0);
+}
+
+static void state_set(hotspot_state_t state)
+{
+    hotspot_state_t previous = hotspot_state.exchange(state);
+    if (previous != state) {
+        state_post(previous, state);
+    }
+}
+
+// Only moves if the current state is still `from` - event handlers use this
+// so they never undo a transition made by the control path in the meantime
+static bool state_transition(hotspot_state_t from, hotspot_state_t to)
+{
+    if (!hotspot_state.compare_exchange_strong(from, to)) {
+        return false;
+    }
+    state_post(from, to);
+    return true;
+}
+
+// State an enabled, unsuspended hotspot should be in
+static hotspot_state_t state_active(void)
+{
+    return uplink_up.load() ? HOTSPOT_STATE_RUNNING : HOTSPOT_STATE_DEGRADED_UPLINK;
+}
+
+static bool state_enabled(hotspot_state_t state)
+{
+    return state == HOTSPOT_STATE_RUNNING || state == HOTSPOT_STATE_DEGRADED_UPLINK ||
+           state == HOTSPOT_STATE_IDLE || state == HOTSPOT_STATE_SUSPENDED;
+}
+
+static void health_post(void)
+{
+    hotspot_health_t health = {};
+    health.nat_enabled = napt_enabled;
+    health.dns_ok = dns_ok.load();
+    health.dns_failures = dns_failures.load();
+    esp_event_post(HOTSPOT_EVENT, HOTSPOT_EVENT_HEALTH, &health, sizeof(health), 0);
+}
+
+static void channel_follow_async(void);
+static void channel_auto_async(void);
+static void idle_enter_async(void);
+static void idle_wake_async(void);
+static void idle_timer_arm(void);
+static void idle_timer_stop(void);
+static esp_err_t dns_forwarder_stop(void);
+
+// ============================================================================
+// WIFI EVENTS
+// ============================================================================
+// Runs on the default event loop after the esp_netif default handlers, so by
+// the time AP_STARTED_BIT is set the AP netif is already up.
+// ============================================================================
+static void uplink_changed(bool up)
+{
+    if (uplink_up.exchange(up) == up) {
+        return;
+    }
+    hotspot_state_t state = hotspot_state.load();
+    if (state == HOTSPOT_STATE_STOPPED) {
+        return;
+    }
+    
+    ESP_LOGW(TAG, "Uplink %s", up ? "restored" : "lost");
+    esp_event_post(HOTSPOT_EVENT, up ? HOTSPOT_EVENT_UPLINK_UP : HOTSPOT_EVENT_UPLINK_DOWN, NULL, 0, 0);
+    if (up) {
+        state_transition(HOTSPOT_STATE_DEGRADED_UPLINK, HOTSPOT_STATE_RUNNING);
+    } else {
+        state_transition(HOTSPOT_STATE_RUNNING, HOTSPOT_STATE_DEGRADED_UPLINK);
+    }
+}
+
+// AIDs deauthenticated by admission control; their disconnect is not a "leave"
+static std::atomic<uint32_t> rejected_aids(0);
+
+static void client_post(int32_t id, const uint8_t *mac, uint8_t aid)
+{
+    hotspot_client_event_t event = {};
+    memcpy(event.mac, mac, sizeof(event.mac));
+    event.aid = aid;
+    esp_event_post(HOTSPOT_EVENT, id, &event, sizeof(event), 0);
+}
+
+static void wifi_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (base == IP_EVENT) {
+        if (id == IP_EVENT_STA_GOT_IP) {
+            uplink_changed(true);
+        } else if (id == IP_EVENT_STA_LOST_IP) {
+            uplink_changed(false);
+        }
+        return;
+    }
+    
+    if (id == WIFI_EVENT_AP_START) {
+        xEventGroupSetBits(wifi_event_group, AP_STARTED_BIT);
+    } else if (id == WIFI_EVENT_AP_STOP) {
+        xEventGroupClearBits(wifi_event_group, AP_STARTED_BIT);
+    } else if (id == WIFI_EVENT_STA_DISCONNECTED) {
+        uplink_changed(false);
+    } else if (id == WIFI_EVENT_STA_CONNECTED) {
+        // The router may have moved (or we roamed); move the AP with it
+        if (state_enabled(hotspot_state.load())) {
+            channel_follow_async();
+        }
+    } else if (id == WIFI_EVENT_AP_PROBEREQRECVED) {
+        // Only unmasked while idle: someone is scanning, beacon normally again
+        if (hotspot_state.load() == HOTSPOT_STATE_IDLE) {
+            idle_wake_async();
+        }
+    } else if (id == WIFI_EVENT_AP_STACONNECTED) {
+        wifi_event_ap_staconnected_t *event = (wifi_event_ap_staconnected_t *)data;
+        hotspot_state_t state = hotspot_state.load();
+        if (state == HOTSPOT_STATE_SUSPENDED) {
+            // A hidden SSID still accepts stations that know it
+            esp_wifi_deauth_sta(event->aid);
+            return;
+        }
+        if (!state_enabled(state)) {
+            // Starting or stopping: the station and ARP tables are not (or
+            // no longer) there to track it
+            return;
+        }
+        idle_timer_stop();
+        if (state == HOTSPOT_STATE_IDLE) {
+            idle_wake_async();
+        }
+        
+        hotspot_reject_reason_t reason = napt_admission_check();
+        if (reason != HOTSPOT_REJECT_NONE) {
+            rejected_aids.fetch_or(1u << (event->aid & 31));
+            esp_wifi_deauth_sta(event->aid);
+            hotspot_client_rejected_t rejected = {};
+            memcpy(rejected.mac, event->mac, sizeof(rejected.mac));
+            rejected.aid = event->aid;
+            rejected.reason = reason;
+            esp_event_post(HOTSPOT_EVENT, HOTSPOT_EVENT_CLIENT_REJECTED, &rejected, sizeof(rejected), 0);
+            return;
+        }
+        napt_arp_station(event->mac, true);
+        napt_stations_join(event->mac, event->aid);
+        client_post(HOTSPOT_EVENT_CLIENT_JOINED, event->mac, event->aid);
+    } else if (id == WIFI_EVENT_AP_STADISCONNECTED) {
+        wifi_event_ap_stadisconnected_t *event = (wifi_event_ap_stadisconnected_t *)data;
+        uint32_t bit = 1u << (event->aid & 31);
+        if (rejected_aids.fetch_and(~bit) & bit) {
+            idle_timer_arm();
+            return;
+        }
+        napt_arp_station(event->mac, false);
+        napt_stations_leave(event->mac);
+        client_post(HOTSPOT_EVENT_CLIENT_LEFT, event->mac, event->aid);
+        // Possibly the last one; the timer re-checks when it fires
+        idle_timer_arm();
+    }
+}
+
+static esp_err_t wifi_events_init(void)
+{
+    if (wifi_event_group == NULL) {
+        wifi_event_group = xEventGroupCreate();
+        if (wifi_event_group == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (wifi_event_instance == NULL) {
+        esp_err_t err = esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID, wifi_event_handler,
+                                                            NULL, &wifi_event_instance);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    if (ip_event_instance == NULL) {
+        return esp_event_handler_instance_register(IP_EVENT, ESP_EVENT_ANY_ID, wifi_event_handler,
+                                                   NULL, &ip_event_instance);
+    }
+    return ESP_OK;
+}
+
 // ============================================================================
 // DNS FORWARDER TASK
 // ============================================================================
@@ -78,116 +500,875 @@ extern "C" {
 //
 // How it works:
 // 1. Client (e.g., phone) sends DNS query to 192.168.4.1:53
-// 2. ESP32 receives query and forwards it to upstream DNS (e.g., 8.8.8.8:53)
-// 3. ESP32 receives response from upstream DNS
-// 4. ESP32 forwards response back to client
+// 2. If a cached answer is still valid, it is sent straight back
+// 3. Otherwise the query gets a fresh random ID and is forwarded upstream
+//    (e.g., 8.8.8.8:53) without waiting for the answer
+// 4. The upstream answer is matched back to the client by that ID, gets the
+//    client's ID back, is forwarded to the client and cached
+//
+// Everything runs from one select() loop, so a slow upstream never holds up
+// other clients. Stopping is a datagram on a loopback wake socket, so the
+// task exits within one loop iteration and closes its own sockets.
 // ============================================================================
-static void dns_forwarder_task(void *pvParameters)
+static char dns_rx_buffer[512];
+static char dns_tx_buffer[512];
+static napt_dns_msg_t dns_query;        // Parsed client query (static: ~280 bytes)
+
+static void dns_pending_free(dns_pending_t *p, napt_dns_outcome_t outcome, uint32_t latency_us)
+{
+    napt_dns_stats_record(p->client.sin_addr.s_addr, p->qname[0] ? p->qname : NULL, outcome, latency_us);
+    p->used = false;
+    
+    // Health changes are posted on the edges only
+    if (outcome == NAPT_DNS_UPSTREAM_OK) {
+        dns_failures.store(0);
+        if (!dns_ok.exchange(true)) {
+            ESP_LOGI(TAG, "DNS Forwarder: Upstream answering again");
+            health_post();
+        }
+    } else if (outcome == NAPT_DNS_UPSTREAM_FAILED) {
+        if (dns_failures.fetch_add(1) + 1 >= HOTSPOT_DNS_UNHEALTHY_FAILURES && dns_ok.exchange(false)) {
+            ESP_LOGW(TAG, "DNS Forwarder: Upstream " IPSTR " not answering", IP2STR(&upstream_dns.u_addr.ip4));
+            health_post();
+        }
+    }
+}
+
+// Free slot, else the oldest query is given up on. That is a local shortage,
+// not a sign of upstream trouble, so it does not count towards health.
+static dns_pending_t *dns_pending_alloc(void)
+{
+    dns_pending_t *oldest = &dns_pending[0];
+    for (int i = 0; i < dns_pending_limit; i++) {
+        if (!dns_pending[i].used) {
+            return &dns_pending[i];
+        }
+        if (dns_pending[i].sent_us < oldest->sent_us) {
+            oldest = &dns_pending[i];
+        }
+    }
+    dns_pending_free(oldest, NAPT_DNS_DROPPED, 0);
+    return oldest;
+}
+
+// Random upstream ID, unique among pending queries (port is fixed, so the ID
+// is what makes off-path answer spoofing hard)
+static uint16_t dns_pending_new_id(void)
+{
+    for (;;) {
+        uint16_t id = (uint16_t)esp_random();
+        bool taken = false;
+        for (int i = 0; i < HOTSPOT_DNS_MAX_PENDING; i++) {
+            if (dns_pending[i].used && dns_pending[i].upstream_id == id) {
+                taken = true;
+                break;
+            }
+        }
+        if (!taken) {
+            return id;
+        }
+    }
+}
+
+static void dns_handle_query(void)
 {
-    static char rx_buffer[512];
-    static char tx_buffer[512];
-    struct sockaddr_in dest_addr;    // Upstream DNS server address
     struct sockaddr_in source_addr;  // Client address
     socklen_t socklen = sizeof(source_addr);
     
-    ESP_LOGI(TAG, "DNS Forwarder: Starting on port 53");
-    
-    // Create UDP socket for DNS (port 53)
-    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
-    if (sock < 0) {
-        ESP_LOGE(TAG, "DNS Forwarder: Unable to create socket: errno %d", errno);
-        vTaskDelete(NULL);
+    // Receive DNS query from client
+    int len = recvfrom(dns_listen_socket, dns_rx_buffer, sizeof(dns_rx_buffer) - 1, MSG_DONTWAIT,
+                       (struct sockaddr *)&source_addr, &socklen);
+    if (len < NAPT_DNS_HEADER_LEN) {
         return;
     }
     
-    // Bind socket to port 53 on all interfaces
-    struct sockaddr_in bind_addr;
-    bind_addr.sin_family = AF_INET;
-    bind_addr.sin_port = htons(53);  // DNS port
-    bind_addr.sin_addr.s_addr = htonl(INADDR_ANY);  // Listen on all interfaces
+    uint32_t client = source_addr.sin_addr.s_addr;
+    const char *qname = NULL;
+    if (napt_dns_parse((const uint8_t *)dns_rx_buffer, len, &dns_query)) {
+        qname = dns_query.qname;
+
+        // Answer from the cache if possible
+        int cached_len = napt_dns_cache_lookup((const uint8_t *)dns_rx_buffer, len, &dns_query,
+                                               (uint8_t *)dns_tx_buffer, sizeof(dns_tx_buffer));
+        if (cached_len > 0) {
+            sendto(dns_listen_socket, dns_tx_buffer, cached_len, 0, (struct sockaddr *)&source_addr, socklen);
+            napt_dns_stats_record(client, qname, NAPT_DNS_CACHE_HIT, 0);
+            napt_dns_snoop_response(client, (const uint8_t *)dns_tx_buffer, cached_len);
+            return;
+        }
+    }
+
+    dns_pending_t *p = dns_pending_alloc();
+    p->used = true;
+    p->client = source_addr;
+    p->client_id = ((uint16_t)(uint8_t)dns_rx_buffer[0] << 8) | (uint8_t)dns_rx_buffer[1];
+    p->upstream_id = dns_pending_new_id();
+    p->sent_us = esp_timer_get_time();
+    strncpy(p->qname, qname ? qname : "", sizeof(p->qname) - 1);
+    p->qname[sizeof(p->qname) - 1] = '\0';
     
-    int err = bind(sock, (struct sockaddr *)&bind_addr, sizeof(bind_addr));
-    if (err < 0) {
-        ESP_LOGE(TAG, "DNS Forwarder: Socket unable to bind: errno %d", errno);
-        close(sock);
-        vTaskDelete(NULL);
+    dns_rx_buffer[0] = (char)(p->upstream_id >> 8);
+    dns_rx_buffer[1] = (char)(p->upstream_id & 0xff);
+
+    // Forward DNS query to upstream DNS server
+    struct sockaddr_in dest_addr;
+    memset(&dest_addr, 0, sizeof(dest_addr));
+    dest_addr.sin_family = AF_INET;
+    dest_addr.sin_port = htons(53);
+    dest_addr.sin_addr.s_addr = upstream_dns.u_addr.ip4.addr;
+    if (sendto(dns_upstream_socket, dns_rx_buffer, len, 0, (struct sockaddr *)&dest_addr, sizeof(dest_addr)) < 0) {
+        dns_pending_free(p, NAPT_DNS_UPSTREAM_FAILED, 0);
+    }
+}
+
+static void dns_handle_response(void)
+{
+    struct sockaddr_in from;
+    socklen_t fromlen = sizeof(from);
+    
+    // Receive response from upstream DNS
+    int len = recvfrom(dns_upstream_socket, dns_tx_buffer, sizeof(dns_tx_buffer) - 1, MSG_DONTWAIT,
+                       (struct sockaddr *)&from, &fromlen);
+    if (len < NAPT_DNS_HEADER_LEN || from.sin_addr.s_addr != upstream_dns.u_addr.ip4.addr ||
+        from.sin_port != htons(53)) {
+        return;
+    }
+
+    uint16_t id = ((uint16_t)(uint8_t)dns_tx_buffer[0] << 8) | (uint8_t)dns_tx_buffer[1];
+    for (int i = 0; i < HOTSPOT_DNS_MAX_PENDING; i++) {
+        dns_pending_t *p = &dns_pending[i];
+        if (!p->used || p->upstream_id != id) {
+            continue;
+        }
+        
+        uint32_t latency_us = (uint32_t)(esp_timer_get_time() - p->sent_us);
+        dns_tx_buffer[0] = (char)(p->client_id >> 8);
+        dns_tx_buffer[1] = (char)(p->client_id & 0xff);
+        
+        // Forward response back to original client
+        sendto(dns_listen_socket, dns_tx_buffer, len, 0, (struct sockaddr *)&p->client, sizeof(p->client));
+
+        // Record which addresses this client just resolved (traffic classification)
+        napt_dns_snoop_response(p->client.sin_addr.s_addr, (const uint8_t *)dns_tx_buffer, len);
+        napt_dns_cache_store((const uint8_t *)dns_tx_buffer, len);
+        dns_pending_free(p, NAPT_DNS_UPSTREAM_OK, latency_us);
         return;
     }
+}
+
+// Fails queries the upstream never answered; returns ms until the next expiry
+static uint32_t dns_expire_pending(void)
+{
+    int64_t now_us = esp_timer_get_time();
+    int64_t timeout_us = (int64_t)HOTSPOT_DNS_UPSTREAM_TIMEOUT_MS * 1000;
+    uint32_t next_ms = 1000;
     
-    ESP_LOGI(TAG, "DNS Forwarder: Listening on 0.0.0.0:53");
+    for (int i = 0; i < HOTSPOT_DNS_MAX_PENDING; i++) {
+        dns_pending_t *p = &dns_pending[i];
+        if (!p->used) {
+            continue;
+        }
+        int64_t left_us = p->sent_us + timeout_us - now_us;
+        if (left_us <= 0) {
+            dns_pending_free(p, NAPT_DNS_UPSTREAM_FAILED, 0);
+        } else if (left_us / 1000 + 1 < next_ms) {
+            next_ms = (uint32_t)(left_us / 1000 + 1);
+        }
+    }
+    return next_ms;
+}
+
+static void dns_forwarder_task(void *pvParameters)
+{
+    ESP_LOGI(TAG, "DNS Forwarder: Listening on 0.0.0.0:%d", HOTSPOT_DNS_PORT);
     ESP_LOGI(TAG, "DNS Forwarder: Forwarding to " IPSTR, IP2STR(&upstream_dns.u_addr.ip4));
+
+    memset(dns_pending, 0, sizeof(dns_pending));
+    int maxfd = dns_listen_socket;
+    if (dns_upstream_socket > maxfd) {
+        maxfd = dns_upstream_socket;
+    }
+    if (dns_wake_socket > maxfd) {
+        maxfd = dns_wake_socket;
+    }
     
-    dns_forwarder_socket = sock;
-    
-    // Set receive timeout so we can check hotspot_enabled periodically
-    struct timeval timeout;
-    timeout.tv_sec = 1;
-    timeout.tv_usec = 0;
-    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
-    
-    // Main DNS forwarding loop - runs while hotspot is enabled
-    while (hotspot_enabled) {
-        // Receive DNS query from client
-        int len = recvfrom(sock, rx_buffer, sizeof(rx_buffer) - 1, 0, 
-                          (struct sockaddr *)&source_addr, &socklen);
+    // Main DNS forwarding loop - runs until the hotspot stops it
+    while (dns_forwarder_run) {
+        uint32_t wait_ms = dns_expire_pending();
+        uint32_t ntp_ms = napt_ntp_tick();
+        if (ntp_ms < wait_ms) {
+            wait_ms = ntp_ms;
+        }
+        struct timeval timeout;
+        timeout.tv_sec = wait_ms / 1000;
+        timeout.tv_usec = (wait_ms % 1000) * 1000;
+        
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        FD_SET(dns_listen_socket, &readfds);
+        FD_SET(dns_upstream_socket, &readfds);
+        FD_SET(dns_wake_socket, &readfds);
+        int nfds = maxfd;
+        napt_ntp_fd_set(&readfds, &nfds);
         
-        if (len < 0) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // Timeout - just continue to check hotspot_enabled
+        int n = select(nfds + 1, &readfds, NULL, NULL, &timeout);
+        if (n < 0) {
+            if (errno == EINTR) {
                 continue;
             }
-            ESP_LOGE(TAG, "DNS Forwarder: recvfrom failed: errno %d", errno);
+            ESP_LOGE(TAG, "DNS Forwarder: select failed: errno %d", errno);
             break;
         }
+        if (n == 0) {
+            continue;
+        }
         
-        if (len > 0) {
-            // Forward DNS query to upstream DNS server
-            dest_addr.sin_family = AF_INET;
-            dest_addr.sin_port = htons(53);
-            dest_addr.sin_addr.s_addr = upstream_dns.u_addr.ip4.addr;
-            
-            // Create new socket for upstream query
-            int upstream_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
-            if (upstream_sock >= 0) {
-                // Set timeout for upstream query (2 seconds)
-                struct timeval upstream_timeout;
-                upstream_timeout.tv_sec = 2;
-                upstream_timeout.tv_usec = 0;
-                setsockopt(upstream_sock, SOL_SOCKET, SO_RCVTIMEO, &upstream_timeout, sizeof upstream_timeout);
-                
-                // Send query to upstream DNS
-                sendto(upstream_sock, rx_buffer, len, 0, 
-                      (struct sockaddr *)&dest_addr, sizeof(dest_addr));
-                
-                // Receive response from upstream DNS
-                int response_len = recvfrom(upstream_sock, tx_buffer, sizeof(tx_buffer) - 1, 0, NULL, NULL);
-                
-                if (response_len > 0) {
-                    // Forward response back to original client
-                    sendto(sock, tx_buffer, response_len, 0, 
-                          (struct sockaddr *)&source_addr, socklen);
-                }
-                
-                close(upstream_sock);
+        if (FD_ISSET(dns_wake_socket, &readfds)) {
+            char drain[4];
+            while (recv(dns_wake_socket, drain, sizeof(drain), MSG_DONTWAIT) > 0) {
             }
         }
+        if (FD_ISSET(dns_upstream_socket, &readfds)) {
+            dns_handle_response();
+        }
+        if (FD_ISSET(dns_listen_socket, &readfds)) {
+            dns_handle_query();
+        }
+        napt_ntp_on_select(&readfds);
     }
     
-    // Cleanup
-    close(sock);
-    dns_forwarder_socket = -1;
+    // Cleanup - queries still in flight are counted as failed
+    for (int i = 0; i < HOTSPOT_DNS_MAX_PENDING; i++) {
+        if (dns_pending[i].used) {
+            dns_pending_free(&dns_pending[i], NAPT_DNS_UPSTREAM_FAILED, 0);
+        }
+    }
+    close(dns_listen_socket);
+    close(dns_upstream_socket);
+    close(dns_wake_socket);
+    dns_listen_socket = -1;
+    dns_upstream_socket = -1;
+    dns_wake_socket = -1;
+    napt_ntp_close();
     ESP_LOGI(TAG, "DNS Forwarder: Stopped");
+    
+    xSemaphoreGive(dns_forwarder_done);
     vTaskDelete(NULL);
 }
 
+// Creates a UDP socket bound to addr:port (port 0 = ephemeral)
+static int dns_udp_socket(uint32_t addr, uint16_t port)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0) {
+        return -1;
+    }
+    struct sockaddr_in bind_addr;
+    memset(&bind_addr, 0, sizeof(bind_addr));
+    bind_addr.sin_family = AF_INET;
+    bind_addr.sin_port = htons(port);
+    bind_addr.sin_addr.s_addr = addr;
+    if (bind(sock, (struct sockaddr *)&bind_addr, sizeof(bind_addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// Opens the sockets and starts the task. Sockets are created here rather than
+// in the task so that dns_forwarder_stop() can always reach the wake socket.
+static esp_err_t dns_forwarder_start(const hotspot_config_t *config)
+{
+    BaseType_t core = config->dns_task_core < 0 ? tskNO_AFFINITY : config->dns_task_core;
+    
+    if (dns_forwarder_task_handle != NULL) {
+        // Running, or an earlier stop gave up waiting; the old task still owns
+        // the sockets until it has exited, so its replacement has to wait
+        if (dns_forwarder_run) {
+            return ESP_OK;
+        }
+        if (dns_forwarder_stop() != ESP_OK) {
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+    if (dns_forwarder_done == NULL) {
+        dns_forwarder_done = xSemaphoreCreateBinary();
+        if (dns_forwarder_done == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    
+    ESP_LOGI(TAG, "DNS Forwarder: Starting on port %d", HOTSPOT_DNS_PORT);
+    
+    // Bind to the DNS port on all interfaces
+    dns_listen_socket = dns_udp_socket(htonl(INADDR_ANY), HOTSPOT_DNS_PORT);
+    dns_upstream_socket = dns_udp_socket(htonl(INADDR_ANY), 0);
+    dns_wake_socket = dns_udp_socket(htonl(INADDR_LOOPBACK), 0);
+    
+    socklen_t wake_len = sizeof(dns_wake_addr);
+    if (dns_listen_socket < 0 || dns_upstream_socket < 0 || dns_wake_socket < 0 ||
+        getsockname(dns_wake_socket, (struct sockaddr *)&dns_wake_addr, &wake_len) < 0) {
+        ESP_LOGE(TAG, "DNS Forwarder: Unable to create sockets: errno %d", errno);
+        goto fail;
+    }
+    
+    // NTP rides on the forwarder task; without it the hotspot still works
+    if (config->ntp_server && !napt_ntp_open(config)) {
+        ESP_LOGW(TAG, "NTP server not started");
+    }
+    
+    dns_forwarder_run = true;
+    dns_pending_limit = config->dns_max_pending;
+    dns_failures.store(0);
+    dns_ok.store(true);
+    xSemaphoreTake(dns_forwarder_done, 0);
+    if (xTaskCreatePinnedToCore(dns_forwarder_task, "dns_forwarder", config->dns_task_stack, NULL,
+                                config->dns_task_priority, &dns_forwarder_task_handle, core) != pdPASS) {
+        ESP_LOGE(TAG, "DNS Forwarder: Unable to create task");
+        dns_forwarder_task_handle = NULL;
+        dns_forwarder_run = false;
+        napt_ntp_close();
+        goto fail;
+    }
+    return ESP_OK;
+
+fail:
+    if (dns_listen_socket >= 0) {
+        close(dns_listen_socket);
+    }
+    if (dns_upstream_socket >= 0) {
+        close(dns_upstream_socket);
+    }
+    if (dns_wake_socket >= 0) {
+        close(dns_wake_socket);
+    }
+    dns_listen_socket = -1;
+    dns_upstream_socket = -1;
+    dns_wake_socket = -1;
+    return ESP_FAIL;
+}
+
+// Wakes the forwarder and waits until it has closed its sockets and exited.
+// ESP_ERR_TIMEOUT if it has not: the handle is kept, and so is everything
+// the task owns, until a later stop sees it go.
+static esp_err_t dns_forwarder_stop(void)
+{
+    if (dns_forwarder_task_handle == NULL)
+    {
+        return ESP_OK;
+    }
+    
+    ESP_LOGI(TAG, "Stopping DNS forwarder");
+    int64_t start_us = esp_timer_get_time();
+    dns_forwarder_run = false;
+    
+    // Wake it from a throwaway socket so no task-owned descriptor is touched here
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock >= 0)
+    {
+        char wake = 0;
+        sendto(sock, &wake, 1, 0, (struct sockaddr *)&dns_wake_addr, sizeof(dns_wake_addr));
+        close(sock);
+    }
+    
+    // Without loopback the select() timeout (at most 1 s) still ends the loop
+    if (xSemaphoreTake(dns_forwarder_done, pdMS_TO_TICKS(1500)) != pdTRUE)
+    {
+        ESP_LOGE(TAG, "DNS forwarder did not exit");
+        return ESP_ERR_TIMEOUT;
+    }
+    
+    dns_forwarder_task_handle = NULL;
+    ESP_LOGI(TAG, "DNS forwarder stopped (%lld us)", (long long)(esp_timer_get_time() - start_us));
+    return ESP_OK;
+}
+
 // ============================================================================
-// PUBLIC API IMPLEMENTATION
+// IDLE
 // ============================================================================
+// With no clients for idle_timeout_s the AP stays visible but beacons at
+// idle_beacon_interval, so the radio wakes for TX far less often. The driver
+// answers probe requests at any time, so a scanning client still finds the
+// AP at once; that probe (or an association) puts the normal interval back
+// before the next slow beacon would have gone out. Probe request events are
+// masked by default and only unmasked while idle, they come in constantly.
+// ============================================================================
+static void idle_probe_events(bool on)
+{
+    uint32_t mask;
+    if (esp_wifi_get_event_mask(&mask) != ESP_OK)
+    {
+        return;
+    }
+    if (on)
+    {
+        idle_saved_probe_mask = mask & WIFI_EVENT_MASK_AP_PROBEREQRECVED;
+        mask &= ~WIFI_EVENT_MASK_AP_PROBEREQRECVED;
+    }
+    else
+    {
+        mask = (mask & ~WIFI_EVENT_MASK_AP_PROBEREQRECVED) | idle_saved_probe_mask;
+    }
+    esp_wifi_set_event_mask(mask);
+}
 
+static void idle_timer_cb(void *arg)
+{
+    idle_enter_async();
+}
+
+// Called from the event loop as well; the timer itself is only created
+// under the control mutex, and the timeout is the atomic copy of the config
+static void idle_timer_arm(void)
+{
+    if (idle_timer == NULL)
+    {
+        return;
+    }
+    esp_timer_stop(idle_timer);
+    uint16_t timeout_s = idle_timeout_s.load();
+    if (timeout_s != 0)
+    {
+        esp_timer_start_once(idle_timer, (uint64_t)timeout_s * 1000000);
+    }
+}
+
+static void idle_timer_stop(void)
+{
+    if (idle_timer != NULL)
+    {
+        esp_timer_stop(idle_timer);
+    }
+}
+
+// Caller holds the control mutex
+static void idle_timer_init(void)
+{
+    if (idle_timer == NULL)
+    {
+        esp_timer_create_args_t args = {};
+        args.callback = idle_timer_cb;
+        args.name = "hotspot_idle";
+        if (esp_timer_create(&args, &idle_timer) != ESP_OK)
+        {
+            idle_timer = NULL;
+        }
+    }
+}
+
+// Caller holds the control mutex
+static esp_err_t idle_enter_locked(void)
+{
+    hotspot_state_t state = hotspot_state.load();
+    if ((state != HOTSPOT_STATE_RUNNING && state != HOTSPOT_STATE_DEGRADED_UPLINK) ||
+        config_get()->idle_timeout_s == 0)
+    {
+        return ESP_OK;
+    }
+    wifi_sta_list_t stations;
+    if (esp_wifi_ap_get_sta_list(&stations) != ESP_OK || stations.num > 0)
+    {
+        return ESP_OK;
+    }
+    
+    // Set first so a station joining during the change wakes the AP again
+    state_set(HOTSPOT_STATE_IDLE);
+    wifi_config_t applied = ap_active_config;
+    config_for_state(HOTSPOT_STATE_IDLE, config_get(), &applied);
+    esp_err_t err = esp_wifi_set_config(WIFI_IF_AP, &applied);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to apply idle AP config: %s", esp_err_to_name(err));
+        state_transition(HOTSPOT_STATE_IDLE, state_active());
+        return err;
+    }
+    idle_probe_events(true);
+    ESP_LOGI(TAG, "No clients for %d s, beacon interval %d TU", config_get()->idle_timeout_s,
+             applied.ap.beacon_interval);
+    return ESP_OK;
+}
+
+// Caller holds the control mutex
+static esp_err_t idle_wake_locked(void)
+{
+    idle_wake_pending.store(false);
+    if (hotspot_state.load() != HOTSPOT_STATE_IDLE)
+    {
+        return ESP_OK;
+    }
+    
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t err = esp_wifi_set_config(WIFI_IF_AP, &ap_active_config);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to restore AP config: %s", esp_err_to_name(err));
+        return err;
+    }
+    idle_probe_events(false);
+    state_set(state_active());
+    
+    // Woken by a probe that led nowhere: go back to idle later
+    idle_timer_arm();
+    ESP_LOGI(TAG, "Idle AP woken in %lld us", (long long)(esp_timer_get_time() - start_us));
+    return ESP_OK;
+}
+
+// ============================================================================
+// SUSPEND / RESUME
+// ============================================================================
+// Suspend keeps everything a full enable has to build up (AP netif, DHCP
+// server and its leases, DNS forwarder and cache, NAT, forwarding hooks) and
+// only changes what clients can see: the SSID is hidden, beacons become
+// rare, stations are disconnected and the AP hooks drop their traffic.
+// Resume is one esp_wifi_set_config() plus a flag write.
+// Caller holds the control mutex.
+// ============================================================================
+static esp_err_t hotspot_suspend_locked(void)
+{
+    hotspot_state_t state = hotspot_state.load();
+    if (state == HOTSPOT_STATE_SUSPENDED)
+    {
+        return ESP_OK;
+    }
+    if (!state_enabled(state))
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    int64_t start_us = esp_timer_get_time();
+    
+    // Set first so a station joining during the change is turned away
+    state_set(HOTSPOT_STATE_SUSPENDED);
+    idle_timer_stop();
+    napt_fwd_set_paused(true);
+    esp_wifi_deauth_sta(0);     // AID 0 = all stations
+    
+    wifi_config_t quiet = ap_active_config;
+    config_for_state(HOTSPOT_STATE_SUSPENDED, config_get(), &quiet);
+    esp_err_t err = esp_wifi_set_config(WIFI_IF_AP, &quiet);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to apply suspended AP config: %s", esp_err_to_name(err));
+        napt_fwd_set_paused(false);
+        state_set(state == HOTSPOT_STATE_IDLE ? HOTSPOT_STATE_IDLE : state_active());
+        return err;
+    }
+    if (state == HOTSPOT_STATE_IDLE)
+    {
+        idle_probe_events(false);
+    }
+    
+    ESP_LOGI(TAG, "Hotspot suspended in %lld us", (long long)(esp_timer_get_time() - start_us));
+    return ESP_OK;
+}
+
+static esp_err_t hotspot_resume_locked(void)
+{
+    hotspot_state_t state = hotspot_state.load();
+    if (!state_enabled(state))
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (state != HOTSPOT_STATE_SUSPENDED)
+    {
+        return ESP_OK;
+    }
+    
+    int64_t start_us = esp_timer_get_time();
+    
+    esp_err_t err = esp_wifi_set_config(WIFI_IF_AP, &ap_active_config);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to restore AP config: %s", esp_err_to_name(err));
+        return err;
+    }
+    napt_fwd_set_paused(false);
+    state_set(state_active());
+    idle_timer_arm();
+    
+    ESP_LOGI(TAG, "Hotspot resumed in %lld us", (long long)(esp_timer_get_time() - start_us));
+    return ESP_OK;
+}
+
+// ============================================================================
+// START / STOP
 // ============================================================================
-// enable_hotspot()
+
+// ============================================================================
+// CHANNEL ALIGNMENT
+// ============================================================================
+// The ESP32 has one radio. With the AP and STA on different channels it
+// time-slices between them, roughly halving throughput and adding latency
+// spikes, so the AP is put on the channel (and HT40 secondary) the STA is
+// using and moved whenever the STA reconnects elsewhere.
+// ============================================================================
+static bool channel_sta(uint8_t *primary, wifi_second_chan_t *second)
+{
+    return esp_wifi_get_channel(primary, second) == ESP_OK && *primary != 0;
+}
+
+static void channel_set_bandwidth(wifi_second_chan_t second)
+{
+    if (napt_profile_ap_ht20(config_get()->wifi_profile))
+    {
+        second = WIFI_SECOND_CHAN_NONE;
+    }
+    esp_err_t err = esp_wifi_set_bandwidth(WIFI_IF_AP, second == WIFI_SECOND_CHAN_NONE ? WIFI_BW_HT20 : WIFI_BW_HT40);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Failed to set AP bandwidth: %s", esp_err_to_name(err));
+    }
+}
+
+static void channel_post(void)
+{
+    hotspot_channel_info_t info = {};
+    hotspot_get_channel_info(&info);
+    esp_event_post(HOTSPOT_EVENT, HOTSPOT_EVENT_CHANNEL_CHANGED, &info, sizeof(info), 0);
+}
+
+// Caller holds the control mutex
+static esp_err_t channel_move_locked(uint8_t primary, wifi_second_chan_t second, const char *reason)
+{
+    hotspot_state_t state = hotspot_state.load();
+    uint8_t old_channel = ap_active_config.ap.channel;
+    wifi_config_t applied = ap_active_config;
+    applied.ap.channel = primary;
+    config_for_state(state, config_get(), &applied);
+    esp_err_t err = esp_wifi_set_config(WIFI_IF_AP, &applied);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to move AP to channel %d: %s", primary, esp_err_to_name(err));
+        return err;
+    }
+    ap_active_config.ap.channel = primary;
+    ap_second_chan = second;
+    channel_set_bandwidth(second);
+    channel_migrations++;
+    
+    ESP_LOGI(TAG, "AP channel %d -> %d%s %s (migration %lu)", old_channel, primary,
+             second == WIFI_SECOND_CHAN_NONE ? "" : (second == WIFI_SECOND_CHAN_ABOVE ? "+" : "-"),
+             reason, (unsigned long)channel_migrations);
+    channel_post();
+    return ESP_OK;
+}
+
+// Caller holds the control mutex
+static esp_err_t channel_follow_locked(void)
+{
+    uint8_t primary;
+    wifi_second_chan_t second;
+    if (!state_enabled(hotspot_state.load()) || !config_get()->follow_sta_channel || !channel_sta(&primary, &second))
+    {
+        return ESP_OK;
+    }
+    if (primary == ap_active_config.ap.channel && second == ap_second_chan)
+    {
+        return ESP_OK;
+    }
+    return channel_move_locked(primary, second, "to follow the STA");
+}
+
+// ============================================================================
+// AUTO CHANNEL
+// ============================================================================
+// Only used when there is no STA channel to follow: following is off, or the
+// uplink is down. Scanning takes the radio off channel for a few seconds,
+// so the periodic re-check only runs while no clients are connected.
+// ============================================================================
+
+// Blocking scan; returns the channel to use, or current if the scan failed
+static uint8_t channel_scan_pick(uint8_t current)
+{
+    wifi_scan_config_t scan = {};
+    scan.show_hidden = true;
+    scan.scan_type = WIFI_SCAN_TYPE_ACTIVE;
+    esp_err_t err = esp_wifi_scan_start(&scan, true);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Channel scan failed: %s", esp_err_to_name(err));
+        return current;
+    }
+    
+    uint16_t count = HOTSPOT_AUTO_CHANNEL_MAX_BSS;
+    wifi_ap_record_t *records = (wifi_ap_record_t *)calloc(count, sizeof(wifi_ap_record_t));
+    napt_scan_bss_t *bss = (napt_scan_bss_t *)calloc(count, sizeof(napt_scan_bss_t));
+    if (records == NULL || bss == NULL || esp_wifi_scan_get_ap_records(&count, records) != ESP_OK)
+    {
+        free(records);
+        free(bss);
+        return current;
+    }
+    
+    for (int i = 0; i < count; i++)
+    {
+        bss[i].primary = records[i].primary;
+        bss[i].second = (uint8_t)records[i].second;
+        bss[i].rssi = records[i].rssi;
+    }
+    uint32_t scores[NAPT_CHANNEL_MAX + 1];
+    napt_channel_score(bss, count, scores);
+    free(records);
+    free(bss);
+    
+    uint8_t pick = napt_channel_pick(scores, HOTSPOT_AUTO_CHANNEL_MASK, current);
+    ESP_LOGI(TAG, "Channel scan: %d networks, ch1=%lu ch6=%lu ch11=%lu -> channel %d", count,
+             (unsigned long)scores[1], (unsigned long)scores[6], (unsigned long)scores[11], pick);
+    return pick;
+}
+
+// No STA channel constrains the AP
+static bool channel_unconstrained(void)
+{
+    return !config_get()->follow_sta_channel || !uplink_up.load();
+}
+
+// Caller holds the control mutex
+static esp_err_t channel_auto_locked(void)
+{
+    hotspot_state_t state = hotspot_state.load();
+    if ((state != HOTSPOT_STATE_RUNNING && state != HOTSPOT_STATE_DEGRADED_UPLINK && state != HOTSPOT_STATE_IDLE) ||
+        !config_get()->auto_channel || !channel_unconstrained())
+    {
+        return ESP_OK;
+    }
+    
+    wifi_sta_list_t stations;
+    if (esp_wifi_ap_get_sta_list(&stations) != ESP_OK || stations.num > 0)
+    {
+        return ESP_OK;
+    }
+    
+    uint8_t pick = channel_scan_pick(ap_active_config.ap.channel);
+    if (pick == ap_active_config.ap.channel)
+    {
+        return ESP_OK;
+    }
+    return channel_move_locked(pick, WIFI_SECOND_CHAN_NONE, "(auto channel)");
+}
+
+static void channel_timer_cb(void *arg)
+{
+    channel_auto_async();
+}
+
+static void channel_timer_start(void)
+{
+    if (channel_timer == NULL)
+    {
+        esp_timer_create_args_t args = {};
+        args.callback = channel_timer_cb;
+        args.name = "hotspot_chan";
+        if (esp_timer_create(&args, &channel_timer) != ESP_OK)
+        {
+            channel_timer = NULL;
+            return;
+        }
+    }
+    esp_timer_stop(channel_timer);
+    esp_timer_start_periodic(channel_timer, (uint64_t)HOTSPOT_AUTO_CHANNEL_INTERVAL_S * 1000000);
+}
+
+static void channel_timer_stop(void)
+{
+    if (channel_timer != NULL)
+    {
+        esp_timer_stop(channel_timer);
+    }
+}
+
+// ============================================================================
+// LIVE RECONFIGURATION
+// ============================================================================
+// What the driver can change on a running AP goes out through
+// esp_wifi_set_config(); the rest is stored for the next enable.
+// Caller holds the control mutex.
+// ============================================================================
+static esp_err_t hotspot_configure_locked(const hotspot_config_t *config)
+{
+    hotspot_config_t *current = config_get();
+    hotspot_state_t state = hotspot_state.load();
+    
+    if (state_enabled(state))
+    {
+        if (config->wifi_profile != current->wifi_profile)
+        {
+            napt_profile_restore();
+            napt_profile_apply(config->wifi_profile);
+        }
+        
+        wifi_config_t ap_config;
+        config_to_ap(config, &ap_config);
+        // The running channel was picked at runtime (uplink or scan), not
+        // taken from the config; a config change must not undo that
+        if (config->follow_sta_channel || config->auto_channel)
+        {
+            ap_config.ap.channel = ap_active_config.ap.channel;
+        }
+        if (memcmp(&ap_config, &ap_active_config, sizeof(ap_config)) != 0 ||
+            (state == HOTSPOT_STATE_IDLE && config->idle_beacon_interval != current->idle_beacon_interval))
+        {
+            // A suspended AP stays hidden and an idle one slow; leaving that
+            // state picks up the new settings
+            wifi_config_t applied = ap_config;
+            config_for_state(state, config, &applied);
+            esp_err_t err = esp_wifi_set_config(WIFI_IF_AP, &applied);
+            if (err != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Failed to apply AP config: %s", esp_err_to_name(err));
+                return err;
+            }
+            ap_active_config = ap_config;
+            ESP_LOGI(TAG, "AP config applied: %s, channel %d, max %d clients", config->ssid,
+                     ap_config.ap.channel, config->max_connections);
+        }
+        
+        if (config->ip.addr != current->ip.addr || config->netmask.addr != current->netmask.addr ||
+            config->dns_fallback.addr != current->dns_fallback.addr ||
+            config->dns_task_stack != current->dns_task_stack ||
+            config->dns_task_priority != current->dns_task_priority ||
+            config->dns_task_core != current->dns_task_core ||
+            config->dns_max_pending != current->dns_max_pending ||
+            config->ntp_server != current->ntp_server ||
+            config->ntp_upstream.addr != current->ntp_upstream.addr ||
+            config->ntp_poll_s != current->ntp_poll_s ||
+            config->dhcp_lease_s != current->dhcp_lease_s ||
+            config->dhcp_rapid_commit != current->dhcp_rapid_commit)
+        {
+            ESP_LOGI(TAG, "Address, DNS forwarder, NTP and DHCP settings take effect on the next enable");
+        }
+    }
+    
+    *current = *config;
+    idle_timeout_s.store(config->idle_timeout_s);
+    napt_admission_configure(config);
+    if (state_enabled(state))
+    {
+        if (config->auto_channel)
+        {
+            channel_timer_start();
+        }
+        else
+        {
+            channel_timer_stop();
+        }
+        if (state == HOTSPOT_STATE_IDLE && config->idle_timeout_s == 0)
+        {
+            idle_wake_locked();
+        }
+        else if (state != HOTSPOT_STATE_SUSPENDED && state != HOTSPOT_STATE_IDLE)
+        {
+            idle_timer_arm();
+        }
+    }
+    return channel_follow_locked();
+}
+
+// ============================================================================
+// hotspot_start()
 // ============================================================================
 // Enables the ESP32 as a WiFi hotspot with full internet sharing via NAT.
+// Caller holds the control mutex.
 // 
 // Prerequisites:
 // - ESP32 must be connected to WiFi (STA mode) first
@@ -195,10 +1376,14 @@ static void dns_forwarder_task(void *pvParameters)
 //
 // What this function does:
 // 1. Creates an Access Point (AP) network interface
-// 2. Configures the AP with SSID, password, and IP (192.168.4.1)
+// 2. Configures the AP from hotspot_config_t (IP 192.168.4.1 by default)
 // 3. Switches WiFi to APSTA mode (both client and hotspot simultaneously)
-// 4. Enables NAT on the AP address for internet sharing
-// 5. Starts a DNS forwarder for automatic DNS resolution
+// 4. While the driver brings the AP up: reads the uplink settings and starts
+//    the DNS forwarder (it binds to INADDR_ANY, so it does not need the AP)
+// 5. Enables NAT on the AP address for internet sharing
+// 6. Hooks the forwarding path
+//
+// Anything started before a failure is stopped again before returning.
 //
 // Network topology after enabling:
 // [Internet] <-> [Router] <-> [ESP32 STA: 192.168.1.x] 
@@ -206,13 +1391,18 @@ static void dns_forwarder_task(void *pvParameters)
 //
 // NAT translates packets between 192.168.4.x (clients) and 192.168.1.x (internet)
 // ============================================================================
-void enable_hotspot(const char *ssid, const char *password)
+static esp_err_t hotspot_start(const hotspot_config_t *config)
 {
     // Check if hotspot is already running
-    if (hotspot_enabled)
+    hotspot_state_t state = hotspot_state.load();
+    if (state == HOTSPOT_STATE_SUSPENDED)
+    {
+        return hotspot_resume_locked();
+    }
+    if (state_enabled(state))
     {
         ESP_LOGI(TAG, "Hotspot already enabled");
-        return;
+        return ESP_OK;
     }
 
     // Verify we're connected to WiFi - this is required for internet sharing
@@ -222,10 +1412,14 @@ void enable_hotspot(const char *ssid, const char *password)
     if (sta_check == NULL || esp_netif_get_ip_info(sta_check, &sta_check_ip) != ESP_OK || sta_check_ip.ip.addr == 0)
     {
         ESP_LOGE(TAG, "Must be connected to WiFi (STA mode) before enabling hotspot");
-        return;
+        return ESP_ERR_INVALID_STATE;
     }
 
-    ESP_LOGI(TAG, "Enabling hotspot: %s", ssid ? ssid : DEFAULT_HOTSPOT_SSID);
+    ESP_LOGI(TAG, "Enabling hotspot: %s", config->ssid);
+    int64_t enable_start_us = esp_timer_get_time();
+    napt_admission_configure(config);
+    uplink_up.store(true);
+    state_set(HOTSPOT_STATE_STARTING);
 
     // Step 1: Create AP network interface if it doesn't exist
     if (ap_netif == NULL)
@@ -234,154 +1428,119 @@ void enable_hotspot(const char *ssid, const char *password)
         if (ap_netif == NULL)
         {
             ESP_LOGE(TAG, "Failed to create AP network interface");
-            return;
+            return ESP_FAIL;
         }
-        
-        // Get DNS server from STA interface (or use Google DNS as fallback)
-        // This will be used by the DNS forwarder
-        esp_netif_dns_info_t dns_info;
-        
-        // Try to get DNS from the STA interface (router's DNS)
-        esp_netif_t *sta_netif_for_dns = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
-        if (sta_netif_for_dns != NULL && 
-            esp_netif_get_dns_info(sta_netif_for_dns, ESP_NETIF_DNS_MAIN, &dns_info) == ESP_OK &&
-            dns_info.ip.u_addr.ip4.addr != 0)
-        {
-            ESP_LOGI(TAG, "Using STA's DNS: " IPSTR, IP2STR(&dns_info.ip.u_addr.ip4));
-        }
-        else
-        {
-            // Fallback to Google DNS (8.8.8.8) if STA DNS not available
-            IP4_ADDR(&dns_info.ip.u_addr.ip4, 8, 8, 8, 8);
-            ESP_LOGI(TAG, "Using fallback DNS: 8.8.8.8");
-        }
-        
-        // Configure DHCP server to advertise DNS to clients
-        // Note: This sets what DNS the DHCP server tells clients to use
-        esp_netif_dhcps_option(ap_netif, ESP_NETIF_OP_SET, ESP_NETIF_DOMAIN_NAME_SERVER, 
-                               &dns_info.ip.u_addr.ip4.addr, sizeof(dns_info.ip.u_addr.ip4.addr));
-        
-        // Step 2: Configure AP IP address and DHCP settings
-        esp_netif_dhcps_stop(ap_netif);  // Stop DHCP to reconfigure
-        
-        esp_netif_ip_info_t ap_ip_config;
-        IP4_ADDR(&ap_ip_config.ip, 192, 168, 4, 1);        // AP IP: 192.168.4.1
-        IP4_ADDR(&ap_ip_config.gw, 192, 168, 4, 1);        // Gateway: 192.168.4.1 (self)
-        IP4_ADDR(&ap_ip_config.netmask, 255, 255, 255, 0); // Subnet: 192.168.4.0/24
+
+    }
+    
+    // Step 2: Configure the AP IP address. The esp_netif DHCP server is kept
+    // off; ours (napt_dhcps.cpp) starts once the AP is up, in step 8.
+    esp_netif_dhcps_stop(ap_netif);
+    esp_netif_ip_info_t ap_ip_config;
+    if (esp_netif_get_ip_info(ap_netif, &ap_ip_config) != ESP_OK ||
+        ap_ip_config.ip.addr != config->ip.addr || ap_ip_config.netmask.addr != config->netmask.addr)
+    {
+        ap_ip_config.ip = config->ip;           // AP address
+        ap_ip_config.gw = config->ip;           // Gateway: the AP itself
+        ap_ip_config.netmask = config->netmask;
         esp_netif_set_ip_info(ap_netif, &ap_ip_config);
-        
-        esp_netif_dhcps_start(ap_netif);  // Restart DHCP server
-        ESP_LOGI(TAG, "AP configured: IP=192.168.4.1, Gateway=192.168.4.1");
+        ESP_LOGI(TAG, "AP configured: IP=" IPSTR ", Netmask=" IPSTR,
+                 IP2STR(&ap_ip_config.ip), IP2STR(&ap_ip_config.netmask));
     }
 
     // Step 3: Switch WiFi to APSTA mode (both Station and Access Point)
     // This allows ESP32 to be connected to WiFi AND act as a hotspot simultaneously
-    esp_err_t err = esp_wifi_set_mode(WIFI_MODE_APSTA);
+    esp_err_t err = wifi_events_init();
     if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "Failed to set APSTA mode: %s", esp_err_to_name(err));
-        return;
+        ESP_LOGE(TAG, "Failed to register WiFi event handler: %s", esp_err_to_name(err));
+        return err;
     }
-    
-    // Allow WiFi stack to stabilize after mode change
-    vTaskDelay(pdMS_TO_TICKS(500));
 
-    // Step 4: Configure Access Point settings (SSID, password, channel, etc.)
-    wifi_config_t ap_config = {};
-    
-    // Set SSID (network name)
-    const char *ap_ssid = ssid ? ssid : DEFAULT_HOTSPOT_SSID;
-    strncpy((char *)ap_config.ap.ssid, ap_ssid, sizeof(ap_config.ap.ssid) - 1);
-    ap_config.ap.ssid_len = strlen(ap_ssid);
-    
-    // Set password and security mode
-    if (password && strlen(password) >= 8)
-    {
-        // Use provided password (must be at least 8 characters)
-        strncpy((char *)ap_config.ap.password, password, sizeof(ap_config.ap.password) - 1);
-        ap_config.ap.authmode = WIFI_AUTH_WPA2_PSK;
-    }
-    else if (strlen(DEFAULT_HOTSPOT_PASSWORD) >= 8)
+    // If the AP is already running (APSTA left on) no AP_START will follow
+    if (esp_netif_is_netif_up(ap_netif))
     {
-        // Use default password
-        strncpy((char *)ap_config.ap.password, DEFAULT_HOTSPOT_PASSWORD, sizeof(ap_config.ap.password) - 1);
-        ap_config.ap.authmode = WIFI_AUTH_WPA2_PSK;
+        xEventGroupSetBits(wifi_event_group, AP_STARTED_BIT);
     }
     else
     {
-        // No valid password - create open network (not recommended)
-        ap_config.ap.authmode = WIFI_AUTH_OPEN;
+        xEventGroupClearBits(wifi_event_group, AP_STARTED_BIT);
     }
-    
-    ap_config.ap.channel = HOTSPOT_CHANNEL;
-    ap_config.ap.max_connection = HOTSPOT_MAX_CONNECTIONS;
-    ap_config.ap.beacon_interval = 100;
 
-    // Apply AP configuration to WiFi driver
-    err = esp_wifi_set_config(WIFI_IF_AP, &ap_config);
+    err = esp_wifi_set_mode(WIFI_MODE_APSTA);
     if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "Failed to set AP config: %s", esp_err_to_name(err));
-        return;
+        ESP_LOGE(TAG, "Failed to set APSTA mode: %s", esp_err_to_name(err));
+        return err;
     }
-
-    ESP_LOGI(TAG, "Hotspot configuration applied, waiting for AP interface...");
+    napt_profile_apply(config->wifi_profile);
     
-    // Step 5: Wait for AP interface to be fully initialized with IP address
-    int retry = 0;
-    uint32_t ap_addr = 0;
-    esp_netif_ip_info_t ap_ip_info;
+    // Step 4: Configure Access Point settings (SSID, password, channel, etc.)
+    wifi_config_t ap_config;
+    config_to_ap(config, &ap_config);
+    const char *ap_ssid = config->ssid;
     
-    while (retry < 20)  // Try for up to 2 seconds (20 * 100ms)
+    // Same channel as the STA, so the radio never has to hop between them
+    uint8_t sta_primary;
+    wifi_second_chan_t sta_second = WIFI_SECOND_CHAN_NONE;
+    if (config->follow_sta_channel && channel_sta(&sta_primary, &sta_second))
     {
-        vTaskDelay(pdMS_TO_TICKS(100));
-        
-        if (esp_netif_get_ip_info(ap_netif, &ap_ip_info) == ESP_OK)
+        ap_config.ap.channel = sta_primary;
+        ESP_LOGI(TAG, "AP channel %d (following STA)", sta_primary);
+    }
+    else
+    {
+        sta_second = WIFI_SECOND_CHAN_NONE;
+        if (config->auto_channel)
         {
-            ap_addr = ap_ip_info.ip.addr;
-            if (ap_addr != 0)
-            {
-                ESP_LOGI(TAG, "AP interface ready: " IPSTR, IP2STR(&ap_ip_info.ip));
-                break;
-            }
+            ap_config.ap.channel = channel_scan_pick(config->channel);
         }
-        retry++;
     }
-    
-    if (ap_addr == 0)
+    ap_second_chan = sta_second;
+    channel_set_bandwidth(sta_second);
+
+    // Apply AP configuration to WiFi driver
+    err = esp_wifi_set_config(WIFI_IF_AP, &ap_config);
+    if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "AP interface failed to get IP address");
-        return;
+        ESP_LOGE(TAG, "Failed to set AP config: %s", esp_err_to_name(err));
+        esp_wifi_set_mode(WIFI_MODE_STA);
+        return err;
     }
+    ap_active_config = ap_config;
 
-    // Step 6: Get STA (Station) interface information
+    ESP_LOGI(TAG, "Hotspot configuration applied, waiting for AP interface...");
+    
+    // Step 5: Get STA (Station) interface information while the AP starts
     // The STA interface is our connection to the internet via the router
     esp_netif_t *sta_netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
     if (sta_netif == NULL)
     {
         ESP_LOGE(TAG, "Failed to get STA network interface");
-        return;
+        esp_wifi_set_mode(WIFI_MODE_STA);
+        return ESP_ERR_INVALID_STATE;
     }
 
     esp_netif_ip_info_t sta_ip_info;
     if (esp_netif_get_ip_info(sta_netif, &sta_ip_info) != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to get STA IP info");
-        return;
+        esp_wifi_set_mode(WIFI_MODE_STA);
+        return ESP_ERR_INVALID_STATE;
     }
 
     uint32_t sta_addr = sta_ip_info.ip.addr;
     if (sta_addr == 0)
     {
         ESP_LOGE(TAG, "STA has no IP (not connected to internet)");
-        return;
+        esp_wifi_set_mode(WIFI_MODE_STA);
+        return ESP_ERR_INVALID_STATE;
     }
 
     ESP_LOGI(TAG, "STA IP: " IPSTR " (internet connection)", IP2STR(&sta_ip_info.ip));
     ESP_LOGI(TAG, "STA Gateway: " IPSTR, IP2STR(&sta_ip_info.gw));
-    ESP_LOGI(TAG, "AP IP: " IPSTR " (hotspot)", IP2STR(&ap_ip_info.ip));
 
-    // Step 7: Configure DNS forwarder
+    // Step 6: Configure DNS forwarder
     // Get DNS server from STA interface (or use 8.8.8.8 as fallback)
     esp_netif_dns_info_t dns_info;
     ip_addr_t dnsserver;
@@ -395,9 +1554,9 @@ void enable_hotspot(const char *ssid, const char *password)
     }
     else
     {
-        // Fallback to Google DNS (8.8.8.8)
-        dnsserver.u_addr.ip4.addr = htonl(0x08080808);  // 8.8.8.8 in network byte order
-        ESP_LOGI(TAG, "Using fallback DNS: 8.8.8.8");
+        // Fallback (8.8.8.8 unless configured otherwise)
+        dnsserver.u_addr.ip4.addr = config->dns_fallback.addr;
+        ESP_LOGI(TAG, "Using fallback DNS: " IPSTR, IP2STR(&config->dns_fallback));
     }
     dnsserver.type = IPADDR_TYPE_V4;
     
@@ -405,7 +1564,50 @@ void enable_hotspot(const char *ssid, const char *password)
     upstream_dns.type = IPADDR_TYPE_V4;
     upstream_dns.u_addr.ip4.addr = dnsserver.u_addr.ip4.addr;
     
-    // Step 8: Enable NAT (Network Address Translation) for internet sharing
+    // Step 7: Start DNS forwarder task for automatic DNS resolution
+    err = dns_forwarder_start(config);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start DNS forwarder");
+        esp_wifi_set_mode(WIFI_MODE_STA);
+        return err;
+    }
+    ESP_LOGI(TAG, "DNS forwarder started");
+
+    // Step 8: Wait for the driver to start the AP (WIFI_EVENT_AP_START), which
+    // also brings the AP netif up with its static address
+    EventBits_t bits = xEventGroupWaitBits(wifi_event_group, AP_STARTED_BIT, pdFALSE, pdTRUE,
+                                           pdMS_TO_TICKS(HOTSPOT_AP_START_TIMEOUT_MS));
+    int64_t ap_started_us = esp_timer_get_time();
+
+    uint32_t ap_addr = 0;
+    esp_netif_ip_info_t ap_ip_info;
+    if ((bits & AP_STARTED_BIT) && esp_netif_is_netif_up(ap_netif) &&
+        esp_netif_get_ip_info(ap_netif, &ap_ip_info) == ESP_OK)
+    {
+        ap_addr = ap_ip_info.ip.addr;
+    }
+    
+    if (ap_addr == 0)
+    {
+        ESP_LOGE(TAG, "AP interface not up after %d ms", HOTSPOT_AP_START_TIMEOUT_MS);
+        dns_forwarder_stop();
+        esp_wifi_set_mode(WIFI_MODE_STA);
+        return ESP_ERR_TIMEOUT;
+    }
+    ESP_LOGI(TAG, "AP interface ready: " IPSTR " (%lld ms)", IP2STR(&ap_ip_info.ip),
+             (long long)((ap_started_us - enable_start_us) / 1000));
+
+    // The AP start may have brought the esp_netif DHCP server back up. If
+    // ours can't get the port, that one is left to serve instead.
+    esp_netif_dhcps_stop(ap_netif);
+    if (napt_dhcps_start(ap_netif, config) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Falling back to the esp_netif DHCP server");
+        esp_netif_dhcps_start(ap_netif);
+    }
+
+    // Step 9: Enable NAT (Network Address Translation) for internet sharing
     // NAT translates packets between the AP network (192.168.4.x) and the internet
     // This is the KEY to making internet sharing work!
     //
@@ -420,97 +1622,581 @@ void enable_hotspot(const char *ssid, const char *password)
             vTaskDelay(pdMS_TO_TICKS(100));
         }
         
-        // Enable NAT on the AP address (192.168.4.1)
+        // Enable NAT on the AP address (192.168.4.1 by default)
         // The AP address is already in network byte order from esp_netif_get_ip_info
-        ESP_LOGI(TAG, "Enabling NAT on AP address: 192.168.4.1");
+        ESP_LOGI(TAG, "Enabling NAT on AP address: " IPSTR, IP2STR(&ap_ip_info.ip));
         ip_napt_enable(ap_addr, 1);
         
         napt_enabled = true;
         napt_address = ap_addr;
         
         ESP_LOGI(TAG, "NAT enabled successfully!");
-        ESP_LOGI(TAG, "Internet routing: Clients(192.168.4.x) -> ESP32(192.168.4.1) -> Router -> Internet");
+        ESP_LOGI(TAG, "Internet routing: Clients -> ESP32(" IPSTR ") -> Router -> Internet", IP2STR(&ap_ip_info.ip));
     }
     else
     {
         ESP_LOGI(TAG, "NAT already enabled");
     }
     
-    // Step 9: Mark hotspot as enabled
-    hotspot_enabled = true;
-    
-    // Step 10: Start DNS forwarder task for automatic DNS resolution
-    if (dns_forwarder_task_handle == NULL)
+    // Step 10: Hook the forwarding path, start the uplink capacity estimator
+    // the QoS scheduler (if configured), heavy-hitter tracking, the station
+    // table and the discovery reflector (if configured)
+    if (napt_fwd_start(ap_netif, sta_netif) == ESP_OK)
+    {
+        napt_capacity_start();
+        napt_qos_start();
+        napt_hitters_start();
+        napt_stations_start(ap_netif);
+        napt_reflector_start();
+    }
+
+    // Step 11: Mark hotspot as enabled
+    *config_get() = *config;
+    idle_timeout_s.store(config->idle_timeout_s);
+    if (config->auto_channel)
     {
-        xTaskCreate(dns_forwarder_task, "dns_forwarder", 3072, NULL, 5, &dns_forwarder_task_handle);
-        ESP_LOGI(TAG, "DNS forwarder started");
+        channel_timer_start();
     }
+    health_post();
+    state_set(state_active());
+    idle_timer_init();
+    idle_timer_arm();
     
-    ESP_LOGI(TAG, "Hotspot enabled successfully");
+    ESP_LOGI(TAG, "Hotspot enabled successfully in %lld ms",
+             (long long)((esp_timer_get_time() - enable_start_us) / 1000));
     ESP_LOGI(TAG, "SSID: %s", ap_ssid);
     ESP_LOGI(TAG, "Password: %s", ap_config.ap.authmode == WIFI_AUTH_OPEN ? "None (Open)" : "********");
-    ESP_LOGI(TAG, "IP Address: 192.168.4.1");
+    ESP_LOGI(TAG, "IP Address: " IPSTR, IP2STR(&ap_ip_info.ip));
     ESP_LOGI(TAG, "DNS: Automatic (forwarded to " IPSTR ")", IP2STR((ip4_addr_t*)&upstream_dns.u_addr.ip4.addr));
     ESP_LOGI(TAG, "NAT: Enabled (full internet sharing)");
+    return ESP_OK;
 }
 
 // ============================================================================
-// disable_hotspot()
+// hotspot_stop()
 // ============================================================================
 // Disables the hotspot and cleans up all resources.
 // This stops the DNS forwarder, disables NAT, and switches back to STA-only mode.
+// Caller holds the control mutex.
 // ============================================================================
-void disable_hotspot(void)
+static esp_err_t hotspot_stop(void)
 {
-    if (!hotspot_enabled)
+    if (!state_enabled(hotspot_state.load()))
     {
         ESP_LOGI(TAG, "Hotspot already disabled");
-        return;
+        return ESP_OK;
     }
 
     ESP_LOGI(TAG, "Disabling hotspot...");
 
-    // Step 1: Stop DNS forwarder
-    // Setting hotspot_enabled=false will cause the DNS forwarder loop to exit
-    hotspot_enabled = false;
-    
-    if (dns_forwarder_task_handle != NULL)
+    // Step 1: Stop the DNS forwarder and the DHCP server
+    hotspot_state_t previous = hotspot_state.load();
+    state_set(HOTSPOT_STATE_STOPPING);
+    channel_timer_stop();
+    idle_timer_stop();
+    if (previous == HOTSPOT_STATE_IDLE)
     {
-        ESP_LOGI(TAG, "Stopping DNS forwarder");
-        vTaskDelay(pdMS_TO_TICKS(200));  // Give task time to exit cleanly
-        
-        // Close socket if still open
-        if (dns_forwarder_socket >= 0)
-        {
-            close(dns_forwarder_socket);
-            dns_forwarder_socket = -1;
-        }
-        
-        dns_forwarder_task_handle = NULL;
-        ESP_LOGI(TAG, "DNS forwarder stopped");
+        idle_probe_events(false);
     }
+    // A forwarder that did not exit fails the stop, but the rest still goes
+    esp_err_t dns_err = dns_forwarder_stop();
+    napt_dhcps_stop();
+    napt_arp_clear();
+
+    // Step 2: Unhook the forwarding path first, so no frame reaches the
+    // subsystems while they are being stopped
+    napt_fwd_stop();
+    napt_reflector_stop();
+    napt_stations_stop();
+    napt_hitters_stop();
+    napt_qos_stop();
+    napt_capacity_stop();
 
-    // Step 2: Disable NAT
+    // Step 3: Disable NAT
     if (napt_enabled && napt_address != 0)
     {
         ESP_LOGI(TAG, "Disabling NAT");
         ip_napt_enable(napt_address, 0);
         napt_enabled = false;
         napt_address = 0;
+        health_post();
     }
 
-    // Step 3: Switch WiFi back to Station-only mode
+    // Step 4: Put back the radio settings the application had before enable
+    // (while the AP interface still exists), then switch WiFi back to
+    // Station-only mode
+    napt_profile_restore();
     esp_err_t err = esp_wifi_set_mode(WIFI_MODE_STA);
+    state_set(HOTSPOT_STATE_STOPPED);
     if (err != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to set STA mode: %s", esp_err_to_name(err));
+        return err;
+    }
+    if (dns_err != ESP_OK)
+    {
+        return dns_err;
     }
 
     ESP_LOGI(TAG, "Hotspot disabled successfully");
+    return ESP_OK;
+}
+
+// ============================================================================
+// CONTROL
+// ============================================================================
+// Start, stop, suspend and resume always run under ctl_mutex, whether called
+// directly or from the control task, so a blocking call and a queued async
+// request can never interleave.
+// ============================================================================
+typedef enum {
+    CTL_ENABLE = 0,
+    CTL_DISABLE,
+    CTL_SUSPEND,
+    CTL_RESUME,
+    CTL_CONFIGURE,
+    CTL_FOLLOW_CHANNEL,
+    CTL_AUTO_CHANNEL,
+    CTL_IDLE,
+    CTL_WAKE,
+    CTL_CALL,
+} ctl_op_t;
+
+typedef struct {
+    ctl_op_t op;
+    void (*fn)(void);       // CTL_CALL
+    bool has_ssid;
+    bool has_password;
+    char ssid[33];
+    char password[65];
+    hotspot_done_cb_t cb;
+    void *arg;
+} ctl_request_t;
+
+static portMUX_TYPE ctl_init_lock = portMUX_INITIALIZER_UNLOCKED;
+static StaticSemaphore_t ctl_mutex_buf;
+static SemaphoreHandle_t ctl_mutex = NULL;
+static StaticSemaphore_t ctl_start_mutex_buf;
+static SemaphoreHandle_t ctl_start_mutex = NULL;   // Serialises creating the control task
+static std::atomic<QueueHandle_t> ctl_queue(NULL); // Set once the control task is running
+
+static SemaphoreHandle_t ctl_get_mutex(void)
+{
+    portENTER_CRITICAL(&ctl_init_lock);
+    if (ctl_mutex == NULL)
+    {
+        ctl_mutex = xSemaphoreCreateMutexStatic(&ctl_mutex_buf);
+    }
+    portEXIT_CRITICAL(&ctl_init_lock);
+    return ctl_mutex;
+}
+
+static SemaphoreHandle_t ctl_get_start_mutex(void)
+{
+    portENTER_CRITICAL(&ctl_init_lock);
+    if (ctl_start_mutex == NULL)
+    {
+        ctl_start_mutex = xSemaphoreCreateMutexStatic(&ctl_start_mutex_buf);
+    }
+    portEXIT_CRITICAL(&ctl_init_lock);
+    return ctl_start_mutex;
+}
+
+void napt_ctl_lock(void)
+{
+    xSemaphoreTake(ctl_get_mutex(), portMAX_DELAY);
+}
+
+void napt_ctl_unlock(void)
+{
+    xSemaphoreGive(ctl_get_mutex());
+}
+
+// Enable from the stored configuration, with the SSID and password of the
+// original enable_hotspot(ssid, password) API overriding it when given
+static esp_err_t ctl_enable(const char *ssid, const char *password)
+{
+    hotspot_config_t config = *config_get();
+    if (ssid != NULL)
+    {
+        strncpy(config.ssid, ssid, sizeof(config.ssid) - 1);
+        config.ssid[sizeof(config.ssid) - 1] = '\0';
+    }
+    // Passwords under 8 characters keep the configured one, as they always have
+    if (password != NULL && strlen(password) >= 8)
+    {
+        strncpy(config.password, password, sizeof(config.password) - 1);
+        config.password[sizeof(config.password) - 1] = '\0';
+    }
+    if (!config_valid(&config))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    esp_err_t err = hotspot_start(&config);
+    if (err != ESP_OK)
+    {
+        // Every failure path has already undone its partial setup
+        napt_profile_restore();
+        state_transition(HOTSPOT_STATE_STARTING, HOTSPOT_STATE_STOPPED);
+    }
+    return err;
+}
+
+static esp_err_t ctl_run(ctl_op_t op, const char *ssid, const char *password, const hotspot_config_t *config)
+{
+    SemaphoreHandle_t mutex = ctl_get_mutex();
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    esp_err_t err;
+    switch (op)
+    {
+    case CTL_ENABLE:
+        err = ctl_enable(ssid, password);
+        break;
+    case CTL_CONFIGURE:
+        err = hotspot_configure_locked(config);
+        break;
+    case CTL_FOLLOW_CHANNEL:
+        err = channel_follow_locked();
+        break;
+    case CTL_AUTO_CHANNEL:
+        err = channel_auto_locked();
+        break;
+    case CTL_IDLE:
+        err = idle_enter_locked();
+        break;
+    case CTL_WAKE:
+        err = idle_wake_locked();
+        break;
+    case CTL_DISABLE:
+        err = hotspot_stop();
+        break;
+    case CTL_SUSPEND:
+        err = hotspot_suspend_locked();
+        break;
+    case CTL_RESUME:
+    default:
+        err = hotspot_resume_locked();
+        break;
+    }
+    xSemaphoreGive(mutex);
+    return err;
+}
+
+static void ctl_task(void *pvParameters)
+{
+    QueueHandle_t queue = (QueueHandle_t)pvParameters;
+    ctl_request_t req;
+    
+    while (true)
+    {
+        if (xQueueReceive(queue, &req, portMAX_DELAY) != pdTRUE)
+        {
+            continue;
+        }
+        if (req.op == CTL_CALL)
+        {
+            req.fn();
+            continue;
+        }
+        
+        int64_t start_us = esp_timer_get_time();
+        esp_err_t err = ctl_run(req.op, req.has_ssid ? req.ssid : NULL, req.has_password ? req.password : NULL, NULL);
+        
+        hotspot_result_t result = {};
+        result.result = err;
+        result.elapsed_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+        
+        if (req.cb != NULL)
+        {
+            req.cb(err, req.arg);
+        }
+        if (req.op == CTL_ENABLE || req.op == CTL_DISABLE)
+        {
+            esp_event_post(HOTSPOT_EVENT,
+                           req.op == CTL_ENABLE ? HOTSPOT_EVENT_ENABLE_DONE : HOTSPOT_EVENT_DISABLE_DONE,
+                           &result, sizeof(result), 0);
+        }
+    }
+}
+
+// Queue and task are created together on first use and live for good. The
+// queue is only published once its task exists, so nobody can post to a
+// queue no task reads. After a failure, every caller gets an error and the
+// next one tries again.
+static QueueHandle_t ctl_task_start(void)
+{
+    SemaphoreHandle_t mutex = ctl_get_start_mutex();
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    QueueHandle_t queue = ctl_queue.load();
+    if (queue == NULL)
+    {
+        queue = xQueueCreate(HOTSPOT_CTL_QUEUE_LEN, sizeof(ctl_request_t));
+        if (queue != NULL && xTaskCreate(ctl_task, "hotspot_ctl", 4096, queue, 5, NULL) != pdPASS)
+        {
+            vQueueDelete(queue);
+            queue = NULL;
+        }
+        ctl_queue.store(queue);
+    }
+    xSemaphoreGive(mutex);
+    return queue;
+}
+
+static esp_err_t ctl_submit(const ctl_request_t *req)
+{
+    QueueHandle_t queue = ctl_queue.load();
+    if (queue == NULL)
+    {
+        queue = ctl_task_start();
+        if (queue == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to start the control task");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    
+    if (xQueueSend(queue, req, 0) != pdTRUE)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t napt_ctl_post(void (*fn)(void))
+{
+    ctl_request_t req = {};
+    req.op = CTL_CALL;
+    req.fn = fn;
+    return ctl_submit(&req);
+}
+
+// Internal requests from event handlers, which must not block on ctl_mutex
+static void channel_follow_async(void)
+{
+    ctl_request_t req = {};
+    req.op = CTL_FOLLOW_CHANNEL;
+    if (ctl_submit(&req) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Control queue full, AP channel not re-checked");
+    }
+}
+
+static void channel_auto_async(void)
+{
+    ctl_request_t req = {};
+    req.op = CTL_AUTO_CHANNEL;
+    ctl_submit(&req);
+}
+
+static void idle_enter_async(void)
+{
+    ctl_request_t req = {};
+    req.op = CTL_IDLE;
+    ctl_submit(&req);
+}
+
+// Probe requests come in bursts; one wake request in the queue is enough
+static void idle_wake_async(void)
+{
+    if (idle_wake_pending.exchange(true))
+    {
+        return;
+    }
+    ctl_request_t req = {};
+    req.op = CTL_WAKE;
+    if (ctl_submit(&req) != ESP_OK)
+    {
+        idle_wake_pending.store(false);
+        ESP_LOGW(TAG, "Control queue full, idle AP not woken");
+    }
+}
+
+// WIFI_EVENT_AP_START is delivered by the default event loop's task
+// ("sys_evt"). A blocking enable from one of its handlers would wait for an
+// event queued behind itself and always time out.
+static bool ctl_in_event_loop(void)
+{
+    if (strcmp(pcTaskGetName(NULL), "sys_evt") != 0)
+    {
+        return false;
+    }
+    ESP_LOGE(TAG, "Blocking enable from the default event loop, use hotspot_enable_async()");
+    return true;
+}
+
+// ============================================================================
+// PUBLIC API IMPLEMENTATION
+// ============================================================================
+esp_err_t hotspot_enable(const char *ssid, const char *password)
+{
+    if (ctl_in_event_loop())
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ctl_run(CTL_ENABLE, ssid, password, NULL);
+}
+
+esp_err_t hotspot_enable_with_config(const hotspot_config_t *config)
+{
+    if (ctl_in_event_loop())
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // Store first; enabling then starts from exactly this configuration
+    esp_err_t err = hotspot_configure(config);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    return ctl_run(CTL_ENABLE, NULL, NULL, NULL);
+}
+
+esp_err_t hotspot_configure(const hotspot_config_t *config)
+{
+    if (config == NULL || !config_valid(config))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ctl_run(CTL_CONFIGURE, NULL, NULL, config);
+}
+
+esp_err_t hotspot_get_config(hotspot_config_t *config)
+{
+    if (config == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    SemaphoreHandle_t mutex = ctl_get_mutex();
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    *config = *config_get();
+    xSemaphoreGive(mutex);
+    return ESP_OK;
+}
+
+esp_err_t hotspot_get_channel_info(hotspot_channel_info_t *info)
+{
+    if (info == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint8_t primary = 0;
+    wifi_second_chan_t second;
+    bool enabled = state_enabled(hotspot_state.load());
+    info->channel = enabled ? ap_active_config.ap.channel : 0;
+    info->secondary = enabled ? (uint8_t)ap_second_chan : 0;
+    info->aligned = enabled && uplink_up.load() && channel_sta(&primary, &second) && primary == info->channel;
+    info->migrations = channel_migrations;
+    return ESP_OK;
+}
+
+esp_err_t hotspot_disable(void)
+{
+    return ctl_run(CTL_DISABLE, NULL, NULL, NULL);
+}
+
+esp_err_t hotspot_enable_async(const char *ssid, const char *password, hotspot_done_cb_t cb, void *arg)
+{
+    ctl_request_t req = {};
+    req.op = CTL_ENABLE;
+    req.cb = cb;
+    req.arg = arg;
+    
+    // Copied now - the caller's strings need not outlive this call
+    if (ssid != NULL)
+    {
+        if (strlen(ssid) >= sizeof(req.ssid))
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        strcpy(req.ssid, ssid);
+        req.has_ssid = true;
+    }
+    if (password != NULL)
+    {
+        if (strlen(password) >= sizeof(req.password))
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        strcpy(req.password, password);
+        req.has_password = true;
+    }
+    return ctl_submit(&req);
+}
+
+esp_err_t hotspot_disable_async(hotspot_done_cb_t cb, void *arg)
+{
+    ctl_request_t req = {};
+    req.op = CTL_DISABLE;
+    req.cb = cb;
+    req.arg = arg;
+    return ctl_submit(&req);
+}
+
+esp_err_t hotspot_suspend(void)
+{
+    return ctl_run(CTL_SUSPEND, NULL, NULL, NULL);
+}
+
+esp_err_t hotspot_resume(void)
+{
+    return ctl_run(CTL_RESUME, NULL, NULL, NULL);
+}
+
+bool is_hotspot_suspended(void)
+{
+    return hotspot_state.load() == HOTSPOT_STATE_SUSPENDED;
+}
+
+hotspot_state_t hotspot_get_state(void)
+{
+    return hotspot_state.load();
+}
+
+esp_err_t hotspot_get_state_times(hotspot_state_times_t *times)
+{
+    if (times == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&state_time_lock);
+    hotspot_state_t state = hotspot_state.load();
+    for (int i = 0; i < HOTSPOT_STATE_MAX; i++)
+    {
+        uint64_t us = state_time_us[i];
+        if (i == state)
+        {
+            us += now_us - state_since_us;
+        }
+        times->time_ms[i] = us / 1000;
+        times->entries[i] = state_entries[i];
+    }
+    portEXIT_CRITICAL(&state_time_lock);
+    return ESP_OK;
+}
+
+const char *hotspot_state_name(hotspot_state_t state)
+{
+    if ((unsigned)state >= sizeof(state_names) / sizeof(state_names[0]))
+    {
+        return "Unknown";
+    }
+    return state_names[state];
+}
+
+void enable_hotspot(const char *ssid, const char *password)
+{
+    hotspot_enable(ssid, password);
+}
+
+void disable_hotspot(void)
+{
+    hotspot_disable();
 }
 
 bool is_hotspot_enabled(void)
 {
-    return hotspot_enabled;
+    return state_enabled(hotspot_state.load());
 }
 
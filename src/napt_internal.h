@@ -0,0 +1,255 @@
+/***************************************************************************************
+ *  File        : napt_internal.h
+ *  Description : Internal interfaces between the hotspot subsystems
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Not part of the public API. Only included by sources in src/.
+ ***************************************************************************************/
+#pragma once
+
+#include <stddef.h>
+#include "napt_interface.h"
+#include "napt_fwd.h"
+#include "napt_qos.h"
+#include "napt_mcast.h"
+#include "napt_stations.h"
+#include "lwip/sockets.h"
+
+// ============================================================================
+// CONTROL (napt_interface.cpp)
+// ============================================================================
+// The mutex hotspot start/stop/configure run under. Public setters that start
+// or stop a subsystem take it too, so they can't interleave with a disable.
+void napt_ctl_lock(void);
+void napt_ctl_unlock(void);
+// Run fn in the control task, without the mutex. For work that must not block
+// the caller's task, e.g. flash writes from an esp_timer callback.
+esp_err_t napt_ctl_post(void (*fn)(void));
+
+// ============================================================================
+// UPLINK CAPACITY ESTIMATOR (napt_capacity.cpp)
+// ============================================================================
+void napt_capacity_start(void);
+void napt_capacity_stop(void);
+void napt_capacity_on_packet(napt_hook_t hook, const napt_pkt_t *pkt);
+
+// ============================================================================
+// QOS SCHEDULER (napt_qos.cpp)
+// ============================================================================
+void napt_qos_start(void);
+void napt_qos_stop(void);
+bool napt_qos_enqueue(napt_pkt_t *pkt, bool driver_busy);
+void napt_qos_bypass_done(napt_pkt_t *pkt, err_t err);
+// Pre-NAT classifiers: queue this packet in cls once it reaches the uplink.
+// Does not modify the packet.
+void napt_qos_mark(const napt_pkt_t *pkt, hotspot_qos_class_t cls);
+
+// ============================================================================
+// DNS MESSAGES (napt_dns_msg.cpp)
+// ============================================================================
+#define NAPT_DNS_HEADER_LEN 12
+#define NAPT_DNS_NAME_MAX 256
+#define NAPT_DNS_FLAG_QR 0x8000
+#define NAPT_DNS_FLAG_TC 0x0200
+#define NAPT_DNS_OPCODE_MASK 0x7800
+#define NAPT_DNS_RCODE_MASK 0x000F
+#define NAPT_DNS_TYPE_A 1
+#define NAPT_DNS_TYPE_CNAME 5
+#define NAPT_DNS_TYPE_OPT 41
+#define NAPT_DNS_CLASS_IN 1
+
+typedef struct {
+    uint16_t id;
+    uint16_t flags;
+    uint16_t qdcount;
+    uint16_t ancount;
+    uint16_t nscount;
+    uint16_t arcount;
+    char qname[NAPT_DNS_NAME_MAX];  // First question, lowercase, no trailing dot
+    uint16_t qtype;
+    uint16_t qclass;
+    int answers_off;                // Offset of the first answer RR
+} napt_dns_msg_t;
+
+typedef struct {
+    uint16_t type;
+    uint16_t rclass;
+    uint32_t ttl;
+    uint16_t rdlength;
+    int rdata_off;
+} napt_dns_rr_t;
+
+bool napt_dns_parse(const uint8_t *msg, int len, napt_dns_msg_t *out);
+int napt_dns_read_name(const uint8_t *msg, int len, int off, char *out, size_t out_len);
+int napt_dns_read_rr(const uint8_t *msg, int len, int off, napt_dns_rr_t *rr, char *name, size_t name_len);
+// True if name equals suffix or is a subdomain of it
+bool napt_dns_name_matches(const char *name, const char *suffix);
+
+// ============================================================================
+// DNS SNOOPING (napt_dns_snoop.cpp)
+// ============================================================================
+void napt_dns_snoop_response(uint32_t client, const uint8_t *msg, int len);
+void napt_dns_snoop_on_packet(napt_hook_t hook, const napt_pkt_t *pkt);
+
+// ============================================================================
+// SPACE-SAVING SKETCH (napt_sketch.cpp)
+// ============================================================================
+#define NAPT_SKETCH_MAX_K 256
+
+typedef struct {
+    uint64_t key;
+    uint32_t count;         // Estimated weight (never below the true weight)
+    uint32_t error;         // Max overestimate: count - error <= true weight
+    uint16_t slot;          // Stable payload slot, 0..k-1
+} napt_sketch_item_t;
+
+typedef struct {
+    napt_sketch_item_t *items;  // Min-heap on count
+    int16_t *index;             // Key -> heap position
+    uint16_t k;
+    uint16_t size;
+    uint16_t index_mask;
+    uint32_t total;             // Sum of all weights added since reset
+} napt_sketch_t;
+
+bool napt_sketch_init(napt_sketch_t *s, uint16_t k);
+void napt_sketch_reset(napt_sketch_t *s);
+int napt_sketch_add(napt_sketch_t *s, uint64_t key, uint32_t weight, bool *is_new);
+int napt_sketch_top(const napt_sketch_t *s, napt_sketch_item_t *out, int max);
+
+// ============================================================================
+// HEAVY HITTERS (napt_hitters.cpp)
+// ============================================================================
+void napt_hitters_start(void);
+void napt_hitters_stop(void);
+void napt_hitters_on_packet(napt_hook_t hook, const napt_pkt_t *pkt);
+
+// Estimated distinct flows seen over the last one to two windows
+uint32_t napt_hitters_active_flows(void);
+
+// ============================================================================
+// DNS RESPONSE CACHE (napt_dns_cache.cpp)
+// ============================================================================
+// Forwarder task only. lookup writes a ready-to-send answer (client's ID and
+// question, TTLs aged) into out and returns its length, or 0 on a miss.
+int napt_dns_cache_lookup(const uint8_t *query, int len, const napt_dns_msg_t *q, uint8_t *out, int out_len);
+void napt_dns_cache_store(const uint8_t *msg, int len);
+int napt_dns_cache_count(void);
+
+// ============================================================================
+// DNS STATISTICS (napt_dns_stats.cpp)
+// ============================================================================
+typedef enum {
+    NAPT_DNS_CACHE_HIT = 0,
+    NAPT_DNS_UPSTREAM_OK,
+    NAPT_DNS_UPSTREAM_FAILED,
+    NAPT_DNS_DROPPED,           // Evicted from a full pending table; says nothing about upstream
+} napt_dns_outcome_t;
+
+// Names are counted by their first 63 characters, whole or truncated
+void napt_dns_stats_record(uint32_t client, const char *qname, napt_dns_outcome_t outcome, uint32_t latency_us);
+
+// ============================================================================
+// CHANNEL SCORING (napt_channel.cpp)
+// ============================================================================
+// 2.4 GHz channels 1-13. Candidate masks use bit n for channel n.
+#define NAPT_CHANNEL_MAX 13
+#define NAPT_CHANNEL_MASK_NON_OVERLAPPING ((1u << 1) | (1u << 6) | (1u << 11))
+
+// Same values as wifi_second_chan_t
+#define NAPT_CHANNEL_SECOND_NONE  0
+#define NAPT_CHANNEL_SECOND_ABOVE 1
+#define NAPT_CHANNEL_SECOND_BELOW 2
+
+typedef struct {
+    uint8_t primary;
+    uint8_t second;     // NAPT_CHANNEL_SECOND_*
+    int8_t rssi;
+} napt_scan_bss_t;
+
+// scores[1..13], lower is better; scores[0] is unused
+void napt_channel_score(const napt_scan_bss_t *bss, int count, uint32_t scores[NAPT_CHANNEL_MAX + 1]);
+
+// Best candidate, or current when it is within the hysteresis margin
+uint8_t napt_channel_pick(const uint32_t scores[NAPT_CHANNEL_MAX + 1], uint16_t candidates, uint8_t current);
+
+// ============================================================================
+// WIFI PROFILES (napt_wifi_profile.cpp)
+// ============================================================================
+// apply saves the driver settings it changes; restore puts them back.
+void napt_profile_apply(hotspot_wifi_profile_t profile);
+void napt_profile_restore(void);
+bool napt_profile_ap_ht20(hotspot_wifi_profile_t profile);
+uint8_t napt_profile_dtim(hotspot_wifi_profile_t profile);
+const char *napt_profile_name(hotspot_wifi_profile_t profile);
+
+// ============================================================================
+// ADMISSION CONTROL (napt_admission.cpp)
+// ============================================================================
+// Copies the thresholds; called under the control mutex whenever the config is applied
+void napt_admission_configure(const hotspot_config_t *config);
+// Decides on a station that just associated and counts the outcome
+hotspot_reject_reason_t napt_admission_check(void);
+
+// ============================================================================
+// BROADCAST / MULTICAST FILTER (napt_mcast.cpp)
+// ============================================================================
+// True if the frame is filtered at this hook; the caller drops it
+bool napt_mcast_drop(napt_hook_t hook, const napt_pkt_t *pkt);
+
+// ============================================================================
+// DISCOVERY REFLECTOR (napt_reflector.cpp)
+// ============================================================================
+void napt_reflector_start(void);
+void napt_reflector_stop(void);
+// AP input hook: takes a reference to client mDNS queries and M-SEARCHes
+void napt_reflector_on_packet(const napt_pkt_t *pkt);
+// True for the reflector's own queries to the LAN
+bool napt_reflector_owns(const napt_pkt_t *pkt);
+
+// ============================================================================
+// NTP SERVER (napt_ntp.cpp)
+// ============================================================================
+// All called from the DNS forwarder task, except open/close on its start path.
+// open binds port 123 and an upstream socket; false leaves NTP off.
+bool napt_ntp_open(const hotspot_config_t *config);
+void napt_ntp_close(void);
+void napt_ntp_fd_set(fd_set *fds, int *maxfd);
+void napt_ntp_on_select(const fd_set *fds);
+// Sends due polls and expires the one in flight; returns ms until the next
+// event (UINT32_MAX when closed)
+uint32_t napt_ntp_tick(void);
+
+// ============================================================================
+// DHCP SERVER (napt_dhcps.cpp)
+// ============================================================================
+// Control task only. start binds port 67 on the AP netif (the esp_netif
+// server must be stopped first); the lease table outlives stop.
+esp_err_t napt_dhcps_start(esp_netif_t *ap, const hotspot_config_t *config);
+void napt_dhcps_stop(void);
+// Any task: the client's address if it holds an unexpired lease
+bool napt_dhcps_lease_ip(const uint8_t *mac, uint32_t *ip);
+
+// ============================================================================
+// STATIC ARP PINNING (napt_arp.cpp)
+// ============================================================================
+// pin/unpin run in the tcpip thread (the DHCP server); the others post to it
+void napt_arp_pin(uint32_t ip, const uint8_t *mac);
+void napt_arp_unpin_ip(uint32_t ip);
+void napt_arp_station(const uint8_t *mac, bool joined);
+void napt_arp_clear(void);
+uint8_t napt_arp_pinned(void);
+
+// ============================================================================
+// STATION TABLE (napt_stations.cpp)
+// ============================================================================
+// join/leave from the WiFi event handler, start/stop from the control task
+void napt_stations_start(esp_netif_t *ap);
+void napt_stations_stop(void);
+void napt_stations_join(const uint8_t *mac, uint8_t aid);
+void napt_stations_leave(const uint8_t *mac);
+void napt_stations_on_packet(napt_hook_t hook, const napt_pkt_t *pkt);
+// DHCP server (tcpip thread): stamps a DHCP milestone of the station's join
+void napt_stations_dhcp(const uint8_t *mac, hotspot_join_event_t ev);
@@ -0,0 +1,148 @@
+/***************************************************************************************
+ *  File        : napt_mcast.cpp
+ *  Description : Broadcast and multicast filtering on the AP and STA segments
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - lwIP never routes broadcast or multicast between netifs, so none of it
+ *     crosses the NAT. What costs airtime and CPU is each segment's chatter
+ *     reaching the device and what the device sends in reply; the filter
+ *     drops it at the four forwarding path hooks.
+ *   - Runs per packet. Unicast frames return on the first test.
+ ***************************************************************************************/
+
+#include <string.h>
+#include "napt_internal.h"
+#include "freertos/FreeRTOS.h"
+#include "lwip/prot/ethernet.h"
+
+#define IP6_HLEN 40
+#define IP6_NEXTHDR_ICMP6 58
+
+// Directions are the hook points, in the same order
+static_assert((int)HOTSPOT_MCAST_FROM_CLIENTS == (int)NAPT_HOOK_AP_IN &&
+              (int)HOTSPOT_MCAST_TO_CLIENTS == (int)NAPT_HOOK_AP_OUT &&
+              (int)HOTSPOT_MCAST_FROM_UPLINK == (int)NAPT_HOOK_STA_IN &&
+              (int)HOTSPOT_MCAST_TO_UPLINK == (int)NAPT_HOOK_STA_OUT, "hook order");
+
+// ============================================================================
+// FILTER STATE
+// ============================================================================
+static portMUX_TYPE mcast_lock = portMUX_INITIALIZER_UNLOCKED;
+static hotspot_mcast_config_t mcast_config = HOTSPOT_MCAST_CONFIG_DEFAULT();
+static volatile uint8_t mcast_any = 0;     // OR of all drop masks; 0 = nothing to check
+static hotspot_mcast_stats_t mcast_stats = {};
+
+// ============================================================================
+// CLASSIFIER
+// ============================================================================
+// Returns the class of a broadcast/multicast frame, or -1 for frames that
+// are never filtered (ARP, DHCP, IGMP, ICMPv6 and everything not IP).
+// ============================================================================
+static int mcast_classify(const napt_pkt_t *pkt)
+{
+    if (pkt->ether_type == ETHTYPE_IPV6) {
+        if (pkt->p->len < SIZEOF_ETH_HDR + IP6_HLEN) {
+            return -1;
+        }
+        // Extension headers before ICMPv6 are rare on link-local traffic
+        uint8_t next = pkt->eth[SIZEOF_ETH_HDR + 6];
+        return next == IP6_NEXTHDR_ICMP6 ? -1 : HOTSPOT_MCAST_IPV6;
+    }
+    if (pkt->ip == NULL || pkt->proto == IP_PROTO_IGMP) {
+        return -1;
+    }
+    if (pkt->proto == IP_PROTO_UDP && pkt->l4 != NULL) {
+        uint16_t port = pkt->dport;
+        if (port == 67 || port == 68) {
+            return -1;
+        }
+        switch (port) {
+        case 5353:
+            return HOTSPOT_MCAST_MDNS;
+        case 1900:
+            return HOTSPOT_MCAST_SSDP;
+        case 5355:
+            return HOTSPOT_MCAST_LLMNR;
+        case 137:
+        case 138:
+            return HOTSPOT_MCAST_NETBIOS;
+        default:
+            break;
+        }
+    }
+    return HOTSPOT_MCAST_OTHER;
+}
+
+// ============================================================================
+// FORWARDING PATH SIDE
+// ============================================================================
+// True if the frame should be dropped; the caller frees or skips it.
+// ============================================================================
+bool napt_mcast_drop(napt_hook_t hook, const napt_pkt_t *pkt)
+{
+    if (!(pkt->broadcast || pkt->multicast) || !(mcast_any & HOTSPOT_MCAST_DIR_BIT(hook))) {
+        return false;
+    }
+    int cls = mcast_classify(pkt);
+    if (cls < 0 || !(mcast_config.drop[cls] & HOTSPOT_MCAST_DIR_BIT(hook)) ||
+        (hook == NAPT_HOOK_STA_OUT && napt_reflector_owns(pkt))) {
+        return false;
+    }
+
+    portENTER_CRITICAL(&mcast_lock);
+    hotspot_mcast_counter_t *c = &mcast_stats.dropped[cls][hook];
+    c->packets++;
+    c->bytes += pkt->frame_len;
+    portEXIT_CRITICAL(&mcast_lock);
+    return true;
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+esp_err_t hotspot_mcast_configure(const hotspot_mcast_config_t *config)
+{
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint8_t any = 0;
+    for (int i = 0; i < HOTSPOT_MCAST_PROTO_MAX; i++) {
+        if (config->drop[i] & ~HOTSPOT_MCAST_DROP_ALL) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        any |= config->drop[i];
+    }
+
+    // Each mask is a single byte, so the hooks never see a torn value
+    portENTER_CRITICAL(&mcast_lock);
+    mcast_config = *config;
+    mcast_any = any;
+    portEXIT_CRITICAL(&mcast_lock);
+    return ESP_OK;
+}
+
+esp_err_t hotspot_mcast_get_config(hotspot_mcast_config_t *config)
+{
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&mcast_lock);
+    *config = mcast_config;
+    portEXIT_CRITICAL(&mcast_lock);
+    return ESP_OK;
+}
+
+esp_err_t hotspot_mcast_get_stats(hotspot_mcast_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&mcast_lock);
+    *stats = mcast_stats;
+    portEXIT_CRITICAL(&mcast_lock);
+    return ESP_OK;
+}
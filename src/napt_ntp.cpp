@@ -0,0 +1,477 @@
+/***************************************************************************************
+ *  File        : napt_ntp.cpp
+ *  Description : Local NTP server on the AP address, disciplined from upstream
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Runs inside the DNS forwarder task: its two sockets sit in the same
+ *     select() and napt_ntp_tick() schedules the upstream polls.
+ *   - Keeps its own clock on top of esp_timer (offset + frequency correction)
+ *     and never touches the system time, which belongs to the application.
+ *   - One SNTP exchange per poll interval; clients get answered locally from
+ *     then on, so none of their NTP traffic crosses the NAT.
+ *   - Only mode 3 (client) requests are answered, with a reply of the same
+ *     size; control and private modes are ignored.
+ ***************************************************************************************/
+
+#include <string.h>
+#include <errno.h>
+#include "napt_ntp.h"
+#include "napt_internal.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "freertos/FreeRTOS.h"
+#include "lwip/sockets.h"
+
+// Upstream reply timeout
+#ifndef HOTSPOT_NTP_TIMEOUT_MS
+#define HOTSPOT_NTP_TIMEOUT_MS 2000
+#endif
+
+// First retry after a failed poll; doubles up to the poll interval
+#ifndef HOTSPOT_NTP_RETRY_S
+#define HOTSPOT_NTP_RETRY_S 8
+#endif
+
+// Without a sync for this long, clients are told the clock is unsynchronised
+#ifndef HOTSPOT_NTP_HOLDOVER_S
+#define HOTSPOT_NTP_HOLDOVER_S 14400
+#endif
+
+// Samples slower than twice the best round trip plus this are discarded
+#ifndef HOTSPOT_NTP_JITTER_US
+#define HOTSPOT_NTP_JITTER_US 20000
+#endif
+
+#define NTP_PORT 123
+#define NTP_PKT_LEN 48
+#define NTP_MODE_CLIENT 3
+#define NTP_MODE_SERVER 4
+#define NTP_LI_ALARM 3
+#define NTP_STRATUM_UNSYNC 16
+#define NTP_PRECISION (-19)                     // ~2 us, esp_timer resolution
+#define NTP_UNIX_OFFSET_S 2208988800ULL         // 1900-01-01 to 1970-01-01
+#define NTP_MAX_PPB 500000                      // Frequency correction limit, 500 ppm
+#define NTP_MIN_FREQ_INTERVAL_US 60000000LL     // Shorter intervals only correct phase
+#define NTP_DRIFT_US_PER_S 15                   // Dispersion growth, 15 ppm (RFC 5905)
+
+static const char *TAG = "napt_ntp";
+
+// ============================================================================
+// CLOCK STATE
+// ============================================================================
+// Time is kept in microseconds since 1900 (the NTP epoch). Written by the
+// forwarder task under ntp_lock; the task itself reads it without the lock.
+// ============================================================================
+typedef struct {
+    bool valid;                 // At least one sample accepted
+    int64_t base_mono_us;       // esp_timer at the last correction
+    uint64_t base_ntp_us;       // Time at base_mono_us
+    int32_t ppb;                // Frequency correction
+    uint8_t up_stratum;
+    uint32_t up_refid;          // Upstream address, network order
+    uint32_t root_delay_us;     // Upstream root delay + our round trip
+    uint32_t root_disp_us;      // Upstream root dispersion + half our round trip
+} ntp_clock_t;
+
+static portMUX_TYPE ntp_lock = portMUX_INITIALIZER_UNLOCKED;
+static ntp_clock_t ntp_clock = {};
+static hotspot_ntp_status_t ntp_status = {};
+
+// Task-side state, reset by napt_ntp_open()
+static int ntp_server_socket = -1;      // Client requests, port 123
+static int ntp_client_socket = -1;      // Upstream polls
+static struct sockaddr_in ntp_upstream;
+static uint32_t ntp_poll_s = 1024;
+static uint32_t ntp_retry_s = HOTSPOT_NTP_RETRY_S;
+static uint32_t ntp_due_ms = 0;         // Next upstream poll
+static bool ntp_in_flight = false;
+static uint32_t ntp_sent_ms = 0;
+static int64_t ntp_sent_mono_us = 0;
+static uint8_t ntp_nonce[8];            // Our transmit timestamp, echoed as origin
+static uint32_t ntp_min_delay_us = 0;   // Best recent round trip, 0 = none yet
+static int64_t ntp_last_sync_us = 0;    // esp_timer at the last accepted sample
+
+// Caller reads a consistent copy of the clock (or is the task)
+static uint64_t clock_read(const ntp_clock_t *c, int64_t mono_us)
+{
+    int64_t elapsed = mono_us - c->base_mono_us;
+    return c->base_ntp_us + elapsed + elapsed * c->ppb / 1000000000LL;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+// 64-bit NTP timestamp: 32.32 fixed point seconds, wrapping in 2036
+static void put_timestamp(uint8_t *p, uint64_t ntp_us)
+{
+    uint64_t frac = ((ntp_us % 1000000) << 32) / 1000000;
+    put_u32(p, (uint32_t)(ntp_us / 1000000));
+    put_u32(p + 4, (uint32_t)frac);
+}
+
+// Seconds below 2^31 are taken as era 1 (after 2036), per RFC 4330
+static uint64_t get_timestamp(const uint8_t *p)
+{
+    uint64_t sec = get_u32(p);
+    if (sec < 0x80000000u) {
+        sec += 1ULL << 32;
+    }
+    return sec * 1000000 + (((uint64_t)get_u32(p + 4) * 1000000 + 0x80000000u) >> 32);
+}
+
+// 32-bit NTP short format: 16.16 fixed point seconds
+static uint32_t short_format(uint64_t us)
+{
+    uint64_t v = (us << 16) / 1000000;
+    return v > 0xffffffffu ? 0xffffffffu : (uint32_t)v;
+}
+
+static uint64_t short_to_us(uint32_t v)
+{
+    return ((uint64_t)v * 1000000) >> 16;
+}
+
+static bool clock_synced(int64_t now_us)
+{
+    return ntp_clock.valid && now_us - ntp_last_sync_us < (int64_t)HOTSPOT_NTP_HOLDOVER_S * 1000000;
+}
+
+// ============================================================================
+// SERVER SIDE
+// ============================================================================
+static void ntp_serve(void)
+{
+    uint8_t buf[NTP_PKT_LEN];
+    struct sockaddr_in from;
+    socklen_t from_len = sizeof(from);
+    int len = recvfrom(ntp_server_socket, buf, sizeof(buf), MSG_DONTWAIT, (struct sockaddr *)&from, &from_len);
+    // Receive timestamp as early as possible; lwIP has no socket timestamps
+    int64_t rx_mono = esp_timer_get_time();
+    if (len < NTP_PKT_LEN) {
+        return;
+    }
+
+    uint8_t vn = (buf[0] >> 3) & 0x07;
+    if ((buf[0] & 0x07) != NTP_MODE_CLIENT || vn < 1 || vn > 4) {
+        return;
+    }
+
+    uint8_t origin[8];
+    memcpy(origin, buf + 40, 8);
+    uint8_t poll = buf[2];
+    memset(buf, 0, sizeof(buf));
+
+    bool synced = clock_synced(rx_mono);
+    const ntp_clock_t *c = &ntp_clock;
+    if (synced) {
+        uint32_t age_s = (uint32_t)((rx_mono - ntp_last_sync_us) / 1000000);
+        buf[0] = (vn << 3) | NTP_MODE_SERVER;
+        buf[1] = c->up_stratum < 15 ? c->up_stratum + 1 : 15;
+        put_u32(buf + 4, short_format(c->root_delay_us));
+        put_u32(buf + 8, short_format((uint64_t)c->root_disp_us + (uint64_t)age_s * NTP_DRIFT_US_PER_S));
+        memcpy(buf + 12, &c->up_refid, 4);
+        put_timestamp(buf + 16, clock_read(c, ntp_last_sync_us));
+    } else {
+        // RFC 5905: alarm + stratum 16, clients discard the time
+        buf[0] = (NTP_LI_ALARM << 6) | (vn << 3) | NTP_MODE_SERVER;
+        buf[1] = NTP_STRATUM_UNSYNC;
+    }
+    buf[2] = poll;
+    buf[3] = (uint8_t)NTP_PRECISION;
+    memcpy(buf + 24, origin, 8);
+    if (c->valid) {
+        put_timestamp(buf + 32, clock_read(c, rx_mono));
+        put_timestamp(buf + 40, clock_read(c, esp_timer_get_time()));
+    }
+    sendto(ntp_server_socket, buf, sizeof(buf), 0, (struct sockaddr *)&from, from_len);
+
+    portENTER_CRITICAL(&ntp_lock);
+    ntp_status.requests++;
+    if (!synced) {
+        ntp_status.unsynced_replies++;
+    }
+    portEXIT_CRITICAL(&ntp_lock);
+}
+
+// ============================================================================
+// UPSTREAM SIDE
+// ============================================================================
+static void poll_failed(const char *why)
+{
+    ESP_LOGD(TAG, "Upstream poll failed: %s", why);
+    ntp_in_flight = false;
+    ntp_due_ms = napt_now_ms() + ntp_retry_s * 1000;
+    ntp_retry_s = ntp_retry_s * 2 < ntp_poll_s ? ntp_retry_s * 2 : ntp_poll_s;
+    portENTER_CRITICAL(&ntp_lock);
+    ntp_status.upstream_failures++;
+    portEXIT_CRITICAL(&ntp_lock);
+}
+
+static void poll_send(void)
+{
+    uint8_t buf[NTP_PKT_LEN] = {};
+    buf[0] = (4 << 3) | NTP_MODE_CLIENT;
+    // A random transmit timestamp: the origin check then also rejects spoofed replies
+    uint32_t r[2] = { esp_random(), esp_random() };
+    memcpy(ntp_nonce, r, sizeof(ntp_nonce));
+    memcpy(buf + 40, ntp_nonce, sizeof(ntp_nonce));
+
+    ntp_sent_mono_us = esp_timer_get_time();
+    ntp_sent_ms = napt_now_ms();
+    ntp_in_flight = true;
+    portENTER_CRITICAL(&ntp_lock);
+    ntp_status.upstream_polls++;
+    portEXIT_CRITICAL(&ntp_lock);
+    if (sendto(ntp_client_socket, buf, sizeof(buf), 0, (struct sockaddr *)&ntp_upstream, sizeof(ntp_upstream)) < 0) {
+        poll_failed("send");
+    }
+}
+
+static void poll_receive(void)
+{
+    uint8_t buf[NTP_PKT_LEN];
+    struct sockaddr_in from;
+    socklen_t from_len = sizeof(from);
+    int len = recvfrom(ntp_client_socket, buf, sizeof(buf), MSG_DONTWAIT, (struct sockaddr *)&from, &from_len);
+    int64_t t4 = esp_timer_get_time();
+    if (len < NTP_PKT_LEN || !ntp_in_flight ||
+        from.sin_addr.s_addr != ntp_upstream.sin_addr.s_addr || from.sin_port != ntp_upstream.sin_port ||
+        memcmp(buf + 24, ntp_nonce, sizeof(ntp_nonce)) != 0) {
+        return;     // Stray or stale datagram; the timeout handles a lost reply
+    }
+
+    uint8_t li = buf[0] >> 6;
+    uint8_t stratum = buf[1];
+    if ((buf[0] & 0x07) != NTP_MODE_SERVER || get_u32(buf + 40) == 0) {
+        poll_failed("malformed reply");
+        return;
+    }
+    if (stratum == 0) {
+        // Kiss-o'-death (RATE, DENY, ...): back off to the full interval
+        ESP_LOGW(TAG, "Upstream kiss-o'-death %.4s", (const char *)buf + 12);
+        poll_failed("kiss-o'-death");
+        ntp_due_ms = napt_now_ms() + ntp_poll_s * 1000;
+        return;
+    }
+    if (li == NTP_LI_ALARM || stratum >= NTP_STRATUM_UNSYNC) {
+        poll_failed("upstream unsynchronised");
+        return;
+    }
+
+    uint64_t t2 = get_timestamp(buf + 32);
+    uint64_t t3 = get_timestamp(buf + 40);
+    int64_t server_us = t3 >= t2 ? (int64_t)(t3 - t2) : 0;
+    int64_t delay = (t4 - ntp_sent_mono_us) - server_us;
+    if (delay < 0) {
+        delay = 0;
+    }
+
+    // Popcorn filter: a slow exchange has an unknown asymmetry, skip it. The
+    // reference relaxes on every rejection so a lasting path change gets through.
+    bool synced = clock_synced(t4);
+    if (ntp_min_delay_us == 0 || delay < ntp_min_delay_us) {
+        ntp_min_delay_us = (uint32_t)delay;
+    } else if (synced && delay > 2 * (int64_t)ntp_min_delay_us + HOTSPOT_NTP_JITTER_US) {
+        ntp_min_delay_us += ntp_min_delay_us / 4 + 1;
+        poll_failed("round trip too long");
+        return;
+    }
+
+    // Server time at t4, assuming a symmetric path
+    uint64_t now_ntp = t3 + delay / 2;
+    int64_t offset = ntp_clock.valid ? (int64_t)(now_ntp - clock_read(&ntp_clock, t4)) : 0;
+
+    // Residual offset over a long enough interval is frequency error
+    int32_t ppb = ntp_clock.ppb;
+    if (synced && t4 - ntp_last_sync_us >= NTP_MIN_FREQ_INTERVAL_US) {
+        int64_t err_ppb = offset * 1000000000LL / (t4 - ntp_last_sync_us);
+        int64_t next = ppb + err_ppb / 2;
+        ppb = (int32_t)(next > NTP_MAX_PPB ? NTP_MAX_PPB : next < -NTP_MAX_PPB ? -NTP_MAX_PPB : next);
+    }
+
+    ntp_clock_t c;
+    c.valid = true;
+    c.base_mono_us = t4;
+    c.base_ntp_us = now_ntp;
+    c.ppb = ppb;
+    c.up_stratum = stratum;
+    c.up_refid = ntp_upstream.sin_addr.s_addr;
+    c.root_delay_us = (uint32_t)(short_to_us(get_u32(buf + 4)) + delay);
+    c.root_disp_us = (uint32_t)(short_to_us(get_u32(buf + 8)) + delay / 2);
+
+    if (!synced) {
+        ESP_LOGI(TAG, "Synchronised to " IPSTR ", stratum %u, delay %lld us",
+                 IP2STR((esp_ip4_addr_t *)&c.up_refid), stratum, (long long)delay);
+    }
+
+    portENTER_CRITICAL(&ntp_lock);
+    ntp_clock = c;
+    ntp_last_sync_us = t4;
+    ntp_status.offset_us = offset > INT32_MAX ? INT32_MAX : offset < INT32_MIN ? INT32_MIN : (int32_t)offset;
+    ntp_status.delay_us = (uint32_t)delay;
+    portEXIT_CRITICAL(&ntp_lock);
+
+    ntp_in_flight = false;
+    ntp_retry_s = HOTSPOT_NTP_RETRY_S;
+    ntp_due_ms = napt_now_ms() + ntp_poll_s * 1000;
+}
+
+// ============================================================================
+// FORWARDER TASK INTERFACE
+// ============================================================================
+static int ntp_udp_socket(uint16_t port)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+bool napt_ntp_open(const hotspot_config_t *config)
+{
+    ntp_server_socket = ntp_udp_socket(NTP_PORT);
+    ntp_client_socket = ntp_udp_socket(0);
+    if (ntp_server_socket < 0 || ntp_client_socket < 0) {
+        ESP_LOGE(TAG, "Unable to create sockets: errno %d", errno);
+        napt_ntp_close();
+        return false;
+    }
+
+    memset(&ntp_upstream, 0, sizeof(ntp_upstream));
+    ntp_upstream.sin_family = AF_INET;
+    ntp_upstream.sin_port = htons(NTP_PORT);
+    ntp_upstream.sin_addr.s_addr = config->ntp_upstream.addr;
+    ntp_poll_s = config->ntp_poll_s;
+    ntp_retry_s = HOTSPOT_NTP_RETRY_S;
+    ntp_in_flight = false;
+    ntp_min_delay_us = 0;
+    ntp_due_ms = napt_now_ms();     // Poll at once; a kept clock serves meanwhile
+
+    ESP_LOGI(TAG, "Serving on port %d, upstream " IPSTR " every %lu s", NTP_PORT,
+             IP2STR(&config->ntp_upstream), (unsigned long)ntp_poll_s);
+    return true;
+}
+
+void napt_ntp_close(void)
+{
+    if (ntp_server_socket >= 0) {
+        close(ntp_server_socket);
+    }
+    if (ntp_client_socket >= 0) {
+        close(ntp_client_socket);
+    }
+    ntp_server_socket = -1;
+    ntp_client_socket = -1;
+    ntp_in_flight = false;
+}
+
+void napt_ntp_fd_set(fd_set *fds, int *maxfd)
+{
+    if (ntp_server_socket < 0) {
+        return;
+    }
+    FD_SET(ntp_server_socket, fds);
+    FD_SET(ntp_client_socket, fds);
+    if (ntp_server_socket > *maxfd) {
+        *maxfd = ntp_server_socket;
+    }
+    if (ntp_client_socket > *maxfd) {
+        *maxfd = ntp_client_socket;
+    }
+}
+
+void napt_ntp_on_select(const fd_set *fds)
+{
+    if (ntp_server_socket < 0) {
+        return;
+    }
+    if (FD_ISSET(ntp_client_socket, fds)) {
+        poll_receive();
+    }
+    if (FD_ISSET(ntp_server_socket, fds)) {
+        ntp_serve();
+    }
+}
+
+uint32_t napt_ntp_tick(void)
+{
+    if (ntp_server_socket < 0) {
+        return UINT32_MAX;
+    }
+    uint32_t now = napt_now_ms();
+    if (ntp_in_flight && now - ntp_sent_ms >= HOTSPOT_NTP_TIMEOUT_MS) {
+        poll_failed("timeout");
+    }
+    if (!ntp_in_flight && (int32_t)(now - ntp_due_ms) >= 0) {
+        poll_send();
+    }
+    if (ntp_in_flight) {
+        return HOTSPOT_NTP_TIMEOUT_MS - (now - ntp_sent_ms);
+    }
+    int32_t wait = (int32_t)(ntp_due_ms - now);
+    return wait > 0 ? (uint32_t)wait : 0;
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+esp_err_t hotspot_ntp_get_status(hotspot_ntp_status_t *status)
+{
+    if (status == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&ntp_lock);
+    *status = ntp_status;
+    ntp_clock_t c = ntp_clock;
+    int64_t last_sync = ntp_last_sync_us;
+    portEXIT_CRITICAL(&ntp_lock);
+
+    status->synced = c.valid && now - last_sync < (int64_t)HOTSPOT_NTP_HOLDOVER_S * 1000000;
+    status->stratum = status->synced ? (c.up_stratum < 15 ? c.up_stratum + 1 : 15) : NTP_STRATUM_UNSYNC;
+    status->upstream.addr = c.up_refid;
+    status->drift_ppb = c.ppb;
+    status->last_sync_age_s = c.valid ? (uint32_t)((now - last_sync) / 1000000) : 0;
+    return ESP_OK;
+}
+
+esp_err_t hotspot_ntp_get_time(int64_t *unix_us)
+{
+    if (unix_us == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&ntp_lock);
+    ntp_clock_t c = ntp_clock;
+    portEXIT_CRITICAL(&ntp_lock);
+    if (!c.valid) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *unix_us = (int64_t)(clock_read(&c, now) - NTP_UNIX_OFFSET_S * 1000000);
+    return ESP_OK;
+}
@@ -0,0 +1,908 @@
+/***************************************************************************************
+ *  File        : napt_qos.cpp
+ *  Description : Classification, priority queueing and shaping of uplink traffic
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Queues sit in front of the STA driver. They only fill when the shaper or
+ *     the WiFi driver (TX buffers full) holds traffic back, so with an idle
+ *     uplink packets go straight through.
+ ***************************************************************************************/
+
+#include <string.h>
+#include "napt_qos.h"
+#include "napt_capacity.h"
+#include "napt_internal.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "lwip/prot/tcp.h"
+
+#ifndef HOTSPOT_QOS_MAX_QUEUE
+#define HOTSPOT_QOS_MAX_QUEUE 64        // Ring size per class (upper bound for queue_limit)
+#endif
+
+#ifndef HOTSPOT_QOS_MAX_RULES
+#define HOTSPOT_QOS_MAX_RULES 16
+#endif
+
+#ifndef HOTSPOT_QOS_TASK_STACK
+#define HOTSPOT_QOS_TASK_STACK 3072
+#endif
+
+#ifndef HOTSPOT_QOS_TASK_PRIORITY
+#define HOTSPOT_QOS_TASK_PRIORITY 18     // Just below the tcpip thread
+#endif
+
+#ifndef HOTSPOT_QOS_ACK_SCAN
+#define HOTSPOT_QOS_ACK_SCAN 16          // Queued entries searched for a superseded ACK
+#endif
+
+// Class tags from pre-NAT classifiers, see napt_qos_mark()
+#ifndef HOTSPOT_QOS_TAGS
+#define HOTSPOT_QOS_TAGS 64              // Power of two
+#endif
+#define QOS_TAG_MAX_AGE_MS 200           // AP_IN to STA_OUT is normally well under 1 ms
+
+// Internal lanes: one per class plus the pure-ACK lane
+#define QOS_LANE_ACK HOTSPOT_QOS_CLASS_MAX
+#define QOS_LANES (HOTSPOT_QOS_CLASS_MAX + 1)
+
+#define QOS_MTU 1514
+#define SHAPER_MIN_BURST 3028            // Two full frames
+#define SHAPER_BURST_DIVISOR 50          // Burst = 20ms worth of rate
+
+// While shaping from the estimate, open up to 125% for 1s out of every 10s
+// so the estimator can see if the uplink got faster.
+#define SHAPER_PROBE_PERIOD_MS 10000
+#define SHAPER_PROBE_LENGTH_MS 1000
+#define SHAPER_PROBE_PERCENT 125
+
+static const char *TAG = "napt_qos";
+
+// ============================================================================
+// QOS STATE
+// ============================================================================
+typedef struct {
+    struct pbuf *p;
+    uint16_t len;
+    bool thinnable;     // Pure cumulative ACK without SACK blocks
+    uint8_t flags;      // TCP flags (thinnable entries only)
+    uint32_t flow;      // Flow hash (thinnable entries only)
+    uint32_t ack;       // ACK number (thinnable entries only)
+} qos_entry_t;
+
+typedef struct {
+    qos_entry_t ring[HOTSPOT_QOS_MAX_QUEUE];
+    uint16_t head;
+    uint16_t count;
+    int32_t deficit;    // DRR deficit, scheduler task only
+} qos_queue_t;
+
+typedef struct {
+    uint8_t proto;
+    uint16_t port_min;
+    uint16_t port_max;
+    hotspot_qos_class_t cls;
+} qos_rule_t;
+
+static portMUX_TYPE qos_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Disabled until hotspot_qos_configure() is called
+static hotspot_qos_config_t qos_config = HOTSPOT_QOS_CONFIG_DEFAULT();
+static bool qos_configured = false;
+
+// A packet's class, keyed on fields NAT leaves alone: destination address
+// and port, protocol and IP identification
+typedef struct {
+    uint32_t dst;
+    uint16_t dport;
+    uint16_t ip_id;
+    uint8_t proto;
+    uint8_t cls;
+    uint32_t stamp_ms;      // 0 = free
+} qos_tag_t;
+
+static uint8_t dscp_map[64];
+static bool dscp_map_ready = false;
+static qos_tag_t qos_tags[HOTSPOT_QOS_TAGS];
+static qos_rule_t qos_rules[HOTSPOT_QOS_MAX_RULES];
+static int qos_rule_count = 0;
+
+static qos_queue_t queues[QOS_LANES];
+static uint32_t queued_total = 0;
+static struct pbuf *qos_inflight = NULL;   // Frame the task is transmitting
+static hotspot_qos_stats_t qos_stats = {};
+
+// Token bucket (bytes)
+static int32_t shaper_tokens = 0;
+static int64_t shaper_stamp_us = 0;
+
+// qos_running and qos_task_handle change under qos_lock; a frame is only
+// queued while both are set. qos_enqueuers counts enqueue calls between
+// queueing a frame and notifying the task, which stop waits out.
+static TaskHandle_t qos_task_handle = NULL;
+static SemaphoreHandle_t qos_task_done = NULL;
+static volatile bool qos_running = false;
+static uint8_t qos_enqueuers = 0;
+
+// ============================================================================
+// CLASSIFIER
+// ============================================================================
+static void dscp_map_init(void)
+{
+    for (int i = 0; i < 64; i++) {
+        dscp_map[i] = HOTSPOT_QOS_CLASS_BEST_EFFORT;
+    }
+    dscp_map[46] = HOTSPOT_QOS_CLASS_VOICE;          // EF
+    dscp_map[44] = HOTSPOT_QOS_CLASS_VOICE;          // VOICE-ADMIT
+    for (int cs = 4; cs <= 7; cs++) {
+        dscp_map[cs << 3] = HOTSPOT_QOS_CLASS_INTERACTIVE;  // CS4-CS7
+    }
+    for (int af = 1; af <= 3; af++) {
+        dscp_map[(4 << 3) | (af << 1)] = HOTSPOT_QOS_CLASS_INTERACTIVE;  // AF41-43
+        dscp_map[(3 << 3) | (af << 1)] = HOTSPOT_QOS_CLASS_INTERACTIVE;  // AF31-33
+        dscp_map[(1 << 3) | (af << 1)] = HOTSPOT_QOS_CLASS_BULK;         // AF11-13
+    }
+    dscp_map[8] = HOTSPOT_QOS_CLASS_BULK;            // CS1 (scavenger)
+    dscp_map_ready = true;
+}
+
+static inline uint16_t pkt_ip_id(const napt_pkt_t *pkt)
+{
+    return ((uint16_t)pkt->ip[4] << 8) | pkt->ip[5];
+}
+
+static inline qos_tag_t *tag_slot(const napt_pkt_t *pkt)
+{
+    uint32_t h = napt_flow_hash(pkt->dst, pkt->dport, pkt_ip_id(pkt), 0, pkt->proto);
+    return &qos_tags[h & (HOTSPOT_QOS_TAGS - 1)];
+}
+
+// Caller holds qos_lock. Not consumed: a frame the driver refused is
+// classified a second time.
+static int tag_find(const napt_pkt_t *pkt)
+{
+    const qos_tag_t *t = tag_slot(pkt);
+    if (t->stamp_ms == 0 || napt_now_ms() - t->stamp_ms > QOS_TAG_MAX_AGE_MS) {
+        return -1;
+    }
+    if (t->dst != pkt->dst || t->dport != pkt->dport || t->proto != pkt->proto || t->ip_id != pkt_ip_id(pkt)) {
+        return -1;
+    }
+    return t->cls;
+}
+
+// Caller holds qos_lock
+static hotspot_qos_class_t qos_classify(const napt_pkt_t *pkt)
+{
+    // Upstream DNS - our forwarder's queries and clients querying directly
+    if (qos_config.prioritize_dns && pkt->l4 != NULL && pkt->dport == 53) {
+        return HOTSPOT_QOS_CLASS_INTERACTIVE;
+    }
+
+    // Port / protocol rules, first match wins
+    for (int i = 0; i < qos_rule_count; i++) {
+        const qos_rule_t *r = &qos_rules[i];
+        if (r->proto != 0 && r->proto != pkt->proto) {
+            continue;
+        }
+        if (r->port_min == 0 && r->port_max == 0) {
+            return r->cls;
+        }
+        if (pkt->l4 != NULL &&
+            ((pkt->dport >= r->port_min && pkt->dport <= r->port_max) ||
+             (pkt->sport >= r->port_min && pkt->sport <= r->port_max))) {
+            return r->cls;
+        }
+    }
+
+    // Tagged before NAT (domain rules)
+    int tagged = tag_find(pkt);
+    if (tagged >= 0) {
+        return (hotspot_qos_class_t)tagged;
+    }
+
+    return (hotspot_qos_class_t)dscp_map[pkt->tos >> 2];
+}
+
+// Rewrite DSCP (keeping ECN bits) and patch the IPv4 header checksum
+// incrementally (RFC 1624: HC' = ~(~HC + ~m + m'))
+static void qos_remark(napt_pkt_t *pkt, uint8_t dscp)
+{
+    uint8_t *ip = pkt->ip;
+    uint8_t new_tos = (uint8_t)((dscp << 2) | (ip[1] & 0x03));
+    if (new_tos == ip[1]) {
+        return;
+    }
+    uint16_t old_word = ((uint16_t)ip[0] << 8) | ip[1];
+    uint16_t new_word = ((uint16_t)ip[0] << 8) | new_tos;
+    uint32_t sum = (uint16_t)~(((uint16_t)ip[10] << 8) | ip[11]);
+    sum += (uint16_t)~old_word;
+    sum += new_word;
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    uint16_t csum = (uint16_t)~sum;
+    ip[1] = new_tos;
+    ip[10] = (uint8_t)(csum >> 8);
+    ip[11] = (uint8_t)csum;
+    pkt->tos = new_tos;
+}
+
+// ============================================================================
+// SHAPER
+// ============================================================================
+// Caller holds qos_lock. Returns the rate in bits/s, 0 = unshaped.
+static uint32_t shaper_rate(void)
+{
+    if (qos_config.rate_bps != 0) {
+        return qos_config.rate_bps;
+    }
+
+    hotspot_capacity_t cap;
+    hotspot_get_uplink_capacity(&cap);
+    // A lower bound is not a capacity - shaping to it would cap the link
+    if (cap.source != HOTSPOT_CAPACITY_SOURCE_SATURATED && cap.source != HOTSPOT_CAPACITY_SOURCE_PROBE) {
+        return 0;
+    }
+
+    uint32_t percent = qos_config.rate_percent;
+    if (napt_now_ms() % SHAPER_PROBE_PERIOD_MS < SHAPER_PROBE_LENGTH_MS) {
+        percent = SHAPER_PROBE_PERCENT;
+    }
+    return (uint32_t)((uint64_t)cap.uplink_bps * percent / 100);
+}
+
+// Caller holds qos_lock. Refills the bucket and takes len bytes if available.
+static bool shaper_take(uint16_t len, uint32_t *wait_us)
+{
+    uint32_t rate = shaper_rate();
+    qos_stats.shaper_rate_bps = rate;
+    if (rate == 0) {
+        return true;
+    }
+
+    uint32_t bytes_per_sec = rate / 8;
+    int32_t burst = (int32_t)(bytes_per_sec / SHAPER_BURST_DIVISOR);
+    if (burst < SHAPER_MIN_BURST) {
+        burst = SHAPER_MIN_BURST;
+    }
+
+    // Only move the stamp when at least one byte was credited, so frequent
+    // calls do not lose the fractional remainder
+    int64_t now = esp_timer_get_time();
+    int64_t refill = (now - shaper_stamp_us) * bytes_per_sec / 1000000;
+    if (refill > 0) {
+        shaper_stamp_us = now;
+        int64_t tokens = (int64_t)shaper_tokens + refill;
+        shaper_tokens = tokens > burst ? burst : (int32_t)tokens;
+    }
+
+    if (shaper_tokens >= len) {
+        shaper_tokens -= len;
+        return true;
+    }
+    if (wait_us != NULL) {
+        *wait_us = (uint32_t)((uint64_t)(len - shaper_tokens) * 1000000 / bytes_per_sec);
+    }
+    return false;
+}
+
+// ============================================================================
+// QUEUES
+// ============================================================================
+// One lane per public class plus the pure-ACK lane, which is served ahead of
+// every class regardless of the scheduler.
+// ============================================================================
+static hotspot_qos_class_stats_t *lane_stats(int lane)
+{
+    return lane == QOS_LANE_ACK ? &qos_stats.ack_lane : &qos_stats.cls[lane];
+}
+
+// Caller holds qos_lock
+static void queue_drop_all(void)
+{
+    for (int lane = 0; lane < QOS_LANES; lane++) {
+        qos_queue_t *q = &queues[lane];
+        while (q->count > 0) {
+            pbuf_free(q->ring[q->head].p);
+            q->head = (q->head + 1) % HOTSPOT_QOS_MAX_QUEUE;
+            q->count--;
+        }
+        q->deficit = 0;
+        lane_stats(lane)->queue_packets = 0;
+        lane_stats(lane)->queue_bytes = 0;
+    }
+    queued_total = 0;
+}
+
+// Caller holds qos_lock. Picks the lane to serve next, -1 if all empty.
+static int queue_pick(void)
+{
+    if (queues[QOS_LANE_ACK].count > 0) {
+        return QOS_LANE_ACK;
+    }
+
+    if (qos_config.scheduler == HOTSPOT_QOS_SCHED_STRICT) {
+        for (int c = 0; c < HOTSPOT_QOS_CLASS_MAX; c++) {
+            if (queues[c].count > 0) {
+                return c;
+            }
+        }
+        return -1;
+    }
+
+    // Deficit round robin. Each visit adds weight * MTU; a class is served
+    // while its deficit covers the head packet.
+    for (int round = 0; round < 2 * HOTSPOT_QOS_CLASS_MAX; round++) {
+        for (int c = 0; c < HOTSPOT_QOS_CLASS_MAX; c++) {
+            qos_queue_t *q = &queues[c];
+            if (q->count == 0) {
+                q->deficit = 0;
+                continue;
+            }
+            if (q->deficit >= q->ring[q->head].len) {
+                return c;
+            }
+        }
+        for (int c = 0; c < HOTSPOT_QOS_CLASS_MAX; c++) {
+            if (queues[c].count > 0) {
+                uint8_t w = qos_config.weights[c] ? qos_config.weights[c] : 1;
+                queues[c].deficit += (int32_t)w * QOS_MTU;
+            }
+        }
+    }
+    return -1;
+}
+
+// Caller holds qos_lock. True if a frame for this lane may skip the queues
+// without overtaking anything the scheduler would send first.
+static bool queue_can_bypass(int lane)
+{
+    if (queues[QOS_LANE_ACK].count > 0) {
+        return false;
+    }
+    if (lane == QOS_LANE_ACK) {
+        return true;
+    }
+    if (qos_config.scheduler != HOTSPOT_QOS_SCHED_STRICT) {
+        return queued_total == 0;
+    }
+    for (int c = 0; c <= lane; c++) {
+        if (queues[c].count > 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// TCP ACK HANDLING
+// ============================================================================
+// On asymmetric links a client's download stalls when its ACKs wait behind
+// bulk uploads. Pure ACKs (no payload, no SYN/FIN/RST) go to their own lane.
+//
+// ACK thinning: a newer cumulative ACK for the same flow makes a queued
+// older one redundant, so the newer ACK takes the older one's place in the
+// queue. Duplicate ACKs (same number) and ACKs carrying SACK blocks are
+// never thinned - the sender needs them for loss recovery.
+// ============================================================================
+static bool is_pure_ack(const napt_pkt_t *pkt)
+{
+    return pkt->l4 != NULL && pkt->proto == IP_PROTO_TCP && pkt->payload_len == 0 &&
+           (pkt->tcp_flags & (NAPT_TCP_SYN | NAPT_TCP_FIN | NAPT_TCP_RST | NAPT_TCP_ACK)) == NAPT_TCP_ACK;
+}
+
+static bool tcp_has_sack(const napt_pkt_t *pkt)
+{
+    const uint8_t *opt = pkt->l4 + TCP_HLEN;
+    const uint8_t *end = pkt->l4 + pkt->tcp_hlen;
+    while (opt < end) {
+        if (opt[0] == 0) {          // End of options
+            break;
+        }
+        if (opt[0] == 1) {          // NOP
+            opt++;
+            continue;
+        }
+        if (opt + 1 >= end || opt[1] < 2) {
+            break;
+        }
+        if (opt[0] == 5) {          // SACK
+            return true;
+        }
+        opt += opt[1];
+    }
+    return false;
+}
+
+// Caller holds qos_lock. Returns the ring index of a queued ACK that the
+// new one supersedes, or -1.
+static int ack_thin_find(qos_queue_t *q, const qos_entry_t *e)
+{
+    int scanned = 0;
+    for (int i = q->count - 1; i >= 0 && scanned < HOTSPOT_QOS_ACK_SCAN; i--, scanned++) {
+        int idx = (q->head + i) % HOTSPOT_QOS_MAX_QUEUE;
+        const qos_entry_t *old = &q->ring[idx];
+        if (!old->thinnable || old->flow != e->flow || old->p == qos_inflight) {
+            continue;
+        }
+        // Same flow: only replace if strictly newer and nothing else differs
+        if ((int32_t)(e->ack - old->ack) > 0 && old->flags == e->flags) {
+            return idx;
+        }
+        return -1;
+    }
+    return -1;
+}
+
+// ============================================================================
+// SCHEDULER TASK
+// ============================================================================
+// Drains the lanes into the WiFi driver:
+// 1. Pick a lane (ACK lane, then strict or DRR) and check the shaper
+// 2. Transmit the head packet
+// 3. If the driver is out of TX buffers, leave it queued and retry shortly
+// ============================================================================
+// Picks the next frame and takes its shaper tokens. NULL with *lane < 0
+// means nothing is queued; NULL otherwise means wait *wait_us for tokens.
+static struct pbuf *qos_next(int *lane, uint16_t *len, uint32_t *wait_us)
+{
+    struct pbuf *p = NULL;
+    *wait_us = 0;
+    *len = 0;
+
+    portENTER_CRITICAL(&qos_lock);
+    *lane = queue_pick();
+    if (*lane >= 0) {
+        qos_queue_t *q = &queues[*lane];
+        *len = q->ring[q->head].len;
+        if (shaper_take(*len, wait_us)) {
+            p = q->ring[q->head].p;
+            qos_inflight = p;   // Protects the head from ACK thinning
+        }
+    }
+    portEXIT_CRITICAL(&qos_lock);
+    return p;
+}
+
+// Settles a frame from qos_next() once the driver has been called. Returns
+// false if the driver had no buffer: the frame stays at the head.
+static bool qos_sent(struct pbuf *p, int lane, uint16_t len, err_t err)
+{
+    portENTER_CRITICAL(&qos_lock);
+    qos_inflight = NULL;
+    if (err == ERR_MEM) {
+        // Driver backpressure - refund and keep the packet at the head
+        shaper_tokens += len;
+        qos_stats.driver_busy++;
+        portEXIT_CRITICAL(&qos_lock);
+        return false;
+    }
+    qos_queue_t *q = &queues[lane];
+    hotspot_qos_class_stats_t *st = lane_stats(lane);
+    q->head = (q->head + 1) % HOTSPOT_QOS_MAX_QUEUE;
+    q->count--;
+    q->deficit -= len;
+    queued_total--;
+    st->queue_packets = q->count;
+    st->queue_bytes -= len;
+    st->sent_packets++;
+    st->sent_bytes += len;
+    portEXIT_CRITICAL(&qos_lock);
+    pbuf_free(p);
+    return true;
+}
+
+static void qos_task(void *pvParameters)
+{
+    while (qos_running) {
+        int lane;
+        uint16_t len;
+        uint32_t wait_us;
+        struct pbuf *p = qos_next(&lane, &len, &wait_us);
+
+        if (lane < 0) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        if (p == NULL) {
+            // Shaper says wait; sleep at least one tick
+            TickType_t ticks = pdMS_TO_TICKS(wait_us / 1000);
+            ulTaskNotifyTake(pdTRUE, ticks > 0 ? ticks : 1);
+            continue;
+        }
+
+        if (!qos_sent(p, lane, len, napt_fwd_sta_transmit(p))) {
+            vTaskDelay(1);
+        }
+    }
+
+    xSemaphoreGive(qos_task_done);
+    vTaskDelete(NULL);
+}
+
+// ============================================================================
+// FORWARDING PATH ENTRY
+// ============================================================================
+// Called from the STA linkoutput hook. Returns true if the frame was taken
+// (queued or dropped); false means the caller should transmit it now.
+//
+// driver_busy is set when the caller already tried to transmit and the
+// driver had no TX buffers: the frame is then always queued, which is what
+// lets a backlog (and therefore priority) form in front of the driver.
+// ============================================================================
+// Caller holds qos_lock
+static bool qos_accepting(void)
+{
+    return qos_running && qos_task_handle != NULL;
+}
+
+bool napt_qos_enqueue(napt_pkt_t *pkt, bool driver_busy)
+{
+    // Non-IP (ARP, IPv6) and unparsed frames bypass the queues
+    if (!qos_running || pkt->ip == NULL) {
+        return false;
+    }
+
+    struct pbuf *p = pkt->p;
+    uint16_t len = p->tot_len;
+    qos_entry_t entry = {};
+    entry.len = len;
+
+    portENTER_CRITICAL(&qos_lock);
+    if (!qos_accepting()) {
+        portEXIT_CRITICAL(&qos_lock);
+        return false;
+    }
+    hotspot_qos_class_t cls = qos_classify(pkt);
+    if (qos_config.remark_dscp && !driver_busy) {
+        qos_remark(pkt, qos_config.remark_value[cls]);
+    }
+
+    int lane = cls;
+    if (is_pure_ack(pkt)) {
+        if (qos_config.prioritize_acks) {
+            lane = QOS_LANE_ACK;
+        }
+        if (qos_config.ack_thinning && !tcp_has_sack(pkt)) {
+            entry.thinnable = true;
+            entry.flow = napt_flow_hash(pkt->src, pkt->sport, pkt->dst, pkt->dport, pkt->proto);
+            entry.ack = pkt->ack;
+            entry.flags = pkt->tcp_flags;
+        }
+    }
+    if (driver_busy && pkt->qos_bypass) {
+        // Queue it where the fast path let it through: a remark or an
+        // expired domain tag may classify it differently by now
+        lane = pkt->qos_lane;
+    }
+    hotspot_qos_class_stats_t *st = lane_stats(lane);
+    qos_queue_t *q = &queues[lane];
+    uint16_t limit = lane == QOS_LANE_ACK ? HOTSPOT_QOS_MAX_QUEUE : qos_config.queue_limit[lane];
+    if (limit == 0 || limit > HOTSPOT_QOS_MAX_QUEUE) {
+        limit = HOTSPOT_QOS_MAX_QUEUE;
+    }
+
+    if (driver_busy) {
+        qos_stats.driver_busy++;
+        if (pkt->qos_bypass) {
+            // The scheduler takes the shaper tokens again when it sends it
+            pkt->qos_bypass = false;
+            shaper_tokens += len;
+        }
+    } else if (queue_can_bypass(lane) && shaper_take(len, NULL)) {
+        // Fast path: nothing ahead of us and the shaper has room. Counted
+        // by napt_qos_bypass_done() once the driver has taken it.
+        pkt->qos_bypass = true;
+        pkt->qos_lane = (uint8_t)lane;
+        portEXIT_CRITICAL(&qos_lock);
+        return false;
+    }
+
+    // A full queue can still take a thinnable ACK (it replaces another)
+    if (q->count >= limit && !entry.thinnable) {
+        st->dropped_packets++;
+        st->dropped_bytes += len;
+        portEXIT_CRITICAL(&qos_lock);
+        return true;
+    }
+    portEXIT_CRITICAL(&qos_lock);
+
+    // Hold our own reference. Frames pointing at volatile memory (e.g. the
+    // WiFi RX buffer for forwarded packets) must be copied, same as lwIP's
+    // ARP queue does.
+    if (PBUF_NEEDS_COPY(p)) {
+        entry.p = pbuf_clone(PBUF_RAW_TX, PBUF_RAM, p);
+        if (entry.p == NULL) {
+            portENTER_CRITICAL(&qos_lock);
+            st->dropped_packets++;
+            st->dropped_bytes += len;
+            portEXIT_CRITICAL(&qos_lock);
+            return true;
+        }
+    } else {
+        pbuf_ref(p);
+        entry.p = p;
+    }
+
+    struct pbuf *release = NULL;
+    TaskHandle_t notify = NULL;
+    portENTER_CRITICAL(&qos_lock);
+    if (!qos_accepting()) {
+        // Stopped while the frame was being copied: the caller sends it
+        portEXIT_CRITICAL(&qos_lock);
+        pbuf_free(entry.p);
+        return false;
+    }
+    int idx = entry.thinnable ? ack_thin_find(q, &entry) : -1;
+    if (idx >= 0) {
+        // Newer ACK takes the older one's place in the queue
+        release = q->ring[idx].p;
+        st->queue_bytes = st->queue_bytes - q->ring[idx].len + len;
+        q->ring[idx] = entry;
+        st->enqueued_packets++;
+        st->enqueued_bytes += len;
+        qos_stats.acks_thinned++;
+    } else if (q->count >= limit) {
+        release = entry.p;
+        st->dropped_packets++;
+        st->dropped_bytes += len;
+    } else {
+        uint16_t tail = (q->head + q->count) % HOTSPOT_QOS_MAX_QUEUE;
+        q->ring[tail] = entry;
+        q->count++;
+        queued_total++;
+        st->enqueued_packets++;
+        st->enqueued_bytes += len;
+        st->queue_packets = q->count;
+        st->queue_bytes += len;
+        if (q->count > st->queue_peak) {
+            st->queue_peak = q->count;
+        }
+        // A replaced ACK needs no wakeup: the one it replaced already had one
+        notify = qos_task_handle;
+        qos_enqueuers++;
+    }
+    portEXIT_CRITICAL(&qos_lock);
+
+    if (release != NULL) {
+        pbuf_free(release);
+    }
+    if (notify != NULL) {
+        xTaskNotifyGive(notify);
+        portENTER_CRITICAL(&qos_lock);
+        qos_enqueuers--;
+        portEXIT_CRITICAL(&qos_lock);
+    }
+    return true;
+}
+
+// Called with the driver's verdict on a frame the fast path let through
+// (and that napt_qos_enqueue(pkt, true) did not take back)
+void napt_qos_bypass_done(napt_pkt_t *pkt, err_t err)
+{
+    if (!pkt->qos_bypass) {
+        return;
+    }
+    pkt->qos_bypass = false;
+    uint16_t len = pkt->p->tot_len;
+
+    portENTER_CRITICAL(&qos_lock);
+    if (err == ERR_OK) {
+        hotspot_qos_class_stats_t *st = lane_stats(pkt->qos_lane);
+        st->enqueued_packets++;
+        st->enqueued_bytes += len;
+        st->sent_packets++;
+        st->sent_bytes += len;
+    } else {
+        // Never went out
+        shaper_tokens += len;
+    }
+    portEXIT_CRITICAL(&qos_lock);
+}
+
+// ============================================================================
+// CLASS MARKING
+// ============================================================================
+// Used by classifiers that run before NAT (e.g. DNS snooping), where the
+// client is still known. The packet itself is left alone: its class goes
+// into a small tag table keyed on fields NAT does not rewrite, and the
+// egress classifier looks it up there. DSCP is only changed on egress, and
+// only with remark_dscp.
+// ============================================================================
+void napt_qos_mark(const napt_pkt_t *pkt, hotspot_qos_class_t cls)
+{
+    if (!qos_running || pkt->ip == NULL || cls >= HOTSPOT_QOS_CLASS_MAX) {
+        return;
+    }
+    uint32_t now_ms = napt_now_ms();
+    portENTER_CRITICAL_SAFE(&qos_lock);
+    qos_tag_t *t = tag_slot(pkt);
+    t->dst = pkt->dst;
+    t->dport = pkt->dport;
+    t->ip_id = pkt_ip_id(pkt);
+    t->proto = pkt->proto;
+    t->cls = (uint8_t)cls;
+    t->stamp_ms = now_ms != 0 ? now_ms : 1;
+    portEXIT_CRITICAL_SAFE(&qos_lock);
+}
+
+// ============================================================================
+// START / STOP
+// ============================================================================
+void napt_qos_start(void)
+{
+    if (!dscp_map_ready) {
+        dscp_map_init();
+    }
+    if (!qos_configured || !qos_config.enabled || qos_running) {
+        return;
+    }
+
+    if (qos_task_done == NULL) {
+        qos_task_done = xSemaphoreCreateBinary();
+    }
+
+    portENTER_CRITICAL(&qos_lock);
+    shaper_tokens = SHAPER_MIN_BURST;
+    shaper_stamp_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&qos_lock);
+
+    // Frames are only queued once the handle is published below
+    TaskHandle_t task = NULL;
+    qos_running = true;
+    if (xTaskCreate(qos_task, "napt_qos", HOTSPOT_QOS_TASK_STACK, NULL,
+                    HOTSPOT_QOS_TASK_PRIORITY, &task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create QoS task");
+        qos_running = false;
+        return;
+    }
+    portENTER_CRITICAL(&qos_lock);
+    qos_task_handle = task;
+    portEXIT_CRITICAL(&qos_lock);
+    ESP_LOGI(TAG, "QoS scheduler started (%s)",
+             qos_config.scheduler == HOTSPOT_QOS_SCHED_STRICT ? "strict priority" : "weighted");
+}
+
+void napt_qos_stop(void)
+{
+    if (!qos_running) {
+        return;
+    }
+
+    // 1. Stop accepting frames; nothing is queued after this
+    portENTER_CRITICAL(&qos_lock);
+    qos_running = false;
+    TaskHandle_t task = qos_task_handle;
+    portEXIT_CRITICAL(&qos_lock);
+
+    // 2. Wait for enqueue calls that queued a frame and are about to notify
+    for (;;) {
+        portENTER_CRITICAL(&qos_lock);
+        uint8_t busy = qos_enqueuers;
+        portEXIT_CRITICAL(&qos_lock);
+        if (busy == 0) {
+            break;
+        }
+        vTaskDelay(1);
+    }
+
+    // 3. Join the task, then drop what it left behind
+    if (task != NULL) {
+        xTaskNotifyGive(task);
+        xSemaphoreTake(qos_task_done, portMAX_DELAY);
+    }
+    portENTER_CRITICAL(&qos_lock);
+    qos_task_handle = NULL;
+    queue_drop_all();
+    portEXIT_CRITICAL(&qos_lock);
+    ESP_LOGI(TAG, "QoS scheduler stopped");
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+esp_err_t hotspot_qos_configure(const hotspot_qos_config_t *config)
+{
+    if (config == NULL || config->scheduler > HOTSPOT_QOS_SCHED_WEIGHTED || config->rate_percent > 100) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int c = 0; c < HOTSPOT_QOS_CLASS_MAX; c++) {
+        if (config->queue_limit[c] > HOTSPOT_QOS_MAX_QUEUE || config->remark_value[c] > 63) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    if (!dscp_map_ready) {
+        dscp_map_init();
+    }
+
+    // Serialised with hotspot_start/stop, which start and stop QoS as well
+    napt_ctl_lock();
+    if (qos_running && !config->enabled) {
+        napt_qos_stop();
+    }
+
+    portENTER_CRITICAL(&qos_lock);
+    qos_config = *config;
+    qos_configured = true;
+    portEXIT_CRITICAL(&qos_lock);
+
+    if (config->enabled && napt_fwd_active()) {
+        napt_qos_start();
+    }
+    napt_ctl_unlock();
+    return ESP_OK;
+}
+
+esp_err_t hotspot_qos_get_config(hotspot_qos_config_t *config)
+{
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&qos_lock);
+    *config = qos_config;
+    if (!qos_configured) {
+        config->enabled = false;
+    }
+    portEXIT_CRITICAL(&qos_lock);
+    return ESP_OK;
+}
+
+esp_err_t hotspot_qos_set_dscp_class(uint8_t dscp, hotspot_qos_class_t cls)
+{
+    if (dscp > 63 || cls >= HOTSPOT_QOS_CLASS_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&qos_lock);
+    if (!dscp_map_ready) {
+        dscp_map_init();
+    }
+    dscp_map[dscp] = cls;
+    portEXIT_CRITICAL(&qos_lock);
+    return ESP_OK;
+}
+
+esp_err_t hotspot_qos_add_rule(uint8_t proto, uint16_t port_min, uint16_t port_max, hotspot_qos_class_t cls)
+{
+    if (port_min > port_max || cls >= HOTSPOT_QOS_CLASS_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = ESP_OK;
+    portENTER_CRITICAL(&qos_lock);
+    if (qos_rule_count >= HOTSPOT_QOS_MAX_RULES) {
+        ret = ESP_ERR_NO_MEM;
+    } else {
+        qos_rules[qos_rule_count].proto = proto;
+        qos_rules[qos_rule_count].port_min = port_min;
+        qos_rules[qos_rule_count].port_max = port_max;
+        qos_rules[qos_rule_count].cls = cls;
+        qos_rule_count++;
+    }
+    portEXIT_CRITICAL(&qos_lock);
+    return ret;
+}
+
+void hotspot_qos_clear_rules(void)
+{
+    portENTER_CRITICAL(&qos_lock);
+    qos_rule_count = 0;
+    portEXIT_CRITICAL(&qos_lock);
+}
+
+esp_err_t hotspot_qos_get_stats(hotspot_qos_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&qos_lock);
+    *stats = qos_stats;
+    portEXIT_CRITICAL(&qos_lock);
+    return ESP_OK;
+}
@@ -0,0 +1,839 @@
+/***************************************************************************************
+ *  File        : napt_reflector.cpp
+ *  Description : mDNS / SSDP service discovery reflector between clients and the LAN
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Client queries are taken from the AP input hook (before the multicast
+ *     filter), so the reflector works with client mDNS/SSDP filtered out and
+ *     does not compete with an mDNS responder for port 5353.
+ *   - Queries go to the LAN from an ephemeral port: mDNS responders then
+ *     answer by unicast (RFC 6762 legacy unicast, TTLs capped at 10 s) and
+ *     SSDP devices always do. Nothing is multicast back onto the LAN.
+ *   - Answers go to the asking client by unicast, never as AP multicast, and
+ *     unsolicited LAN announcements are not reflected at all.
+ *   - Only plain BSD sockets are used on the task side.
+ ***************************************************************************************/
+
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include "napt_reflector.h"
+#include "napt_internal.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_random.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "lwip/sockets.h"
+
+#ifndef HOTSPOT_REFLECTOR_CACHE_ENTRIES
+#define HOTSPOT_REFLECTOR_CACHE_ENTRIES 8
+#endif
+
+// Larger responses are still relayed, just not cached
+#ifndef HOTSPOT_REFLECTOR_MSG_MAX
+#define HOTSPOT_REFLECTOR_MSG_MAX 512
+#endif
+
+// Forwarded queries whose responses are still being relayed
+#ifndef HOTSPOT_REFLECTOR_PENDING
+#define HOTSPOT_REFLECTOR_PENDING 8
+#endif
+
+// How long responses to a forwarded query are relayed to the client
+#ifndef HOTSPOT_REFLECTOR_WAIT_MS
+#define HOTSPOT_REFLECTOR_WAIT_MS 3000
+#endif
+
+#ifndef HOTSPOT_REFLECTOR_MAX_TTL_S
+#define HOTSPOT_REFLECTOR_MAX_TTL_S 120
+#endif
+
+#ifndef HOTSPOT_REFLECTOR_QUEUE_LEN
+#define HOTSPOT_REFLECTOR_QUEUE_LEN 4
+#endif
+
+#ifndef HOTSPOT_REFLECTOR_TASK_STACK
+#define HOTSPOT_REFLECTOR_TASK_STACK 4096
+#endif
+
+#ifndef HOTSPOT_REFLECTOR_TASK_PRIORITY
+#define HOTSPOT_REFLECTOR_TASK_PRIORITY 4
+#endif
+
+#define MDNS_PORT 5353
+#define SSDP_PORT 1900
+#define MDNS_GROUP 0xE00000FBu      // 224.0.0.251
+#define SSDP_GROUP 0xEFFFFFFAu      // 239.255.255.250
+#define RX_BUF_LEN 1500
+#define POLL_MS 20                  // Socket poll interval while responses are expected
+
+static const char *TAG = "napt_reflector";
+
+// ============================================================================
+// REFLECTOR STATE
+// ============================================================================
+// Intake from the AP hook: the frame is referenced, not copied, so the WiFi
+// driver task never needs a message-sized buffer
+typedef struct {
+    struct pbuf *p;             // NULL = stop marker
+    const uint8_t *data;        // UDP payload inside p
+    uint16_t len;
+    uint8_t proto;
+    uint16_t client_port;       // Host order
+    uint32_t client;            // Network order
+} intake_t;
+
+typedef struct {
+    uint32_t key;               // Question hash, 0 = free
+    uint32_t src;               // Responder, network order
+    uint32_t expires_ms;
+    uint8_t proto;
+    uint16_t len;
+    uint8_t msg[HOTSPOT_REFLECTOR_MSG_MAX];
+} cache_entry_t;
+
+typedef struct {
+    uint32_t key;               // 0 = any response (multi-question mDNS, SSDP ssdp:all)
+    uint32_t client;
+    uint32_t expires_ms;
+    uint16_t client_port;
+    uint16_t client_id;         // mDNS query ID, echoed to legacy (non-5353) clients
+    uint8_t proto;
+    bool used;
+} pending_t;
+
+typedef struct {
+    uint32_t tokens;            // Thousandths of a packet
+    uint32_t stamp_ms;
+} bucket_t;
+
+static portMUX_TYPE reflector_lock = portMUX_INITIALIZER_UNLOCKED;
+static hotspot_reflector_config_t reflector_config = HOTSPOT_REFLECTOR_CONFIG_DEFAULT();
+static hotspot_reflector_stats_t reflector_stats = {};
+
+// reflector_running changes under reflector_lock. intake_posters counts hook
+// calls between checking it and queueing a frame, which stop waits out.
+static QueueHandle_t intake_queue = NULL;  // Created once, never deleted
+static TaskHandle_t reflector_task_handle = NULL;
+static SemaphoreHandle_t reflector_done = NULL;
+static volatile bool reflector_running = false;
+static uint8_t intake_posters = 0;
+static volatile uint16_t reflector_ports[HOTSPOT_REFLECT_PROTO_MAX];   // Source ports of our LAN queries
+
+// Reflector task only
+static cache_entry_t *cache = NULL;
+static pending_t pending[HOTSPOT_REFLECTOR_PENDING];
+static bucket_t query_bucket[HOTSPOT_REFLECT_PROTO_MAX];
+static bucket_t reply_bucket[HOTSPOT_REFLECT_PROTO_MAX];
+static int lan_socket[HOTSPOT_REFLECT_PROTO_MAX] = { -1, -1 };
+static int mdns_reply_socket = -1;         // Bound to the AP address, port 5353
+static uint8_t tx_buf[RX_BUF_LEN];
+
+#define STAT_INC(p, field) do {                     \
+    portENTER_CRITICAL(&reflector_lock);            \
+    reflector_stats.proto[p].field++;               \
+    portEXIT_CRITICAL(&reflector_lock);             \
+} while (0)
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+// Anything still queued holds a frame reference
+static void intake_drain(void)
+{
+    intake_t in;
+    while (xQueueReceive(intake_queue, &in, 0) == pdTRUE) {
+        if (in.p != NULL) {
+            pbuf_free(in.p);
+        }
+    }
+}
+
+// Token bucket with a burst of two seconds' worth
+static bool bucket_take(bucket_t *b, uint8_t rate, uint32_t now_ms)
+{
+    uint32_t elapsed = now_ms - b->stamp_ms;
+    uint32_t cap = (uint32_t)rate * 2000;
+    b->stamp_ms = now_ms;
+    b->tokens += (elapsed > 2000 ? 2000 : elapsed) * rate;
+    if (b->tokens > cap) {
+        b->tokens = cap;
+    }
+    if (b->tokens < 1000) {
+        return false;
+    }
+    b->tokens -= 1000;
+    return true;
+}
+
+// FNV-1a over the protocol and a case-folded string, plus an optional type
+static uint32_t key_hash(uint8_t proto, const char *s, uint16_t type)
+{
+    uint32_t h = (2166136261u ^ proto) * 16777619u;
+    while (*s) {
+        h = (h ^ (uint8_t)tolower((unsigned char)*s++)) * 16777619u;
+    }
+    h = (h ^ (type >> 8)) * 16777619u;
+    h = (h ^ (type & 0xff)) * 16777619u;
+    return h != 0 ? h : 1;
+}
+
+// Value of an HTTP-style header line ("ST: ..."), trimmed. False if absent.
+static bool ssdp_header(const uint8_t *msg, int len, const char *name, char *out, size_t out_len)
+{
+    size_t name_len = strlen(name);
+    int i = 0;
+    while (i < len) {
+        int eol = i;
+        while (eol < len && msg[eol] != '\r' && msg[eol] != '\n') {
+            eol++;
+        }
+        if (eol - i > (int)name_len && msg[i + name_len] == ':' &&
+            strncasecmp((const char *)msg + i, name, name_len) == 0) {
+            int v = i + name_len + 1;
+            while (v < eol && (msg[v] == ' ' || msg[v] == '\t')) {
+                v++;
+            }
+            int end = eol;
+            while (end > v && (msg[end - 1] == ' ' || msg[end - 1] == '\t')) {
+                end--;
+            }
+            size_t n = (size_t)(end - v) < out_len - 1 ? (size_t)(end - v) : out_len - 1;
+            memcpy(out, msg + v, n);
+            out[n] = '\0';
+            return true;
+        }
+        i = eol + 1;
+    }
+    return false;
+}
+
+// Smallest answer TTL of an mDNS response, UINT32_MAX if none
+static uint32_t mdns_min_ttl(const uint8_t *msg, int len, const napt_dns_msg_t *m)
+{
+    uint32_t min_ttl = UINT32_MAX;
+    int off = m->answers_off;
+    napt_dns_rr_t rr;
+    for (int i = 0; i < m->ancount && off >= 0; i++) {
+        off = napt_dns_read_rr(msg, len, off, &rr, NULL, 0);
+        if (off >= 0 && rr.ttl < min_ttl) {
+            min_ttl = rr.ttl;
+        }
+    }
+    return min_ttl;
+}
+
+static uint32_t lan_address(void)
+{
+    esp_netif_t *sta = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    esp_netif_ip_info_t info;
+    if (sta == NULL || esp_netif_get_ip_info(sta, &info) != ESP_OK) {
+        return 0;
+    }
+    return info.ip.addr;
+}
+
+// ============================================================================
+// CACHE
+// ============================================================================
+static inline bool cache_live(const cache_entry_t *e, uint32_t now_ms)
+{
+    return e->key != 0 && (int32_t)(e->expires_ms - now_ms) > 0;
+}
+
+static void cache_store(uint8_t proto, uint32_t key, uint32_t src, const uint8_t *msg, int len, uint32_t ttl_s)
+{
+    if (key == 0 || ttl_s == 0 || len > HOTSPOT_REFLECTOR_MSG_MAX) {
+        return;
+    }
+    if (ttl_s > HOTSPOT_REFLECTOR_MAX_TTL_S) {
+        ttl_s = HOTSPOT_REFLECTOR_MAX_TTL_S;
+    }
+    uint32_t now_ms = napt_now_ms();
+
+    // Same answer from the same responder, else a free or expired entry,
+    // else the one expiring first
+    cache_entry_t *target = NULL;
+    for (int i = 0; i < HOTSPOT_REFLECTOR_CACHE_ENTRIES; i++) {
+        cache_entry_t *e = &cache[i];
+        if (e->key == key && e->proto == proto && e->src == src) {
+            target = e;
+            break;
+        }
+        if (target == NULL || (cache_live(target, now_ms) &&
+            (!cache_live(e, now_ms) || (int32_t)(e->expires_ms - target->expires_ms) < 0))) {
+            target = e;
+        }
+    }
+
+    memcpy(target->msg, msg, len);
+    target->len = (uint16_t)len;
+    target->key = key;
+    target->src = src;
+    target->proto = proto;
+    target->expires_ms = now_ms + ttl_s * 1000;
+}
+
+static uint16_t cache_count(void)
+{
+    uint32_t now_ms = napt_now_ms();
+    uint16_t n = 0;
+    for (int i = 0; i < HOTSPOT_REFLECTOR_CACHE_ENTRIES; i++) {
+        if (cache_live(&cache[i], now_ms)) {
+            n++;
+        }
+    }
+    return n;
+}
+
+// ============================================================================
+// SENDING
+// ============================================================================
+static void send_to_client(uint8_t proto, const pending_t *to, const uint8_t *msg, int len, uint8_t rate)
+{
+    if (!bucket_take(&reply_bucket[proto], rate, napt_now_ms())) {
+        STAT_INC(proto, reply_limited);
+        return;
+    }
+
+    int sock = lan_socket[proto];
+    if (proto == HOTSPOT_REFLECT_MDNS) {
+        // Queriers on 5353 only accept responses from 5353 with ID 0;
+        // legacy queriers expect their own ID back
+        memcpy(tx_buf, msg, len);
+        if (to->client_port == MDNS_PORT) {
+            sock = mdns_reply_socket;
+            tx_buf[0] = 0;
+            tx_buf[1] = 0;
+        } else {
+            tx_buf[0] = (uint8_t)(to->client_id >> 8);
+            tx_buf[1] = (uint8_t)to->client_id;
+        }
+        msg = tx_buf;
+    }
+    if (sock < 0) {
+        return;
+    }
+
+    struct sockaddr_in dst = {};
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons(to->client_port);
+    dst.sin_addr.s_addr = to->client;
+    if (sendto(sock, msg, len, 0, (struct sockaddr *)&dst, sizeof(dst)) == len) {
+        STAT_INC(proto, replies);
+    }
+}
+
+static bool send_to_lan(uint8_t proto, const uint8_t *msg, int len)
+{
+    uint32_t lan = lan_address();
+    if (lan == 0) {
+        return false;
+    }
+    struct in_addr iface = {};
+    iface.s_addr = lan;
+    setsockopt(lan_socket[proto], IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface));
+
+    struct sockaddr_in dst = {};
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons(proto == HOTSPOT_REFLECT_MDNS ? MDNS_PORT : SSDP_PORT);
+    dst.sin_addr.s_addr = htonl(proto == HOTSPOT_REFLECT_MDNS ? MDNS_GROUP : SSDP_GROUP);
+    return sendto(lan_socket[proto], msg, len, 0, (struct sockaddr *)&dst, sizeof(dst)) == len;
+}
+
+// ============================================================================
+// CLIENT QUERIES
+// ============================================================================
+// Answer from the cache if possible, otherwise forward to the LAN (rate
+// limited) and remember who asked.
+// ============================================================================
+static void handle_query(const intake_t *in, const hotspot_reflector_config_t *config)
+{
+    static napt_dns_msg_t m;    // Reflector task only
+    uint8_t proto = in->proto;
+    uint32_t key = 0;
+    bool match_all = false;
+    uint16_t client_id = 0;
+
+    STAT_INC(proto, client_queries);
+
+    if (proto == HOTSPOT_REFLECT_MDNS) {
+        if (!napt_dns_parse(in->data, in->len, &m) || (m.flags & NAPT_DNS_FLAG_QR)) {
+            return;
+        }
+        client_id = m.id;
+        // Several questions in one query can't be answered from single
+        // entries; any response to it is relayed
+        key = m.qdcount == 1 ? key_hash(proto, m.qname, m.qtype) : 0;
+    } else {
+        char st[128];
+        if (!ssdp_header(in->data, in->len, "ST", st, sizeof(st))) {
+            return;
+        }
+        match_all = strcasecmp(st, "ssdp:all") == 0;
+        key = match_all ? 0 : key_hash(proto, st, 0);
+    }
+
+    pending_t client = {};
+    client.key = key;
+    client.client = in->client;
+    client.client_port = in->client_port;
+    client.client_id = client_id;
+    client.proto = proto;
+
+    // Cache
+    uint32_t now_ms = napt_now_ms();
+    bool answered = false;
+    if (key != 0 || match_all) {
+        for (int i = 0; i < HOTSPOT_REFLECTOR_CACHE_ENTRIES; i++) {
+            cache_entry_t *e = &cache[i];
+            if (!cache_live(e, now_ms) || e->proto != proto || (!match_all && e->key != key)) {
+                continue;
+            }
+            send_to_client(proto, &client, e->msg, e->len, config->replies_per_s[proto]);
+            answered = true;
+        }
+    }
+    if (answered) {
+        STAT_INC(proto, cache_answered);
+        return;
+    }
+
+    // Forward
+    if (!bucket_take(&query_bucket[proto], config->queries_per_s[proto], now_ms)) {
+        STAT_INC(proto, query_limited);
+        return;
+    }
+    const uint8_t *msg = in->data;
+    if (proto == HOTSPOT_REFLECT_MDNS) {
+        // A non-zero ID and our ephemeral source port make this a legacy
+        // unicast query
+        memcpy(tx_buf, in->data, in->len);
+        uint16_t id = (uint16_t)(esp_random() | 1);
+        tx_buf[0] = (uint8_t)(id >> 8);
+        tx_buf[1] = (uint8_t)id;
+        msg = tx_buf;
+    }
+    if (!send_to_lan(proto, msg, in->len)) {
+        return;
+    }
+    STAT_INC(proto, forwarded);
+
+    // Remember the client: a free or expired slot, else the oldest
+    pending_t *slot = &pending[0];
+    for (int i = 0; i < HOTSPOT_REFLECTOR_PENDING; i++) {
+        pending_t *p = &pending[i];
+        if (!p->used || (int32_t)(p->expires_ms - now_ms) <= 0) {
+            slot = p;
+            break;
+        }
+        if ((int32_t)(p->expires_ms - slot->expires_ms) < 0) {
+            slot = p;
+        }
+    }
+    *slot = client;
+    slot->used = true;
+    slot->expires_ms = now_ms + HOTSPOT_REFLECTOR_WAIT_MS;
+}
+
+// ============================================================================
+// LAN RESPONSES
+// ============================================================================
+static void handle_response(uint8_t proto, const uint8_t *msg, int len, uint32_t src,
+                            const hotspot_reflector_config_t *config)
+{
+    static napt_dns_msg_t m;    // Reflector task only
+    uint32_t key = 0;
+    uint32_t ttl_s = HOTSPOT_REFLECTOR_MAX_TTL_S;
+
+    if (proto == HOTSPOT_REFLECT_MDNS) {
+        if (!napt_dns_parse(msg, len, &m) || !(m.flags & NAPT_DNS_FLAG_QR) || m.ancount == 0) {
+            return;
+        }
+        // Legacy unicast responses repeat the question
+        key = m.qdcount == 1 ? key_hash(proto, m.qname, m.qtype) : 0;
+        ttl_s = mdns_min_ttl(msg, len, &m);
+    } else {
+        char value[128];
+        if (len < 12 || strncmp((const char *)msg, "HTTP/1.1 200", 12) != 0 ||
+            !ssdp_header(msg, len, "ST", value, sizeof(value))) {
+            return;
+        }
+        key = key_hash(proto, value, 0);
+        if (ssdp_header(msg, len, "CACHE-CONTROL", value, sizeof(value))) {
+            const char *age = strstr(value, "max-age");
+            if (age != NULL && (age = strchr(age, '=')) != NULL) {
+                ttl_s = (uint32_t)strtoul(age + 1, NULL, 10);
+            }
+        }
+    }
+    STAT_INC(proto, responses);
+
+    // Whoever is still waiting for it
+    uint32_t now_ms = napt_now_ms();
+    bool wanted = false;
+    for (int i = 0; i < HOTSPOT_REFLECTOR_PENDING; i++) {
+        pending_t *p = &pending[i];
+        if (!p->used || p->proto != proto || (int32_t)(p->expires_ms - now_ms) <= 0 ||
+            (p->key != 0 && p->key != key)) {
+            continue;
+        }
+        send_to_client(proto, p, msg, len, config->replies_per_s[proto]);
+        wanted = true;
+    }
+
+    // Only what a client asked for is cached, so the table holds the
+    // services clients actually look up
+    if (wanted) {
+        cache_store(proto, key, src, msg, len, ttl_s);
+    }
+}
+
+static bool pending_live(void)
+{
+    uint32_t now_ms = napt_now_ms();
+    for (int i = 0; i < HOTSPOT_REFLECTOR_PENDING; i++) {
+        if (pending[i].used && (int32_t)(pending[i].expires_ms - now_ms) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ============================================================================
+// REFLECTOR TASK
+// ============================================================================
+// Blocks on the intake queue while nothing is outstanding, so an idle
+// reflector costs no wakeups; polls the LAN sockets every POLL_MS while
+// responses are expected.
+// ============================================================================
+static int reflector_socket(uint32_t addr, uint16_t port, uint8_t ttl)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0) {
+        return -1;
+    }
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+
+    struct sockaddr_in bind_addr = {};
+    bind_addr.sin_family = AF_INET;
+    bind_addr.sin_port = htons(port);
+    bind_addr.sin_addr.s_addr = addr;
+    if (bind(sock, (struct sockaddr *)&bind_addr, sizeof(bind_addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+    return sock;
+}
+
+static void reflector_close(void)
+{
+    for (int p = 0; p < HOTSPOT_REFLECT_PROTO_MAX; p++) {
+        if (lan_socket[p] >= 0) {
+            close(lan_socket[p]);
+        }
+        lan_socket[p] = -1;
+        reflector_ports[p] = 0;
+    }
+    if (mdns_reply_socket >= 0) {
+        close(mdns_reply_socket);
+    }
+    mdns_reply_socket = -1;
+}
+
+static void reflector_task(void *arg)
+{
+    uint8_t *rx_buf = (uint8_t *)malloc(RX_BUF_LEN);
+    cache = (cache_entry_t *)calloc(HOTSPOT_REFLECTOR_CACHE_ENTRIES, sizeof(cache_entry_t));
+    memset(pending, 0, sizeof(pending));
+
+    // mDNS wants TTL 255; SSDP's recommended multicast TTL is 2
+    lan_socket[HOTSPOT_REFLECT_MDNS] = reflector_socket(htonl(INADDR_ANY), 0, 255);
+    lan_socket[HOTSPOT_REFLECT_SSDP] = reflector_socket(htonl(INADDR_ANY), 0, 2);
+    for (int p = 0; p < HOTSPOT_REFLECT_PROTO_MAX; p++) {
+        struct sockaddr_in local;
+        socklen_t local_len = sizeof(local);
+        if (lan_socket[p] >= 0 && getsockname(lan_socket[p], (struct sockaddr *)&local, &local_len) == 0) {
+            reflector_ports[p] = ntohs(local.sin_port);
+        }
+    }
+
+    esp_netif_t *ap = esp_netif_get_handle_from_ifkey("WIFI_AP_DEF");
+    esp_netif_ip_info_t ap_info;
+    if (ap != NULL && esp_netif_get_ip_info(ap, &ap_info) == ESP_OK) {
+        mdns_reply_socket = reflector_socket(ap_info.ip.addr, MDNS_PORT, 255);
+    }
+    if (mdns_reply_socket < 0) {
+        ESP_LOGW(TAG, "Port 5353 on the AP address unavailable; only legacy mDNS clients get answers");
+    }
+
+    if (rx_buf == NULL || cache == NULL ||
+        lan_socket[HOTSPOT_REFLECT_MDNS] < 0 || lan_socket[HOTSPOT_REFLECT_SSDP] < 0) {
+        ESP_LOGE(TAG, "Reflector setup failed");
+        portENTER_CRITICAL(&reflector_lock);
+        reflector_running = false;
+        portEXIT_CRITICAL(&reflector_lock);
+    }
+
+    while (reflector_running) {
+        hotspot_reflector_config_t config;
+        portENTER_CRITICAL(&reflector_lock);
+        config = reflector_config;
+        portEXIT_CRITICAL(&reflector_lock);
+
+        intake_t in;
+        TickType_t wait = pending_live() ? pdMS_TO_TICKS(POLL_MS) : portMAX_DELAY;
+        if (xQueueReceive(intake_queue, &in, wait) == pdTRUE) {
+            if (in.p == NULL) {
+                continue;   // Stop marker; the loop condition decides
+            }
+            if (config.enabled[in.proto]) {
+                handle_query(&in, &config);
+            }
+            pbuf_free(in.p);
+        }
+
+        for (int p = 0; p < HOTSPOT_REFLECT_PROTO_MAX; p++) {
+            struct sockaddr_in from;
+            socklen_t from_len = sizeof(from);
+            int n;
+            while ((n = recvfrom(lan_socket[p], rx_buf, RX_BUF_LEN, MSG_DONTWAIT,
+                                 (struct sockaddr *)&from, &from_len)) > 0) {
+                handle_response((uint8_t)p, rx_buf, n, from.sin_addr.s_addr, &config);
+                from_len = sizeof(from);
+            }
+        }
+
+        uint16_t entries = cache_count();
+        portENTER_CRITICAL(&reflector_lock);
+        reflector_stats.cache_entries = entries;
+        portEXIT_CRITICAL(&reflector_lock);
+    }
+
+    intake_drain();
+    reflector_close();
+    free(rx_buf);
+    free(cache);
+    cache = NULL;
+    portENTER_CRITICAL(&reflector_lock);
+    reflector_stats.cache_entries = 0;
+    portEXIT_CRITICAL(&reflector_lock);
+
+    xSemaphoreGive(reflector_done);
+    vTaskDelete(NULL);
+}
+
+// ============================================================================
+// AP HOOK SIDE
+// ============================================================================
+// Runs in the WiFi driver task for every client frame. Only multicast mDNS
+// queries and SSDP M-SEARCHes for an enabled protocol get past the first
+// tests; they are handed to the task by reference.
+// ============================================================================
+void napt_reflector_on_packet(const napt_pkt_t *pkt)
+{
+    if (!reflector_running || !pkt->multicast || pkt->proto != IP_PROTO_UDP || pkt->l4 == NULL) {
+        return;
+    }
+    uint8_t proto;
+    if (pkt->dport == MDNS_PORT) {
+        proto = HOTSPOT_REFLECT_MDNS;
+    } else if (pkt->dport == SSDP_PORT) {
+        proto = HOTSPOT_REFLECT_SSDP;
+    } else {
+        return;
+    }
+    if (!reflector_config.enabled[proto]) {
+        return;
+    }
+
+    const uint8_t *data = pkt->l4 + 8;
+    uint16_t len = pkt->payload_len;
+    if (len == 0 || data + len > pkt->eth + pkt->p->len) {
+        return;
+    }
+    if (proto == HOTSPOT_REFLECT_MDNS ? (len < NAPT_DNS_HEADER_LEN || (data[2] & 0x80)) :
+                                        (len < 8 || memcmp(data, "M-SEARCH", 8) != 0)) {
+        return;
+    }
+
+    intake_t in = {};
+    in.p = pkt->p;
+    in.data = data;
+    in.len = len;
+    in.proto = proto;
+    in.client = pkt->src;
+    in.client_port = pkt->sport;
+
+    portENTER_CRITICAL(&reflector_lock);
+    bool accepting = reflector_running;
+    if (accepting) {
+        intake_posters++;
+    }
+    portEXIT_CRITICAL(&reflector_lock);
+    if (!accepting) {
+        return;
+    }
+
+    pbuf_ref(pkt->p);
+    bool queued = xQueueSend(intake_queue, &in, 0) == pdTRUE;
+    portENTER_CRITICAL(&reflector_lock);
+    intake_posters--;
+    if (!queued) {
+        reflector_stats.proto[proto].query_limited++;
+    }
+    portEXIT_CRITICAL(&reflector_lock);
+    if (!queued) {
+        pbuf_free(pkt->p);
+    }
+}
+
+// Our own LAN queries are exempt from the multicast filter
+bool napt_reflector_owns(const napt_pkt_t *pkt)
+{
+    if (pkt->proto != IP_PROTO_UDP || pkt->l4 == NULL || pkt->sport == 0) {
+        return false;
+    }
+    return pkt->sport == reflector_ports[HOTSPOT_REFLECT_MDNS] ||
+           pkt->sport == reflector_ports[HOTSPOT_REFLECT_SSDP];
+}
+
+// ============================================================================
+// START / STOP
+// ============================================================================
+// No frame is queued once this returns
+static void intake_close(void)
+{
+    portENTER_CRITICAL(&reflector_lock);
+    reflector_running = false;
+    portEXIT_CRITICAL(&reflector_lock);
+    for (;;) {
+        portENTER_CRITICAL(&reflector_lock);
+        uint8_t busy = intake_posters;
+        portEXIT_CRITICAL(&reflector_lock);
+        if (busy == 0) {
+            break;
+        }
+        vTaskDelay(1);
+    }
+}
+
+static bool reflector_wanted(void)
+{
+    return reflector_config.enabled[HOTSPOT_REFLECT_MDNS] || reflector_config.enabled[HOTSPOT_REFLECT_SSDP];
+}
+
+void napt_reflector_start(void)
+{
+    if (reflector_running || !reflector_wanted()) {
+        return;
+    }
+    if (reflector_done == NULL) {
+        reflector_done = xSemaphoreCreateBinary();
+    }
+    if (intake_queue == NULL) {
+        intake_queue = xQueueCreate(HOTSPOT_REFLECTOR_QUEUE_LEN, sizeof(intake_t));
+    }
+    if (reflector_done == NULL || intake_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create reflector queue");
+        return;
+    }
+
+    // Stop drains the queue; this only catches a stop marker the task never read
+    intake_drain();
+
+    portENTER_CRITICAL(&reflector_lock);
+    reflector_running = true;
+    portEXIT_CRITICAL(&reflector_lock);
+    xSemaphoreTake(reflector_done, 0);
+    if (xTaskCreate(reflector_task, "napt_reflector", HOTSPOT_REFLECTOR_TASK_STACK, NULL,
+                    HOTSPOT_REFLECTOR_TASK_PRIORITY, &reflector_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create reflector task");
+        intake_close();
+        reflector_task_handle = NULL;
+        intake_drain();
+        return;
+    }
+    ESP_LOGI(TAG, "Discovery reflector started (mDNS %s, SSDP %s)",
+             reflector_config.enabled[HOTSPOT_REFLECT_MDNS] ? "on" : "off",
+             reflector_config.enabled[HOTSPOT_REFLECT_SSDP] ? "on" : "off");
+}
+
+void napt_reflector_stop(void)
+{
+    if (reflector_task_handle == NULL) {
+        return;
+    }
+    intake_close();
+
+    // The task may be blocked on the queue with nothing outstanding
+    intake_t stop = {};
+    xQueueSend(intake_queue, &stop, 0);
+    xSemaphoreTake(reflector_done, portMAX_DELAY);
+    reflector_task_handle = NULL;
+    intake_drain();
+    ESP_LOGI(TAG, "Discovery reflector stopped");
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+esp_err_t hotspot_reflector_configure(const hotspot_reflector_config_t *config)
+{
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int p = 0; p < HOTSPOT_REFLECT_PROTO_MAX; p++) {
+        if (config->queries_per_s[p] < 1 || config->queries_per_s[p] > 100 ||
+            config->replies_per_s[p] < 1 || config->replies_per_s[p] > 100) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    // Same lock as hotspot enable/disable, which start and stop the reflector too
+    napt_ctl_lock();
+    portENTER_CRITICAL(&reflector_lock);
+    reflector_config = *config;
+    portEXIT_CRITICAL(&reflector_lock);
+
+    if (!reflector_wanted()) {
+        napt_reflector_stop();
+    } else if (napt_fwd_active()) {
+        napt_reflector_start();
+    }
+    napt_ctl_unlock();
+    return ESP_OK;
+}
+
+esp_err_t hotspot_reflector_get_config(hotspot_reflector_config_t *config)
+{
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&reflector_lock);
+    *config = reflector_config;
+    portEXIT_CRITICAL(&reflector_lock);
+    return ESP_OK;
+}
+
+esp_err_t hotspot_reflector_get_stats(hotspot_reflector_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&reflector_lock);
+    *stats = reflector_stats;
+    portEXIT_CRITICAL(&reflector_lock);
+    return ESP_OK;
+}
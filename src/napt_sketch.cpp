@@ -0,0 +1,247 @@
+/***************************************************************************************
+ *  File        : napt_sketch.cpp
+ *  Description : Fixed-memory space-saving sketch for top-K tracking
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Space-saving (Metwally et al.): k counters, a new key evicts the smallest
+ *     and inherits its count as the error bound. Any key whose true weight is
+ *     above total/k is guaranteed to be tracked.
+ *   - Counters live in a min-heap; a small open-addressed index maps keys to
+ *     heap positions. Updates are O(log k), independent of traffic volume.
+ *   - Not thread-safe. Callers serialize access.
+ ***************************************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include "napt_internal.h"
+
+#define INDEX_EMPTY -1
+
+// ============================================================================
+// INDEX (key -> heap position), linear probing with backward-shift delete
+// ============================================================================
+static inline uint32_t key_hash(uint64_t key)
+{
+    uint64_t h = key;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return (uint32_t)h;
+}
+
+static int index_find(const napt_sketch_t *s, uint64_t key)
+{
+    uint32_t i = key_hash(key) & s->index_mask;
+    while (s->index[i] != INDEX_EMPTY) {
+        if (s->items[s->index[i]].key == key) {
+            return (int)i;
+        }
+        i = (i + 1) & s->index_mask;
+    }
+    return -1;
+}
+
+static void index_insert(napt_sketch_t *s, uint64_t key, int16_t pos)
+{
+    uint32_t i = key_hash(key) & s->index_mask;
+    while (s->index[i] != INDEX_EMPTY) {
+        i = (i + 1) & s->index_mask;
+    }
+    s->index[i] = pos;
+}
+
+static void index_remove(napt_sketch_t *s, int slot)
+{
+    // Backward-shift deletion keeps probe chains intact without tombstones
+    uint32_t i = (uint32_t)slot;
+    uint32_t j = i;
+    for (;;) {
+        j = (j + 1) & s->index_mask;
+        if (s->index[j] == INDEX_EMPTY) {
+            break;
+        }
+        uint32_t home = key_hash(s->items[s->index[j]].key) & s->index_mask;
+        // Move j back to i if its home is not cyclically within (i, j]
+        bool in_range = (i <= j) ? (home > i && home <= j) : (home > i || home <= j);
+        if (!in_range) {
+            s->index[i] = s->index[j];
+            i = j;
+        }
+    }
+    s->index[i] = INDEX_EMPTY;
+}
+
+// ============================================================================
+// MIN-HEAP ON COUNT
+// ============================================================================
+static void heap_swap(napt_sketch_t *s, int a, int b)
+{
+    // Locate both index entries while they still point at a and b
+    int ia = index_find(s, s->items[a].key);
+    int ib = index_find(s, s->items[b].key);
+    napt_sketch_item_t t = s->items[a];
+    s->items[a] = s->items[b];
+    s->items[b] = t;
+    s->index[ia] = (int16_t)b;
+    s->index[ib] = (int16_t)a;
+}
+
+static void sift_down(napt_sketch_t *s, int pos)
+{
+    for (;;) {
+        int l = 2 * pos + 1;
+        int r = l + 1;
+        int m = pos;
+        if (l < s->size && s->items[l].count < s->items[m].count) {
+            m = l;
+        }
+        if (r < s->size && s->items[r].count < s->items[m].count) {
+            m = r;
+        }
+        if (m == pos) {
+            return;
+        }
+        heap_swap(s, pos, m);
+        pos = m;
+    }
+}
+
+static void sift_up(napt_sketch_t *s, int pos)
+{
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (s->items[parent].count <= s->items[pos].count) {
+            return;
+        }
+        heap_swap(s, pos, parent);
+        pos = parent;
+    }
+}
+
+// ============================================================================
+// PUBLIC (INTERNAL) API
+// ============================================================================
+bool napt_sketch_init(napt_sketch_t *s, uint16_t k)
+{
+    memset(s, 0, sizeof(*s));
+    if (k == 0 || k > NAPT_SKETCH_MAX_K) {
+        return false;
+    }
+    uint16_t index_size = 1;
+    while (index_size < 2 * k) {
+        index_size <<= 1;
+    }
+    s->items = (napt_sketch_item_t *)calloc(k, sizeof(napt_sketch_item_t));
+    s->index = (int16_t *)malloc(index_size * sizeof(int16_t));
+    if (s->items == NULL || s->index == NULL) {
+        free(s->items);
+        free(s->index);
+        s->items = NULL;
+        s->index = NULL;
+        return false;
+    }
+    s->k = k;
+    s->index_mask = index_size - 1;
+    napt_sketch_reset(s);
+    return true;
+}
+
+void napt_sketch_reset(napt_sketch_t *s)
+{
+    if (s->items == NULL) {
+        return;
+    }
+    s->size = 0;
+    s->total = 0;
+    for (uint32_t i = 0; i <= s->index_mask; i++) {
+        s->index[i] = INDEX_EMPTY;
+    }
+}
+
+// ============================================================================
+// napt_sketch_add()
+// ============================================================================
+// 1. Tracked key: add weight, restore heap order
+// 2. Table not full: insert with count = weight
+// 3. Table full: the minimum is evicted; the new key takes its slot with
+//    count = min + weight and error = min (it may have been seen before)
+//
+// Returns the stable payload slot for the key, or -1 if not initialized.
+// *is_new tells the caller to (re)initialize the payload in that slot.
+// ============================================================================
+int napt_sketch_add(napt_sketch_t *s, uint64_t key, uint32_t weight, bool *is_new)
+{
+    if (s->items == NULL) {
+        return -1;
+    }
+    s->total += weight;
+
+    int idx = index_find(s, key);
+    if (idx >= 0) {
+        int pos = s->index[idx];
+        s->items[pos].count += weight;
+        uint16_t slot = s->items[pos].slot;
+        sift_down(s, pos);
+        *is_new = false;
+        return slot;
+    }
+
+    *is_new = true;
+    if (s->size < s->k) {
+        int pos = s->size++;
+        s->items[pos].key = key;
+        s->items[pos].count = weight;
+        s->items[pos].error = 0;
+        s->items[pos].slot = (uint16_t)pos;
+        index_insert(s, key, (int16_t)pos);
+        sift_up(s, pos);
+        return pos;
+    }
+
+    // Replace the minimum (heap root)
+    napt_sketch_item_t *min = &s->items[0];
+    int old = index_find(s, min->key);
+    if (old >= 0) {
+        index_remove(s, old);
+    }
+    uint32_t min_count = min->count;
+    min->key = key;
+    min->error = min_count;
+    min->count = min_count + weight;
+    uint16_t slot = min->slot;
+    index_insert(s, key, 0);
+    sift_down(s, 0);
+    return slot;
+}
+
+// Copies the tracked items, largest count first. Returns how many were copied.
+int napt_sketch_top(const napt_sketch_t *s, napt_sketch_item_t *out, int max)
+{
+    if (s->items == NULL || max <= 0) {
+        return 0;
+    }
+    int n = s->size < max ? s->size : max;
+
+    // Selection sort over k items - k is small and this is not on the packet path
+    uint8_t taken[NAPT_SKETCH_MAX_K] = {};
+    for (int i = 0; i < n; i++) {
+        int best = -1;
+        for (int j = 0; j < s->size; j++) {
+            if (!taken[j] && (best < 0 || s->items[j].count > s->items[best].count)) {
+                best = j;
+            }
+        }
+        if (best < 0) {
+            return i;
+        }
+        taken[best] = 1;
+        out[i] = s->items[best];
+    }
+    return n;
+}
@@ -0,0 +1,617 @@
+/***************************************************************************************
+ *  File        : napt_stations.cpp
+ *  Description : Per-station radio and traffic table for the AP's clients
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Entries are added and removed by the association events; the forwarding
+ *     path finds a station by the Ethernet address of the frame through a
+ *     small open-addressing index, so each packet costs one hash and
+ *     (almost always) one compare.
+ *   - RSSI and PHY modes come from esp_wifi_ap_get_sta_list() when a
+ *     snapshot is taken, not per packet.
+ *   - NAT flows are a linear-counting estimate over two tumbling epochs, the
+ *     same scheme as the hotspot-wide count in napt_hitters.cpp.
+ *   - Join timelines: milestones are stamped where they are seen (DHCP server,
+ *     AP hooks) with one bit test each. A join is closed and added to the
+ *     histograms by a 1 s timer that only runs while a join is open, so the
+ *     forwarding path never logs.
+ ***************************************************************************************/
+
+#include <string.h>
+#include <math.h>
+#include "napt_stations.h"
+#include "napt_internal.h"
+#include "esp_log.h"
+#include "esp_wifi.h"
+#include "esp_timer.h"
+#include "esp_mac.h"
+#include "freertos/FreeRTOS.h"
+
+#ifndef HOTSPOT_STATIONS_FLOW_WINDOW_MS
+#define HOTSPOT_STATIONS_FLOW_WINDOW_MS 60000
+#endif
+
+// Bits per station and epoch (power of two). Good to a few percent up to
+// roughly this many flows, which is far more than one client keeps open.
+#ifndef HOTSPOT_STATIONS_FLOW_BITMAP
+#define HOTSPOT_STATIONS_FLOW_BITMAP 256
+#endif
+
+// A join still without a reply through NAT this long after association is
+// closed as incomplete
+#ifndef HOTSPOT_JOIN_TIMEOUT_MS
+#define HOTSPOT_JOIN_TIMEOUT_MS 30000
+#endif
+
+// Completed joins slower than this are logged with their timeline
+#ifndef HOTSPOT_JOIN_SLOW_MS
+#define HOTSPOT_JOIN_SLOW_MS 3000
+#endif
+
+#define STATIONS_MAX ESP_WIFI_MAX_CONN_NUM
+#define INDEX_SIZE 32               // Power of two, at least twice STATIONS_MAX
+
+static const char *TAG = "napt_stations";
+
+// ============================================================================
+// TABLE
+// ============================================================================
+typedef struct {
+    bool used;
+    uint8_t mac[6];
+    uint8_t aid;
+    uint32_t ip;                    // Network order
+    int64_t assoc_us;
+    uint32_t last_rx_ms;
+    bool rx_seen;
+    uint64_t bytes_up;
+    uint64_t bytes_down;
+    uint32_t packets_up;
+    uint32_t packets_down;
+    uint32_t dns_queries;
+    uint32_t flow_bits[2][HOTSPOT_STATIONS_FLOW_BITMAP / 32];  // [epoch]
+    bool join_open;                 // Timeline still collecting milestones
+    uint8_t join_reached;           // Bit per hotspot_join_event_t
+    uint32_t assoc_ms;
+    uint32_t join_at[HOTSPOT_JOIN_EVENT_MAX];   // napt_now_ms() of each milestone
+} station_t;
+
+static portMUX_TYPE stations_lock = portMUX_INITIALIZER_UNLOCKED;
+static station_t stations[STATIONS_MAX];
+static int8_t mac_index[INDEX_SIZE];        // Slot in stations[], -1 = empty
+static bool index_ready = false;
+static uint32_t subnet = 0;                 // AP network and mask, network order
+static uint32_t netmask = 0;
+static uint32_t epoch_start_ms = 0;
+static int cur_epoch = 0;
+static volatile bool stations_running = false;
+
+// Join histograms, also under stations_lock
+static hotspot_join_stats_t join_stats;
+static uint64_t join_sum_ms[HOTSPOT_JOIN_PHASE_MAX];
+static esp_timer_handle_t join_timer = NULL;
+
+static const char *const join_event_names[HOTSPOT_JOIN_EVENT_MAX] = {
+    "discover", "offer", "request", "ack", "dns", "forward", "nat",
+};
+static const char *const join_phase_names[HOTSPOT_JOIN_PHASE_MAX] = {
+    "dhcp start", "offer", "request", "ack", "dns", "forward", "nat", "total",
+};
+
+static inline uint32_t mac_hash(const uint8_t *mac)
+{
+    // The OUI is shared by many clients, the last three bytes are not
+    uint32_t v = ((uint32_t)mac[3] << 16) | ((uint32_t)mac[4] << 8) | mac[5];
+    return (v * 0x9e3779b1u) >> 27;
+}
+
+// Caller holds stations_lock. Rebuilt on every join and leave; at most
+// STATIONS_MAX inserts, and it keeps lookups free of tombstones.
+static void index_rebuild(void)
+{
+    memset(mac_index, -1, sizeof(mac_index));
+    for (int i = 0; i < STATIONS_MAX; i++) {
+        if (!stations[i].used) {
+            continue;
+        }
+        uint32_t h = mac_hash(stations[i].mac);
+        while (mac_index[h] >= 0) {
+            h = (h + 1) & (INDEX_SIZE - 1);
+        }
+        mac_index[h] = (int8_t)i;
+    }
+    index_ready = true;
+}
+
+// Caller holds stations_lock. The index is never more than half full, so
+// the probe ends at an empty bucket.
+static station_t *station_find(const uint8_t *mac)
+{
+    if (!index_ready) {
+        return NULL;
+    }
+    uint32_t h = mac_hash(mac);
+    for (;;) {
+        int8_t slot = mac_index[h];
+        if (slot < 0) {
+            return NULL;
+        }
+        if (memcmp(stations[slot].mac, mac, 6) == 0) {
+            return &stations[slot];
+        }
+        h = (h + 1) & (INDEX_SIZE - 1);
+    }
+}
+
+// Caller holds stations_lock
+static void epoch_advance(uint32_t now_ms)
+{
+    uint32_t age = now_ms - epoch_start_ms;
+    if (age < HOTSPOT_STATIONS_FLOW_WINDOW_MS) {
+        return;
+    }
+    // Idle for more than a window: the previous epoch is stale as well
+    bool both = age >= 2 * HOTSPOT_STATIONS_FLOW_WINDOW_MS;
+    cur_epoch ^= 1;
+    for (int i = 0; i < STATIONS_MAX; i++) {
+        memset(stations[i].flow_bits[cur_epoch], 0, sizeof(stations[i].flow_bits[0]));
+        if (both) {
+            memset(stations[i].flow_bits[cur_epoch ^ 1], 0, sizeof(stations[i].flow_bits[0]));
+        }
+    }
+    epoch_start_ms = now_ms;
+}
+
+// ============================================================================
+// JOIN TIMELINE
+// ============================================================================
+// Caller holds stations_lock. Only the first occurrence of each milestone
+// counts.
+static inline void join_mark(station_t *st, hotspot_join_event_t ev, uint32_t now_ms)
+{
+    if (st->join_open && !(st->join_reached & (1u << ev))) {
+        st->join_reached |= 1u << ev;
+        st->join_at[ev] = now_ms;
+    }
+}
+
+// Milestones in ms after association
+static void join_offsets(const station_t *st, uint32_t at[HOTSPOT_JOIN_EVENT_MAX])
+{
+    for (int e = 0; e < HOTSPOT_JOIN_EVENT_MAX; e++) {
+        at[e] = (st->join_reached & (1u << e)) ? st->join_at[e] - st->assoc_ms : HOTSPOT_JOIN_NOT_REACHED;
+    }
+}
+
+// Phase durations from the milestones, HOTSPOT_JOIN_NOT_REACHED for phases
+// that did not happen. A skipped start falls back to the milestone before.
+static void join_phases(const uint32_t at[HOTSPOT_JOIN_EVENT_MAX], uint32_t ms[HOTSPOT_JOIN_PHASE_MAX])
+{
+    const uint32_t none = HOTSPOT_JOIN_NOT_REACHED;
+    uint32_t disc = at[HOTSPOT_JOIN_DHCP_DISCOVER];
+    uint32_t offer = at[HOTSPOT_JOIN_DHCP_OFFER];
+    uint32_t req = at[HOTSPOT_JOIN_DHCP_REQUEST];
+    uint32_t ack = at[HOTSPOT_JOIN_DHCP_ACK];
+    uint32_t fwd = at[HOTSPOT_JOIN_FIRST_FORWARD];
+    uint32_t nat = at[HOTSPOT_JOIN_FIRST_NAT];
+    uint32_t dns = at[HOTSPOT_JOIN_FIRST_DNS];
+    uint32_t dhcp_start = disc < req ? disc : req;
+    uint32_t ack_from = req != none ? req : disc;
+
+    ms[HOTSPOT_JOIN_PHASE_DHCP_START] = dhcp_start;
+    ms[HOTSPOT_JOIN_PHASE_OFFER] = disc != none && offer != none ? offer - disc : none;
+    ms[HOTSPOT_JOIN_PHASE_REQUEST] = offer != none && req != none && req >= offer ? req - offer : none;
+    ms[HOTSPOT_JOIN_PHASE_ACK] = ack != none && ack_from != none && ack >= ack_from ? ack - ack_from : none;
+    // Static addresses, or traffic before the ACK: measured from association
+    ms[HOTSPOT_JOIN_PHASE_DNS] = dns == none ? none : ack != none && ack <= dns ? dns - ack : dns;
+    ms[HOTSPOT_JOIN_PHASE_FORWARD] = fwd == none ? none : ack != none && ack <= fwd ? fwd - ack : fwd;
+    ms[HOTSPOT_JOIN_PHASE_NAT] = nat != none && fwd != none && nat >= fwd ? nat - fwd : none;
+    ms[HOTSPOT_JOIN_PHASE_TOTAL] = nat;
+}
+
+// Caller holds stations_lock
+static void join_hist_add(hotspot_join_phase_t phase, uint32_t ms)
+{
+    hotspot_join_hist_t *h = &join_stats.phases[phase];
+    int bucket = ms < 4 ? 0 : 30 - __builtin_clz(ms);
+    if (bucket >= HOTSPOT_JOIN_HIST_BUCKETS) {
+        bucket = HOTSPOT_JOIN_HIST_BUCKETS - 1;
+    }
+    h->buckets[bucket]++;
+    h->count++;
+    if (ms > h->max_ms) {
+        h->max_ms = ms;
+    }
+    join_sum_ms[phase] += ms;
+}
+
+typedef struct {
+    uint8_t mac[6];
+    uint8_t aid;
+    bool complete;
+    uint32_t at[HOTSPOT_JOIN_EVENT_MAX];
+} join_record_t;
+
+// Caller holds stations_lock. Closes the timeline and counts it; returns
+// true if it should be logged (outside the lock).
+static bool join_close(station_t *st, join_record_t *rec)
+{
+    st->join_open = false;
+    memcpy(rec->mac, st->mac, 6);
+    rec->aid = st->aid;
+    join_offsets(st, rec->at);
+    rec->complete = rec->at[HOTSPOT_JOIN_FIRST_NAT] != HOTSPOT_JOIN_NOT_REACHED;
+
+    uint32_t ms[HOTSPOT_JOIN_PHASE_MAX];
+    join_phases(rec->at, ms);
+    for (int p = 0; p < HOTSPOT_JOIN_PHASE_MAX; p++) {
+        if (ms[p] != HOTSPOT_JOIN_NOT_REACHED) {
+            join_hist_add((hotspot_join_phase_t)p, ms[p]);
+        }
+    }
+    if (!rec->complete) {
+        join_stats.incomplete++;
+        return true;
+    }
+    join_stats.completed++;
+    if (ms[HOTSPOT_JOIN_PHASE_TOTAL] > HOTSPOT_JOIN_SLOW_MS) {
+        join_stats.slow++;
+        return true;
+    }
+    return false;
+}
+
+static void join_log(const join_record_t *rec, const char *what)
+{
+    char line[160];
+    int len = 0;
+    for (int e = 0; e < HOTSPOT_JOIN_EVENT_MAX && len < (int)sizeof(line); e++) {
+        if (rec->at[e] != HOTSPOT_JOIN_NOT_REACHED) {
+            len += snprintf(line + len, sizeof(line) - len, "%s%s %lu", len ? ", " : "",
+                            join_event_names[e], (unsigned long)rec->at[e]);
+        }
+    }
+    if (len == 0) {
+        snprintf(line, sizeof(line), "no DHCP or traffic");
+    }
+
+    // The phase that took longest, not counting the total
+    uint32_t ms[HOTSPOT_JOIN_PHASE_MAX];
+    join_phases(rec->at, ms);
+    int slowest = -1;
+    for (int p = 0; p < HOTSPOT_JOIN_PHASE_TOTAL; p++) {
+        if (ms[p] != HOTSPOT_JOIN_NOT_REACHED && (slowest < 0 || ms[p] > ms[slowest])) {
+            slowest = p;
+        }
+    }
+    if (slowest < 0) {
+        ESP_LOGW(TAG, "Join of " MACSTR " (AID %d) %s: %s", MAC2STR(rec->mac), rec->aid, what, line);
+    } else {
+        ESP_LOGW(TAG, "Join of " MACSTR " (AID %d) %s: %s ms after association; slowest phase %s (%lu ms)", MAC2STR(rec->mac),
+                 rec->aid, what, line, join_phase_names[slowest], (unsigned long)ms[slowest]);
+    }
+}
+
+// esp_timer task, every second while any join is open
+static void join_timer_cb(void *arg)
+{
+    bool open = false;
+    for (int i = 0; i < STATIONS_MAX; i++) {
+        join_record_t rec;
+        bool log = false;
+        uint32_t now_ms = napt_now_ms();
+        portENTER_CRITICAL(&stations_lock);
+        station_t *st = &stations[i];
+        if (st->used && st->join_open) {
+            if ((st->join_reached & (1u << HOTSPOT_JOIN_FIRST_NAT)) ||
+                now_ms - st->assoc_ms >= HOTSPOT_JOIN_TIMEOUT_MS) {
+                log = join_close(st, &rec);
+            } else {
+                open = true;
+            }
+        }
+        portEXIT_CRITICAL(&stations_lock);
+        if (log) {
+            join_log(&rec, rec.complete ? "slow" : "got no reply through NAT");
+        }
+    }
+    if (open) {
+        return;
+    }
+
+    // A join may have opened since its slot was checked; its start call saw
+    // the timer still running
+    esp_timer_stop(join_timer);
+    portENTER_CRITICAL(&stations_lock);
+    for (int i = 0; i < STATIONS_MAX; i++) {
+        open |= stations[i].used && stations[i].join_open;
+    }
+    portEXIT_CRITICAL(&stations_lock);
+    if (open) {
+        esp_timer_start_periodic(join_timer, 1000000);
+    }
+}
+
+void napt_stations_dhcp(const uint8_t *mac, hotspot_join_event_t ev)
+{
+    uint32_t now_ms = napt_now_ms();
+    portENTER_CRITICAL(&stations_lock);
+    station_t *st = station_find(mac);
+    if (st != NULL) {
+        join_mark(st, ev, now_ms);
+    }
+    portEXIT_CRITICAL(&stations_lock);
+}
+
+// ============================================================================
+// FORWARDING PATH SIDE
+// ============================================================================
+// AP_IN (station -> ESP, WiFi task): source MAC is the station.
+// AP_OUT (ESP -> station, tcpip thread): destination MAC is the station.
+// ============================================================================
+void napt_stations_on_packet(napt_hook_t hook, const napt_pkt_t *pkt)
+{
+    if (!stations_running || pkt->eth == NULL) {
+        return;
+    }
+    bool up = hook == NAPT_HOOK_AP_IN;
+    if (!up && (hook != NAPT_HOOK_AP_OUT || pkt->broadcast || pkt->multicast)) {
+        return;
+    }
+
+    uint32_t now_ms = napt_now_ms();
+    portENTER_CRITICAL_SAFE(&stations_lock);
+    station_t *st = station_find(up ? pkt->eth + 6 : pkt->eth);
+    if (st == NULL) {
+        portEXIT_CRITICAL_SAFE(&stations_lock);
+        return;
+    }
+    if (!up) {
+        st->bytes_down += pkt->frame_len;
+        st->packets_down++;
+        if (pkt->ip != NULL && (pkt->src & netmask) != subnet) {
+            join_mark(st, HOTSPOT_JOIN_FIRST_NAT, now_ms);
+        }
+        portEXIT_CRITICAL_SAFE(&stations_lock);
+        return;
+    }
+
+    st->bytes_up += pkt->frame_len;
+    st->packets_up++;
+    st->last_rx_ms = now_ms;
+    st->rx_seen = true;
+    if (pkt->ip != NULL) {
+        // DHCP (0.0.0.0) and link-local sources are not the station's address
+        if (pkt->src != 0 && (pkt->src & netmask) == subnet) {
+            st->ip = pkt->src;
+        }
+        if (pkt->proto == IP_PROTO_UDP && pkt->dport == 53) {
+            st->dns_queries++;
+            join_mark(st, HOTSPOT_JOIN_FIRST_DNS, now_ms);
+        }
+        bool outside = (pkt->dst & netmask) != subnet && !pkt->multicast && !pkt->broadcast;
+        if (outside) {
+            join_mark(st, HOTSPOT_JOIN_FIRST_FORWARD, now_ms);
+        }
+        if (outside && pkt->l4 != NULL) {
+            epoch_advance(now_ms);
+            uint32_t bit = napt_flow_hash(pkt->src, pkt->sport, pkt->dst, pkt->dport, pkt->proto) &
+                           (HOTSPOT_STATIONS_FLOW_BITMAP - 1);
+            st->flow_bits[cur_epoch][bit >> 5] |= 1u << (bit & 31);
+        }
+    }
+    portEXIT_CRITICAL_SAFE(&stations_lock);
+}
+
+// ============================================================================
+// ASSOCIATION EVENTS
+// ============================================================================
+void napt_stations_join(const uint8_t *mac, uint8_t aid)
+{
+    // A returning client usually keeps its lease; traffic corrects it otherwise
+    uint32_t ip = 0;
+    napt_dhcps_lease_ip(mac, &ip);
+
+    if (join_timer == NULL) {
+        esp_timer_create_args_t args = {};
+        args.callback = join_timer_cb;
+        args.name = "napt_join";
+        esp_timer_create(&args, &join_timer);   // Without it joins are only closed on leave
+    }
+
+    join_record_t rec;
+    bool log = false;
+    portENTER_CRITICAL(&stations_lock);
+    station_t *st = station_find(mac);
+    if (st != NULL && st->join_open) {
+        // Reassociated before the previous join finished
+        log = join_close(st, &rec);
+    }
+    for (int i = 0; st == NULL && i < STATIONS_MAX; i++) {
+        if (!stations[i].used) {
+            st = &stations[i];
+        }
+    }
+    if (st != NULL) {
+        memset(st, 0, sizeof(*st));
+        st->used = true;
+        memcpy(st->mac, mac, 6);
+        st->aid = aid;
+        st->ip = ip;
+        st->assoc_us = esp_timer_get_time();
+        st->assoc_ms = napt_now_ms();
+        st->join_open = true;
+        index_rebuild();
+    }
+    portEXIT_CRITICAL(&stations_lock);
+
+    if (log) {
+        join_log(&rec, "reassociated first");
+    }
+    if (st == NULL) {
+        ESP_LOGW(TAG, "Station table full, AID %d not tracked", aid);
+    } else if (join_timer != NULL && !esp_timer_is_active(join_timer)) {
+        esp_timer_start_periodic(join_timer, 1000000);
+    }
+}
+
+void napt_stations_leave(const uint8_t *mac)
+{
+    join_record_t rec;
+    bool log = false;
+    portENTER_CRITICAL(&stations_lock);
+    station_t *st = station_find(mac);
+    if (st != NULL) {
+        if (st->join_open) {
+            log = join_close(st, &rec);
+        }
+        st->used = false;
+        index_rebuild();
+    }
+    portEXIT_CRITICAL(&stations_lock);
+
+    if (log) {
+        join_log(&rec, "left before it finished");
+    }
+}
+
+// ============================================================================
+// START / STOP
+// ============================================================================
+// The table follows association, not forwarding: stations that joined before
+// start are kept. stop empties it, as the AP is going down with it.
+// ============================================================================
+void napt_stations_start(esp_netif_t *ap)
+{
+    esp_netif_ip_info_t info;
+    if (esp_netif_get_ip_info(ap, &info) != ESP_OK) {
+        ESP_LOGW(TAG, "No AP address, station table disabled");
+        return;
+    }
+    portENTER_CRITICAL(&stations_lock);
+    netmask = info.netmask.addr;
+    subnet = info.ip.addr & netmask;
+    cur_epoch = 0;
+    epoch_start_ms = napt_now_ms();
+    for (int i = 0; i < STATIONS_MAX; i++) {
+        memset(stations[i].flow_bits, 0, sizeof(stations[i].flow_bits));
+    }
+    portEXIT_CRITICAL(&stations_lock);
+    stations_running = true;
+}
+
+void napt_stations_stop(void)
+{
+    // Open joins are dropped, not counted: the AP is what went away
+    stations_running = false;
+    if (join_timer != NULL) {
+        esp_timer_stop(join_timer);
+    }
+    portENTER_CRITICAL(&stations_lock);
+    memset(stations, 0, sizeof(stations));
+    index_rebuild();
+    portEXIT_CRITICAL(&stations_lock);
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+// Linear counting over the union of both epochs: n = -m * ln(empty / m)
+static uint16_t flows_estimate(const station_t *st)
+{
+    int set = 0;
+    for (int i = 0; i < HOTSPOT_STATIONS_FLOW_BITMAP / 32; i++) {
+        set += __builtin_popcount(st->flow_bits[0][i] | st->flow_bits[1][i]);
+    }
+    int empty = HOTSPOT_STATIONS_FLOW_BITMAP - set;
+    if (empty == 0) {
+        empty = 1;      // Saturated: report the largest value the bitmap can tell apart
+    }
+    return (uint16_t)(-(float)HOTSPOT_STATIONS_FLOW_BITMAP * logf((float)empty / HOTSPOT_STATIONS_FLOW_BITMAP) + 0.5f);
+}
+
+esp_err_t hotspot_get_stations(hotspot_station_info_t *out, size_t max, size_t *count)
+{
+    if (out == NULL || count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *count = 0;
+
+    // Driver first, outside the lock; fails harmlessly when the AP is down
+    wifi_sta_list_t list;
+    if (esp_wifi_ap_get_sta_list(&list) != ESP_OK) {
+        list.num = 0;
+    }
+
+    // Stations are copied one at a time so interrupts are off only briefly
+    uint32_t now_ms = napt_now_ms();
+    int64_t now_us = esp_timer_get_time();
+    for (int i = 0; i < STATIONS_MAX && *count < max; i++) {
+        station_t st;
+        portENTER_CRITICAL(&stations_lock);
+        if (stations_running) {
+            epoch_advance(now_ms);
+        }
+        st = stations[i];
+        portEXIT_CRITICAL(&stations_lock);
+        if (!st.used) {
+            continue;
+        }
+
+        hotspot_station_info_t *info = &out[*count];
+        memset(info, 0, sizeof(*info));
+        memcpy(info->mac, st.mac, 6);
+        info->aid = st.aid;
+        info->ip.addr = st.ip;
+        info->connected_s = (uint32_t)((now_us - st.assoc_us) / 1000000);
+        info->idle_ms = st.rx_seen ? now_ms - st.last_rx_ms : UINT32_MAX;
+        info->bytes_up = st.bytes_up;
+        info->bytes_down = st.bytes_down;
+        info->packets_up = st.packets_up;
+        info->packets_down = st.packets_down;
+        info->nat_flows = flows_estimate(&st);
+        info->dns_queries = st.dns_queries;
+        join_offsets(&st, info->join_ms);
+        for (int j = 0; j < list.num; j++) {
+            const wifi_sta_info_t *sta = &list.sta[j];
+            if (memcmp(sta->mac, st.mac, 6) == 0) {
+                info->rssi = sta->rssi;
+                info->phy = (sta->phy_11b ? HOTSPOT_STATION_PHY_11B : 0) |
+                            (sta->phy_11g ? HOTSPOT_STATION_PHY_11G : 0) |
+                            (sta->phy_11n ? HOTSPOT_STATION_PHY_11N : 0) |
+                            (sta->phy_lr ? HOTSPOT_STATION_PHY_LR : 0) |
+                            (sta->phy_11ax ? HOTSPOT_STATION_PHY_11AX : 0);
+                break;
+            }
+        }
+        (*count)++;
+    }
+    return ESP_OK;
+}
+
+esp_err_t hotspot_get_join_stats(hotspot_join_stats_t *stats)
+{
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    portENTER_CRITICAL(&stations_lock);
+    *stats = join_stats;
+    for (int p = 0; p < HOTSPOT_JOIN_PHASE_MAX; p++) {
+        uint32_t n = stats->phases[p].count;
+        stats->phases[p].avg_ms = n ? (uint32_t)(join_sum_ms[p] / n) : 0;
+    }
+    portEXIT_CRITICAL(&stations_lock);
+    return ESP_OK;
+}
+
+void hotspot_join_stats_reset(void)
+{
+    portENTER_CRITICAL(&stations_lock);
+    memset(&join_stats, 0, sizeof(join_stats));
+    memset(join_sum_ms, 0, sizeof(join_sum_ms));
+    portEXIT_CRITICAL(&stations_lock);
+}
@@ -0,0 +1,130 @@
+/***************************************************************************************
+ *  File        : napt_wifi_profile.cpp
+ *  Description : Radio settings applied as a set while the hotspot runs
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Only runtime driver settings are touched. AMPDU and buffer counts are
+ *     fixed at esp_wifi_init() from sdkconfig (see README).
+ *   - Whatever the application had set before enable is restored on disable.
+ ***************************************************************************************/
+
+#include "napt_internal.h"
+#include "esp_log.h"
+#include "esp_wifi.h"
+
+static const char *TAG = "napt_profile";
+
+// ============================================================================
+// PROFILE TABLE
+// ============================================================================
+// ps          STA power save. Modem sleep holds frames for the router's DTIM,
+//             which adds latency to everything forwarded through the STA.
+// sta_ht40    STA bandwidth; takes effect at the next association.
+// ap_ht20     Force the AP to HT20 even if the STA uses HT40.
+// ap_protocol Without 11b the AP avoids long preambles and b-rate protection.
+// dtim        AP DTIM period: higher lets clients sleep longer, but delays
+//             broadcast/multicast (ARP, mDNS) by the same number of beacons.
+// ============================================================================
+typedef struct {
+    const char *name;
+    wifi_ps_type_t ps;
+    bool sta_ht40;
+    bool ap_ht20;
+    uint8_t ap_protocol;
+    uint8_t dtim;
+} profile_t;
+
+static const profile_t profiles[] = {
+    [HOTSPOT_WIFI_PROFILE_DEFAULT] = { "default", WIFI_PS_MIN_MODEM, false, false, 0, 1 },
+    [HOTSPOT_WIFI_PROFILE_MAX_THROUGHPUT] = {
+        "max-throughput", WIFI_PS_NONE, true, false, WIFI_PROTOCOL_11G | WIFI_PROTOCOL_11N, 1 },
+    [HOTSPOT_WIFI_PROFILE_LOW_LATENCY] = {
+        "low-latency", WIFI_PS_NONE, false, true, WIFI_PROTOCOL_11G | WIFI_PROTOCOL_11N, 1 },
+    [HOTSPOT_WIFI_PROFILE_LOW_POWER] = {
+        "low-power", WIFI_PS_MAX_MODEM, false, true,
+        WIFI_PROTOCOL_11B | WIFI_PROTOCOL_11G | WIFI_PROTOCOL_11N, 3 },
+};
+
+// ============================================================================
+// SAVED STATE
+// ============================================================================
+static bool saved = false;
+static wifi_ps_type_t saved_ps;
+static wifi_bandwidth_t saved_sta_bw;
+static uint8_t saved_ap_protocol;
+
+static const profile_t *profile_get(hotspot_wifi_profile_t profile)
+{
+    if ((unsigned)profile >= sizeof(profiles) / sizeof(profiles[0])) {
+        profile = HOTSPOT_WIFI_PROFILE_DEFAULT;
+    }
+    return &profiles[profile];
+}
+
+// ============================================================================
+// APPLY / RESTORE
+// ============================================================================
+// Called in APSTA mode before the AP config is set, so the AP starts with
+// the right protocol set. A failing setting is logged and skipped; the
+// hotspot works with any of them.
+// ============================================================================
+void napt_profile_apply(hotspot_wifi_profile_t profile)
+{
+    if (profile == HOTSPOT_WIFI_PROFILE_DEFAULT) {
+        return;
+    }
+    const profile_t *p = profile_get(profile);
+
+    if (!saved) {
+        saved = esp_wifi_get_ps(&saved_ps) == ESP_OK &&
+                esp_wifi_get_bandwidth(WIFI_IF_STA, &saved_sta_bw) == ESP_OK &&
+                esp_wifi_get_protocol(WIFI_IF_AP, &saved_ap_protocol) == ESP_OK;
+    }
+
+    esp_err_t err = esp_wifi_set_ps(p->ps);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Power save: %s", esp_err_to_name(err));
+    }
+    err = esp_wifi_set_bandwidth(WIFI_IF_STA, p->sta_ht40 ? WIFI_BW_HT40 : WIFI_BW_HT20);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "STA bandwidth: %s", esp_err_to_name(err));
+    }
+    if (p->ap_protocol != 0) {
+        err = esp_wifi_set_protocol(WIFI_IF_AP, p->ap_protocol);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "AP protocol: %s", esp_err_to_name(err));
+        }
+    }
+    ESP_LOGI(TAG, "Profile %s applied", p->name);
+}
+
+void napt_profile_restore(void)
+{
+    if (!saved) {
+        return;
+    }
+    esp_wifi_set_ps(saved_ps);
+    esp_wifi_set_bandwidth(WIFI_IF_STA, saved_sta_bw);
+    esp_wifi_set_protocol(WIFI_IF_AP, saved_ap_protocol);
+    saved = false;
+    ESP_LOGI(TAG, "Radio settings restored");
+}
+
+bool napt_profile_ap_ht20(hotspot_wifi_profile_t profile)
+{
+    return profile_get(profile)->ap_ht20;
+}
+
+uint8_t napt_profile_dtim(hotspot_wifi_profile_t profile)
+{
+    return profile_get(profile)->dtim;
+}
+
+const char *napt_profile_name(hotspot_wifi_profile_t profile)
+{
+    return profile_get(profile)->name;
+}
@@ -0,0 +1,57 @@
+/***************************************************************************************
+ *  File        : host_test.h
+ *  Description : Minimal check macros for the host tests
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - A failed CHECK prints its location and the test carries on; main()
+ *     returns TEST_RESULT() so ctest sees the failure.
+ *   - TEST_RESULT() exits straight away: the port's tasks are detached
+ *     threads still blocked on their queues, and running static
+ *     destructors under them can hang.
+ ***************************************************************************************/
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond) do {                                                        \
+    if (!(cond)) {                                                              \
+        fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+        test_failures++;                                                        \
+    }                                                                           \
+} while (0)
+
+#define CHECK_MSG(cond, fmt, ...) do {                                          \
+    if (!(cond)) {                                                              \
+        fprintf(stderr, "%s:%d: CHECK failed: %s: " fmt "\n", __FILE__, __LINE__, \
+                #cond, ##__VA_ARGS__);                                          \
+        test_failures++;                                                        \
+    }                                                                           \
+} while (0)
+
+static inline int test_result(void)
+{
+    if (test_failures == 0) {
+        printf("PASS\n");
+    } else {
+        printf("FAIL (%d)\n", test_failures);
+    }
+    fflush(stdout);
+    fflush(stderr);
+    _Exit(test_failures == 0 ? 0 : 1);
+}
+
+#define TEST_RESULT() test_result()
+
+// Iteration counts can be raised for a longer soak: HOST_TEST_SCALE=10
+static inline int test_scaled(int n)
+{
+    const char *scale = getenv("HOST_TEST_SCALE");
+    return scale != NULL && atoi(scale) > 0 ? n * atoi(scale) : n;
+}
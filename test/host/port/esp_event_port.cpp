@@ -0,0 +1,113 @@
+/***************************************************************************************
+ *  File        : esp_event_port.cpp
+ *  Description : Default event loop of ESP-IDF for host tests
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - The default event loop runs handlers on its own thread, in posting
+ *     order, in a task named like the ESP-IDF one ("sys_evt").
+ ***************************************************************************************/
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "esp_event.h"
+#include "freertos/task.h"
+
+// ============================================================================
+// DEFAULT EVENT LOOP
+// ============================================================================
+struct event_handler {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t fn;
+    void *arg;
+    bool removed;
+};
+
+struct event_post {
+    esp_event_base_t base;
+    int32_t id;
+    std::vector<uint8_t> data;
+};
+
+static std::mutex loop_lock;
+static std::condition_variable loop_cv;
+static std::deque<event_post> loop_queue;
+static std::vector<event_handler *> loop_handlers;
+static bool loop_started = false;
+
+static void event_loop(void *arg)
+{
+    std::unique_lock<std::mutex> lock(loop_lock);
+    for (;;) {
+        loop_cv.wait(lock, [] { return !loop_queue.empty(); });
+        event_post post = loop_queue.front();
+        loop_queue.pop_front();
+        std::vector<event_handler *> handlers = loop_handlers;
+        lock.unlock();
+        for (event_handler *h : handlers) {
+            // Unregistering only marks the entry, so h is still valid here
+            if (!h->removed && h->base == post.base && (h->id == ESP_EVENT_ANY_ID || h->id == post.id)) {
+                h->fn(h->arg, post.base, post.id, post.data.empty() ? NULL : post.data.data());
+            }
+        }
+        lock.lock();
+    }
+}
+
+esp_err_t esp_event_post(esp_event_base_t base, int32_t id, const void *data, size_t size, TickType_t ticks)
+{
+    std::lock_guard<std::mutex> guard(loop_lock);
+    if (!loop_started) {
+        loop_started = true;
+        xTaskCreate(event_loop, "sys_evt", 0, NULL, 0, NULL);
+    }
+    event_post post;
+    post.base = base;
+    post.id = id;
+    post.data.assign((const uint8_t *)data, (const uint8_t *)data + (data != NULL ? size : 0));
+    loop_queue.push_back(post);
+    loop_cv.notify_all();
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_register(esp_event_base_t base, int32_t id, esp_event_handler_t fn, void *arg,
+                                              esp_event_handler_instance_t *instance)
+{
+    event_handler *h = new event_handler{base, id, fn, arg, false};
+    std::lock_guard<std::mutex> guard(loop_lock);
+    loop_handlers.push_back(h);
+    if (instance != NULL) {
+        *instance = h;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_unregister(esp_event_base_t base, int32_t id,
+                                                esp_event_handler_instance_t instance)
+{
+    std::lock_guard<std::mutex> guard(loop_lock);
+    ((event_handler *)instance)->removed = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t base, int32_t id, esp_event_handler_t fn, void *arg)
+{
+    return esp_event_handler_instance_register(base, id, fn, arg, NULL);
+}
+
+esp_err_t esp_event_handler_unregister(esp_event_base_t base, int32_t id, esp_event_handler_t fn)
+{
+    std::lock_guard<std::mutex> guard(loop_lock);
+    for (event_handler *h : loop_handlers) {
+        if (h->base == base && h->id == id && h->fn == fn) {
+            h->removed = true;
+        }
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,102 @@
+/***************************************************************************************
+ *  File        : esp_system_port.cpp
+ *  Description : Logging and system calls of ESP-IDF for host tests
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Shared by the threaded port and the simulations (sim_port.cpp).
+ ***************************************************************************************/
+
+#include <mutex>
+#include <random>
+#include <dirent.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "host_port.h"
+
+// ============================================================================
+// LOGGING
+// ============================================================================
+void host_log(esp_log_level_t level, const char *tag, const char *fmt, ...)
+{
+    static const bool verbose = getenv("HOST_TEST_VERBOSE") != NULL;
+    if (level > ESP_LOG_WARN && !verbose) {
+        return;
+    }
+    static const char letters[] = "NEWIDV";
+    va_list args;
+    va_start(args, fmt);
+    flockfile(stderr);      // One line at a time, tasks log concurrently
+    fprintf(stderr, "%c (%s) ", letters[level], tag);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    funlockfile(stderr);
+    va_end(args);
+}
+
+const char *esp_err_to_name(esp_err_t err)
+{
+    switch (err) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    default: return "ESP_ERR_?";
+    }
+}
+
+// ============================================================================
+// SYSTEM
+// ============================================================================
+uint32_t esp_random(void)
+{
+    static std::mutex lock;
+    static std::mt19937 rng(12345);     // Fixed seed: runs are repeatable
+    std::lock_guard<std::mutex> guard(lock);
+    return rng();
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    return 200 * 1024;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    return 100 * 1024;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    return 150 * 1024;
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return 200 * 1024;
+}
+
+int host_open_fds(void)
+{
+    int n = 0;
+    DIR *dir = opendir("/proc/self/fd");
+    if (dir == NULL) {
+        return -1;
+    }
+    while (readdir(dir) != NULL) {
+        n++;
+    }
+    closedir(dir);
+    return n - 3;   // ".", ".." and the directory itself
+}
@@ -0,0 +1,134 @@
+/***************************************************************************************
+ *  File        : esp_timer_port.cpp
+ *  Description : esp_timer on a dispatcher thread
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Host tests only. Callbacks run one at a time on a single thread, like
+ *     the ESP_TIMER_TASK dispatch method.
+ ***************************************************************************************/
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "esp_timer.h"
+
+typedef std::chrono::steady_clock host_clock;
+static const host_clock::time_point host_boot = host_clock::now();
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    bool active;
+    uint64_t period_us;     // 0 = one-shot
+    int64_t due_us;
+    esp_timer *next;        // All timers ever created
+};
+
+static std::mutex timers_lock;
+static std::condition_variable timers_cv;
+static esp_timer *timers = NULL;
+static bool dispatcher_started = false;
+
+int64_t esp_timer_get_time(void)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(host_clock::now() - host_boot).count();
+}
+
+static void dispatcher(void)
+{
+    std::unique_lock<std::mutex> lock(timers_lock);
+    for (;;) {
+        esp_timer *due = NULL;
+        for (esp_timer *t = timers; t != NULL; t = t->next) {
+            if (t->active && (due == NULL || t->due_us < due->due_us)) {
+                due = t;
+            }
+        }
+        if (due == NULL) {
+            timers_cv.wait(lock);
+            continue;
+        }
+        int64_t wait_us = due->due_us - esp_timer_get_time();
+        if (wait_us > 0) {
+            timers_cv.wait_for(lock, std::chrono::microseconds(wait_us));
+            continue;
+        }
+        if (due->period_us != 0) {
+            due->due_us += due->period_us;
+        } else {
+            due->active = false;
+        }
+        esp_timer_cb_t callback = due->callback;
+        void *arg = due->arg;
+        lock.unlock();
+        callback(arg);
+        lock.lock();
+    }
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle)
+{
+    esp_timer *t = new esp_timer();
+    t->callback = args->callback;
+    t->arg = args->arg;
+    std::lock_guard<std::mutex> guard(timers_lock);
+    t->next = timers;
+    timers = t;
+    if (!dispatcher_started) {
+        dispatcher_started = true;
+        std::thread(dispatcher).detach();
+    }
+    *handle = t;
+    return ESP_OK;
+}
+
+static esp_err_t timer_start(esp_timer_handle_t t, uint64_t timeout_us, uint64_t period_us)
+{
+    std::lock_guard<std::mutex> guard(timers_lock);
+    if (t->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    t->active = true;
+    t->period_us = period_us;
+    t->due_us = esp_timer_get_time() + (int64_t)timeout_us;
+    timers_cv.notify_all();
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t timeout_us)
+{
+    return timer_start(t, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t t, uint64_t period_us)
+{
+    return timer_start(t, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t t)
+{
+    std::lock_guard<std::mutex> guard(timers_lock);
+    if (!t->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    t->active = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t t)
+{
+    std::lock_guard<std::mutex> guard(timers_lock);
+    t->active = false;      // Kept in the list: the dispatcher may still hold it
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t t)
+{
+    std::lock_guard<std::mutex> guard(timers_lock);
+    return t->active;
+}
@@ -0,0 +1,366 @@
+/***************************************************************************************
+ *  File        : freertos_port.cpp
+ *  Description : FreeRTOS tasks, queues, semaphores and event groups on std::thread
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Host tests only. Enough of the kernel API for the component's control
+ *     paths to run with real concurrency; no priorities, no core affinity.
+ *   - vTaskDelete(NULL) unwinds the calling thread. Deleting another task is
+ *     not supported (the component never does it).
+ *   - Task control blocks are never freed, so a stale handle stays valid.
+ ***************************************************************************************/
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "host_port.h"
+
+typedef std::chrono::steady_clock host_clock;
+static const host_clock::time_point host_boot = host_clock::now();
+
+// Deadline for a wait of ticks (1 tick = 1 ms); false = wait forever
+static bool wait_deadline(TickType_t ticks, host_clock::time_point *deadline)
+{
+    if (ticks == portMAX_DELAY) {
+        return false;
+    }
+    *deadline = host_clock::now() + std::chrono::milliseconds(ticks);
+    return true;
+}
+
+template <typename Pred>
+static bool wait_until(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, TickType_t ticks, Pred pred)
+{
+    host_clock::time_point deadline;
+    if (!wait_deadline(ticks, &deadline)) {
+        cv.wait(lock, pred);
+        return true;
+    }
+    return cv.wait_until(lock, deadline, pred);
+}
+
+// ============================================================================
+// CRITICAL SECTIONS
+// ============================================================================
+void vPortEnterCritical(portMUX_TYPE *mux)
+{
+    while (__atomic_exchange_n(&mux->locked, 1, __ATOMIC_ACQUIRE)) {
+        std::this_thread::yield();
+    }
+}
+
+void vPortExitCritical(portMUX_TYPE *mux)
+{
+    __atomic_store_n(&mux->locked, 0, __ATOMIC_RELEASE);
+}
+
+// ============================================================================
+// TASKS
+// ============================================================================
+struct tskTaskControlBlock {
+    std::mutex lock;
+    std::condition_variable cv;
+    uint32_t notify_value = 0;
+    bool notify_pending = false;
+    char name[16] = {};
+};
+
+namespace {
+struct task_exit {};
+}
+
+static thread_local TaskHandle_t current_task = NULL;
+static std::atomic<int> tasks_running(0);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    TaskHandle_t task = new tskTaskControlBlock();
+    strncpy(task->name, name, sizeof(task->name) - 1);
+    if (handle != NULL) {
+        *handle = task;
+    }
+    tasks_running++;
+    std::thread([fn, arg, task]() {
+        current_task = task;
+        try {
+            fn(arg);
+        } catch (const task_exit &) {
+        }
+        tasks_running--;
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t priority,
+                       TaskHandle_t *handle)
+{
+    return xTaskCreatePinnedToCore(fn, name, stack, arg, priority, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task != NULL && task != xTaskGetCurrentTaskHandle()) {
+        abort();
+    }
+    throw task_exit();
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)std::chrono::duration_cast<std::chrono::milliseconds>(host_clock::now() - host_boot).count();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    if (current_task == NULL) {
+        current_task = new tskTaskControlBlock();   // A thread the port did not create (main)
+    }
+    return current_task;
+}
+
+char *pcTaskGetName(TaskHandle_t task)
+{
+    return (task != NULL ? task : xTaskGetCurrentTaskHandle())->name;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    std::lock_guard<std::mutex> guard(task->lock);
+    switch (action) {
+    case eSetBits:
+        task->notify_value |= value;
+        break;
+    case eIncrement:
+        task->notify_value++;
+        break;
+    case eSetValueWithOverwrite:
+        task->notify_value = value;
+        break;
+    case eSetValueWithoutOverwrite:
+        if (task->notify_pending) {
+            return pdFAIL;
+        }
+        task->notify_value = value;
+        break;
+    case eNoAction:
+        break;
+    }
+    task->notify_pending = true;
+    task->cv.notify_all();
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    return xTaskNotify(task, 0, eIncrement);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(self->lock);
+    wait_until(self->cv, lock, ticks, [self] { return self->notify_value != 0; });
+    uint32_t value = self->notify_value;
+    if (value != 0) {
+        self->notify_value = clear ? 0 : value - 1;
+    }
+    self->notify_pending = false;
+    return value;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t ticks)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(self->lock);
+    if (!self->notify_pending) {
+        self->notify_value &= ~clear_on_entry;
+    }
+    bool got = wait_until(self->cv, lock, ticks, [self] { return self->notify_pending; });
+    if (value != NULL) {
+        *value = self->notify_value;
+    }
+    if (got) {
+        self->notify_value &= ~clear_on_exit;
+        self->notify_pending = false;
+    }
+    return got ? pdTRUE : pdFALSE;
+}
+
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority)
+{
+}
+
+int host_tasks_running(void)
+{
+    return tasks_running.load();
+}
+
+// ============================================================================
+// QUEUES AND SEMAPHORES
+// ============================================================================
+// A semaphore is a queue of zero-size items, as in FreeRTOS
+struct QueueDef {
+    std::mutex lock;
+    std::condition_variable cv;
+    std::deque<std::vector<uint8_t>> items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+};
+
+static QueueHandle_t queue_new(UBaseType_t length, UBaseType_t item_size, UBaseType_t initial)
+{
+    QueueHandle_t q = new QueueDef();
+    q->length = length;
+    q->item_size = item_size;
+    for (UBaseType_t i = 0; i < initial; i++) {
+        q->items.emplace_back();
+    }
+    return q;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    return queue_new(length, item_size, 0);
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> lock(q->lock);
+    if (!wait_until(q->cv, lock, ticks, [q] { return q->items.size() < q->length; })) {
+        return pdFALSE;
+    }
+    const uint8_t *bytes = (const uint8_t *)item;
+    q->items.emplace_back(bytes, bytes + q->item_size);
+    q->cv.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> lock(q->lock);
+    if (!wait_until(q->cv, lock, ticks, [q] { return !q->items.empty(); })) {
+        return pdFALSE;
+    }
+    if (q->item_size != 0) {
+        memcpy(item, q->items.front().data(), q->item_size);
+    }
+    q->items.pop_front();
+    q->cv.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    std::lock_guard<std::mutex> guard(q->lock);
+    return (UBaseType_t)q->items.size();
+}
+
+void vQueueDelete(QueueHandle_t q)
+{
+    delete q;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return queue_new(1, 0, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return queue_new(1, 0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer)
+{
+    return xSemaphoreCreateMutex();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    return xQueueReceive(sem, NULL, ticks);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    return xQueueSend(sem, NULL, 0);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    vQueueDelete(sem);
+}
+
+// ============================================================================
+// EVENT GROUPS
+// ============================================================================
+struct EventGroupDef {
+    std::mutex lock;
+    std::condition_variable cv;
+    EventBits_t bits = 0;
+};
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    return new EventGroupDef();
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    std::lock_guard<std::mutex> guard(group->lock);
+    group->bits |= bits;
+    group->cv.notify_all();
+    return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    std::lock_guard<std::mutex> guard(group->lock);
+    EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group)
+{
+    std::lock_guard<std::mutex> guard(group->lock);
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear, BaseType_t all,
+                                TickType_t ticks)
+{
+    std::unique_lock<std::mutex> lock(group->lock);
+    auto ready = [group, bits, all] { return all ? (group->bits & bits) == bits : (group->bits & bits) != 0; };
+    bool met = wait_until(group->cv, lock, ticks, ready);
+    EventBits_t result = group->bits;
+    if (met && clear) {
+        group->bits &= ~bits;
+    }
+    return result;
+}
+
+void vEventGroupDelete(EventGroupHandle_t group)
+{
+    delete group;
+}
@@ -0,0 +1,56 @@
+/***************************************************************************************
+ *  File        : host_port.h
+ *  Description : Controls and probes of the host port, for the host tests
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ ***************************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// KERNEL (freertos_port.cpp)
+// ============================================================================
+// Tasks created through xTaskCreate() that have not returned or deleted themselves
+int host_tasks_running(void);
+
+// ============================================================================
+// WIFI DRIVER AND NETIFS (wifi_port.cpp)
+// ============================================================================
+typedef struct {
+    uint32_t ap_start_delay_ms;     // APSTA mode -> WIFI_EVENT_AP_START; UINT32_MAX = never
+    uint32_t sta_ip;                // Network order, 0 = STA not connected
+    uint32_t sta_dns;               // Network order, 0 = none from DHCP
+    uint8_t sta_channel;
+} host_wifi_params_t;
+
+void host_wifi_reset(const host_wifi_params_t *params);
+uint32_t host_wifi_mode_changes(void);
+
+// ============================================================================
+// SYSTEM (esp_system_port.cpp)
+// ============================================================================
+// Open file descriptors of the process (sockets included)
+int host_open_fds(void);
+
+// ============================================================================
+// VIRTUAL TIME (sim_port.cpp, simulations only)
+// ============================================================================
+// esp_timer_get_time() in the simulations
+int64_t sim_now_us(void);
+// Move the clock to until_us, firing due esp_timer callbacks on the way
+void sim_run_until(int64_t until_us);
+// pbufs allocated and not yet freed
+int sim_pbufs(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,343 @@
+/***************************************************************************************
+ *  File        : sim_port.cpp
+ *  Description : Virtual-time stand-ins of the kernel, esp_timer, events and pbufs
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - For the simulations, which are single threaded: the clock only moves
+ *     when the simulation calls sim_run_until(), and esp_timer callbacks
+ *     fire from there in due order. Runs are fully repeatable.
+ *   - Tasks are created but never run; a simulation drives the code a task
+ *     would run itself. Semaphores and notifications never block.
+ *   - Events are delivered synchronously, from within esp_event_post().
+ ***************************************************************************************/
+
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "esp_event.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "lwip/pbuf.h"
+#include "napt_fwd.h"
+#include "host_port.h"
+
+static int64_t sim_clock_us = 0;
+
+// ============================================================================
+// ESP_TIMER
+// ============================================================================
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    bool active;
+    uint64_t period_us;     // 0 = one-shot
+    int64_t due_us;
+};
+
+static std::vector<esp_timer *> sim_timers;
+
+int64_t esp_timer_get_time(void)
+{
+    return sim_clock_us;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    esp_timer *t = new esp_timer{args->callback, args->arg, false, 0, 0};
+    sim_timers.push_back(t);
+    *out = t;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t t, uint64_t period_us)
+{
+    t->active = true;
+    t->period_us = period_us;
+    t->due_us = sim_clock_us + (int64_t)period_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t timeout_us)
+{
+    t->active = true;
+    t->period_us = 0;
+    t->due_us = sim_clock_us + (int64_t)timeout_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t t)
+{
+    if (!t->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    t->active = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t t)
+{
+    t->active = false;      // Never freed: a stale handle stays harmless
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t t)
+{
+    return t->active;
+}
+
+int64_t sim_now_us(void)
+{
+    return sim_clock_us;
+}
+
+void sim_run_until(int64_t until_us)
+{
+    for (;;) {
+        esp_timer *next = NULL;
+        for (esp_timer *t : sim_timers) {
+            if (t->active && t->due_us <= until_us && (next == NULL || t->due_us < next->due_us)) {
+                next = t;
+            }
+        }
+        if (next == NULL) {
+            break;
+        }
+        if (next->due_us > sim_clock_us) {
+            sim_clock_us = next->due_us;
+        }
+        if (next->period_us != 0) {
+            next->due_us += (int64_t)next->period_us;
+        } else {
+            next->active = false;
+        }
+        next->callback(next->arg);
+    }
+    if (until_us > sim_clock_us) {
+        sim_clock_us = until_us;
+    }
+}
+
+// ============================================================================
+// KERNEL
+// ============================================================================
+struct tskTaskControlBlock {
+    TaskFunction_t fn;
+    void *arg;
+};
+
+struct QueueDef {
+    bool full;
+};
+
+void vPortEnterCritical(portMUX_TYPE *mux)
+{
+}
+
+void vPortExitCritical(portMUX_TYPE *mux)
+{
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    TaskHandle_t task = new tskTaskControlBlock{fn, arg};
+    if (handle != NULL) {
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t priority,
+                       TaskHandle_t *handle)
+{
+    return xTaskCreatePinnedToCore(fn, name, stack, arg, priority, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    sim_run_until(sim_clock_us + (int64_t)ticks * 1000);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(sim_clock_us / 1000);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    return 1;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return new QueueDef{true};
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return new QueueDef{false};
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    sem->full = false;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    sem->full = true;
+    return pdTRUE;
+}
+
+// ============================================================================
+// EVENTS
+// ============================================================================
+struct sim_handler {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t fn;
+    void *arg;
+};
+
+static std::vector<sim_handler> sim_handlers;
+
+esp_err_t esp_event_post(esp_event_base_t base, int32_t id, const void *data, size_t size, TickType_t ticks)
+{
+    // Handlers may register more; iterate over a copy
+    std::vector<sim_handler> handlers = sim_handlers;
+    for (const sim_handler &h : handlers) {
+        if (h.base == base && (h.id == ESP_EVENT_ANY_ID || h.id == id)) {
+            h.fn(h.arg, base, id, (void *)data);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t base, int32_t id, esp_event_handler_t fn, void *arg)
+{
+    sim_handlers.push_back(sim_handler{base, id, fn, arg});
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_unregister(esp_event_base_t base, int32_t id, esp_event_handler_t fn)
+{
+    for (size_t i = 0; i < sim_handlers.size(); i++) {
+        if (sim_handlers[i].base == base && sim_handlers[i].id == id && sim_handlers[i].fn == fn) {
+            sim_handlers.erase(sim_handlers.begin() + i);
+            break;
+        }
+    }
+    return ESP_OK;
+}
+
+// ============================================================================
+// PBUFS
+// ============================================================================
+// Single-segment RAM pbufs with the payload right behind the header
+static int sim_pbufs_live = 0;
+
+int sim_pbufs(void)
+{
+    return sim_pbufs_live;
+}
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, uint16_t len, pbuf_type type)
+{
+    struct pbuf *p = (struct pbuf *)calloc(1, sizeof(struct pbuf) + len);
+    if (p == NULL) {
+        return NULL;
+    }
+    p->payload = p + 1;
+    p->tot_len = len;
+    p->len = len;
+    p->type_internal = (uint8_t)type;
+    p->ref = 1;
+    sim_pbufs_live++;
+    return p;
+}
+
+void pbuf_ref(struct pbuf *p)
+{
+    p->ref++;
+}
+
+uint8_t pbuf_free(struct pbuf *p)
+{
+    if (p == NULL || --p->ref > 0) {
+        return 0;
+    }
+    free(p);
+    sim_pbufs_live--;
+    return 1;
+}
+
+struct pbuf *pbuf_clone(pbuf_layer layer, pbuf_type type, struct pbuf *src)
+{
+    struct pbuf *p = pbuf_alloc(layer, src->tot_len, type);
+    if (p != NULL) {
+        memcpy(p->payload, src->payload, src->tot_len);
+    }
+    return p;
+}
+
+uint16_t pbuf_copy_partial(const struct pbuf *p, void *out, uint16_t len, uint16_t offset)
+{
+    if (offset >= p->tot_len) {
+        return 0;
+    }
+    if (len > p->tot_len - offset) {
+        len = p->tot_len - offset;
+    }
+    memcpy(out, (const uint8_t *)p->payload + offset, len);
+    return len;
+}
+
+err_t pbuf_take(struct pbuf *p, const void *data, uint16_t len)
+{
+    if (len > p->tot_len) {
+        return ERR_ARG;
+    }
+    memcpy(p->payload, data, len);
+    return ERR_OK;
+}
+
+// ============================================================================
+// FORWARDING PATH HELPERS
+// ============================================================================
+uint32_t napt_now_ms(void)
+{
+    return (uint32_t)(sim_clock_us / 1000);
+}
+
+// Any direction-independent hash will do for the simulations; napt_fwd.cpp,
+// where the real one lives, needs the lwIP netifs
+uint32_t napt_flow_hash(uint32_t a, uint16_t aport, uint32_t b, uint16_t bport, uint8_t proto)
+{
+    if (a > b || (a == b && aport > bport)) {
+        uint32_t t = a; a = b; b = t;
+        uint16_t tp = aport; aport = bport; bport = tp;
+    }
+    uint32_t h = 2166136261u;
+    uint32_t words[4] = { a, b, ((uint32_t)aport << 16) | bport, proto };
+    for (int i = 0; i < 4; i++) {
+        h = (h ^ words[i]) * 16777619u;
+        h ^= h >> 15;
+    }
+    return h;
+}
@@ -0,0 +1,249 @@
+/***************************************************************************************
+ *  File        : wifi_port.cpp
+ *  Description : Scripted WiFi driver and esp_netif objects for host tests
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Switching to an AP mode starts the AP ap_start_delay_ms later on a
+ *     driver thread: the AP netif goes up, then WIFI_EVENT_AP_START is
+ *     posted, the order in which ESP-IDF's default handlers run.
+ *   - Back to STA mode stops the AP at once and posts WIFI_EVENT_AP_STOP.
+ *   - No stations, no scan results.
+ ***************************************************************************************/
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <string.h>
+#include "esp_wifi.h"
+#include "esp_netif.h"
+#include "esp_netif_net_stack.h"
+#include "lwip/netif.h"
+#include "host_port.h"
+
+ESP_EVENT_DEFINE_BASE(WIFI_EVENT);
+ESP_EVENT_DEFINE_BASE(IP_EVENT);
+
+struct esp_netif_obj {
+    esp_netif_ip_info_t ip;
+    bool up;
+    bool dhcps;
+    struct netif lwip;
+};
+
+static std::mutex wifi_lock;
+static host_wifi_params_t params;
+static esp_netif_obj sta_netif;
+static esp_netif_obj ap_netif;
+static bool ap_created = false;
+static wifi_mode_t mode = WIFI_MODE_STA;
+static uint32_t mode_changes = 0;
+static uint32_t ap_generation = 0;     // Bumped on every mode change; a stale start is dropped
+static wifi_config_t ap_config;
+static uint32_t event_mask = WIFI_EVENT_MASK_AP_PROBEREQRECVED;
+
+void host_wifi_reset(const host_wifi_params_t *p)
+{
+    std::lock_guard<std::mutex> guard(wifi_lock);
+    params = *p;
+    sta_netif.ip.ip.addr = p->sta_ip;
+    sta_netif.up = p->sta_ip != 0;
+    mode_changes = 0;
+}
+
+uint32_t host_wifi_mode_changes(void)
+{
+    std::lock_guard<std::mutex> guard(wifi_lock);
+    return mode_changes;
+}
+
+static void ap_start_later(uint32_t generation, uint32_t delay_ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+    {
+        std::lock_guard<std::mutex> guard(wifi_lock);
+        if (generation != ap_generation) {
+            return;
+        }
+        ap_netif.up = true;
+    }
+    esp_event_post(WIFI_EVENT, WIFI_EVENT_AP_START, NULL, 0, 0);
+}
+
+// ============================================================================
+// DRIVER
+// ============================================================================
+esp_err_t esp_wifi_set_mode(wifi_mode_t new_mode)
+{
+    std::unique_lock<std::mutex> lock(wifi_lock);
+    bool had_ap = mode == WIFI_MODE_AP || mode == WIFI_MODE_APSTA;
+    bool has_ap = new_mode == WIFI_MODE_AP || new_mode == WIFI_MODE_APSTA;
+    mode = new_mode;
+    mode_changes++;
+    if (had_ap == has_ap) {
+        return ESP_OK;
+    }
+    uint32_t generation = ++ap_generation;
+    if (has_ap) {
+        if (params.ap_start_delay_ms != UINT32_MAX) {
+            std::thread(ap_start_later, generation, params.ap_start_delay_ms).detach();
+        }
+        return ESP_OK;
+    }
+    bool was_up = ap_netif.up;
+    ap_netif.up = false;
+    lock.unlock();
+    if (was_up) {
+        esp_event_post(WIFI_EVENT, WIFI_EVENT_AP_STOP, NULL, 0, 0);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_mode(wifi_mode_t *out)
+{
+    std::lock_guard<std::mutex> guard(wifi_lock);
+    *out = mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t iface, wifi_config_t *config)
+{
+    std::lock_guard<std::mutex> guard(wifi_lock);
+    if (iface == WIFI_IF_AP) {
+        ap_config = *config;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_config(wifi_interface_t iface, wifi_config_t *config)
+{
+    std::lock_guard<std::mutex> guard(wifi_lock);
+    *config = ap_config;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_ap_get_sta_list(wifi_sta_list_t *list)
+{
+    memset(list, 0, sizeof(*list));
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_deauth_sta(uint16_t aid)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_channel(uint8_t *primary, wifi_second_chan_t *second)
+{
+    std::lock_guard<std::mutex> guard(wifi_lock);
+    *primary = params.sta_channel;
+    *second = WIFI_SECOND_CHAN_NONE;
+    return params.sta_channel != 0 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_wifi_set_bandwidth(wifi_interface_t iface, wifi_bandwidth_t bw)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_event_mask(uint32_t mask)
+{
+    std::lock_guard<std::mutex> guard(wifi_lock);
+    event_mask = mask;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_event_mask(uint32_t *mask)
+{
+    std::lock_guard<std::mutex> guard(wifi_lock);
+    *mask = event_mask;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_start(const wifi_scan_config_t *config, bool block)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_get_ap_records(uint16_t *number, wifi_ap_record_t *records)
+{
+    *number = 0;
+    return ESP_OK;
+}
+
+// ============================================================================
+// NETIFS
+// ============================================================================
+esp_netif_t *esp_netif_create_default_wifi_ap(void)
+{
+    std::lock_guard<std::mutex> guard(wifi_lock);
+    ap_created = true;
+    return &ap_netif;
+}
+
+esp_netif_t *esp_netif_get_handle_from_ifkey(const char *key)
+{
+    std::lock_guard<std::mutex> guard(wifi_lock);
+    if (strcmp(key, "WIFI_STA_DEF") == 0) {
+        return &sta_netif;
+    }
+    if (strcmp(key, "WIFI_AP_DEF") == 0 && ap_created) {
+        return &ap_netif;
+    }
+    return NULL;
+}
+
+esp_err_t esp_netif_get_ip_info(esp_netif_t *netif, esp_netif_ip_info_t *info)
+{
+    std::lock_guard<std::mutex> guard(wifi_lock);
+    *info = netif->ip;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_set_ip_info(esp_netif_t *netif, const esp_netif_ip_info_t *info)
+{
+    std::lock_guard<std::mutex> guard(wifi_lock);
+    netif->ip = *info;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_get_dns_info(esp_netif_t *netif, esp_netif_dns_type_t type, esp_netif_dns_info_t *dns)
+{
+    std::lock_guard<std::mutex> guard(wifi_lock);
+    memset(dns, 0, sizeof(*dns));
+    dns->ip.u_addr.ip4.addr = params.sta_dns;
+    return ESP_OK;
+}
+
+bool esp_netif_is_netif_up(esp_netif_t *netif)
+{
+    std::lock_guard<std::mutex> guard(wifi_lock);
+    return netif->up;
+}
+
+esp_err_t esp_netif_dhcps_start(esp_netif_t *netif)
+{
+    std::lock_guard<std::mutex> guard(wifi_lock);
+    netif->dhcps = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_dhcps_stop(esp_netif_t *netif)
+{
+    std::lock_guard<std::mutex> guard(wifi_lock);
+    netif->dhcps = false;
+    return ESP_OK;
+}
+
+void *esp_netif_get_netif_impl(esp_netif_t *netif)
+{
+    return &netif->lwip;
+}
+
+// lwIP NAPT, declared by the component itself
+extern "C" void ip_napt_enable(uint32_t addr, int enable)
+{
+}
@@ -0,0 +1,134 @@
+/***************************************************************************************
+ *  File        : sim_net.h
+ *  Description : Event queue and TCP segments for the virtual-time simulations
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Links with sim_port.cpp. Events at the same time run in the order
+ *     they were scheduled; esp_timer callbacks due by then run first.
+ ***************************************************************************************/
+#pragma once
+
+#include <functional>
+#include <queue>
+#include <vector>
+#include <string.h>
+#include "napt_fwd.h"
+#include "lwip/pbuf.h"
+#include "lwip/prot/ip.h"
+#include "host_port.h"
+
+#define SIM_MSS 1460
+#define SIM_HEADERS 54          // Ethernet + IPv4 + TCP without options
+
+// ============================================================================
+// EVENT QUEUE
+// ============================================================================
+class sim_events {
+public:
+    void at(int64_t when_us, std::function<void()> fn)
+    {
+        queue_.push(entry{when_us, next_seq_++, fn});
+    }
+
+    void after(int64_t delay_us, std::function<void()> fn)
+    {
+        at(sim_now_us() + delay_us, fn);
+    }
+
+    // Runs everything due up to until_us, then leaves the clock there
+    void run_until(int64_t until_us)
+    {
+        while (!queue_.empty() && queue_.top().when_us <= until_us) {
+            entry e = queue_.top();
+            queue_.pop();
+            sim_run_until(e.when_us);
+            e.fn();
+        }
+        sim_run_until(until_us);
+    }
+
+private:
+    struct entry {
+        int64_t when_us;
+        uint64_t seq;
+        std::function<void()> fn;
+        bool operator>(const entry &o) const
+        {
+            return when_us != o.when_us ? when_us > o.when_us : seq > o.seq;
+        }
+    };
+    std::priority_queue<entry, std::vector<entry>, std::greater<entry>> queue_;
+    uint64_t next_seq_ = 0;
+};
+
+// ============================================================================
+// TCP SEGMENTS
+// ============================================================================
+typedef struct {
+    uint32_t src;           // Network order
+    uint32_t dst;
+    uint16_t sport;         // Host order
+    uint16_t dport;
+    uint32_t seq;
+    uint32_t ack;
+    uint8_t flags;          // NAPT_TCP_*
+    uint16_t payload_len;
+} sim_tcp_seg_t;
+
+// Builds the frame of a segment into a new pbuf and fills pkt as
+// napt_pkt_parse() would. The payload is zeros. The caller frees the pbuf.
+static inline struct pbuf *sim_tcp_frame(const sim_tcp_seg_t *seg, napt_pkt_t *pkt)
+{
+    static uint16_t ip_id = 0;
+    uint16_t len = SIM_HEADERS + seg->payload_len;
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, len, PBUF_RAM);
+    uint8_t *eth = (uint8_t *)p->payload;
+    uint8_t *ip = eth + 14;
+    uint8_t *tcp = ip + 20;
+    eth[12] = 0x08;
+    ip[0] = 0x45;
+    ip[2] = (uint8_t)((len - 14) >> 8);
+    ip[3] = (uint8_t)(len - 14);
+    ip_id++;
+    ip[4] = (uint8_t)(ip_id >> 8);
+    ip[5] = (uint8_t)ip_id;
+    ip[8] = 64;
+    ip[9] = IP_PROTO_TCP;
+    memcpy(ip + 12, &seg->src, 4);
+    memcpy(ip + 16, &seg->dst, 4);
+    tcp[0] = (uint8_t)(seg->sport >> 8);
+    tcp[1] = (uint8_t)seg->sport;
+    tcp[2] = (uint8_t)(seg->dport >> 8);
+    tcp[3] = (uint8_t)seg->dport;
+    for (int i = 0; i < 4; i++) {
+        tcp[4 + i] = (uint8_t)(seg->seq >> (24 - 8 * i));
+        tcp[8 + i] = (uint8_t)(seg->ack >> (24 - 8 * i));
+    }
+    tcp[12] = 5 << 4;
+    tcp[13] = seg->flags;
+
+    memset(pkt, 0, sizeof(*pkt));
+    pkt->p = p;
+    pkt->eth = eth;
+    pkt->ip = ip;
+    pkt->l4 = tcp;
+    pkt->frame_len = len;
+    pkt->ether_type = 0x0800;
+    pkt->ip_len = len - 14;
+    pkt->ip_hlen = 20;
+    pkt->proto = IP_PROTO_TCP;
+    pkt->src = seg->src;
+    pkt->dst = seg->dst;
+    pkt->sport = seg->sport;
+    pkt->dport = seg->dport;
+    pkt->tcp_flags = seg->flags;
+    pkt->tcp_hlen = 20;
+    pkt->seq = seg->seq;
+    pkt->ack = seg->ack;
+    pkt->payload_len = seg->payload_len;
+    return p;
+}
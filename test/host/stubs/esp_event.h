@@ -0,0 +1,21 @@
+#pragma once
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+typedef const char *esp_event_base_t;
+typedef void *esp_event_handler_instance_t;
+typedef void *esp_event_loop_handle_t;
+typedef void (*esp_event_handler_t)(void *arg, esp_event_base_t base, int32_t id, void *data);
+#define ESP_EVENT_DECLARE_BASE(id) extern esp_event_base_t const id
+#define ESP_EVENT_DEFINE_BASE(id) extern esp_event_base_t const id; esp_event_base_t const id = #id
+#define ESP_EVENT_ANY_ID -1
+esp_err_t esp_event_post(esp_event_base_t, int32_t, const void *, size_t, TickType_t);
+esp_err_t esp_event_handler_register(esp_event_base_t, int32_t, esp_event_handler_t, void *);
+esp_err_t esp_event_handler_unregister(esp_event_base_t, int32_t, esp_event_handler_t);
+esp_err_t esp_event_handler_instance_register(esp_event_base_t, int32_t, esp_event_handler_t, void *, esp_event_handler_instance_t *);
+esp_err_t esp_event_handler_instance_unregister(esp_event_base_t, int32_t, esp_event_handler_instance_t);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,46 @@
+#pragma once
+#include "esp_err.h"
+#include "esp_netif_ip_addr.h"
+#include "esp_event.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+typedef struct esp_netif_obj esp_netif_t;
+typedef struct { esp_ip4_addr_t ip, netmask, gw; } esp_netif_ip_info_t;
+typedef struct { esp_ip_addr_t ip; } esp_netif_dns_info_t;
+typedef enum { ESP_NETIF_DNS_MAIN, ESP_NETIF_DNS_BACKUP, ESP_NETIF_DNS_FALLBACK } esp_netif_dns_type_t;
+typedef enum { ESP_NETIF_OP_START, ESP_NETIF_OP_SET, ESP_NETIF_OP_GET } esp_netif_dhcp_option_mode_t;
+typedef enum { ESP_NETIF_SUBNET_MASK=1, ESP_NETIF_DOMAIN_NAME_SERVER=6, ESP_NETIF_ROUTER_SOLICITATION_ADDRESS=32, ESP_NETIF_REQUESTED_IP_ADDRESS=50, ESP_NETIF_IP_ADDRESS_LEASE_TIME=51, ESP_NETIF_IP_REQUEST_RETRY_TIME=52 } esp_netif_dhcp_option_id_t;
+typedef enum { ESP_NETIF_DHCP_CLIENT=1, ESP_NETIF_DHCP_SERVER=2, ESP_NETIF_FLAG_AUTOUP=4, ESP_NETIF_FLAG_GARP=8, ESP_NETIF_FLAG_EVENT_IP_MODIFIED=16 } esp_netif_flags_t;
+typedef struct { esp_netif_flags_t flags; uint8_t mac[6]; const esp_netif_ip_info_t *ip_info; uint32_t get_ip_event; uint32_t lost_ip_event; const char *if_key; const char *if_desc; int route_prio; int bridge_info; } esp_netif_inherent_config_t;
+typedef struct { const esp_netif_inherent_config_t *base; const void *driver; const void *stack; } esp_netif_config_t;
+extern const esp_netif_inherent_config_t _g_esp_netif_inherent_ap_config;
+extern const void *_g_esp_netif_netstack_default_wifi_ap;
+#define ESP_NETIF_BASE_DEFAULT_WIFI_AP (&_g_esp_netif_inherent_ap_config)
+#define ESP_NETIF_NETSTACK_DEFAULT_WIFI_AP _g_esp_netif_netstack_default_wifi_ap
+#define ESP_NETIF_INHERENT_DEFAULT_WIFI_AP() { ESP_NETIF_DHCP_SERVER, {0}, NULL, 0, 0, "WIFI_AP_DEF", "ap", 10, 0 }
+esp_netif_t *esp_netif_create_default_wifi_ap(void);
+esp_netif_t *esp_netif_create_wifi(int wifi_if, const esp_netif_inherent_config_t *);
+esp_err_t esp_wifi_set_default_wifi_ap_handlers(void);
+esp_netif_t *esp_netif_get_handle_from_ifkey(const char *);
+esp_err_t esp_netif_get_ip_info(esp_netif_t *, esp_netif_ip_info_t *);
+esp_err_t esp_netif_set_ip_info(esp_netif_t *, const esp_netif_ip_info_t *);
+esp_err_t esp_netif_get_dns_info(esp_netif_t *, esp_netif_dns_type_t, esp_netif_dns_info_t *);
+esp_err_t esp_netif_dhcps_option(esp_netif_t *, esp_netif_dhcp_option_mode_t, esp_netif_dhcp_option_id_t, void *, uint32_t);
+esp_err_t esp_netif_dhcps_start(esp_netif_t *);
+esp_err_t esp_netif_dhcps_stop(esp_netif_t *);
+bool esp_netif_is_netif_up(esp_netif_t *);
+esp_err_t esp_netif_get_mac(esp_netif_t *, uint8_t mac[]);
+void esp_netif_destroy(esp_netif_t *);
+int esp_netif_get_netif_impl_index(esp_netif_t *);
+esp_err_t esp_netif_get_netif_impl_name(esp_netif_t *, char *);
+typedef struct { esp_netif_t *esp_netif; esp_netif_ip_info_t ip_info; bool ip_changed; } ip_event_got_ip_t;
+typedef struct { esp_ip4_addr_t ip; uint8_t mac[6]; } ip_event_ap_staipassigned_t;
+ESP_EVENT_DECLARE_BASE(IP_EVENT);
+typedef enum { IP_EVENT_STA_GOT_IP, IP_EVENT_STA_LOST_IP, IP_EVENT_AP_STAIPASSIGNED } ip_event_t;
+#define IPSTR "%d.%d.%d.%d"
+#define esp_ip4_addr_get_byte(ipaddr, idx) (((const uint8_t*)(&(ipaddr)->addr))[idx])
+#define IP2STR(ipaddr) esp_ip4_addr_get_byte(ipaddr, 0), esp_ip4_addr_get_byte(ipaddr, 1), esp_ip4_addr_get_byte(ipaddr, 2), esp_ip4_addr_get_byte(ipaddr, 3)
+#ifdef __cplusplus
+}
+#endif
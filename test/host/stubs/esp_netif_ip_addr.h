@@ -0,0 +1,8 @@
+#pragma once
+#include <stdint.h>
+typedef struct { uint32_t addr; } esp_ip4_addr_t;
+typedef struct { uint32_t addr[4]; uint8_t zone; } esp_ip6_addr_t;
+typedef struct { union { esp_ip6_addr_t ip6; esp_ip4_addr_t ip4; } u_addr; uint8_t type; } esp_ip_addr_t;
+#define ESP_IP4TOADDR(a,b,c,d) ((uint32_t)(((d)&0xff)<<24)|(((c)&0xff)<<16)|(((b)&0xff)<<8)|((a)&0xff))
+#define ESP_IP4_ADDR(ipaddr, a,b,c,d) (ipaddr)->addr = ESP_IP4TOADDR(a,b,c,d)
+#define ESP_IPADDR_TYPE_V4 0
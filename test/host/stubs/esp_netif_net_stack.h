@@ -0,0 +1,9 @@
+#pragma once
+#include "esp_netif.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+void *esp_netif_get_netif_impl(esp_netif_t *);
+#ifdef __cplusplus
+}
+#endif
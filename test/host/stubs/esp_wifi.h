@@ -0,0 +1,66 @@
+#pragma once
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+typedef enum { WIFI_MODE_NULL, WIFI_MODE_STA, WIFI_MODE_AP, WIFI_MODE_APSTA } wifi_mode_t;
+typedef enum { WIFI_IF_STA = 0, WIFI_IF_AP = 1 } wifi_interface_t;
+typedef enum { WIFI_AUTH_OPEN, WIFI_AUTH_WEP, WIFI_AUTH_WPA_PSK, WIFI_AUTH_WPA2_PSK, WIFI_AUTH_WPA_WPA2_PSK } wifi_auth_mode_t;
+typedef enum { WIFI_SECOND_CHAN_NONE, WIFI_SECOND_CHAN_ABOVE, WIFI_SECOND_CHAN_BELOW } wifi_second_chan_t;
+typedef enum { WIFI_BW_HT20 = 1, WIFI_BW_HT40 = 2 } wifi_bandwidth_t;
+typedef enum { WIFI_PS_NONE, WIFI_PS_MIN_MODEM, WIFI_PS_MAX_MODEM } wifi_ps_type_t;
+#define WIFI_PROTOCOL_11B 1
+#define WIFI_PROTOCOL_11G 2
+#define WIFI_PROTOCOL_11N 4
+#define WIFI_PROTOCOL_LR 8
+#define ESP_WIFI_MAX_CONN_NUM 15
+#define WIFI_EVENT_MASK_ALL 0xffffffff
+#define WIFI_EVENT_MASK_NONE 0
+#define WIFI_EVENT_MASK_AP_PROBEREQRECVED 1
+typedef struct { uint8_t ssid[32]; uint8_t password[64]; uint8_t ssid_len; uint8_t channel; wifi_auth_mode_t authmode; uint8_t ssid_hidden; uint8_t max_connection; uint16_t beacon_interval; uint8_t csa_count; uint8_t dtim_period; int pairwise_cipher; bool ftm_responder; } wifi_ap_config_t;
+typedef struct { uint8_t ssid[32]; uint8_t password[64]; uint8_t channel; } wifi_sta_config_t;
+typedef union { wifi_ap_config_t ap; wifi_sta_config_t sta; } wifi_config_t;
+typedef struct { uint8_t mac[6]; int8_t rssi; uint32_t phy_11b:1; uint32_t phy_11g:1; uint32_t phy_11n:1; uint32_t phy_lr:1; uint32_t phy_11ax:1; uint32_t is_mesh_child:1; uint32_t reserved:26; } wifi_sta_info_t;
+typedef struct { wifi_sta_info_t sta[ESP_WIFI_MAX_CONN_NUM]; int num; } wifi_sta_list_t;
+typedef struct { uint8_t bssid[6]; uint8_t ssid[33]; uint8_t primary; wifi_second_chan_t second; int8_t rssi; wifi_auth_mode_t authmode; } wifi_ap_record_t;
+typedef enum { WIFI_SCAN_TYPE_ACTIVE, WIFI_SCAN_TYPE_PASSIVE } wifi_scan_type_t;
+typedef struct { uint32_t min; uint32_t max; } wifi_active_scan_time_t;
+typedef struct { wifi_active_scan_time_t active; uint32_t passive; } wifi_scan_time_t;
+typedef struct { uint8_t *ssid; uint8_t *bssid; uint8_t channel; bool show_hidden; wifi_scan_type_t scan_type; wifi_scan_time_t scan_time; uint8_t home_chan_dwell_time; } wifi_scan_config_t;
+ESP_EVENT_DECLARE_BASE(WIFI_EVENT);
+typedef enum { WIFI_EVENT_WIFI_READY, WIFI_EVENT_SCAN_DONE, WIFI_EVENT_STA_START, WIFI_EVENT_STA_STOP, WIFI_EVENT_STA_CONNECTED, WIFI_EVENT_STA_DISCONNECTED, WIFI_EVENT_STA_AUTHMODE_CHANGE, WIFI_EVENT_AP_START, WIFI_EVENT_AP_STOP, WIFI_EVENT_AP_STACONNECTED, WIFI_EVENT_AP_STADISCONNECTED, WIFI_EVENT_AP_PROBEREQRECVED } wifi_event_t;
+typedef struct { uint8_t mac[6]; uint8_t aid; bool is_mesh_child; } wifi_event_ap_staconnected_t;
+typedef struct { uint8_t mac[6]; uint8_t aid; bool is_mesh_child; uint16_t reason; } wifi_event_ap_stadisconnected_t;
+typedef struct { int rssi; uint8_t mac[6]; } wifi_event_ap_probe_req_rx_t;
+typedef struct { uint8_t ssid[32]; uint8_t ssid_len; uint8_t bssid[6]; uint8_t channel; wifi_auth_mode_t authmode; uint16_t aid; } wifi_event_sta_connected_t;
+typedef struct { uint8_t ssid[32]; uint8_t ssid_len; uint8_t bssid[6]; uint8_t reason; int8_t rssi; } wifi_event_sta_disconnected_t;
+esp_err_t esp_wifi_set_mode(wifi_mode_t);
+esp_err_t esp_wifi_get_mode(wifi_mode_t *);
+esp_err_t esp_wifi_set_config(wifi_interface_t, wifi_config_t *);
+esp_err_t esp_wifi_get_config(wifi_interface_t, wifi_config_t *);
+esp_err_t esp_wifi_ap_get_sta_list(wifi_sta_list_t *);
+esp_err_t esp_wifi_ap_get_sta_aid(const uint8_t mac[6], uint16_t *aid);
+esp_err_t esp_wifi_deauth_sta(uint16_t aid);
+esp_err_t esp_wifi_get_channel(uint8_t *, wifi_second_chan_t *);
+esp_err_t esp_wifi_set_channel(uint8_t, wifi_second_chan_t);
+esp_err_t esp_wifi_set_bandwidth(wifi_interface_t, wifi_bandwidth_t);
+esp_err_t esp_wifi_get_bandwidth(wifi_interface_t, wifi_bandwidth_t *);
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t);
+esp_err_t esp_wifi_get_ps(wifi_ps_type_t *);
+esp_err_t esp_wifi_set_protocol(wifi_interface_t, uint8_t);
+esp_err_t esp_wifi_get_protocol(wifi_interface_t, uint8_t *);
+esp_err_t esp_wifi_set_max_tx_power(int8_t);
+esp_err_t esp_wifi_get_max_tx_power(int8_t *);
+esp_err_t esp_wifi_scan_start(const wifi_scan_config_t *, bool);
+esp_err_t esp_wifi_scan_get_ap_num(uint16_t *);
+esp_err_t esp_wifi_scan_get_ap_records(uint16_t *, wifi_ap_record_t *);
+esp_err_t esp_wifi_clear_ap_list(void);
+esp_err_t esp_wifi_set_event_mask(uint32_t);
+esp_err_t esp_wifi_get_event_mask(uint32_t *);
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *);
+esp_err_t esp_wifi_set_inactive_time(wifi_interface_t, uint16_t);
+#ifdef __cplusplus
+}
+#endif
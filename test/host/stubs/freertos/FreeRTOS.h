@@ -0,0 +1,50 @@
+// Host stand-in for the FreeRTOS kernel header. Tasks are threads, a tick is 1 ms.
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xffffffffu
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(x) ((TickType_t)(x))
+#define tskNO_AFFINITY 0x7fffffff
+
+#ifndef configMAX_PRIORITIES
+#define configMAX_PRIORITIES 25
+#endif
+#ifndef portNUM_PROCESSORS
+#define portNUM_PROCESSORS 2
+#endif
+
+// Spinlock, not recursive, like the ESP-IDF port
+typedef struct {
+    volatile int locked;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+void vPortEnterCritical(portMUX_TYPE *mux);
+void vPortExitCritical(portMUX_TYPE *mux);
+
+#define portENTER_CRITICAL(m) vPortEnterCritical(m)
+#define portEXIT_CRITICAL(m) vPortExitCritical(m)
+#define portENTER_CRITICAL_SAFE(m) vPortEnterCritical(m)
+#define portEXIT_CRITICAL_SAFE(m) vPortExitCritical(m)
+#define taskENTER_CRITICAL(m) vPortEnterCritical(m)
+#define taskEXIT_CRITICAL(m) vPortExitCritical(m)
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+#include "FreeRTOS.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+typedef struct EventGroupDef *EventGroupHandle_t;
+typedef uint32_t EventBits_t;
+EventGroupHandle_t xEventGroupCreate(void);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t, EventBits_t);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t, EventBits_t);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t, EventBits_t, BaseType_t, BaseType_t, TickType_t);
+void vEventGroupDelete(EventGroupHandle_t);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+#include "FreeRTOS.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+typedef struct QueueDef *SemaphoreHandle_t;
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t);
+void vSemaphoreDelete(SemaphoreHandle_t);
+typedef struct { void *dummy[20]; } StaticSemaphore_t;
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *);
+#ifdef __cplusplus
+}
+#endif
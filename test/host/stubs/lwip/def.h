@@ -0,0 +1,8 @@
+#pragma once
+#include <arpa/inet.h>
+#define lwip_htons htons
+#define lwip_htonl htonl
+#define lwip_ntohs ntohs
+#define lwip_ntohl ntohl
+#define PP_HTONS(x) htons(x)
+#define PP_HTONL(x) htonl(x)
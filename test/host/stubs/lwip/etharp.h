@@ -0,0 +1,11 @@
+#pragma once
+#include "netif.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+struct eth_addr { uint8_t addr[6]; };
+err_t etharp_add_static_entry(const ip4_addr_t *ipaddr, struct eth_addr *ethaddr);
+err_t etharp_remove_static_entry(const ip4_addr_t *ipaddr);
+#ifdef __cplusplus
+}
+#endif
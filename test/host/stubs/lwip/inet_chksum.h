@@ -0,0 +1,9 @@
+#pragma once
+#include <stdint.h>
+#ifdef __cplusplus
+extern "C" {
+#endif
+uint16_t inet_chksum(const void *dataptr, uint16_t len);
+#ifdef __cplusplus
+}
+#endif
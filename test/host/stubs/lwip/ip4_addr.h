@@ -0,0 +1,7 @@
+#pragma once
+#include <stdint.h>
+typedef struct ip4_addr { uint32_t addr; } ip4_addr_t;
+#define IP4_ADDR(ipaddr, a,b,c,d) (ipaddr)->addr = ((uint32_t)((d) & 0xff) << 24) | ((uint32_t)((c) & 0xff) << 16) | ((uint32_t)((b) & 0xff) << 8) | (uint32_t)((a) & 0xff)
+#define ip4_addr_get_u32(a) ((a)->addr)
+#define ip4_addr_set_u32(d, v) ((d)->addr = (v))
+#define IPADDR_BROADCAST ((uint32_t)0xffffffffUL)
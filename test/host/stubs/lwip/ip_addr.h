@@ -0,0 +1,12 @@
+#pragma once
+#include "ip4_addr.h"
+typedef struct { uint32_t addr[4]; uint8_t zone; } ip6_addr_t;
+typedef struct ip_addr { union { ip6_addr_t ip6; ip4_addr_t ip4; } u_addr; uint8_t type; } ip_addr_t;
+#define IPADDR_TYPE_V4 0
+#define IPADDR_TYPE_ANY 46
+#define ip_2_ip4(a) (&((a)->u_addr.ip4))
+#define IP_ADDR_ANY (&ip_addr_any)
+extern const ip_addr_t ip_addr_any;
+extern const ip_addr_t ip_addr_broadcast;
+#define IP_ADDR_BROADCAST (&ip_addr_broadcast)
+#define IP_ADDR4(ipaddr,a,b,c,d) do { IP4_ADDR(ip_2_ip4(ipaddr),a,b,c,d); (ipaddr)->type = IPADDR_TYPE_V4; } while(0)
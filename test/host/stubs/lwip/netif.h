@@ -0,0 +1,8 @@
+#pragma once
+#include "pbuf.h"
+#include "ip_addr.h"
+struct netif;
+typedef err_t (*netif_input_fn)(struct pbuf *p, struct netif *inp);
+typedef err_t (*netif_linkoutput_fn)(struct netif *netif, struct pbuf *p);
+struct netif { struct netif *next; ip_addr_t ip_addr; ip_addr_t netmask; ip_addr_t gw; netif_input_fn input; netif_linkoutput_fn linkoutput; void *state; uint16_t mtu; uint8_t hwaddr_len; uint8_t hwaddr[6]; uint8_t flags; char name[2]; uint8_t num; };
+#define netif_ip4_addr(n) (&((n)->ip_addr.u_addr.ip4))
@@ -0,0 +1,5 @@
+#pragma once
+#define ETHARP_SUPPORT_STATIC_ENTRIES 1
+#define LWIP_TCPIP_CORE_LOCKING 1
+#define ETH_PAD_SIZE 0
+#define ARP_TABLE_SIZE 10
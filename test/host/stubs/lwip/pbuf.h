@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+#include "err.h"
+#include "opt.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+typedef enum { PBUF_TRANSPORT, PBUF_IP, PBUF_LINK, PBUF_RAW_TX, PBUF_RAW } pbuf_layer;
+typedef enum { PBUF_RAM = 0x280, PBUF_ROM = 1, PBUF_REF = 0x41, PBUF_POOL = 0x182 } pbuf_type;
+struct pbuf { struct pbuf *next; void *payload; uint16_t tot_len; uint16_t len; uint8_t type_internal; uint8_t flags; uint8_t ref; uint8_t if_idx; };
+#define PBUF_TYPE_FLAG_DATA_VOLATILE 0x40
+#define PBUF_NEEDS_COPY(p) ((p)->type_internal & PBUF_TYPE_FLAG_DATA_VOLATILE)
+struct pbuf *pbuf_alloc(pbuf_layer, uint16_t, pbuf_type);
+void pbuf_ref(struct pbuf *);
+uint8_t pbuf_free(struct pbuf *);
+struct pbuf *pbuf_clone(pbuf_layer, pbuf_type, struct pbuf *);
+uint16_t pbuf_copy_partial(const struct pbuf *, void *, uint16_t, uint16_t);
+err_t pbuf_take(struct pbuf *, const void *, uint16_t);
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,4 @@
+#pragma once
+#include "../opt.h"
+#define SIZEOF_ETH_HDR (14 + ETH_PAD_SIZE)
+enum eth_type { ETHTYPE_IP = 0x0800U, ETHTYPE_ARP = 0x0806U, ETHTYPE_IPV6 = 0x86DDU };
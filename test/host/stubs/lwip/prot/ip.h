@@ -0,0 +1,5 @@
+#pragma once
+#define IP_PROTO_ICMP 1
+#define IP_PROTO_IGMP 2
+#define IP_PROTO_UDP 17
+#define IP_PROTO_TCP 6
@@ -0,0 +1,4 @@
+#pragma once
+#define IP_HLEN 20
+#define IP_OFFMASK 0x1fffU
+#define IP_MF 0x2000U
@@ -0,0 +1,2 @@
+#pragma once
+#define TCP_HLEN 20
@@ -0,0 +1,2 @@
+#pragma once
+#define UDP_HLEN 8
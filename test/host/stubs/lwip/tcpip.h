@@ -0,0 +1,15 @@
+#pragma once
+#include "err.h"
+#include "opt.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+typedef void (*tcpip_callback_fn)(void *ctx);
+err_t tcpip_callback(tcpip_callback_fn, void *);
+void sys_lock_tcpip_core(void);
+void sys_unlock_tcpip_core(void);
+#define LOCK_TCPIP_CORE() sys_lock_tcpip_core()
+#define UNLOCK_TCPIP_CORE() sys_unlock_tcpip_core()
+#ifdef __cplusplus
+}
+#endif
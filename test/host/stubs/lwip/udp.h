@@ -0,0 +1,19 @@
+#pragma once
+#include "netif.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
+struct udp_pcb;
+typedef void (*udp_recv_fn)(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, uint16_t port);
+struct udp_pcb *udp_new(void);
+void udp_remove(struct udp_pcb *);
+err_t udp_bind(struct udp_pcb *, const ip_addr_t *, uint16_t);
+void udp_bind_netif(struct udp_pcb *, const struct netif *);
+void udp_recv(struct udp_pcb *, udp_recv_fn, void *);
+err_t udp_sendto_if(struct udp_pcb *, struct pbuf *, const ip_addr_t *, uint16_t, struct netif *);
+err_t udp_sendto(struct udp_pcb *, struct pbuf *, const ip_addr_t *, uint16_t);
+#define ip_set_option(pcb, opt) (void)(pcb)
+#define SOF_BROADCAST 0x20
+#ifdef __cplusplus
+}
+#endif
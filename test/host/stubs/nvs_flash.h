@@ -0,0 +1,5 @@
+#pragma once
+#include "nvs.h"
+esp_err_t nvs_flash_init(void); esp_err_t nvs_flash_erase(void);
+#define ESP_ERR_NVS_NO_FREE_PAGES 1
+#define ESP_ERR_NVS_NEW_VERSION_FOUND 2
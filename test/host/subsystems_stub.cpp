@@ -0,0 +1,72 @@
+/***************************************************************************************
+ *  File        : subsystems_stub.cpp
+ *  Description : No-op forwarding-path subsystems for the control path host tests
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Everything napt_interface.cpp starts and stops that needs lwIP
+ *     internals. The DNS message, cache, stats and channel modules are the
+ *     real ones.
+ ***************************************************************************************/
+
+#include "napt_internal.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+uint32_t napt_now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+esp_err_t napt_fwd_start(esp_netif_t *ap, esp_netif_t *sta) { return ESP_OK; }
+void napt_fwd_stop(void) {}
+bool napt_fwd_active(void) { return false; }
+void napt_fwd_set_paused(bool paused) {}
+
+void napt_capacity_start(void) {}
+void napt_capacity_stop(void) {}
+void napt_qos_start(void) {}
+void napt_qos_stop(void) {}
+void napt_hitters_start(void) {}
+void napt_hitters_stop(void) {}
+void napt_reflector_start(void) {}
+void napt_reflector_stop(void) {}
+void napt_stations_start(esp_netif_t *ap) {}
+void napt_stations_stop(void) {}
+void napt_stations_join(const uint8_t *mac, uint8_t aid) {}
+void napt_stations_leave(const uint8_t *mac) {}
+
+void napt_dns_snoop_response(uint32_t client, const uint8_t *msg, int len) {}
+
+bool napt_ntp_open(const hotspot_config_t *config) { return false; }
+void napt_ntp_close(void) {}
+void napt_ntp_fd_set(fd_set *fds, int *maxfd) {}
+void napt_ntp_on_select(const fd_set *fds) {}
+// A test sets this to hold the forwarder task in its loop, as a stuck one would be
+volatile uint32_t host_ntp_tick_stall_ms = 0;
+
+uint32_t napt_ntp_tick(void)
+{
+    if (host_ntp_tick_stall_ms != 0) {
+        vTaskDelay(pdMS_TO_TICKS(host_ntp_tick_stall_ms));
+    }
+    return UINT32_MAX;
+}
+
+esp_err_t napt_dhcps_start(esp_netif_t *ap, const hotspot_config_t *config) { return ESP_OK; }
+void napt_dhcps_stop(void) {}
+
+void napt_arp_station(const uint8_t *mac, bool joined) {}
+void napt_arp_clear(void) {}
+
+void napt_admission_configure(const hotspot_config_t *config) {}
+hotspot_reject_reason_t napt_admission_check(void) { return HOTSPOT_REJECT_NONE; }
+
+void napt_profile_apply(hotspot_wifi_profile_t profile) {}
+void napt_profile_restore(void) {}
+bool napt_profile_ap_ht20(hotspot_wifi_profile_t profile) { return false; }
+uint8_t napt_profile_dtim(hotspot_wifi_profile_t profile) { return 1; }
@@ -0,0 +1,345 @@
+/***************************************************************************************
+ *  File        : test_ack_lane_sim.cpp
+ *  Description : Download throughput during a concurrent upload, with and without the ACK lane
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - One client uploads in bulk and downloads at the same time over an
+ *     asymmetric uplink (2 Mbit/s up, 20 Mbit/s down). The download's ACKs
+ *     share the STA transmit path with the upload, so their queueing delay
+ *     sets the download's round trip and, with a fixed window, its rate.
+ *   - The STA driver has a few TX buffers; when they are full the frame goes
+ *     to QoS (driver_busy), as in napt_fwd.cpp. The scheduler task's loop
+ *     is driven from the simulation through qos_next()/qos_sent().
+ *   - Virtual time, repeatable.
+ ***************************************************************************************/
+
+#include <deque>
+#include <memory>
+#include "napt_qos.cpp"
+#include "host_test.h"
+#include "sim_net.h"
+
+#define UPLINK_BPS 2000000
+#define DOWNLINK_BPS 20000000
+#define ONE_WAY_US 15000            // Router <-> server, each way
+#define DRIVER_TX_BUFFERS 4
+#define UPLOAD_WINDOW 64            // Segments
+#define DOWNLOAD_WINDOW 44          // Segments (64 KB)
+#define WARMUP_US 2000000
+#define MEASURE_US 10000000
+
+// ============================================================================
+// STAND-INS FOR THE REST OF THE COMPONENT
+// ============================================================================
+void napt_ctl_lock(void)
+{
+}
+
+void napt_ctl_unlock(void)
+{
+}
+
+bool napt_fwd_active(void)
+{
+    return true;
+}
+
+// No estimate: the shaper stays open and queues form at the driver
+esp_err_t hotspot_get_uplink_capacity(hotspot_capacity_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    return ESP_OK;
+}
+
+// ============================================================================
+// NETWORK
+// ============================================================================
+static std::unique_ptr<sim_events> events;
+
+static const uint32_t client_addr = htonl(0x0a000002);      // STA address after NAT
+static const uint32_t server_addr = htonl(0xc6336401);      // 198.51.100.1
+#define UPLOAD_PORT 5001
+#define DOWNLOAD_PORT 443
+#define CLIENT_PORT 40000
+
+typedef struct {
+    uint32_t next_seq;      // Next segment to send
+    uint32_t acked;         // Highest cumulative ACK received
+    uint64_t acked_bytes;   // Goodput since the start of the measurement
+    uint32_t unacked_rx;    // Receiver: segments since the last ACK sent (delayed ACK every 2)
+    uint32_t received;      // Receiver: next expected sequence number
+} tcp_state_t;
+
+static tcp_state_t upload;
+static tcp_state_t download;
+static bool measuring = false;
+
+static std::deque<struct pbuf *> driver_tx;
+static bool driver_busy = false;
+static bool qos_wake_pending = false;
+static uint32_t uplink_drops = 0;
+
+static void server_rx(const sim_tcp_seg_t *seg);
+static void upload_send(void);
+static void qos_pump(void);
+
+static sim_tcp_seg_t frame_seg(struct pbuf *p)
+{
+    const uint8_t *ip = (const uint8_t *)p->payload + 14;
+    const uint8_t *tcp = ip + 20;
+    sim_tcp_seg_t seg = {};
+    memcpy(&seg.src, ip + 12, 4);
+    memcpy(&seg.dst, ip + 16, 4);
+    seg.sport = (uint16_t)(tcp[0] << 8 | tcp[1]);
+    seg.dport = (uint16_t)(tcp[2] << 8 | tcp[3]);
+    for (int i = 0; i < 4; i++) {
+        seg.seq = seg.seq << 8 | tcp[4 + i];
+        seg.ack = seg.ack << 8 | tcp[8 + i];
+    }
+    seg.flags = tcp[13];
+    seg.payload_len = (uint16_t)(p->tot_len - SIM_HEADERS);
+    return seg;
+}
+
+// STA driver: DRIVER_TX_BUFFERS frames, sent one after another at the uplink rate
+static void driver_start(void)
+{
+    if (driver_busy || driver_tx.empty()) {
+        return;
+    }
+    driver_busy = true;
+    int64_t serialize_us = (int64_t)driver_tx.front()->tot_len * 8 * 1000000 / UPLINK_BPS;
+    events->after(serialize_us, [] {
+        struct pbuf *p = driver_tx.front();
+        driver_tx.pop_front();
+        driver_busy = false;
+        driver_start();
+        sim_tcp_seg_t seg = frame_seg(p);
+        pbuf_free(p);
+        events->after(ONE_WAY_US, [seg] { server_rx(&seg); });
+    });
+}
+
+err_t napt_fwd_sta_transmit(struct pbuf *p)
+{
+    if (driver_tx.size() >= DRIVER_TX_BUFFERS) {
+        return ERR_MEM;
+    }
+    pbuf_ref(p);        // The driver copies the frame; a reference does here
+    driver_tx.push_back(p);
+    driver_start();
+    return ERR_OK;
+}
+
+// What the STA linkoutput hook does with a frame (napt_fwd.cpp)
+static void uplink_output(const sim_tcp_seg_t *seg)
+{
+    napt_pkt_t pkt;
+    struct pbuf *p = sim_tcp_frame(seg, &pkt);
+    if (!napt_qos_enqueue(&pkt, false)) {
+        err_t err = napt_fwd_sta_transmit(p);
+        if (err == ERR_MEM && napt_qos_enqueue(&pkt, true)) {
+            err = ERR_OK;
+        } else if (err == ERR_MEM) {
+            uplink_drops++;
+        }
+        napt_qos_bypass_done(&pkt, err);
+    }
+    pbuf_free(p);
+    qos_pump();     // Enqueueing notified the scheduler task
+}
+
+// The scheduler task's loop, one wakeup at a time
+static void qos_pump(void)
+{
+    if (qos_wake_pending) {
+        return;
+    }
+    for (;;) {
+        int lane;
+        uint16_t len;
+        uint32_t wait_us;
+        struct pbuf *p = qos_next(&lane, &len, &wait_us);
+        if (lane < 0) {
+            return;     // Sleeps until the next enqueue
+        }
+        int64_t sleep_us = 1000;        // One tick: vTaskDelay(1) or the shaper's minimum
+        if (p != NULL) {
+            if (qos_sent(p, lane, len, napt_fwd_sta_transmit(p))) {
+                continue;
+            }
+        } else if (wait_us / 1000 > 1) {
+            sleep_us = (int64_t)(wait_us / 1000) * 1000;
+        }
+        qos_wake_pending = true;
+        events->after(sleep_us, [] {
+            qos_wake_pending = false;
+            qos_pump();
+        });
+        return;
+    }
+}
+
+// Downlink to the client: not through QoS, never the bottleneck here
+static int64_t downlink_free_us = 0;
+
+static void client_rx(const sim_tcp_seg_t *seg)
+{
+    if (seg->dport != CLIENT_PORT || seg->sport != DOWNLOAD_PORT) {
+        // Server's ACK for the upload
+        if ((int32_t)(seg->ack - upload.acked) > 0) {
+            upload.acked = seg->ack;
+        }
+        upload_send();
+        return;
+    }
+    // Download data, always in order here: ACK every second segment
+    download.received = seg->seq + seg->payload_len;
+    if (++download.unacked_rx >= 2) {
+        download.unacked_rx = 0;
+        sim_tcp_seg_t ack = { client_addr, server_addr, CLIENT_PORT, DOWNLOAD_PORT, 1, download.received,
+                              NAPT_TCP_ACK, 0 };
+        uplink_output(&ack);
+    }
+}
+
+static void downlink_send(const sim_tcp_seg_t *seg)
+{
+    int64_t serialize_us = (int64_t)(SIM_HEADERS + seg->payload_len) * 8 * 1000000 / DOWNLINK_BPS;
+    int64_t start_us = downlink_free_us > sim_now_us() + ONE_WAY_US ? downlink_free_us : sim_now_us() + ONE_WAY_US;
+    downlink_free_us = start_us + serialize_us;
+    sim_tcp_seg_t copy = *seg;
+    events->at(downlink_free_us, [copy] { client_rx(&copy); });
+}
+
+static void download_send(void)
+{
+    while ((int32_t)(download.next_seq - download.acked) < DOWNLOAD_WINDOW * SIM_MSS) {
+        sim_tcp_seg_t seg = { server_addr, client_addr, DOWNLOAD_PORT, CLIENT_PORT, download.next_seq, 1,
+                              NAPT_TCP_ACK | NAPT_TCP_PSH, SIM_MSS };
+        download.next_seq += SIM_MSS;
+        downlink_send(&seg);
+    }
+}
+
+static void upload_send(void)
+{
+    // Segments lost in the uplink queue are resent once the window allows;
+    // the model just keeps the window full
+    while ((int32_t)(upload.next_seq - upload.acked) < UPLOAD_WINDOW * SIM_MSS) {
+        sim_tcp_seg_t seg = { client_addr, server_addr, CLIENT_PORT + 1, UPLOAD_PORT, upload.next_seq, 1,
+                              NAPT_TCP_ACK | NAPT_TCP_PSH, SIM_MSS };
+        upload.next_seq += SIM_MSS;
+        uplink_output(&seg);
+    }
+}
+
+static void server_rx(const sim_tcp_seg_t *seg)
+{
+    if (seg->dport == UPLOAD_PORT) {
+        if (measuring) {
+            upload.acked_bytes += seg->payload_len;     // Delivered, not just acknowledged
+        }
+        // Cumulative ACK for what arrived; a gap (tail drop) is treated as
+        // recovered straight away so the upload stays backlogged
+        sim_tcp_seg_t ack = { server_addr, client_addr, UPLOAD_PORT, CLIENT_PORT + 1, 1, seg->seq + seg->payload_len,
+                              NAPT_TCP_ACK, 0 };
+        downlink_send(&ack);
+        return;
+    }
+    if ((int32_t)(seg->ack - download.acked) > 0) {
+        if (measuring) {
+            download.acked_bytes += seg->ack - download.acked;
+        }
+        download.acked = seg->ack;
+    }
+    download_send();
+}
+
+// ============================================================================
+// RUN
+// ============================================================================
+typedef struct {
+    double download_bps;
+    double upload_bps;
+    hotspot_qos_stats_t stats;
+} run_result_t;
+
+static run_result_t run(bool prioritize_acks, bool ack_thinning)
+{
+    hotspot_qos_config_t config = HOTSPOT_QOS_CONFIG_DEFAULT();
+    config.prioritize_acks = prioritize_acks;
+    config.ack_thinning = ack_thinning;
+    CHECK(hotspot_qos_configure(&config) == ESP_OK);
+    CHECK(qos_running);
+
+    events.reset(new sim_events());
+    upload = tcp_state_t{ 1, 1, 0, 0, 0 };
+    download = tcp_state_t{ 1, 1, 0, 0, 1 };
+    downlink_free_us = 0;
+    uplink_drops = 0;
+    memset(&qos_stats, 0, sizeof(qos_stats));
+    measuring = false;
+
+    int64_t start_us = sim_now_us();
+    upload_send();
+    download_send();
+    events->run_until(start_us + WARMUP_US);
+    measuring = true;
+    events->run_until(start_us + WARMUP_US + MEASURE_US);
+
+    run_result_t r;
+    r.download_bps = download.acked_bytes * 8.0 * 1000000 / MEASURE_US;
+    r.upload_bps = upload.acked_bytes * 8.0 * 1000000 / MEASURE_US;
+    hotspot_qos_get_stats(&r.stats);
+
+    // Frames the driver pushed back are counted once, in the lane that
+    // queued them; the fast path counts nothing the driver did not take
+    CHECK(r.stats.driver_busy > 0);
+    CHECK(r.stats.ack_lane.sent_packets <= r.stats.ack_lane.enqueued_packets);
+    for (int i = 0; i < HOTSPOT_QOS_CLASS_MAX; i++) {
+        CHECK(r.stats.cls[i].sent_packets <= r.stats.cls[i].enqueued_packets);
+    }
+
+    // Stop: QoS drops its queue, the driver's buffers are released
+    config.enabled = false;
+    hotspot_qos_configure(&config);
+    while (!driver_tx.empty()) {
+        pbuf_free(driver_tx.front());
+        driver_tx.pop_front();
+    }
+    driver_busy = false;
+    qos_wake_pending = false;
+    events.reset();
+    return r;
+}
+
+int main(void)
+{
+    run_result_t fifo = run(false, false);
+    run_result_t lane = run(true, false);
+    run_result_t thin = run(true, true);
+
+    printf("                     download kbit/s  upload kbit/s  ACK lane pkts  thinned\n");
+    printf("no ACK lane          %15.0f  %13.0f  %13s  %7s\n", fifo.download_bps / 1000, fifo.upload_bps / 1000,
+           "-", "-");
+    printf("ACK lane             %15.0f  %13.0f  %13lu  %7lu\n", lane.download_bps / 1000, lane.upload_bps / 1000,
+           (unsigned long)lane.stats.ack_lane.sent_packets, (unsigned long)lane.stats.acks_thinned);
+    printf("ACK lane + thinning  %15.0f  %13.0f  %13lu  %7lu\n", thin.download_bps / 1000, thin.upload_bps / 1000,
+           (unsigned long)thin.stats.ack_lane.sent_packets, (unsigned long)thin.stats.acks_thinned);
+
+    // ACKs behind a full best-effort queue: about 64 frames at 2 Mbit/s,
+    // ~390 ms, which holds a 64 KB window under 2 Mbit/s
+    CHECK_MSG(lane.download_bps >= 4 * fifo.download_bps, "download %.0f bit/s with the lane, %.0f without",
+              lane.download_bps, fifo.download_bps);
+    CHECK_MSG(lane.upload_bps >= 0.8 * fifo.upload_bps, "upload %.0f bit/s with the lane, %.0f without",
+              lane.upload_bps, fifo.upload_bps);
+    CHECK(lane.stats.ack_lane.sent_packets > 0 && fifo.stats.ack_lane.sent_packets == 0);
+    CHECK(thin.download_bps >= 0.9 * lane.download_bps);
+    CHECK(sim_pbufs() == 0);
+    return TEST_RESULT();
+}
@@ -0,0 +1,161 @@
+/***************************************************************************************
+ *  File        : test_bringup.cpp
+ *  Description : Hotspot bring-up time against a scripted WiFi driver
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - The scripted driver posts WIFI_EVENT_AP_START a set time after the
+ *     switch to APSTA. Enabling must take about that long: not less (it
+ *     waited for the event), and not a fixed delay more.
+ *   - Built with HOTSPOT_AP_START_TIMEOUT_MS=300 for the no-event case.
+ *   - The event loop port runs its handlers in a task named "sys_evt", so
+ *     enabling from a handler is caught as on the target.
+ ***************************************************************************************/
+
+#include "napt_interface.cpp"
+#include "host_port.h"
+#include "host_test.h"
+
+#define SLACK_MS 100            // Scheduling noise on a loaded host; the old fixed waits were 1 s and more
+#define RUNS 5
+
+static host_wifi_params_t wifi_params(uint32_t ap_start_delay_ms)
+{
+    host_wifi_params_t wifi = {};
+    wifi.ap_start_delay_ms = ap_start_delay_ms;
+    wifi.sta_ip = htonl(0x0a000002);            // 10.0.0.2
+    wifi.sta_dns = htonl(INADDR_LOOPBACK);
+    wifi.sta_channel = 6;
+    return wifi;
+}
+
+static int64_t enable_ms(esp_err_t *err)
+{
+    int64_t start_us = esp_timer_get_time();
+    *err = hotspot_enable(NULL, NULL);
+    return (esp_timer_get_time() - start_us) / 1000;
+}
+
+// Enable time follows the driver's AP start, whatever it is
+static void test_follows_event(uint32_t delay_ms)
+{
+    host_wifi_params_t wifi = wifi_params(delay_ms);
+    host_wifi_reset(&wifi);
+
+    int64_t worst_ms = 0;
+    for (int i = 0; i < RUNS; i++) {
+        esp_err_t err;
+        int64_t took_ms = enable_ms(&err);
+        CHECK(err == ESP_OK);
+        CHECK(hotspot_get_state() == HOTSPOT_STATE_RUNNING);
+        CHECK_MSG(took_ms >= delay_ms, "enabled in %lld ms, before the AP started (%u ms)", (long long)took_ms,
+                  (unsigned)delay_ms);
+        if (took_ms > worst_ms) {
+            worst_ms = took_ms;
+        }
+        CHECK(hotspot_disable() == ESP_OK);
+    }
+    printf("AP start after %u ms: enable worst %lld ms\n", (unsigned)delay_ms, (long long)worst_ms);
+    CHECK_MSG(worst_ms < delay_ms + SLACK_MS, "enable worst %lld ms, AP start %u ms", (long long)worst_ms,
+              (unsigned)delay_ms);
+}
+
+// APSTA left on by the application: the AP is already up and no
+// WIFI_EVENT_AP_START will come
+static void test_ap_already_up(void)
+{
+    host_wifi_params_t wifi = wifi_params(0);
+    host_wifi_reset(&wifi);
+    esp_wifi_set_mode(WIFI_MODE_APSTA);
+    vTaskDelay(20);
+
+    esp_err_t err;
+    int64_t took_ms = enable_ms(&err);
+    printf("AP already up: enable %lld ms\n", (long long)took_ms);
+    CHECK(err == ESP_OK);
+    CHECK_MSG(took_ms < SLACK_MS, "enable %lld ms", (long long)took_ms);
+    CHECK(hotspot_disable() == ESP_OK);
+}
+
+// The AP never starts: enable gives up after HOTSPOT_AP_START_TIMEOUT_MS and
+// leaves nothing behind
+static void test_ap_never_starts(void)
+{
+    host_wifi_params_t wifi = wifi_params(UINT32_MAX);
+    host_wifi_reset(&wifi);
+    int fds_before = host_open_fds();
+
+    esp_err_t err;
+    int64_t took_ms = enable_ms(&err);
+    printf("AP never starts: enable failed after %lld ms\n", (long long)took_ms);
+    CHECK(err == ESP_ERR_TIMEOUT);
+    CHECK(took_ms >= HOTSPOT_AP_START_TIMEOUT_MS && took_ms < HOTSPOT_AP_START_TIMEOUT_MS + SLACK_MS);
+    CHECK(hotspot_get_state() == HOTSPOT_STATE_STOPPED);
+    CHECK(dns_forwarder_task_handle == NULL);
+    wifi_mode_t mode;
+    esp_wifi_get_mode(&mode);
+    CHECK(mode == WIFI_MODE_STA);
+    CHECK_MSG(host_open_fds() == fds_before, "%d fds open, %d before", host_open_fds(), fds_before);
+
+    // And a later attempt with a working driver succeeds
+    wifi = wifi_params(10);
+    host_wifi_reset(&wifi);
+    CHECK(hotspot_enable(NULL, NULL) == ESP_OK);
+    CHECK(hotspot_disable() == ESP_OK);
+}
+
+// Enabling from a handler on the default event loop, as an application
+// would on IP_EVENT_STA_GOT_IP: the blocking call is refused at once, the
+// async one goes through
+static std::atomic<esp_err_t> handler_err(ESP_FAIL);
+static std::atomic<int64_t> handler_ms(-1);
+static std::atomic<esp_err_t> async_err(ESP_FAIL);
+static std::atomic<bool> async_done(false);
+
+static void on_enabled(esp_err_t result, void *arg)
+{
+    async_err = result;
+    async_done = true;
+}
+
+static void got_ip_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    esp_err_t err;
+    handler_ms = enable_ms(&err);
+    handler_err = err;
+    hotspot_enable_async(NULL, NULL, on_enabled, NULL);
+}
+
+static void test_enable_from_event_loop(void)
+{
+    host_wifi_params_t wifi = wifi_params(40);
+    host_wifi_reset(&wifi);
+    esp_event_handler_instance_t instance;
+    esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, got_ip_handler, NULL, &instance);
+    esp_event_post(IP_EVENT, IP_EVENT_STA_GOT_IP, NULL, 0, 0);
+    for (int i = 0; i < 100 && !async_done; i++) {
+        vTaskDelay(10);
+    }
+    esp_event_handler_instance_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, instance);
+
+    printf("Enable from the event loop: %s in %lld ms, async %s\n", esp_err_to_name(handler_err),
+           (long long)handler_ms, esp_err_to_name(async_err));
+    CHECK(handler_err == ESP_ERR_INVALID_STATE);
+    CHECK_MSG(handler_ms >= 0 && handler_ms < SLACK_MS, "refused after %lld ms", (long long)handler_ms);
+    CHECK(async_done && async_err == ESP_OK);
+    CHECK(hotspot_get_state() == HOTSPOT_STATE_RUNNING);
+    CHECK(hotspot_disable() == ESP_OK);
+}
+
+int main(void)
+{
+    test_follows_event(40);
+    test_follows_event(150);
+    test_ap_already_up();
+    test_ap_never_starts();
+    test_enable_from_event_loop();
+    return TEST_RESULT();
+}
@@ -0,0 +1,220 @@
+/***************************************************************************************
+ *  File        : test_capacity_sim.cpp
+ *  Description : Uplink capacity estimator against a simulated variable-rate link
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Two AIMD TCP uploads cross the hotspot into a drop-tail bottleneck
+ *     behind the router whose rate changes every 20 s, then go quiet. The
+ *     estimator only sees their segments (STA_OUT) and ACKs (STA_IN).
+ *   - Virtual time: the 80 s run takes well under a second.
+ ***************************************************************************************/
+
+#include <deque>
+#include "napt_capacity.cpp"
+#include "host_test.h"
+#include "sim_net.h"
+
+ESP_EVENT_DEFINE_BASE(HOTSPOT_EVENT);
+
+bool is_hotspot_enabled(void)
+{
+    return true;
+}
+
+#define BASE_RTT_US 40000
+#define LINK_BUFFER 64          // Packets queued at the bottleneck before tail drop
+#define FLOWS 2
+#define TOLERANCE_PERCENT 20
+
+typedef struct {
+    int64_t start_us;
+    uint32_t rate_bps;          // 0 = senders idle, the estimate must hold the last rate
+    int64_t settle_limit_us;    // Time allowed to get (and stay) within TOLERANCE_PERCENT
+} phase_t;
+
+static const phase_t phases[] = {
+    { 0, 8000000, 3000000 },
+    { 20000000, 2000000, 11000000 },    // Old maximum ages out of the 10 s window
+    { 40000000, 12000000, 3000000 },
+    { 60000000, 0, 11000000 },          // Idle: the estimate settles, then stays
+};
+#define PHASES (sizeof(phases) / sizeof(phases[0]))
+#define RUN_US 80000000
+
+// ============================================================================
+// NETWORK
+// ============================================================================
+// client -> [hotspot, STA_OUT] -> bottleneck queue -> server
+// server -> ACK after the base RTT -> [hotspot, STA_IN]
+typedef struct {
+    uint32_t next_seq;
+    double cwnd;
+    double ssthresh;
+    uint32_t inflight;
+    int64_t recovery_until_us;  // One window reduction per round trip
+} tcp_flow_t;
+
+typedef struct {
+    int flow;
+    uint32_t seq_end;
+    uint16_t bytes;
+} link_pkt_t;
+
+static sim_events events;
+static tcp_flow_t flows[FLOWS];
+static std::deque<link_pkt_t> link_queue;
+static bool link_busy = false;
+static uint32_t link_rate_bps = 0;
+static bool senders_active = true;
+
+static const uint32_t client_addr = htonl(0x0a000002);      // STA address after NAT
+static const uint32_t server_addr = htonl(0xc6336401);      // 198.51.100.1
+
+static void flow_send(int f);
+
+static void link_start(void)
+{
+    if (link_busy || link_queue.empty()) {
+        return;
+    }
+    link_busy = true;
+    link_pkt_t pkt = link_queue.front();
+    int64_t serialize_us = (int64_t)pkt.bytes * 8 * 1000000 / link_rate_bps;
+    events.after(serialize_us, [] {
+        link_pkt_t done = link_queue.front();
+        link_queue.pop_front();
+        link_busy = false;
+        link_start();
+
+        events.after(BASE_RTT_US, [done] {
+            tcp_flow_t *fl = &flows[done.flow];
+            sim_tcp_seg_t seg = { server_addr, client_addr, 443, (uint16_t)(50000 + done.flow), 1,
+                                  done.seq_end, NAPT_TCP_ACK, 0 };
+            napt_pkt_t pkt;
+            struct pbuf *p = sim_tcp_frame(&seg, &pkt);
+            napt_capacity_on_packet(NAPT_HOOK_STA_IN, &pkt);
+            pbuf_free(p);
+
+            fl->inflight--;
+            fl->cwnd += fl->cwnd < fl->ssthresh ? 1.0 : 1.0 / fl->cwnd;
+            flow_send(done.flow);
+        });
+    });
+}
+
+static void flow_send(int f)
+{
+    tcp_flow_t *fl = &flows[f];
+    while (senders_active && fl->inflight < (uint32_t)fl->cwnd) {
+        sim_tcp_seg_t seg = { client_addr, server_addr, (uint16_t)(50000 + f), 443, fl->next_seq, 1,
+                              NAPT_TCP_ACK | NAPT_TCP_PSH, SIM_MSS };
+        napt_pkt_t pkt;
+        struct pbuf *p = sim_tcp_frame(&seg, &pkt);
+        napt_capacity_on_packet(NAPT_HOOK_STA_OUT, &pkt);
+        pbuf_free(p);
+
+        fl->next_seq += SIM_MSS;
+        fl->inflight++;
+        if (link_queue.size() < LINK_BUFFER) {
+            link_queue.push_back(link_pkt_t{f, fl->next_seq, (uint16_t)(SIM_HEADERS + SIM_MSS)});
+            link_start();
+            continue;
+        }
+        // Tail drop: the sender finds out about a round trip later, halves
+        // its window and retransmits (the retransmission is a new segment)
+        events.after(BASE_RTT_US, [f] {
+            tcp_flow_t *fl = &flows[f];
+            fl->inflight--;
+            if (sim_now_us() >= fl->recovery_until_us) {
+                fl->ssthresh = fl->cwnd / 2 > 2 ? fl->cwnd / 2 : 2;
+                fl->cwnd = fl->ssthresh;
+                fl->recovery_until_us = sim_now_us() + BASE_RTT_US * 2;
+            }
+            flow_send(f);
+        });
+    }
+}
+
+// ============================================================================
+// RUN
+// ============================================================================
+static int capacity_events = 0;
+
+static void on_capacity(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    capacity_events++;
+}
+
+static uint32_t estimate_bps(void)
+{
+    hotspot_capacity_t cap;
+    hotspot_get_uplink_capacity(&cap);
+    return cap.uplink_bps;
+}
+
+static bool within(uint32_t value, uint32_t target)
+{
+    uint64_t diff = value > target ? value - target : target - value;
+    return diff * 100 <= (uint64_t)target * TOLERANCE_PERCENT;
+}
+
+int main(void)
+{
+    esp_event_handler_register(HOTSPOT_EVENT, HOTSPOT_EVENT_UPLINK_CAPACITY, on_capacity, NULL);
+    napt_capacity_start();
+
+    for (int f = 0; f < FLOWS; f++) {
+        flows[f] = tcp_flow_t{ 1, 10, 1e9, 0, 0 };
+    }
+
+    printf("phase  link kbit/s  settled after  estimate at end\n");
+    uint32_t held_bps = 0;
+    for (size_t i = 0; i < PHASES; i++) {
+        const phase_t *ph = &phases[i];
+        int64_t end_us = i + 1 < PHASES ? phases[i + 1].start_us : RUN_US;
+        if (ph->rate_bps != 0) {
+            link_rate_bps = ph->rate_bps;
+        } else {
+            senders_active = false;
+            held_bps = link_rate_bps;
+        }
+        for (int f = 0; f < FLOWS; f++) {
+            flow_send(f);
+        }
+
+        // Sample at every estimator tick; settled = within tolerance from
+        // then on until the end of the phase
+        int64_t settled_us = -1;
+        for (int64_t t = ph->start_us; t < end_us; t += HOTSPOT_CAPACITY_INTERVAL_MS * 1000) {
+            events.run_until(t + HOTSPOT_CAPACITY_INTERVAL_MS * 1000);
+            bool ok = within(estimate_bps(), ph->rate_bps != 0 ? ph->rate_bps : held_bps);
+            if (!ok) {
+                settled_us = -1;
+            } else if (settled_us < 0) {
+                settled_us = sim_now_us() - ph->start_us;
+            }
+        }
+
+        printf("%5u  %11lu  %10.2f s  %15lu\n", (unsigned)i, (unsigned long)(ph->rate_bps / 1000),
+               settled_us >= 0 ? settled_us / 1e6 : -1.0, (unsigned long)(estimate_bps() / 1000));
+        CHECK_MSG(settled_us >= 0 && settled_us <= ph->settle_limit_us,
+                  "phase %u: %lu kbit/s link, estimate %lu kbit/s, settled after %lld us", (unsigned)i,
+                  (unsigned long)(ph->rate_bps / 1000), (unsigned long)(estimate_bps() / 1000),
+                  (long long)settled_us);
+    }
+
+    hotspot_capacity_t cap;
+    hotspot_get_uplink_capacity(&cap);
+    printf("%d capacity events, %lu RTT samples, min RTT %lu us\n", capacity_events,
+           (unsigned long)cap.rtt_samples, (unsigned long)cap.min_rtt_us);
+    CHECK(cap.source == HOTSPOT_CAPACITY_SOURCE_SATURATED);
+    CHECK(capacity_events >= 3 && capacity_events <= 40);
+    CHECK(sim_pbufs() == 0);
+
+    napt_capacity_stop();
+    return TEST_RESULT();
+}
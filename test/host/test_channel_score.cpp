@@ -0,0 +1,182 @@
+/***************************************************************************************
+ *  File        : test_channel_score.cpp
+ *  Description : Channel scoring and picking against scan results
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Scans are given as channel_scan_pick() hands them over: primary
+ *     channel, secondary position and RSSI of each BSS.
+ *   - Picks are made as the hotspot makes them, among 1, 6 and 11.
+ ***************************************************************************************/
+
+#include "napt_channel.cpp"
+#include "host_test.h"
+
+#define COUNT(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+static uint8_t pick(const napt_scan_bss_t *bss, int count, uint8_t current, uint32_t scores[NAPT_CHANNEL_MAX + 1])
+{
+    napt_channel_score(bss, count, scores);
+    return napt_channel_pick(scores, NAPT_CHANNEL_MASK_NON_OVERLAPPING, current);
+}
+
+static void print_scores(const char *name, const uint32_t scores[NAPT_CHANNEL_MAX + 1])
+{
+    printf("%-22s", name);
+    for (int ch = 1; ch <= NAPT_CHANNEL_MAX; ch++) {
+        printf(" %4lu", (unsigned long)scores[ch]);
+    }
+    printf("\n");
+}
+
+// ============================================================================
+// SCANS
+// ============================================================================
+// Five routers on the default channel 1, one weak one on 11, nothing on 6
+static const napt_scan_bss_t crowded_1[] = {
+    { 1, NAPT_CHANNEL_SECOND_NONE, -48 },
+    { 1, NAPT_CHANNEL_SECOND_NONE, -61 },
+    { 1, NAPT_CHANNEL_SECOND_NONE, -67 },
+    { 1, NAPT_CHANNEL_SECOND_NONE, -74 },
+    { 2, NAPT_CHANNEL_SECOND_NONE, -80 },
+    { 11, NAPT_CHANNEL_SECOND_NONE, -86 },
+};
+
+// One strong HT40+ BSS on 1 (secondary block on 5) and a weak one on 11
+static const napt_scan_bss_t ht40_above[] = {
+    { 1, NAPT_CHANNEL_SECOND_ABOVE, -45 },
+    { 11, NAPT_CHANNEL_SECOND_NONE, -80 },
+};
+
+// The same BSS seen as 20 MHz only
+static const napt_scan_bss_t ht20_same[] = {
+    { 1, NAPT_CHANNEL_SECOND_NONE, -45 },
+    { 11, NAPT_CHANNEL_SECOND_NONE, -80 },
+};
+
+// HT40- on 11 loads 7, which 6 overlaps; the BSS on 1 is weak
+static const napt_scan_bss_t ht40_below[] = {
+    { 11, NAPT_CHANNEL_SECOND_BELOW, -50 },
+    { 1, NAPT_CHANNEL_SECOND_NONE, -88 },
+};
+
+// ============================================================================
+// TESTS
+// ============================================================================
+static void test_crowded_channel(void)
+{
+    uint32_t scores[NAPT_CHANNEL_MAX + 1];
+    CHECK(pick(crowded_1, COUNT(crowded_1), 1, scores) == 6);
+    print_scores("crowded 1", scores);
+    CHECK(scores[6] < scores[11] && scores[11] < scores[1]);
+
+    // Co-channel networks cost their penalty even when weak
+    CHECK(scores[11] >= NAPT_CHANNEL_BSS_PENALTY);
+    // 6 only gets the edge of the BSS on 2, four channels away
+    CHECK(scores[6] == (uint32_t)(-80 + 100 + 1) * 1);
+
+    // Without a current channel (first enable) the best one is taken
+    CHECK(pick(crowded_1, COUNT(crowded_1), 0, scores) == 6);
+}
+
+static void test_ht40_secondary(void)
+{
+    uint32_t scores[NAPT_CHANNEL_MAX + 1];
+    uint32_t ht20[NAPT_CHANNEL_MAX + 1];
+
+    CHECK(pick(ht20_same, COUNT(ht20_same), 0, ht20) == 6);
+    CHECK(pick(ht40_above, COUNT(ht40_above), 0, scores) == 11);
+    print_scores("HT40+ on 1", scores);
+    print_scores("same BSS at HT20", ht20);
+
+    // The secondary block is centred four above the primary, and weighs
+    // what the primary does
+    CHECK(ht20[6] == 0);
+    CHECK(scores[5] - ht20[5] == (uint32_t)(-45 + 100 + 1) * 5);
+    CHECK(scores[6] - ht20[6] == (uint32_t)(-45 + 100 + 1) * 4);
+    CHECK(scores[1] == ht20[1] + (uint32_t)(-45 + 100 + 1));
+
+    CHECK(pick(ht40_below, COUNT(ht40_below), 0, scores) == 1);
+    print_scores("HT40- on 11", scores);
+    CHECK(scores[6] > scores[1]);
+}
+
+static void test_rssi_clamp(void)
+{
+    uint32_t high[NAPT_CHANNEL_MAX + 1];
+    uint32_t zero[NAPT_CHANNEL_MAX + 1];
+    uint32_t low[NAPT_CHANNEL_MAX + 1];
+    uint32_t floor[NAPT_CHANNEL_MAX + 1];
+
+    // Out-of-range readings count as the nearest valid one
+    const napt_scan_bss_t bogus_high[] = { { 6, NAPT_CHANNEL_SECOND_NONE, 20 } };
+    const napt_scan_bss_t at_zero[] = { { 6, NAPT_CHANNEL_SECOND_NONE, 0 } };
+    const napt_scan_bss_t bogus_low[] = { { 6, NAPT_CHANNEL_SECOND_NONE, -128 } };
+    const napt_scan_bss_t at_floor[] = { { 6, NAPT_CHANNEL_SECOND_NONE, -100 } };
+    napt_channel_score(bogus_high, 1, high);
+    napt_channel_score(at_zero, 1, zero);
+    napt_channel_score(bogus_low, 1, low);
+    napt_channel_score(at_floor, 1, floor);
+    CHECK(memcmp(high, zero, sizeof(high)) == 0);
+    CHECK(memcmp(low, floor, sizeof(low)) == 0);
+    CHECK(zero[6] == 101 * 5 + NAPT_CHANNEL_BSS_PENALTY);
+    CHECK(floor[6] == 1 * 5 + NAPT_CHANNEL_BSS_PENALTY);
+
+    // Primaries outside 1..13 are skipped
+    const napt_scan_bss_t off_band[] = { { 0, NAPT_CHANNEL_SECOND_NONE, -40 }, { 14, NAPT_CHANNEL_SECOND_NONE, -40 } };
+    napt_channel_score(off_band, COUNT(off_band), low);
+    for (int ch = 1; ch <= NAPT_CHANNEL_MAX; ch++) {
+        CHECK(low[ch] == 0);
+    }
+}
+
+static void test_hysteresis(void)
+{
+    uint32_t scores[NAPT_CHANNEL_MAX + 1] = {};
+    scores[1] = 500;
+    scores[6] = 100;
+
+    // Gain under 20%: stay
+    scores[11] = 81;
+    CHECK(napt_channel_pick(scores, NAPT_CHANNEL_MASK_NON_OVERLAPPING, 6) == 6);
+    // Exactly 20% is not enough either
+    scores[11] = 80;
+    CHECK(napt_channel_pick(scores, NAPT_CHANNEL_MASK_NON_OVERLAPPING, 6) == 6);
+    // Over 20%: move
+    scores[11] = 79;
+    CHECK(napt_channel_pick(scores, NAPT_CHANNEL_MASK_NON_OVERLAPPING, 6) == 11);
+
+    // A current channel outside the candidates is always left
+    scores[11] = 99;
+    CHECK(napt_channel_pick(scores, NAPT_CHANNEL_MASK_NON_OVERLAPPING, 3) == 11);
+    // No candidates: keep what we have
+    CHECK(napt_channel_pick(scores, 0, 3) == 3);
+
+    // From a scan: 11 is a little quieter than 6, not enough to move clients
+    const napt_scan_bss_t close_call[] = {
+        { 6, NAPT_CHANNEL_SECOND_NONE, -88 },
+        { 11, NAPT_CHANNEL_SECOND_NONE, -90 },
+        { 1, NAPT_CHANNEL_SECOND_NONE, -55 },
+    };
+    CHECK(pick(close_call, COUNT(close_call), 6, scores) == 6);
+    print_scores("6 against 11", scores);
+    CHECK(scores[11] < scores[6]);
+    CHECK(pick(close_call, COUNT(close_call), 0, scores) == 11);
+}
+
+int main(void)
+{
+    printf("%-22s", "scores");
+    for (int ch = 1; ch <= NAPT_CHANNEL_MAX; ch++) {
+        printf(" %4d", ch);
+    }
+    printf("\n");
+    test_crowded_channel();
+    test_ht40_secondary();
+    test_rssi_clamp();
+    test_hysteresis();
+    return TEST_RESULT();
+}
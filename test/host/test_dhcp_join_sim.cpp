@@ -0,0 +1,408 @@
+/***************************************************************************************
+ *  File        : test_dhcp_join_sim.cpp
+ *  Description : Join-to-address latency against a scripted DHCP client, with and without Rapid Commit
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Twelve clients associate within half a second of each other (an AP
+ *     restart) and run the RFC 2131 client state machine against the real
+ *     server: request_parse(), lease allocation, reply_build(). Every client
+ *     asks for Rapid Commit; the server grants it or not.
+ *   - Each frame spends a random 2..12 ms on the air and is lost with a
+ *     given probability; clients retransmit after 4 s, doubling (RFC 2131
+ *     4.1). Two messages instead of four means half the air time and half
+ *     the chances to lose one.
+ *   - Virtual time, repeatable. The server's own processing time is not
+ *     modelled; on the target it is tens of microseconds.
+ ***************************************************************************************/
+
+#include <memory>
+#include <vector>
+#include "napt_dhcps.cpp"
+#include "host_test.h"
+#include "sim_net.h"
+
+#define CLIENTS 12
+#define JOIN_SPREAD_US 500000       // Association times spread over this
+#define AIR_MIN_US 2000
+#define AIR_MAX_US 12000
+#define RETRANSMIT_US 4000000       // First retransmission, doubling up to 64 s
+#define RUN_US 120000000
+
+// ============================================================================
+// STAND-INS FOR LWIP AND THE REST OF THE COMPONENT
+// ============================================================================
+ESP_EVENT_DEFINE_BASE(IP_EVENT);
+const ip_addr_t ip_addr_any = {};
+const ip_addr_t ip_addr_broadcast = {};
+
+struct udp_pcb {
+    udp_recv_fn recv;
+    void *arg;
+};
+
+static struct netif ap_netif;
+static struct udp_pcb server_pcb;
+static bool server_open = false;
+static int arp_pins = 0;
+
+void *esp_netif_get_netif_impl(esp_netif_t *netif)
+{
+    return &ap_netif;
+}
+
+err_t tcpip_callback(tcpip_callback_fn fn, void *ctx)
+{
+    fn(ctx);
+    return ERR_OK;
+}
+
+esp_err_t napt_ctl_post(void (*fn)(void))
+{
+    fn();
+    return ESP_OK;
+}
+
+struct udp_pcb *udp_new(void)
+{
+    server_open = true;
+    return &server_pcb;
+}
+
+void udp_remove(struct udp_pcb *pcb)
+{
+    server_open = false;
+}
+
+err_t udp_bind(struct udp_pcb *pcb, const ip_addr_t *addr, uint16_t port)
+{
+    return ERR_OK;
+}
+
+void udp_bind_netif(struct udp_pcb *pcb, const struct netif *nif)
+{
+}
+
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn fn, void *arg)
+{
+    pcb->recv = fn;
+    pcb->arg = arg;
+}
+
+void napt_stations_dhcp(const uint8_t *mac, hotspot_join_event_t ev)
+{
+}
+
+void napt_arp_pin(uint32_t ip, const uint8_t *mac)
+{
+    arp_pins++;
+}
+
+void napt_arp_unpin_ip(uint32_t ip)
+{
+}
+
+uint8_t napt_arp_pinned(void)
+{
+    return (uint8_t)arp_pins;
+}
+
+// One blob is all the server keeps
+static std::vector<uint8_t> nvs_blob;
+
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *out)
+{
+    *out = 1;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t nvs)
+{
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t nvs, const char *key, void *out, size_t *len)
+{
+    if (nvs_blob.empty() || *len < nvs_blob.size()) {
+        return ESP_FAIL;
+    }
+    memcpy(out, nvs_blob.data(), nvs_blob.size());
+    *len = nvs_blob.size();
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t nvs, const char *key, const void *value, size_t len)
+{
+    nvs_blob.assign((const uint8_t *)value, (const uint8_t *)value + len);
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t nvs)
+{
+    return ESP_OK;
+}
+
+// ============================================================================
+// AIR
+// ============================================================================
+static std::unique_ptr<sim_events> events;
+static uint32_t rng_state;
+static int loss_percent;
+static int frames_on_air;
+
+static uint32_t rng(void)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state >> 8;
+}
+
+typedef std::shared_ptr<std::vector<uint8_t>> frame_t;
+
+// Calls deliver after the frame's air time, unless it is lost
+static void air_send(const frame_t &frame, void (*deliver)(const frame_t &))
+{
+    frames_on_air++;
+    int64_t air_us = AIR_MIN_US + (int64_t)(rng() % (AIR_MAX_US - AIR_MIN_US));
+    if ((int)(rng() % 100) < loss_percent) {
+        return;
+    }
+    events->after(air_us, [frame, deliver] { deliver(frame); });
+}
+
+static void server_deliver(const frame_t &frame)
+{
+    if (!server_open) {
+        return;
+    }
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, (uint16_t)frame->size(), PBUF_RAM);
+    pbuf_take(p, frame->data(), (uint16_t)frame->size());
+    server_pcb.recv(server_pcb.arg, &server_pcb, p, IP_ADDR_ANY, DHCP_CLIENT_PORT);
+}
+
+static void clients_deliver(const frame_t &frame);
+
+// Every reply goes to every client, as a broadcast would; each one filters
+// on xid and chaddr
+err_t udp_sendto_if(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst, uint16_t port, struct netif *nif)
+{
+    frame_t frame = std::make_shared<std::vector<uint8_t>>(p->tot_len);
+    pbuf_copy_partial(p, frame->data(), p->tot_len, 0);
+    air_send(frame, clients_deliver);
+    return ERR_OK;
+}
+
+// ============================================================================
+// CLIENTS
+// ============================================================================
+typedef enum {
+    CLIENT_SELECTING = 0,       // DISCOVER sent
+    CLIENT_REQUESTING,          // REQUEST sent after an OFFER
+    CLIENT_BOUND,
+} client_state_t;
+
+typedef struct {
+    uint8_t mac[6];
+    uint32_t xid;
+    client_state_t state;
+    uint32_t offered_ip;        // Network order
+    uint32_t server_id;
+    uint32_t ip;
+    int64_t join_us;            // Association
+    int64_t bound_us;
+    int64_t backoff_us;
+    uint32_t timer_gen;         // Stale retransmission timers do nothing
+} sim_client_t;
+
+static sim_client_t clients[CLIENTS];
+
+static frame_t client_message(const sim_client_t *c, uint8_t type)
+{
+    frame_t frame = std::make_shared<std::vector<uint8_t>>(BOOTP_MIN_LEN);
+    uint8_t *m = frame->data();
+    m[0] = 1;
+    m[1] = 1;
+    m[2] = 6;
+    for (int i = 0; i < 4; i++) {
+        m[4 + i] = (uint8_t)(c->xid >> (24 - 8 * i));
+    }
+    memcpy(m + 28, c->mac, 6);
+    memcpy(m + 236, DHCP_MAGIC, sizeof(DHCP_MAGIC));
+    uint8_t *o = m + DHCP_OPTIONS_OFS;
+    o = put_option(o, OPT_MSG_TYPE, &type, 1);
+    if (type == DHCPDISCOVER) {
+        *o++ = OPT_RAPID_COMMIT;
+        *o++ = 0;
+    } else {
+        o = put_option(o, OPT_REQUESTED_IP, &c->offered_ip, 4);
+        o = put_option(o, OPT_SERVER_ID, &c->server_id, 4);
+    }
+    *o = OPT_END;
+    return frame;
+}
+
+static void client_transmit(sim_client_t *c)
+{
+    air_send(client_message(c, c->state == CLIENT_SELECTING ? DHCPDISCOVER : DHCPREQUEST), server_deliver);
+    uint32_t gen = ++c->timer_gen;
+    int64_t delay_us = c->backoff_us - 1000000 + (int64_t)(rng() % 2000000);   // +-1 s
+    events->after(delay_us, [c, gen] {
+        if (c->timer_gen == gen && c->state != CLIENT_BOUND) {
+            if (c->backoff_us < 64000000) {
+                c->backoff_us *= 2;
+            }
+            client_transmit(c);
+        }
+    });
+}
+
+static void client_receive(sim_client_t *c, const uint8_t *m, size_t len)
+{
+    uint8_t type = 0;
+    bool rapid = false;
+    uint32_t server_id = 0;
+    for (size_t i = DHCP_OPTIONS_OFS; i + 1 < len && m[i] != OPT_END;) {
+        if (m[i] == OPT_PAD) {
+            i++;
+            continue;
+        }
+        const uint8_t *v = m + i + 2;
+        if (m[i] == OPT_MSG_TYPE) {
+            type = v[0];
+        } else if (m[i] == OPT_SERVER_ID) {
+            memcpy(&server_id, v, 4);
+        } else if (m[i] == OPT_RAPID_COMMIT) {
+            rapid = true;
+        }
+        i += 2 + m[i + 1];
+    }
+    uint32_t yiaddr;
+    memcpy(&yiaddr, m + 16, 4);
+
+    if (type == DHCPOFFER && c->state == CLIENT_SELECTING) {
+        c->state = CLIENT_REQUESTING;
+        c->offered_ip = yiaddr;
+        c->server_id = server_id;
+        c->backoff_us = RETRANSMIT_US;
+        client_transmit(c);
+    } else if (type == DHCPACK && (c->state == CLIENT_REQUESTING || (c->state == CLIENT_SELECTING && rapid))) {
+        c->state = CLIENT_BOUND;
+        c->ip = yiaddr;
+        c->bound_us = sim_now_us();
+        c->timer_gen++;
+    } else if (type == DHCPNAK && c->state == CLIENT_REQUESTING) {
+        c->state = CLIENT_SELECTING;
+        c->backoff_us = RETRANSMIT_US;
+        client_transmit(c);
+    }
+}
+
+static void clients_deliver(const frame_t &frame)
+{
+    const uint8_t *m = frame->data();
+    if (frame->size() < DHCP_OPTIONS_OFS + 3 || m[0] != 2) {
+        return;
+    }
+    uint32_t xid = (uint32_t)m[4] << 24 | (uint32_t)m[5] << 16 | (uint32_t)m[6] << 8 | m[7];
+    for (sim_client_t &c : clients) {
+        if (c.xid == xid && memcmp(c.mac, m + 28, 6) == 0) {
+            client_receive(&c, m, frame->size());
+        }
+    }
+}
+
+// ============================================================================
+// RUN
+// ============================================================================
+typedef struct {
+    int bound;
+    double mean_ms;
+    double max_ms;
+    double frames_per_client;
+    hotspot_dhcp_stats_t stats;
+} run_result_t;
+
+static run_result_t run(bool rapid_commit, int loss)
+{
+    hotspot_config_t config = HOTSPOT_CONFIG_DEFAULT();
+    config.dhcp_rapid_commit = rapid_commit;
+    CHECK(napt_dhcps_start((esp_netif_t *)&ap_netif, &config) == ESP_OK);
+
+    events.reset(new sim_events());
+    rng_state = 12345;
+    loss_percent = loss;
+    frames_on_air = 0;
+    int64_t start_us = sim_now_us();
+    for (int i = 0; i < CLIENTS; i++) {
+        sim_client_t *c = &clients[i];
+        memset(c, 0, sizeof(*c));
+        uint8_t mac[6] = { 0x02, 0x00, 0x00, 0x00, (uint8_t)(rapid_commit ? 1 : 2), (uint8_t)(loss * 16 + i) };
+        memcpy(c->mac, mac, 6);
+        c->xid = rng();
+        c->join_us = start_us + (int64_t)(rng() % JOIN_SPREAD_US);
+        c->backoff_us = RETRANSMIT_US;
+        events->at(c->join_us, [c] { client_transmit(c); });
+    }
+    events->run_until(start_us + RUN_US);
+
+    run_result_t r = {};
+    double total_ms = 0;
+    for (const sim_client_t &c : clients) {
+        if (c.state != CLIENT_BOUND) {
+            continue;
+        }
+        double ms = (c.bound_us - c.join_us) / 1000.0;
+        total_ms += ms;
+        r.max_ms = ms > r.max_ms ? ms : r.max_ms;
+        r.bound++;
+    }
+    r.mean_ms = r.bound != 0 ? total_ms / r.bound : 0;
+    r.frames_per_client = (double)frames_on_air / CLIENTS;
+    hotspot_dhcp_get_stats(&r.stats);
+
+    // Every bound client holds the address it was given, and no two share one
+    hotspot_dhcp_lease_t leases_out[HOTSPOT_DHCP_MAX_LEASES];
+    size_t count = 0;
+    hotspot_dhcp_get_leases(leases_out, HOTSPOT_DHCP_MAX_LEASES, &count);
+    for (const sim_client_t &c : clients) {
+        uint32_t ip = 0;
+        CHECK(napt_dhcps_lease_ip(c.mac, &ip) && ip == c.ip);
+        for (const sim_client_t &o : clients) {
+            CHECK(&o == &c || o.ip != c.ip);
+        }
+    }
+    CHECK(count == CLIENTS);
+
+    // Next run starts from an empty table
+    napt_dhcps_stop();
+    leases_clear();
+    memset(&dhcps_stats, 0, sizeof(dhcps_stats));
+    events.reset();
+    return r;
+}
+
+int main(void)
+{
+    printf("                    loss  bound  mean ms  max ms  frames/client  rapid commits\n");
+    for (int loss : { 0, 10 }) {
+        run_result_t four = run(false, loss);
+        run_result_t rapid = run(true, loss);
+        printf("four messages       %3d%%  %5d  %7.1f  %6.0f  %13.1f  %13lu\n", loss, four.bound, four.mean_ms,
+               four.max_ms, four.frames_per_client, (unsigned long)four.stats.rapid_commits);
+        printf("Rapid Commit        %3d%%  %5d  %7.1f  %6.0f  %13.1f  %13lu\n", loss, rapid.bound, rapid.mean_ms,
+               rapid.max_ms, rapid.frames_per_client, (unsigned long)rapid.stats.rapid_commits);
+
+        CHECK(four.bound == CLIENTS && rapid.bound == CLIENTS);
+        CHECK(four.stats.rapid_commits == 0 && four.stats.offers >= CLIENTS);
+        CHECK(rapid.stats.rapid_commits >= CLIENTS && rapid.stats.offers == 0 && rapid.stats.requests == 0);
+        CHECK_MSG(rapid.mean_ms <= 0.6 * four.mean_ms, "%d%% loss: mean %.1f ms with Rapid Commit, %.1f ms without",
+                  loss, rapid.mean_ms, four.mean_ms);
+        if (loss == 0) {
+            // Air time only: two frames, then four
+            CHECK(rapid.max_ms <= 2 * AIR_MAX_US / 1000 && four.max_ms <= 4 * AIR_MAX_US / 1000);
+        }
+    }
+    CHECK(sim_pbufs() == 0);
+    return TEST_RESULT();
+}
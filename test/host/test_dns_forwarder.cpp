@@ -0,0 +1,144 @@
+/***************************************************************************************
+ *  File        : test_dns_forwarder.cpp
+ *  Description : Enable/disable stress test of the DNS forwarder wake and join path
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - Toggles the hotspot through the public API with queries in flight and
+ *     checks that every disable returns quickly (the forwarder is woken,
+ *     not left to its select() timeout), that the task is gone and that no
+ *     socket leaks.
+ *   - Then holds the task past the stop's wait: disable and the next enable
+ *     must fail rather than hand its sockets to a new task.
+ *   - Built with HOTSPOT_DNS_PORT=0, so the forwarder listens on an
+ *     ephemeral port and the test needs no privileges.
+ ***************************************************************************************/
+
+#include "napt_interface.cpp"
+#include "host_port.h"
+#include "host_test.h"
+
+#define TOGGLES 2000
+#define MAX_DISABLE_US 100000       // The old sleep-and-close took 200 ms to 1.2 s
+#define STALL_MS 4000               // Outlasts two 1.5 s stop waits, not three
+
+extern volatile uint32_t host_ntp_tick_stall_ms;
+
+static uint16_t listen_port(void)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if (getsockname(dns_listen_socket, (struct sockaddr *)&addr, &len) < 0) {
+        return 0;
+    }
+    return ntohs(addr.sin_port);
+}
+
+// A minimal A query for "example.com"; nothing answers it upstream, so it
+// stays pending until the forwarder is stopped
+static void send_query(int sock, uint16_t port, uint16_t id)
+{
+    static const uint8_t question[] = {
+        7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0, 0, 1, 0, 1,
+    };
+    uint8_t msg[NAPT_DNS_HEADER_LEN + sizeof(question)] = {};
+    msg[0] = (uint8_t)(id >> 8);
+    msg[1] = (uint8_t)id;
+    msg[2] = 0x01;      // RD
+    msg[5] = 1;         // QDCOUNT
+    memcpy(msg + NAPT_DNS_HEADER_LEN, question, sizeof(question));
+
+    struct sockaddr_in to = {};
+    to.sin_family = AF_INET;
+    to.sin_port = htons(port);
+    to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sendto(sock, msg, sizeof(msg), 0, (struct sockaddr *)&to, sizeof(to));
+}
+
+int main(void)
+{
+    host_wifi_params_t wifi = {};
+    wifi.ap_start_delay_ms = 0;
+    wifi.sta_ip = htonl(0x0a000002);            // 10.0.0.2
+    wifi.sta_dns = htonl(INADDR_LOOPBACK);
+    wifi.sta_channel = 6;
+    host_wifi_reset(&wifi);
+
+    int client = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    CHECK(client >= 0);
+
+    // One cycle first, so lazily created objects (control task, mutexes,
+    // event group) are not mistaken for leaks
+    CHECK(hotspot_enable(NULL, NULL) == ESP_OK);
+    CHECK(hotspot_disable() == ESP_OK);
+    int fds_before = host_open_fds();
+    int tasks_before = host_tasks_running();
+
+    int toggles = test_scaled(TOGGLES);
+    int64_t worst_us = 0;
+    int64_t total_us = 0;
+    for (int i = 0; i < toggles; i++) {
+        CHECK(hotspot_enable(NULL, NULL) == ESP_OK);
+        CHECK(hotspot_get_state() == HOTSPOT_STATE_RUNNING);
+        CHECK(dns_forwarder_task_handle != NULL);
+
+        // Every other cycle, leave queries pending; every fourth, stop
+        // straight away, racing the task's first select()
+        if (i % 2 == 0) {
+            uint16_t port = listen_port();
+            CHECK(port != 0);
+            for (int q = 0; q < 3; q++) {
+                send_query(client, port, (uint16_t)(i * 4 + q));
+            }
+        }
+        if (i % 4 != 3) {
+            vTaskDelay(1);
+        }
+
+        int64_t start_us = esp_timer_get_time();
+        CHECK(hotspot_disable() == ESP_OK);
+        int64_t took_us = esp_timer_get_time() - start_us;
+        total_us += took_us;
+        if (took_us > worst_us) {
+            worst_us = took_us;
+        }
+
+        CHECK(hotspot_get_state() == HOTSPOT_STATE_STOPPED);
+        CHECK(dns_forwarder_task_handle == NULL);
+        CHECK(dns_listen_socket == -1 && dns_upstream_socket == -1 && dns_wake_socket == -1);
+        if (test_failures > 10) {
+            break;
+        }
+    }
+
+    // A forwarder that does not exit in time: the disable fails and keeps the
+    // task's sockets, an enable while it is still there fails too, and once
+    // it has gone the next enable works
+    CHECK(hotspot_enable(NULL, NULL) == ESP_OK);
+    host_ntp_tick_stall_ms = STALL_MS;
+    send_query(client, listen_port(), 0xffff);
+    vTaskDelay(pdMS_TO_TICKS(50));
+    host_ntp_tick_stall_ms = 0;
+    CHECK(hotspot_disable() == ESP_ERR_TIMEOUT);
+    CHECK(dns_forwarder_task_handle != NULL && dns_listen_socket >= 0);
+    CHECK(hotspot_enable(NULL, NULL) == ESP_ERR_INVALID_STATE);
+    CHECK(dns_forwarder_task_handle != NULL);
+    CHECK(hotspot_enable(NULL, NULL) == ESP_OK);
+    CHECK(hotspot_disable() == ESP_OK);
+    CHECK(dns_forwarder_task_handle == NULL);
+
+    // The forwarder gives its done semaphore as its last action; let the
+    // thread itself finish unwinding
+    vTaskDelay(20);
+    printf("%d toggles, disable avg %lld us, worst %lld us\n", toggles, (long long)(total_us / toggles),
+           (long long)worst_us);
+    CHECK_MSG(worst_us < MAX_DISABLE_US, "worst disable %lld us", (long long)worst_us);
+    CHECK_MSG(host_open_fds() == fds_before, "%d fds open, %d before", host_open_fds(), fds_before);
+    CHECK_MSG(host_tasks_running() == tasks_before, "%d tasks, %d before", host_tasks_running(), tasks_before);
+
+    close(client);
+    return TEST_RESULT();
+}
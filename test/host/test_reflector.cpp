@@ -0,0 +1,416 @@
+/***************************************************************************************
+ *  File        : test_reflector.cpp
+ *  Description : Discovery reflector against an mDNS / SSDP responder on loopback multicast
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - The STA address is 127.0.0.1, so the reflector's LAN queries go out
+ *     as real multicast on lo. A responder thread joined to both groups
+ *     answers by unicast, as LAN devices answer legacy queries.
+ *   - Client queries are fed to napt_reflector_on_packet() as the AP hook
+ *     would; the client is a plain socket on 127.0.0.1 that receives the
+ *     relayed answers. It is not on 5353 (there is no AP netif for the
+ *     5353 reply socket), so every answer takes the legacy path.
+ *   - Exits with 77 (skipped) where lo can't carry multicast.
+ ***************************************************************************************/
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+#include "napt_reflector.cpp"
+#include "esp_timer.h"
+#include "host_port.h"
+#include "host_test.h"
+
+#define SSDP_ALL_DEVICES 6          // Responses the responder sends to ssdp:all
+#define REPLY_WAIT_MS 300           // Client waits this long after the last answer
+#define SKIPPED 77
+
+// ============================================================================
+// STAND-INS FOR THE REST OF THE COMPONENT
+// ============================================================================
+// Uptime well past boot, as when a hotspot is enabled: the rate buckets
+// start out full
+uint32_t napt_now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000) + 60000;
+}
+
+void napt_ctl_lock(void)
+{
+}
+
+void napt_ctl_unlock(void)
+{
+}
+
+bool napt_fwd_active(void)
+{
+    return true;
+}
+
+// Single-segment RAM pbufs; references are taken in the test thread and
+// dropped in the reflector task
+static std::atomic<int> pbufs_live(0);
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, uint16_t len, pbuf_type type)
+{
+    struct pbuf *p = (struct pbuf *)calloc(1, sizeof(struct pbuf) + len);
+    p->payload = p + 1;
+    p->tot_len = len;
+    p->len = len;
+    p->ref = 1;
+    pbufs_live++;
+    return p;
+}
+
+void pbuf_ref(struct pbuf *p)
+{
+    __atomic_add_fetch(&p->ref, 1, __ATOMIC_SEQ_CST);
+}
+
+uint8_t pbuf_free(struct pbuf *p)
+{
+    if (p == NULL || __atomic_sub_fetch(&p->ref, 1, __ATOMIC_SEQ_CST) > 0) {
+        return 0;
+    }
+    free(p);
+    pbufs_live--;
+    return 1;
+}
+
+// ============================================================================
+// LAN RESPONDER
+// ============================================================================
+static std::atomic<bool> responder_run(true);
+static std::atomic<int> responder_queries[HOTSPOT_REFLECT_PROTO_MAX];
+static std::atomic<uint16_t> responder_last_id(0);
+
+static int group_socket(uint16_t port, uint32_t group)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(group);
+    struct ip_mreq mreq = {};
+    mreq.imr_multiaddr.s_addr = htonl(group);
+    mreq.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// Legacy unicast answer: the query's ID and question, one A record, TTL 10
+static int mdns_answer(const uint8_t *q, int len, uint8_t *out)
+{
+    static const uint8_t answer[] = {
+        0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x04, 127, 0, 0, 1,
+    };
+    memcpy(out, q, len);
+    out[2] = 0x84;      // QR, AA
+    out[3] = 0;
+    out[7] = 1;         // ANCOUNT
+    memcpy(out + len, answer, sizeof(answer));
+    return len + (int)sizeof(answer);
+}
+
+static int ssdp_answer(const char *st, int device, char *out, size_t out_len)
+{
+    return snprintf(out, out_len,
+                    "HTTP/1.1 200 OK\r\nCACHE-CONTROL: max-age=1800\r\nST: %s\r\n"
+                    "USN: uuid:device-%d::%s\r\nLOCATION: http://127.0.0.1:8080/%d.xml\r\n\r\n",
+                    st, device, st, device);
+}
+
+static void responder(int mdns, int ssdp)
+{
+    uint8_t buf[1500];
+    char out[512];
+    while (responder_run) {
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(mdns, &fds);
+        FD_SET(ssdp, &fds);
+        struct timeval tv = { 0, 20000 };
+        if (select((mdns > ssdp ? mdns : ssdp) + 1, &fds, NULL, NULL, &tv) <= 0) {
+            continue;
+        }
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        if (FD_ISSET(mdns, &fds)) {
+            int n = recvfrom(mdns, buf, sizeof(buf) - 32, 0, (struct sockaddr *)&from, &from_len);
+            if (n >= NAPT_DNS_HEADER_LEN && !(buf[2] & 0x80)) {
+                responder_queries[HOTSPOT_REFLECT_MDNS]++;
+                responder_last_id = (uint16_t)(buf[0] << 8 | buf[1]);
+                int len = mdns_answer(buf, n, (uint8_t *)out);
+                sendto(mdns, out, len, 0, (struct sockaddr *)&from, from_len);
+            }
+        }
+        from_len = sizeof(from);
+        if (FD_ISSET(ssdp, &fds)) {
+            int n = recvfrom(ssdp, buf, sizeof(buf) - 1, 0, (struct sockaddr *)&from, &from_len);
+            char st[128];
+            if (n > 0 && ssdp_header(buf, n, "ST", st, sizeof(st))) {
+                responder_queries[HOTSPOT_REFLECT_SSDP]++;
+                bool all = strcasecmp(st, "ssdp:all") == 0;
+                for (int d = 0; d < (all ? SSDP_ALL_DEVICES : 1); d++) {
+                    char device_st[64];
+                    snprintf(device_st, sizeof(device_st), "urn:test:device:Kind%d:1", d);
+                    int len = ssdp_answer(all ? device_st : st, d, out, sizeof(out));
+                    sendto(ssdp, out, len, 0, (struct sockaddr *)&from, from_len);
+                }
+            }
+        }
+    }
+    close(mdns);
+    close(ssdp);
+}
+
+// ============================================================================
+// CLIENT
+// ============================================================================
+static int client_sock = -1;
+static uint16_t client_port = 0;
+
+// A client frame as the AP input hook sees it, multicast to the protocol's group
+static void client_send(uint8_t proto, const void *payload, uint16_t len)
+{
+    uint16_t frame_len = 14 + 20 + 8 + len;
+    struct pbuf *p = pbuf_alloc(PBUF_RAW, frame_len, PBUF_RAM);
+    uint8_t *eth = (uint8_t *)p->payload;
+    uint8_t *ip = eth + 14;
+    uint8_t *udp = ip + 20;
+    eth[0] = 0x01;
+    eth[12] = 0x08;
+    ip[0] = 0x45;
+    ip[9] = IP_PROTO_UDP;
+    memcpy(udp + 8, payload, len);
+
+    napt_pkt_t pkt = {};
+    pkt.p = p;
+    pkt.eth = eth;
+    pkt.ip = ip;
+    pkt.l4 = udp;
+    pkt.frame_len = frame_len;
+    pkt.ether_type = 0x0800;
+    pkt.ip_hlen = 20;
+    pkt.proto = IP_PROTO_UDP;
+    pkt.src = htonl(INADDR_LOOPBACK);
+    pkt.dst = htonl(proto == HOTSPOT_REFLECT_MDNS ? MDNS_GROUP : SSDP_GROUP);
+    pkt.sport = client_port;
+    pkt.dport = proto == HOTSPOT_REFLECT_MDNS ? MDNS_PORT : SSDP_PORT;
+    pkt.payload_len = len;
+    pkt.multicast = true;
+    napt_reflector_on_packet(&pkt);
+    pbuf_free(p);       // The driver's reference
+}
+
+static void mdns_query(const char *host, uint16_t id)
+{
+    uint8_t q[128] = {};
+    q[0] = (uint8_t)(id >> 8);
+    q[1] = (uint8_t)id;
+    q[5] = 1;       // QDCOUNT
+    int off = NAPT_DNS_HEADER_LEN;
+    for (const char *label = host; *label;) {
+        const char *dot = strchr(label, '.');
+        int n = dot != NULL ? (int)(dot - label) : (int)strlen(label);
+        q[off++] = (uint8_t)n;
+        memcpy(q + off, label, n);
+        off += n;
+        label += n + (dot != NULL ? 1 : 0);
+    }
+    q[off++] = 0;
+    q[off + 1] = 1;     // A
+    q[off + 3] = 1;     // IN
+    client_send(HOTSPOT_REFLECT_MDNS, q, (uint16_t)(off + 4));
+}
+
+static void ssdp_search(const char *st)
+{
+    char msg[256];
+    int len = snprintf(msg, sizeof(msg),
+                       "M-SEARCH * HTTP/1.1\r\nHOST: 239.255.255.250:1900\r\nMAN: \"ssdp:discover\"\r\n"
+                       "MX: 1\r\nST: %s\r\n\r\n", st);
+    client_send(HOTSPOT_REFLECT_SSDP, msg, (uint16_t)len);
+}
+
+// Everything relayed to the client until it has been quiet for REPLY_WAIT_MS
+static std::vector<std::string> client_receive(void)
+{
+    std::vector<std::string> got;
+    char buf[1500];
+    for (;;) {
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(client_sock, &fds);
+        struct timeval tv = { 0, REPLY_WAIT_MS * 1000 };
+        if (select(client_sock + 1, &fds, NULL, NULL, &tv) <= 0) {
+            return got;
+        }
+        int n = recv(client_sock, buf, sizeof(buf), 0);
+        if (n > 0) {
+            got.push_back(std::string(buf, n));
+        }
+    }
+}
+
+static uint16_t msg_id(const std::string &m)
+{
+    return (uint16_t)((uint8_t)m[0] << 8 | (uint8_t)m[1]);
+}
+
+static hotspot_reflector_proto_stats_t stats_of(uint8_t proto)
+{
+    hotspot_reflector_stats_t s;
+    hotspot_reflector_get_stats(&s);
+    return s.proto[proto];
+}
+
+// ============================================================================
+// TESTS
+// ============================================================================
+static void test_mdns_relay_and_cache(void)
+{
+    const uint8_t MDNS = HOTSPOT_REFLECT_MDNS;
+
+    // Forwarded as a legacy unicast query with an ID of our own, answered
+    // to the client by unicast with the client's ID put back
+    mdns_query("printer.local", 0x1234);
+    std::vector<std::string> got = client_receive();
+    CHECK(got.size() == 1);
+    CHECK(responder_queries[MDNS] == 1);
+    CHECK(responder_last_id != 0x1234 && (responder_last_id & 1));
+    if (got.size() == 1) {
+        CHECK(msg_id(got[0]) == 0x1234);
+        CHECK((uint8_t)got[0][2] & 0x80);
+        CHECK((uint8_t)got[0][7] == 1);
+    }
+    hotspot_reflector_proto_stats_t s = stats_of(MDNS);
+    CHECK(s.forwarded == 1 && s.responses == 1 && s.replies == 1 && s.cache_answered == 0);
+
+    // The repeat is answered from the cache, with the new ID
+    mdns_query("printer.local", 0x5678);
+    got = client_receive();
+    CHECK(got.size() == 1 && msg_id(got[0]) == 0x5678);
+    CHECK(responder_queries[MDNS] == 1);
+    s = stats_of(MDNS);
+    CHECK(s.forwarded == 1 && s.cache_answered == 1 && s.replies == 2);
+
+    // One question, one cached answer
+    hotspot_reflector_stats_t all;
+    hotspot_reflector_get_stats(&all);
+    CHECK(all.cache_entries == 1);
+}
+
+static void test_ssdp_reply_limit(void)
+{
+    const uint8_t SSDP = HOTSPOT_REFLECT_SSDP;
+
+    // replies_per_s 1: a burst of two answers, the rest of ssdp:all dropped
+    ssdp_search("ssdp:all");
+    std::vector<std::string> got = client_receive();
+    hotspot_reflector_proto_stats_t s = stats_of(SSDP);
+    printf("ssdp:all: %d responses, %u relayed, %u reply-limited\n", SSDP_ALL_DEVICES, (unsigned)s.replies,
+           (unsigned)s.reply_limited);
+    CHECK(responder_queries[SSDP] == 1);
+    CHECK(s.forwarded == 1 && s.responses == SSDP_ALL_DEVICES);
+    CHECK(s.replies >= 2 && s.replies <= 3);
+    CHECK(s.replies + s.reply_limited == SSDP_ALL_DEVICES);
+    CHECK(got.size() == s.replies);
+    for (const std::string &m : got) {
+        CHECK(m.compare(0, 12, "HTTP/1.1 200") == 0);
+    }
+
+    // mDNS answers have their own bucket
+    CHECK(stats_of(HOTSPOT_REFLECT_MDNS).reply_limited == 0);
+}
+
+static void test_query_limit(void)
+{
+    const uint8_t MDNS = HOTSPOT_REFLECT_MDNS;
+    const uint8_t SSDP = HOTSPOT_REFLECT_SSDP;
+    hotspot_reflector_proto_stats_t before = stats_of(MDNS);
+    int lan_before = responder_queries[MDNS];
+
+    // queries_per_s 2: a burst of four (one already spent) gets through
+    for (int i = 0; i < 10; i++) {
+        char host[32];
+        snprintf(host, sizeof(host), "host-%d.local", i);
+        mdns_query(host, (uint16_t)(0x100 + i));
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    client_receive();
+    hotspot_reflector_proto_stats_t s = stats_of(MDNS);
+    uint32_t forwarded = s.forwarded - before.forwarded;
+    uint32_t limited = s.query_limited - before.query_limited;
+    printf("10 mDNS queries: %u forwarded, %u query-limited\n", (unsigned)forwarded, (unsigned)limited);
+    CHECK(forwarded >= 3 && forwarded <= 4);
+    CHECK(forwarded + limited == 10);
+    CHECK(responder_queries[MDNS] - lan_before == (int)forwarded);
+
+    // SSDP's bucket is untouched by that
+    uint32_t ssdp_before = stats_of(SSDP).forwarded;
+    ssdp_search("urn:schemas-upnp-org:device:MediaRenderer:1");
+    client_receive();
+    CHECK(stats_of(SSDP).forwarded == ssdp_before + 1);
+    CHECK(stats_of(SSDP).query_limited == 0);
+}
+
+int main(void)
+{
+    host_wifi_params_t wifi = {};
+    wifi.sta_ip = htonl(INADDR_LOOPBACK);
+    host_wifi_reset(&wifi);
+
+    int mdns = group_socket(MDNS_PORT, MDNS_GROUP);
+    int ssdp = group_socket(SSDP_PORT, SSDP_GROUP);
+    if (mdns < 0 || ssdp < 0) {
+        printf("SKIP: no multicast on lo (errno %d)\n", errno);
+        return SKIPPED;
+    }
+    std::thread(responder, mdns, ssdp).detach();
+
+    client_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    CHECK(bind(client_sock, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    CHECK(getsockname(client_sock, (struct sockaddr *)&addr, &addr_len) == 0);
+    client_port = ntohs(addr.sin_port);
+
+    int fds_before = host_open_fds();
+    hotspot_reflector_config_t config = HOTSPOT_REFLECTOR_CONFIG_DEFAULT();
+    config.enabled[HOTSPOT_REFLECT_MDNS] = true;
+    config.enabled[HOTSPOT_REFLECT_SSDP] = true;
+    config.replies_per_s[HOTSPOT_REFLECT_SSDP] = 1;
+    CHECK(hotspot_reflector_configure(&config) == ESP_OK);
+    CHECK(reflector_task_handle != NULL);
+
+    test_mdns_relay_and_cache();
+    test_ssdp_reply_limit();
+    test_query_limit();
+
+    // Stopping releases every queued frame and closes the task's sockets
+    config.enabled[HOTSPOT_REFLECT_MDNS] = false;
+    config.enabled[HOTSPOT_REFLECT_SSDP] = false;
+    CHECK(hotspot_reflector_configure(&config) == ESP_OK);
+    CHECK(reflector_task_handle == NULL);
+    CHECK_MSG(pbufs_live == 0, "%d pbufs live", pbufs_live.load());
+    CHECK_MSG(host_open_fds() == fds_before, "%d fds open, %d before", host_open_fds(), fds_before);
+
+    responder_run = false;
+    close(client_sock);
+    return TEST_RESULT();
+}
@@ -0,0 +1,173 @@
+/***************************************************************************************
+ *  File        : test_wifi_profile.cpp
+ *  Description : Wi-Fi profile table, apply and restore against a fake radio
+ *  Author      : Noah Clark
+ *  Created     : 2026-02-01
+ *--------------------------------------------------------------------------------------
+ *  Part of the QC Smartwatch Firmware
+ *--------------------------------------------------------------------------------------
+ *  Notes:
+ *   - The expected settings are the README's profile table, row by row.
+ *   - The radio is a handful of variables behind the esp_wifi getters and
+ *     setters the profiles use; a setter can be made to fail.
+ ***************************************************************************************/
+
+#include <string.h>
+#include "napt_wifi_profile.cpp"
+#include "host_test.h"
+
+#define PROTO_BGN (WIFI_PROTOCOL_11B | WIFI_PROTOCOL_11G | WIFI_PROTOCOL_11N)
+#define PROTO_GN (WIFI_PROTOCOL_11G | WIFI_PROTOCOL_11N)
+
+// ============================================================================
+// FAKE RADIO
+// ============================================================================
+typedef struct {
+    wifi_ps_type_t ps;
+    wifi_bandwidth_t sta_bw;
+    uint8_t ap_protocol;
+} radio_t;
+
+static radio_t radio;
+static int radio_writes = 0;
+static bool fail_ps = false;
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t ps)
+{
+    if (fail_ps) {
+        return ESP_FAIL;
+    }
+    radio.ps = ps;
+    radio_writes++;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_ps(wifi_ps_type_t *ps)
+{
+    *ps = radio.ps;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_bandwidth(wifi_interface_t iface, wifi_bandwidth_t bw)
+{
+    CHECK(iface == WIFI_IF_STA);
+    radio.sta_bw = bw;
+    radio_writes++;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_bandwidth(wifi_interface_t iface, wifi_bandwidth_t *bw)
+{
+    *bw = radio.sta_bw;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_protocol(wifi_interface_t iface, uint8_t protocol)
+{
+    CHECK(iface == WIFI_IF_AP);
+    radio.ap_protocol = protocol;
+    radio_writes++;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_protocol(wifi_interface_t iface, uint8_t *protocol)
+{
+    *protocol = radio.ap_protocol;
+    return ESP_OK;
+}
+
+// What the application set up before enabling. The AP protocol set matches
+// no profile, so a restore cannot pass by coincidence.
+static const radio_t app_radio = { WIFI_PS_MIN_MODEM, WIFI_BW_HT20, PROTO_GN | WIFI_PROTOCOL_LR };
+
+static bool radio_is(const radio_t *r)
+{
+    return radio.ps == r->ps && radio.sta_bw == r->sta_bw && radio.ap_protocol == r->ap_protocol;
+}
+
+// ============================================================================
+// TESTS
+// ============================================================================
+typedef struct {
+    hotspot_wifi_profile_t profile;
+    radio_t radio;
+    bool ap_ht20;
+    uint8_t dtim;
+} expected_t;
+
+static const expected_t table[] = {
+    { HOTSPOT_WIFI_PROFILE_MAX_THROUGHPUT, { WIFI_PS_NONE, WIFI_BW_HT40, PROTO_GN }, false, 1 },
+    { HOTSPOT_WIFI_PROFILE_LOW_LATENCY, { WIFI_PS_NONE, WIFI_BW_HT20, PROTO_GN }, true, 1 },
+    { HOTSPOT_WIFI_PROFILE_LOW_POWER, { WIFI_PS_MAX_MODEM, WIFI_BW_HT20, PROTO_BGN }, true, 3 },
+};
+
+static void test_table(void)
+{
+    for (const expected_t &e : table) {
+        radio = app_radio;
+        napt_profile_apply(e.profile);
+        CHECK_MSG(radio_is(&e.radio), "%s: ps %d, STA bw %d, AP protocol 0x%x", napt_profile_name(e.profile),
+                  radio.ps, radio.sta_bw, radio.ap_protocol);
+        CHECK(napt_profile_ap_ht20(e.profile) == e.ap_ht20);
+        CHECK(napt_profile_dtim(e.profile) == e.dtim);
+
+        napt_profile_restore();
+        CHECK_MSG(radio_is(&app_radio), "%s not restored", napt_profile_name(e.profile));
+    }
+}
+
+static void test_default(void)
+{
+    // Leaves the driver alone, and so has nothing to restore
+    radio = app_radio;
+    radio_writes = 0;
+    napt_profile_apply(HOTSPOT_WIFI_PROFILE_DEFAULT);
+    napt_profile_restore();
+    CHECK(radio_writes == 0 && radio_is(&app_radio));
+    CHECK(!napt_profile_ap_ht20(HOTSPOT_WIFI_PROFILE_DEFAULT));
+    CHECK(napt_profile_dtim(HOTSPOT_WIFI_PROFILE_DEFAULT) == 1);
+
+    // Out-of-range values read as the default
+    hotspot_wifi_profile_t bogus = (hotspot_wifi_profile_t)42;
+    CHECK(strcmp(napt_profile_name(bogus), "default") == 0);
+    CHECK(napt_profile_dtim(bogus) == 1 && !napt_profile_ap_ht20(bogus));
+}
+
+static void test_reapply(void)
+{
+    // A profile change while enabled restores first, so the application's
+    // settings are the ones put back on disable
+    radio = app_radio;
+    napt_profile_apply(HOTSPOT_WIFI_PROFILE_LOW_POWER);
+    napt_profile_restore();
+    napt_profile_apply(HOTSPOT_WIFI_PROFILE_MAX_THROUGHPUT);
+    napt_profile_restore();
+    CHECK(radio_is(&app_radio));
+
+    // Two applies without a restore keep the first saved state
+    napt_profile_apply(HOTSPOT_WIFI_PROFILE_LOW_POWER);
+    napt_profile_apply(HOTSPOT_WIFI_PROFILE_LOW_LATENCY);
+    napt_profile_restore();
+    CHECK(radio_is(&app_radio));
+}
+
+static void test_failed_setting(void)
+{
+    // A setting the driver refuses is skipped, the others still apply
+    radio = app_radio;
+    fail_ps = true;
+    napt_profile_apply(HOTSPOT_WIFI_PROFILE_MAX_THROUGHPUT);
+    CHECK(radio.ps == app_radio.ps && radio.sta_bw == WIFI_BW_HT40 && radio.ap_protocol == PROTO_GN);
+    fail_ps = false;
+    napt_profile_restore();
+    CHECK(radio_is(&app_radio));
+}
+
+int main(void)
+{
+    test_table();
+    test_default();
+    test_reapply();
+    test_failed_setting();
+    return TEST_RESULT();
+}